@@ -28,12 +28,14 @@ void DefinitionWidget::setWords(Dictionary *d, const std::vector<int> &words)
     if (dict != nullptr)
     {
         disconnect(dict, &Dictionary::entryRemoved, this, &DefinitionWidget::dictEntryRemoved);
+        disconnect(dict, &Dictionary::entriesCompacted, this, &DefinitionWidget::dictEntriesCompacted);
         disconnect(dict, &Dictionary::entryChanged, this, &DefinitionWidget::dictEntryChanged);
     }
     dict = d;
     if (dict != nullptr)
     {
         connect(dict, &Dictionary::entryRemoved, this, &DefinitionWidget::dictEntryRemoved);
+        connect(dict, &Dictionary::entriesCompacted, this, &DefinitionWidget::dictEntriesCompacted);
         connect(dict, &Dictionary::entryChanged, this, &DefinitionWidget::dictEntryChanged);
     }
     list = words;
@@ -92,30 +94,23 @@ void DefinitionWidget::on_defResetButton_clicked(bool)
 void DefinitionWidget::dictEntryRemoved(int windex)
 {
     int pos = indexpos(windex);
-    if (pos == tosigned(list.size()))
+    if (pos == tosigned(list.size()) || list[pos] != windex)
         return;
 
-    if (list.size() == 1 && list[pos] != windex)
-    {
-        --list.front();
-        return;
-    }
-
-    if (list[pos] == windex)
-    {
-        list.erase(list.begin() + pos);
-        data.erase(data.begin() + pos);
-    }
-
-    while (pos != tosigned(list.size()))
-    {
-        --list[pos];
-        ++pos;
-    }
+    list.erase(list.begin() + pos);
+    data.erase(data.begin() + pos);
 
     update();
 }
 
+void DefinitionWidget::dictEntriesCompacted(const std::vector<int> &changes)
+{
+    // Removed words were taken out of the list in dictEntryRemoved(). The order of the rest
+    // doesn't change.
+    for (int &windex : list)
+        windex = changes[windex];
+}
+
 void DefinitionWidget::dictEntryChanged(int windex, bool /*studydef*/)
 {
     int pos = indexpos(windex);
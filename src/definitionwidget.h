@@ -26,6 +26,7 @@ protected:
     virtual bool event(QEvent *e) override;
 protected slots:
     void dictEntryRemoved(int windex);
+    void dictEntriesCompacted(const std::vector<int> &changes);
     void dictEntryChanged(int windex, bool studydef);
     void on_defEdit_textEdited(const QString &str);
     void on_defEdit_focusChanged(bool activated);
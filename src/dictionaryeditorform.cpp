@@ -255,6 +255,8 @@ void DictionaryEditorForm::on_delButton_clicked(bool /*checked*/)
     f.remove();
     f.setFileName(ZKanji::userFolder() + "/data/" + name + ".zkuser");
     f.remove();
+    f.setFileName(Dictionary::userDataJournalName(ZKanji::userFolder() + "/data/" + name + ".zkuser"));
+    f.remove();
 
     ZKanji::deleteDictionary(ZKanji::dictionaryPosition(ui->dictView->currentRow()));
 }
@@ -0,0 +1,349 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#include <QThreadPool>
+#include <QHash>
+#include <algorithm>
+#include "dictionarystats.h"
+#include "words.h"
+#include "kanji.h"
+#include "grammar_enums.h"
+
+#include "checked_cast.h"
+
+
+//-------------------------------------------------------------
+
+
+namespace
+{
+    // Adds d to the count of hash in counts, updating the number of unique hashes.
+    void countHash(std::unordered_map<quint64, int> &counts, quint64 hash, int d, int &unique)
+    {
+        int &cnt = counts[hash];
+        if (cnt == 0)
+            ++unique;
+        cnt += d;
+        if (cnt == 0)
+        {
+            counts.erase(hash);
+            --unique;
+        }
+    }
+
+    // Adds d to the item at every set bit of flags.
+    void countFlags(std::vector<int> &counts, uint flags, int d)
+    {
+        for (int ix = 0, siz = tosigned(counts.size()); flags != 0 && ix != siz; ++ix, flags >>= 1)
+            if ((flags & 1) != 0)
+                counts[ix] += d;
+    }
+
+    // Adds every item in src to the item at the same position in dest.
+    void addCounts(std::vector<int> &dest, const std::vector<int> &src)
+    {
+        if (dest.size() < src.size())
+            dest.resize(src.size(), 0);
+        for (int ix = 0, siz = tosigned(src.size()); ix != siz; ++ix)
+            dest[ix] += src[ix];
+    }
+}
+
+
+//-------------------------------------------------------------
+
+
+struct DictionaryStats::Work
+{
+    // Set when the computation should stop. Registered as a background search.
+    std::atomic<bool> cancel;
+    // Number of threads still running.
+    std::atomic<int> remaining;
+
+    // Number of words handled by each thread.
+    int partsize;
+    std::vector<Part> parts;
+    std::vector<WordRecord> records;
+};
+
+DictionaryStats* DictionaryStats::get(Dictionary *dict)
+{
+    DictionaryStats *stats = dict->findChild<DictionaryStats*>(QString(), Qt::FindDirectChildrenOnly);
+    if (stats == nullptr)
+        stats = new DictionaryStats(dict);
+    return stats;
+}
+
+DictionaryStats::DictionaryStats(Dictionary *dict) : base(dict), dict(dict), isready(false)
+{
+    connect(dict, &Dictionary::entryAdded, this, &DictionaryStats::entryAdded);
+    connect(dict, &Dictionary::entryChanged, this, &DictionaryStats::entryChanged);
+    connect(dict, &Dictionary::entryRemoved, this, &DictionaryStats::entryRemoved);
+    connect(dict, &Dictionary::entriesCompacted, this, &DictionaryStats::entriesCompacted);
+    connect(dict, &Dictionary::dictionaryReset, this, &DictionaryStats::dictionaryReset);
+}
+
+DictionaryStats::~DictionaryStats()
+{
+    cancel();
+}
+
+bool DictionaryStats::ready() const
+{
+    return isready;
+}
+
+const DictionaryStatData& DictionaryStats::data() const
+{
+    return stats.data;
+}
+
+void DictionaryStats::start()
+{
+    if (isready || work != nullptr)
+        return;
+
+    int cnt = dict->entryCount();
+    QThreadPool *pool = QThreadPool::globalInstance();
+
+    // Using more parts than threads evens out the work when some threads finish early.
+    int partcnt = std::max(1, std::min(pool->maxThreadCount() * 4, (cnt + 1023) / 1024));
+
+    std::shared_ptr<Work> w = std::make_shared<Work>();
+    w->cancel = false;
+    w->remaining = partcnt;
+    w->partsize = (cnt + partcnt - 1) / partcnt;
+    w->parts.resize(partcnt);
+    w->records.resize(cnt);
+    work = w;
+
+    ZKanji::beginBackgroundSearch(&w->cancel);
+
+    for (int ix = 0; ix != partcnt; ++ix)
+    {
+        pool->start([this, w, ix, cnt]() {
+            Part &p = w->parts[ix];
+            for (int iy = ix * w->partsize, last = std::min(cnt, iy + w->partsize); iy < last && !w->cancel; ++iy)
+            {
+                if (dict->isEntryRemoved(iy))
+                    continue;
+                makeRecord(iy, w->records[iy]);
+                addRecord(p, w->records[iy], true);
+            }
+
+            if (--w->remaining != 0)
+                return;
+
+            // The last thread to finish merges the results.
+            for (int iy = 1, siz = tosigned(w->parts.size()); iy != siz && !w->cancel; ++iy)
+                mergePart(w->parts[0], w->parts[iy]);
+
+            QMetaObject::invokeMethod(this, [this, w]() { finishWork(w); }, Qt::QueuedConnection);
+            ZKanji::endBackgroundSearch(&w->cancel);
+        });
+    }
+}
+
+void DictionaryStats::cancel()
+{
+    if (work == nullptr)
+        return;
+
+    ZKanji::stopBackgroundSearch(&work->cancel);
+    work.reset();
+}
+
+void DictionaryStats::entryAdded(int windex)
+{
+    if (work != nullptr)
+        work->cancel = true;
+    if (!isready)
+        return;
+
+    records.insert(records.begin() + windex, WordRecord());
+    makeRecord(windex, records[windex]);
+    addRecord(stats, records[windex], true);
+    updateKanji();
+
+    emit updated();
+}
+
+void DictionaryStats::entryChanged(int windex)
+{
+    if (work != nullptr)
+        work->cancel = true;
+    if (!isready)
+        return;
+
+    addRecord(stats, records[windex], false);
+    makeRecord(windex, records[windex]);
+    addRecord(stats, records[windex], true);
+
+    emit updated();
+}
+
+void DictionaryStats::entryRemoved(int windex)
+{
+    if (work != nullptr)
+        work->cancel = true;
+    if (!isready)
+        return;
+
+    // The record is kept until the dictionary is compacted, so the other words keep their
+    // position.
+    addRecord(stats, records[windex], false);
+    updateKanji();
+
+    emit updated();
+}
+
+void DictionaryStats::entriesCompacted(const std::vector<int> &changes)
+{
+    if (work != nullptr)
+        work->cancel = true;
+    if (!isready)
+        return;
+
+    for (int ix = 0, siz = tosigned(changes.size()); ix != siz; ++ix)
+        if (changes[ix] != -1 && changes[ix] != ix)
+            records[changes[ix]] = std::move(records[ix]);
+    records.resize(dict->entryCount());
+}
+
+void DictionaryStats::dictionaryReset()
+{
+    if (work != nullptr)
+        work->cancel = true;
+
+    isready = false;
+    stats = Part();
+    std::vector<WordRecord>().swap(records);
+}
+
+void DictionaryStats::makeRecord(int windex, WordRecord &r) const
+{
+    const WordEntry *e = dict->wordEntry(windex);
+
+    r.freq = e->freq;
+    r.defs.resize(e->defs.size());
+
+    quint64 hash = e->defs.size();
+    for (int ix = 0, siz = tosigned(e->defs.size()); ix != siz; ++ix)
+    {
+        const WordDefinition &def = e->defs[ix];
+        DefRecord &d = r.defs[ix];
+        d.hash = qHashBits(def.def.data(), def.def.size() * sizeof(QChar));
+        d.length = std::min(65535, def.def.size());
+        d.dialects = def.attrib.dialects;
+        d.types = def.attrib.types;
+        d.notes = def.attrib.notes;
+        d.fields = def.attrib.fields;
+
+        hash ^= d.hash + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    r.hash = hash;
+}
+
+void DictionaryStats::addRecord(Part &p, const WordRecord &r, bool add)
+{
+    DictionaryStatData &s = p.data;
+    int d = add ? 1 : -1;
+
+    if (s.types.empty())
+    {
+        s.types.resize((int)WordTypes::Count, 0);
+        s.notes.resize((int)WordNotes::Count, 0);
+        s.fields.resize((int)WordFields::Count, 0);
+        s.dialects.resize((int)WordDialects::Count, 0);
+        s.deflengths.resize(DictionaryStatData::DefLengthSteps, 0);
+    }
+
+    s.entries += d;
+    if (r.freq > ZKanji::popularFreqLimit)
+        s.popular += d;
+    else if (r.freq > ZKanji::mediumFreqLimit)
+        s.medium += d;
+    else
+        s.nofreq += d;
+
+    int fpos = r.freq / DictionaryStatData::FreqStep;
+    if (tosigned(s.freqhist.size()) <= fpos)
+        s.freqhist.resize(fpos + 1, 0);
+    s.freqhist[fpos] += d;
+
+    countHash(p.entryhashes, r.hash, d, s.uniqueentries);
+
+    for (const DefRecord &def : r.defs)
+    {
+        s.defs += d;
+        countHash(p.defhashes, def.hash, d, s.uniquedefs);
+
+        countFlags(s.types, def.types, d);
+        countFlags(s.notes, def.notes, d);
+        countFlags(s.fields, def.fields, d);
+        countFlags(s.dialects, def.dialects, d);
+
+        s.deflengths[std::min<int>(def.length / DictionaryStatData::DefLengthStep, DictionaryStatData::DefLengthSteps - 1)] += d;
+    }
+}
+
+void DictionaryStats::mergePart(Part &dest, Part &src)
+{
+    DictionaryStatData &d = dest.data;
+    const DictionaryStatData &s = src.data;
+
+    d.entries += s.entries;
+    d.defs += s.defs;
+    d.popular += s.popular;
+    d.medium += s.medium;
+    d.nofreq += s.nofreq;
+    addCounts(d.freqhist, s.freqhist);
+    addCounts(d.types, s.types);
+    addCounts(d.notes, s.notes);
+    addCounts(d.fields, s.fields);
+    addCounts(d.dialects, s.dialects);
+    addCounts(d.deflengths, s.deflengths);
+
+    for (const auto &h : src.entryhashes)
+        dest.entryhashes[h.first] += h.second;
+    for (const auto &h : src.defhashes)
+        dest.defhashes[h.first] += h.second;
+    d.uniqueentries = tosigned(dest.entryhashes.size());
+    d.uniquedefs = tosigned(dest.defhashes.size());
+
+    HashCounts().swap(src.entryhashes);
+    HashCounts().swap(src.defhashes);
+}
+
+void DictionaryStats::updateKanji()
+{
+    int cnt = 0;
+    for (int ix = 0, siz = tosigned(ZKanji::kanjis.size()); ix != siz; ++ix)
+        if (dict->kanjiWordCount(ix) != 0)
+            ++cnt;
+    stats.data.usedkanji = cnt;
+}
+
+void DictionaryStats::finishWork(std::shared_ptr<Work> w)
+{
+    if (work != w)
+        return;
+    work.reset();
+
+    // The dictionary changed while computing.
+    if (w->cancel)
+    {
+        start();
+        return;
+    }
+
+    stats = std::move(w->parts[0]);
+    records = std::move(w->records);
+    updateKanji();
+    isready = true;
+
+    emit updated();
+}
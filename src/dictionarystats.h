@@ -0,0 +1,148 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#ifndef DICTIONARYSTATS_H
+#define DICTIONARYSTATS_H
+
+#include <QObject>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+
+// Aggregate values computed over the words of a dictionary.
+struct DictionaryStatData
+{
+    // Number of word entries.
+    int entries = 0;
+    // Number of entries with a unique list of definitions.
+    int uniqueentries = 0;
+    // Number of definitions in all entries.
+    int defs = 0;
+    // Number of unique definition texts.
+    int uniquedefs = 0;
+
+    // Number of entries above ZKanji::popularFreqLimit, above ZKanji::mediumFreqLimit, and
+    // the rest.
+    int popular = 0;
+    int medium = 0;
+    int nofreq = 0;
+    // Number of entries in each frequency range of FreqStep width.
+    std::vector<int> freqhist;
+
+    // Number of definitions with each WordTypes, WordNotes, WordFields and WordDialects flag.
+    std::vector<int> types;
+    std::vector<int> notes;
+    std::vector<int> fields;
+    std::vector<int> dialects;
+
+    // Number of definitions in each range of DefLengthStep characters. Longer definitions
+    // are counted in the last item.
+    std::vector<int> deflengths;
+
+    // Number of kanji used in the written form of at least one word.
+    int usedkanji = 0;
+
+    enum { FreqStep = 500, DefLengthStep = 10, DefLengthSteps = 21 };
+};
+
+class Dictionary;
+// Computes and caches statistics of a dictionary. The words are divided between the threads
+// of the global thread pool, which compute every value in a single pass. Once computed, the
+// values are updated when entries are added, changed or removed. The computation runs as a
+// background search, and it's restarted when canceled by a change in the dictionary.
+class DictionaryStats : public QObject
+{
+    Q_OBJECT
+signals:
+    // Emited when the statistics are first computed and after every update.
+    void updated();
+public:
+    // Returns the statistics object of dict, creating it if it doesn't exist. The object is
+    // deleted with the dictionary.
+    static DictionaryStats* get(Dictionary *dict);
+
+    virtual ~DictionaryStats();
+
+    // Whether the statistics have been computed.
+    bool ready() const;
+    // The computed statistics. Only valid when ready() is true.
+    const DictionaryStatData& data() const;
+
+    // Starts computing the statistics in the background if they are not ready or being
+    // computed already. The updated() signal is emited when done.
+    void start();
+    // Stops computing the statistics and waits for the threads to finish.
+    void cancel();
+private slots:
+    void entryAdded(int windex);
+    void entryChanged(int windex);
+    void entryRemoved(int windex);
+    void entriesCompacted(const std::vector<int> &changes);
+    void dictionaryReset();
+private:
+    DictionaryStats(Dictionary *dict);
+
+    // Values of a single definition needed to remove it from the statistics.
+    struct DefRecord
+    {
+        quint64 hash;
+        ushort length;
+        ushort dialects;
+        uint types;
+        uint notes;
+        uint fields;
+    };
+    // Values of a single word needed to remove it from the statistics.
+    struct WordRecord
+    {
+        // Hash of the definition texts in order.
+        quint64 hash;
+        ushort freq;
+        std::vector<DefRecord> defs;
+    };
+
+    typedef std::unordered_map<quint64, int> HashCounts;
+
+    // Statistics computed by a single thread for a range of words.
+    struct Part
+    {
+        DictionaryStatData data;
+        HashCounts entryhashes;
+        HashCounts defhashes;
+    };
+
+    // Data shared by the threads computing the statistics.
+    struct Work;
+
+    // Fills the record of the word at windex.
+    void makeRecord(int windex, WordRecord &r) const;
+    // Adds the values of r to the statistics, or removes them if add is false.
+    static void addRecord(Part &p, const WordRecord &r, bool add);
+    // Adds the statistics in src to dest.
+    static void mergePart(Part &dest, Part &src);
+    // Computes the number of kanji used in words.
+    void updateKanji();
+
+    // Called on the main thread when the computation ended. Canceled computations are
+    // restarted unless cancel() was called.
+    void finishWork(std::shared_ptr<Work> work);
+
+    Dictionary *dict;
+
+    bool isready;
+    // Set while computing.
+    std::shared_ptr<Work> work;
+
+    Part stats;
+    // Record of each word in the dictionary at the same index.
+    std::vector<WordRecord> records;
+
+    typedef QObject base;
+};
+
+
+#endif // DICTIONARYSTATS_H
@@ -8,14 +8,14 @@
 #include <QDesktopServices>
 #include <QPushButton>
 #include <QScrollBar>
-#include <chrono>
-#include <thread>
 #include <list>
 #include "dictionarystatsform.h"
 #include "ui_dictionarystatsform.h"
+#include "dictionarystats.h"
 
 #include "globalui.h"
 #include "words.h"
+#include "dictionarysettings.h"
 #include "kanji.h"
 #include "zui.h"
 #include "sentences.h"
@@ -25,224 +25,10 @@
 #include "formstates.h"
 
 
-#ifndef NDEBUG
-#ifndef _DEBUG
-#define NDEBUG
-#define NDEBUG_ADDED_SEPARATELY
-#endif
-#endif
-
-#include <cassert>
-
-#ifdef NDEBUG_ADDED_SEPARATELY
-#undef NDEBUG_ADDED_SEPARATELY
-#undef NDEBUG
-#endif
-
-
 //-------------------------------------------------------------
 
 
-StatsThread::StatsThread(DictionaryStatsForm *owner, Dictionary *dict) : base(), owner(owner), dict(dict), valentry(0), valdef(0), valkanji(0)
-{
-    terminate = false;
-    done = false;
-
-    setAutoDelete(false);
-}
-
-StatsThread::~StatsThread()
-{
-    assert(done);
-}
-
-void StatsThread::run()
-{
-    if (calculateEntries() && calculateDefinitions() && calculateKanji())
-        done = true;
-}
-
-int StatsThread::entryResult() const
-{
-    return valentry;
-}
-int StatsThread::definitionResult() const
-{
-    return valdef;
-}
-
-int StatsThread::kanjiResult() const
-{
-    return valkanji;
-}
-
-bool StatsThread::checkTerminate()
-{
-    if (terminate)
-    {
-        done = true;
-        return true;
-    }
-    return false;
-}
-
-bool StatsThread::calculateEntries()
-{
-    if (dict->entryCount() == 0)
-        return true;
-
-    if (checkTerminate())
-        return false;
-
-    std::vector<int> list;
-    list.resize(dict->entryCount());
-    std::iota(list.begin(), list.end(), 0);
-
-    interruptSort(list.begin(), list.end(), [this](int a, int b, bool &localdone) {
-        localdone = terminate;
-        if (localdone)
-            return false;
-
-        WordEntry *ea = dict->wordEntry(a);
-        WordEntry *eb = dict->wordEntry(b);
-
-        if (ea->defs.size() != eb->defs.size())
-            return ea->defs.size() < eb->defs.size();
-        for (int ix = 0, siz = tosigned(ea->defs.size()); ix != siz; ++ix)
-        {
-            int res = ea->defs[ix].def.compare(eb->defs[ix].def);
-            if (res != 0)
-                return res < 0;
-        }
-
-        return false;
-    });
-    if (checkTerminate())
-        return false;
-
-    valentry = 1;
-    for (int ix = 1, siz = tosigned(list.size()); ix != siz; ++ix)
-    {
-        const auto &defa = dict->wordEntry(list[ix - 1])->defs;
-        const auto &defb = dict->wordEntry(list[ix])->defs;
-
-        if (defa.size() != defb.size())
-            ++valentry;
-        else
-        {
-            for (int iy = 0, sizy = tosigned(defa.size()); iy != sizy; ++iy)
-            {
-                if (defa[iy].def != defb[iy].def)
-                {
-                    ++valentry;
-                    break;
-                }
-            }
-        }
-
-        if ((ix % 5 == 0) && checkTerminate())
-            return false;
-    }
-
-    return true;
-}
-
-bool StatsThread::calculateDefinitions()
-{
-    if (checkTerminate())
-        return false;
-
-    // Word index, definition index pairs.
-    typedef std::pair<int, int> DefPair;
-    std::vector<DefPair> pairs;
-    pairs.reserve(dict->entryCount() * 1.2);
-    for (int ix = 0, siz = dict->entryCount(); ix != siz; ++ix)
-    {
-        WordEntry *e = dict->wordEntry(ix);
-        for (int iy = 0, sizy = tosigned(e->defs.size()); iy != sizy; ++iy)
-            pairs.push_back(std::make_pair(ix, iy));
-    }
-
-    if (pairs.empty())
-        return true;
-
-    if (checkTerminate())
-        return false;
-
-    interruptSort(pairs.begin(), pairs.end(), [this](const DefPair &a, const DefPair &b, bool &localdone) {
-        localdone = terminate;
-        if (localdone)
-            return false;
-
-        WordEntry *ea = dict->wordEntry(a.first);
-        WordEntry *eb = dict->wordEntry(b.first);
-
-        return ea->defs[a.second].def < eb->defs[b.second].def;
-    });
-    if (checkTerminate())
-        return false;
-
-    valdef = 1;
-    for (int ix = 1, siz = tosigned(pairs.size()); ix != siz; ++ix)
-    {
-        if (dict->wordEntry(pairs[ix - 1].first)->defs[pairs[ix - 1].second].def != dict->wordEntry(pairs[ix].first)->defs[pairs[ix].second].def)
-            ++valdef;
-
-        if ((ix % 10) && checkTerminate())
-            return false;
-    }
-
-    return true;
-}
-
-bool StatsThread::calculateKanji()
-{
-    if (checkTerminate())
-        return false;
-
-    QSet<int> found;
-    KanjiGroupCategory *cat = &dict->kanjiGroups();
-
-    std::list<KanjiGroupCategory*> stack;
-    stack.push_back(cat);
-    while (!stack.empty())
-    {
-        if (checkTerminate())
-            return false;
-
-        cat = stack.front();
-        stack.pop_front();
-        for (int ix = 0, siz = cat->categoryCount(); ix != siz; ++ix)
-            stack.push_back(cat->categories(ix));
-        if (checkTerminate())
-            return false;
-
-        for (int ix = 0, siz = tosigned(cat->size()); ix != siz; ++ix)
-        {
-            KanjiGroup *grp = cat->items(ix);
-            for (int iy = 0, siy = tosigned(grp->size()); iy != siy; ++iy)
-            {
-                if ((iy % 10) == 0 && checkTerminate())
-                    return false;
-                int i = grp->items(iy)->index;
-                if (!found.contains(i))
-                {
-                    found.insert(i);
-                    ++valkanji;
-                }
-            }
-        }
-    }
-
-    return true;
-}
-
-
-
-//-------------------------------------------------------------
-
-
-DictionaryStatsForm::DictionaryStatsForm(int index, QWidget *prnt) : base(prnt), ui(new Ui::DictionaryStatsForm)
+DictionaryStatsForm::DictionaryStatsForm(int index, QWidget *prnt) : base(prnt), ui(new Ui::DictionaryStatsForm), stats(nullptr)
 {
     ui->setupUi(this);
 
@@ -316,7 +102,7 @@ DictionaryStatsForm::DictionaryStatsForm(int index, QWidget *prnt) : base(prnt),
 
 DictionaryStatsForm::~DictionaryStatsForm()
 {
-    stopThreads();
+    stopStats();
     delete ui;
 }
 
@@ -327,30 +113,6 @@ void DictionaryStatsForm::on_dictCBox_currentIndexChanged(int /*newindex*/)
 
 bool DictionaryStatsForm::event(QEvent *e)
 {
-    if (e->type() == QEvent::Timer)
-    {
-        QTimerEvent *te = (QTimerEvent*)e;
-        if (te->timerId() == timer.timerId())
-        {
-            if (thread != nullptr && !thread->terminate && thread->done)
-            {
-                timer.stop();
-
-                Dictionary *d = ZKanji::dictionary(ZKanji::dictionaryPosition(ui->dictCBox->currentIndex()));
-                StatResult &r = results[d];
-                r.entries = thread->entryResult();
-                r.defs = thread->definitionResult();
-                r.kanji = thread->kanjiResult();
-
-                thread.reset();
-
-                updateLabels(r);
-
-            }
-
-            return true;
-        }
-    }
     if (e->type() == QEvent::LanguageChange)
     {
         ui->retranslateUi(this);
@@ -385,7 +147,7 @@ bool DictionaryStatsForm::eventFilter(QObject *o, QEvent *e)
 
 void DictionaryStatsForm::closeEvent(QCloseEvent *e)
 {
-    stopThreads();
+    stopStats();
 
     base::closeEvent(e);
 }
@@ -398,7 +160,7 @@ void DictionaryStatsForm::showEvent(QShowEvent *e)
 
 void DictionaryStatsForm::updateData()
 {
-    stopThreads();
+    stopStats();
 
     Dictionary *d = ZKanji::dictionary(0);
     d = ZKanji::dictionary(ZKanji::dictionaryPosition(ui->dictCBox->currentIndex()));
@@ -411,30 +173,15 @@ void DictionaryStatsForm::updateData()
             ++cnt;
     ui->kanjiDefLabel->setText(QString::number(cnt));
 
-    ui->entryNumLabel->setText(QString::number(d->entryCount()));
-    cnt = 0;
-    for (int ix = 0, siz = d->entryCount(); ix != siz; ++ix)
-        cnt += tosigned(d->wordEntry(ix)->defs.size());
-    ui->defNumLabel->setText(QString::number(cnt));
-
-    cnt = 0;
-    int cnt2 = 0;
-    for (int ix = 0, siz = d->entryCount(); ix != siz; ++ix)
-        if (d->wordEntry(ix)->freq > ZKanji::popularFreqLimit)
-            ++cnt;
-        else if (d->wordEntry(ix)->freq > ZKanji::mediumFreqLimit)
-            ++cnt2;
-    ui->entryPopLabel->setText(QString::number(cnt));
-    ui->entryMidLabel->setText(QString::number(cnt2));
-    ui->entryNofreqLabel->setText(QString::number(d->entryCount() - cnt - cnt2));
-
+    ui->entryNumLabel->setText(QString::number(tosigned(d->wordOrdering(BrowseOrder::ABCDE).size())));
 
     ui->kanjiGrpLabel->setText(QString::number(d->kanjiGroups().groupCount()));
+    ui->kanjiGrpNumLabel->setText(QString::number(groupKanjiCount(d)));
     ui->wordGrpLabel->setText(QString::number(d->wordGroups().groupCount()));
     ui->wordGrpNumLabel->setText(QString::number(d->wordGroups().wordsInGroups()));
 
     cnt = 0;
-    cnt2 = 0;
+    int cnt2 = 0;
     for (int ix = 0, siz = tosigned(ZKanji::kanjis.size()); ix != siz; ++ix)
     {
         if (ZKanji::kanjis[ix]->jouyou < 7)
@@ -453,46 +200,49 @@ void DictionaryStatsForm::updateData()
 
     ui->dictInfoText->verticalScrollBar()->triggerAction(QScrollBar::SliderToMinimum);
 
-    auto it = results.find(d);
-    if (it != results.end())
-    {
-        updateLabels(it->second);
-        return;
-    }
-
-    ui->entryUniqueLabel->setText("...");
-    ui->defUniqueLabel->setText("...");
-    ui->kanjiGrpNumLabel->setText("...");
+    stats = DictionaryStats::get(d);
+    connect(stats, &DictionaryStats::updated, this, &DictionaryStatsForm::updateLabels);
+    stats->start();
 
-    startThreads(d);
+    updateLabels();
 }
 
-void DictionaryStatsForm::stopThreads()
+void DictionaryStatsForm::stopStats()
 {
-    if (!timer.isActive())
+    if (stats == nullptr)
         return;
 
-    timer.stop();
-
-    if (thread == nullptr)
-        return;
-
-    thread->terminate = true;
-
-    auto mil1 = std::chrono::milliseconds(1);
-    while (!thread->done)
-        std::this_thread::sleep_for(mil1);
-
-    thread.reset();
+    disconnect(stats, nullptr, this, nullptr);
+    // Finished statistics are kept up to date with the dictionary, only an unfinished
+    // computation is stopped.
+    if (!stats->ready())
+        stats->cancel();
+    stats = nullptr;
 }
 
-void DictionaryStatsForm::startThreads(Dictionary *d)
+int DictionaryStatsForm::groupKanjiCount(Dictionary *d) const
 {
-    thread.reset(new StatsThread(this, d));
+    QSet<int> found;
+    KanjiGroupCategory *cat = &d->kanjiGroups();
+
+    std::list<KanjiGroupCategory*> stack;
+    stack.push_back(cat);
+    while (!stack.empty())
+    {
+        cat = stack.front();
+        stack.pop_front();
+        for (int ix = 0, siz = cat->categoryCount(); ix != siz; ++ix)
+            stack.push_back(cat->categories(ix));
 
-    QThreadPool::globalInstance()->start(thread.get());
+        for (int ix = 0, siz = tosigned(cat->size()); ix != siz; ++ix)
+        {
+            KanjiGroup *grp = cat->items(ix);
+            for (int iy = 0, siy = tosigned(grp->size()); iy != siy; ++iy)
+                found.insert(grp->items(iy)->index);
+        }
+    }
 
-    timer.start(100, this);
+    return found.size();
 }
 
 void DictionaryStatsForm::translateTexts()
@@ -509,11 +259,21 @@ void DictionaryStatsForm::translateTexts()
     ui->buttonBox->button(QDialogButtonBox::Close)->setText(qApp->translate("ButtonBox", "Close"));
 }
 
-void DictionaryStatsForm::updateLabels(const StatResult &r)
+void DictionaryStatsForm::updateLabels()
 {
-    ui->entryUniqueLabel->setText(QString::number(r.entries));
-    ui->defUniqueLabel->setText(QString::number(r.defs));
-    ui->kanjiGrpNumLabel->setText(QString::number(r.kanji));
+    QLabel *lb[] = { ui->defNumLabel, ui->entryUniqueLabel, ui->defUniqueLabel, ui->entryPopLabel, ui->entryMidLabel, ui->entryNofreqLabel };
+
+    if (stats == nullptr || !stats->ready())
+    {
+        for (QLabel *l : lb)
+            l->setText("...");
+        return;
+    }
+
+    const DictionaryStatData &data = stats->data();
+    int val[] = { data.defs, data.uniqueentries, data.uniquedefs, data.popular, data.medium, data.nofreq };
+    for (int ix = 0, siz = sizeof(lb) / sizeof(QLabel*); ix != siz; ++ix)
+        lb[ix]->setText(QString::number(val[ix]));
 }
 
 void DictionaryStatsForm::setHtmlInfoText(const QString &str)
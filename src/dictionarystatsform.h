@@ -7,59 +7,14 @@
 #ifndef DICTIONARYSTATSFORM_H
 #define DICTIONARYSTATSFORM_H
 
-#include <QBasicTimer>
-#include <QThread>
-#include <atomic>
-#include <memory>
 #include "dialogwindow.h"
 
 namespace Ui {
     class DictionaryStatsForm;
 }
 
-class DictionaryStatsForm;
-class Dictionary;
-class StatsThread : public QRunnable
-{
-public:
-    StatsThread(DictionaryStatsForm *owner, Dictionary *dict);
-    virtual ~StatsThread();
-
-    virtual void run() override;
-    // Returns the calculated value. Only valid when the variable "done" is set to true.
-    int entryResult() const;
-    int definitionResult() const;
-    int kanjiResult() const;
-
-    std::atomic_bool terminate;
-    std::atomic_bool done;
-private:
-    // Checks whether the thread should be terminated. If so, sets done to true and returns 
-    // true.
-    bool checkTerminate();
-
-    bool calculateEntries();
-    bool calculateDefinitions();
-    bool calculateKanji();
-
-    DictionaryStatsForm *owner;
-    Dictionary *dict;
-
-    int valentry;
-    int valdef;
-    int valkanji;
-
-    typedef QRunnable base;
-};
-
-struct StatResult
-{
-    int entries;
-    int defs;
-    int kanji;
-};
-
 class Dictionary;
+class DictionaryStats;
 class DictionaryStatsForm : public DialogWindow
 {
     Q_OBJECT
@@ -76,20 +31,21 @@ protected:
 private:
     void updateData();
 
-    void stopThreads();
-    void startThreads(Dictionary *d);
+    // Stops computing the statistics of the shown dictionary, if they are not ready yet.
+    void stopStats();
+    // Number of unique kanji in the kanji groups of d.
+    int groupKanjiCount(Dictionary *d) const;
 
     void translateTexts();
-    void updateLabels(const StatResult &result);
+    // Shows the values computed by stats, or placeholders if they are not ready.
+    void updateLabels();
 
     void setHtmlInfoText(const QString &str);
 
     Ui::DictionaryStatsForm *ui;
-    QBasicTimer timer;
-
-    std::unique_ptr<StatsThread> thread;
 
-    std::map<Dictionary *, StatResult> results;
+    // Statistics of the shown dictionary.
+    DictionaryStats *stats;
 
     typedef DialogWindow    base;
 };
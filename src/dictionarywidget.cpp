@@ -1188,8 +1188,8 @@ void DictionaryWidget::exampleWordSelected(ushort block, uchar line, int wordpos
     if (dictionary() == nullptr)
         return;
 
-    auto sentence = ZKanji::sentences.getSentence(block, line);
-    ExampleWordsData::Form &f = sentence.words[wordpos].forms[wordform];
+    ExampleSentence sentence = ZKanji::sentences.getSentence(block, line);
+    const ExampleWordsData::Form &f = sentence->words[wordpos].forms[wordform];
     int ix = dictionary()->findKanjiKanaWord(f.kanji, f.kana);
     if (ix == -1)
         return;
@@ -1787,7 +1787,9 @@ void DictionaryWidget::updateWords()
             return;
         }
 
-        if (filtermodel != nullptr)
+        // The filter model is kept while the source model is the same, so it can reuse the
+        // results of previous searches.
+        if (filtermodel != nullptr && (filtermodel->sourceModel() != model || (searchText().isEmpty() && conditionsEmpty() && !sortfunc)))
         {
             filtermodel->deleteLater();
             filtermodel.release();
@@ -1795,10 +1797,14 @@ void DictionaryWidget::updateWords()
 
         if (!searchText().isEmpty() || !conditionsEmpty() || sortfunc)
         {
-            filtermodel.reset(new DictionarySearchFilterProxyModel(this));
-            filtermodel->setSourceModel(model);
+            bool created = filtermodel == nullptr;
+            if (created)
+            {
+                filtermodel.reset(new DictionarySearchFilterProxyModel(this));
+                filtermodel->setSourceModel(model);
+            }
 
-            if (!searchText().isEmpty() || !conditionsEmpty())
+            if (!created || !searchText().isEmpty() || !conditionsEmpty())
                 filtermodel->filter(mode, searchText(), wildcards, strict, ui->inflButton->isChecked(), isStudyDefinitionUsed(), ui->filterButton->isChecked() ? conditions.get() : nullptr);
             if (sortfunc)
                 filtermodel->sortBy(ui->wordsTable->horizontalHeader()->sortIndicatorSection(), ui->wordsTable->horizontalHeader()->sortIndicatorOrder(), sortfunc);
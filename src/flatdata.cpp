@@ -0,0 +1,131 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#include <QIODevice>
+#include "flatdata.h"
+#include "zkanjimain.h"
+#include "qcharstring.h"
+
+#include "checked_cast.h"
+
+
+//-------------------------------------------------------------
+
+
+FlatWriter::FlatWriter(QIODevice *dev) : dev(dev)
+{
+}
+
+void FlatWriter::writeChars(const QChar *str, size_t length)
+{
+    writeArray<ushort>(reinterpret_cast<const ushort*>(str), length);
+}
+
+void FlatWriter::align(int n)
+{
+    static const char zeroes[8] = { 0 };
+    int pad = (n - (dev->pos() % n)) % n;
+    while (pad > 0)
+    {
+        int len = std::min<int>(pad, sizeof(zeroes));
+        writeRaw(zeroes, len);
+        pad -= len;
+    }
+}
+
+void FlatWriter::writeRaw(const void *data, qint64 size)
+{
+    if (dev->write(reinterpret_cast<const char*>(data), size) != size)
+        throw ZException("Couldn't write flat data.");
+}
+
+
+//-------------------------------------------------------------
+
+
+FlatReader::FlatReader(const uchar *data, qint64 size, qint64 pos) : data(data), size(size), p(pos)
+{
+}
+
+const QChar* FlatReader::chars(size_t length)
+{
+    if ((p % 2) != 0)
+        throw ZException("Misaligned character data in flat data.");
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return reinterpret_cast<const QChar*>(skip(sizeof(QChar) * length));
+#else
+    converted.push_back(std::vector<QChar>(length));
+    std::vector<QChar> &vec = converted.back();
+    readArray<ushort>(reinterpret_cast<ushort*>(vec.data()), length);
+    return vec.data();
+#endif
+}
+
+const uchar* FlatReader::skip(qint64 len)
+{
+    if (len < 0 || p + len > size)
+        throw ZException("Unexpected end of flat data.");
+    const uchar *result = data + p;
+    p += len;
+    return result;
+}
+
+void FlatReader::align(int n)
+{
+    skip((n - (p % n)) % n);
+}
+
+qint64 FlatReader::pos() const
+{
+    return p;
+}
+
+qint64 FlatReader::remaining() const
+{
+    return size - p;
+}
+
+
+//-------------------------------------------------------------
+
+
+FlatStringPool::FlatStringPool()
+{
+    list.push_back(QChar(0));
+}
+
+quint32 FlatStringPool::add(const QChar *str)
+{
+    if (str == nullptr || str->unicode() == 0)
+        return 0;
+
+    quint32 result = (quint32)list.size();
+    size_t len = qcharlen(str);
+    list.insert(list.end(), str, str + len + 1);
+    return result;
+}
+
+void FlatStringPool::write(FlatWriter &writer) const
+{
+    writer.write<quint32>((quint32)list.size());
+    writer.writeChars(list.data(), list.size());
+    writer.align(4);
+}
+
+const QChar* FlatStringPool::read(FlatReader &reader, quint32 &size)
+{
+    size = reader.read<quint32>();
+    const QChar *result = reader.chars(size);
+    reader.align(4);
+
+    // Every string in the pool must be null terminated, which can be checked by looking at
+    // the last character.
+    if (size == 0 || result[size - 1].unicode() != 0)
+        throw ZException("Invalid string data in flat data.");
+
+    return result;
+}
@@ -0,0 +1,145 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#ifndef FLATDATA_H
+#define FLATDATA_H
+
+#include <QtEndian>
+#include <QChar>
+#include <vector>
+#include <list>
+#include "checked_cast.h"
+
+class QIODevice;
+
+// Helpers for the flat data format of dictionary files. Data in this format is written as
+// little-endian integers and UTF-16 character blocks packed one after the other, without any
+// per item markers. Files written this way are not parsed with QDataStream when loading.
+// Their data is mapped in memory, or read at once if that's not possible, and bulk loaded
+// from there: strings and arrays are copied out in whole blocks, without decoding them one
+// item at a time. Nothing refers to the file data after loading, so the file can be
+// unmapped and overwritten while the program runs.
+// Character blocks and integer arrays are aligned to 4 bytes from the start of the file, so
+// they can be copied without unaligned reads.
+
+class FlatWriter
+{
+public:
+    FlatWriter(const FlatWriter&) = delete;
+    FlatWriter& operator=(const FlatWriter&) = delete;
+
+    // Constructs a writer that writes to dev at its current position. Positions used for
+    // alignment are measured from the start of the device.
+    FlatWriter(QIODevice *dev);
+
+    // Writes a single integer value in little-endian byte order.
+    template<typename T>
+    void write(T val)
+    {
+        T le = qToLittleEndian<T>(val);
+        writeRaw(&le, sizeof(T));
+    }
+
+    // Writes count integer values from arr in little-endian byte order.
+    template<typename T>
+    void writeArray(const T *arr, size_t count)
+    {
+        if (count == 0)
+            return;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        writeRaw(arr, sizeof(T) * count);
+#else
+        std::vector<T> tmp(count);
+        qToLittleEndian<T>(arr, count, tmp.data());
+        writeRaw(tmp.data(), sizeof(T) * count);
+#endif
+    }
+
+    // Writes length number of characters from str without a size prefix.
+    void writeChars(const QChar *str, size_t length);
+
+    // Writes zero bytes until the position in the device is divisible by n.
+    void align(int n);
+private:
+    void writeRaw(const void *data, qint64 size);
+
+    QIODevice *dev;
+};
+
+class FlatReader
+{
+public:
+    FlatReader(const FlatReader&) = delete;
+    FlatReader& operator=(const FlatReader&) = delete;
+
+    // Constructs a reader for size bytes in data, starting at the byte position pos. Throws
+    // a ZException when reading past the end of the data.
+    FlatReader(const uchar *data, qint64 size, qint64 pos);
+
+    // Reads a single little-endian integer value.
+    template<typename T>
+    T read()
+    {
+        return qFromLittleEndian<T>(skip(sizeof(T)));
+    }
+
+    // Reads count number of little-endian integers to dest.
+    template<typename T>
+    void readArray(T *dest, size_t count)
+    {
+        if (count == 0)
+            return;
+        qFromLittleEndian<T>(skip(sizeof(T) * count), tosigned(count), dest);
+    }
+
+    // Returns a pointer to length number of characters in the data, and moves past them.
+    // The position must be aligned to 2 bytes. On big-endian systems the returned pointer
+    // points to a converted copy which is valid while the reader exists.
+    const QChar* chars(size_t length);
+
+    // Returns the address of the current position and moves size bytes forward.
+    const uchar* skip(qint64 size);
+
+    // Moves forward until the position is divisible by n.
+    void align(int n);
+
+    // Current position in bytes from the start of the data.
+    qint64 pos() const;
+    // Number of bytes that can be read after the current position.
+    qint64 remaining() const;
+private:
+    const uchar *data;
+    qint64 size;
+    qint64 p;
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    std::list<std::vector<QChar>> converted;
+#endif
+};
+
+// Collects null terminated strings in a single character block for writing in the flat
+// format. Strings are referenced by their offset in the block. Empty strings all share the
+// offset 0.
+class FlatStringPool
+{
+public:
+    FlatStringPool();
+
+    // Adds str to the pool and returns its offset.
+    quint32 add(const QChar *str);
+
+    // Writes the number of characters and the character block, padded to 4 bytes.
+    void write(FlatWriter &writer) const;
+
+    // Reads a character block written by write() and returns its address. The number of
+    // characters is stored in size. Throws a ZException if the block is not valid.
+    static const QChar* read(FlatReader &reader, quint32 &size);
+private:
+    std::vector<QChar> list;
+};
+
+
+#endif // FLATDATA_H
@@ -1642,6 +1642,8 @@ void testFuriganaReadingTest()
 #ifdef  CHECKED_WORD_INDEX
             ix = CHECKED_WORD_INDEX;
 #endif
+            if (d->isEntryRemoved(ix))
+                continue;
             WordEntry *e = d->wordEntry(ix);
 
             std::vector<FuriganaData> furi;
@@ -979,7 +979,7 @@ void GlobalUI::timerEvent(QTimerEvent *e)
         if (lastsave.secsTo(now) >= Settings::data.interval * 60)
         {
             lastsave = now;
-            ZKanji::saveUserData();
+            ZKanji::saveUserData(false, true);
         }
     }
 }
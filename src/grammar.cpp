@@ -4,6 +4,10 @@
 ** GNU General Public License version 3. See the file LICENSE for details.
 **/
 
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <map>
+#include <algorithm>
 #include "grammar.h"
 #include "grammar_enums.h"
 #include "romajizer.h"
@@ -462,6 +466,160 @@ const InfTypes ruinftype[]
 
 
 
+namespace
+{
+    // A suffix rule from the verb inflection tables. Words ending in the inflected suffix are
+    // deinflected by replacing it with the suffix of the dictionary form.
+    struct DeinflectRule
+    {
+        // Inflected suffix in hiragana.
+        const QCharString *inflected;
+        // Suffix of the dictionary form.
+        QString suffix;
+        WordTypes type;
+        InfTypes inftype;
+        // Kuru rules only match the inflected suffix without its first character, which can
+        // be that character or one of the kanji of kuru.
+        bool kuru;
+    };
+
+    // Node in the trie of the inflected suffixes, which is built starting from their last
+    // characters.
+    struct DeinflectNode
+    {
+        ushort ch;
+        // Position of the first child node in deinflectnodes and the number of children.
+        // Children are ordered by their character.
+        int childpos;
+        int childcnt;
+        // Position of the first rule index in deinflectnoderules and the number of rules
+        // with an inflected suffix ending at this node.
+        int rulepos;
+        int rulecnt;
+    };
+
+    // Every suffix rule in the order they are applied.
+    std::vector<DeinflectRule> deinflectrules;
+    // Index of the first ichidan verb rule in deinflectrules.
+    int ichidanrulepos;
+    // Nodes of the suffix trie. The first node is the root.
+    std::vector<DeinflectNode> deinflectnodes;
+    // Rule indexes of the trie nodes.
+    std::vector<int> deinflectnoderules;
+}
+
+void addDeinflectRules(const QCharStringList &list, const InfTypes *inftypes, const QString &suffix, WordTypes type)
+{
+    for (int ix = 0, siz = list.size(); ix != siz; ++ix)
+        deinflectrules.push_back({ &list[ix], suffix, type, inftypes[ix], false });
+}
+
+// Compiles the verb inflection tables into the list of rules and the suffix trie, so the rules
+// matching a word can be found in a single pass over its last characters, instead of
+// comparing the word to every inflected suffix.
+void initializeDeinflectRules()
+{
+    const QString surukana = toKana("suru", 4);
+    const QString kurukana = toKana("kuru", 4);
+
+    addDeinflectRules(ikuinf, ikuinftype, QChar(0x304f) /* ku */, WordTypes::IkuVerb);
+    for (int ix = 0, siz = suruinf.size(); ix != siz; ++ix)
+    {
+        deinflectrules.push_back({ &suruinf[ix], surukana, WordTypes::SuruVerb, suruinftype[ix], false });
+        deinflectrules.push_back({ &suruinf[ix], QString(), WordTypes::TakesSuru, suruinftype[ix], false });
+    }
+    for (int ix = 0, siz = kuruinf.size(); ix != siz; ++ix)
+        deinflectrules.push_back({ &kuruinf[ix], kurukana, WordTypes::KuruVerb, kuruinftype[ix], true });
+    addDeinflectRules(uinf, uinftype, QChar(0x3046) /* u */, WordTypes::GodanVerb);
+    addDeinflectRules(kuinf, kuinftype, QChar(0x304f) /* ku */, WordTypes::GodanVerb);
+    addDeinflectRules(guinf, guinftype, QChar(0x3050) /* gu */, WordTypes::GodanVerb);
+    addDeinflectRules(suinf, suinftype, QChar(0x3059) /* su */, WordTypes::GodanVerb);
+    addDeinflectRules(tuinf, tuinftype, QChar(0x3064) /* tu */, WordTypes::GodanVerb);
+    addDeinflectRules(nuinf, nuinftype, QChar(0x306C) /* nu */, WordTypes::GodanVerb);
+    addDeinflectRules(buinf, buinftype, QChar(0x3076) /* bu */, WordTypes::GodanVerb);
+    addDeinflectRules(muinf, muinftype, QChar(0x3080) /* mu */, WordTypes::GodanVerb);
+    addDeinflectRules(r_uinf, r_uinftype, QChar(0x308B) /* ru */, WordTypes::GodanVerb);
+    ichidanrulepos = tosigned(deinflectrules.size());
+    addDeinflectRules(ruinf, ruinftype, QChar(0x308B) /* ru */, WordTypes::IchidanVerb);
+
+    // The trie is first built with the children in maps, and then flattened breadth first,
+    // which places the children of every node next to each other.
+
+    struct BuildNode
+    {
+        std::map<ushort, int> children;
+        std::vector<int> rules;
+    };
+    std::vector<BuildNode> nodes(1);
+
+    for (int ix = 0, siz = tosigned(deinflectrules.size()); ix != siz; ++ix)
+    {
+        const DeinflectRule &rule = deinflectrules[ix];
+        const QCharString &str = *rule.inflected;
+
+        int node = 0;
+        for (int pos = str.size() - 1, first = rule.kuru ? 1 : 0; pos >= first; --pos)
+        {
+            ushort ch = str[pos].unicode();
+            auto it = nodes[node].children.find(ch);
+            if (it == nodes[node].children.end())
+            {
+                nodes.emplace_back();
+                it = nodes[node].children.insert(std::make_pair(ch, tosigned(nodes.size()) - 1)).first;
+            }
+            node = it->second;
+        }
+        nodes[node].rules.push_back(ix);
+    }
+
+    // Index of the built nodes in the order of their position in the flattened trie.
+    std::vector<int> order(1, 0);
+    deinflectnodes.resize(nodes.size());
+    deinflectnodes[0].ch = 0;
+    for (int ix = 0; ix != tosigned(order.size()); ++ix)
+    {
+        const BuildNode &b = nodes[order[ix]];
+        DeinflectNode &n = deinflectnodes[ix];
+        n.childpos = tosigned(order.size());
+        n.childcnt = tosigned(b.children.size());
+        n.rulepos = tosigned(deinflectnoderules.size());
+        n.rulecnt = tosigned(b.rules.size());
+        deinflectnoderules.insert(deinflectnoderules.end(), b.rules.begin(), b.rules.end());
+
+        for (const auto &p : b.children)
+        {
+            deinflectnodes[order.size()].ch = p.first;
+            order.push_back(p.second);
+        }
+    }
+}
+
+// Fills matches with the indexes of the rules in deinflectrules matching the end of hstr in
+// increasing order, by walking the suffix trie from the last character of hstr. Kuru rules
+// are listed without checking the first character of their suffix.
+void findDeinflectRules(const QString &hstr, std::vector<int> &matches)
+{
+    matches.clear();
+
+    int node = 0;
+    for (int pos = hstr.size() - 1; pos != -1; --pos)
+    {
+        const DeinflectNode &n = deinflectnodes[node];
+        ushort ch = hstr.at(pos).unicode();
+        auto first = deinflectnodes.begin() + n.childpos;
+        auto last = first + n.childcnt;
+        auto it = std::lower_bound(first, last, ch, [](const DeinflectNode &a, ushort ch) { return a.ch < ch; });
+        if (it == last || it->ch != ch)
+            break;
+
+        node = tosigned(it - deinflectnodes.begin());
+        const DeinflectNode &child = deinflectnodes[node];
+        matches.insert(matches.end(), deinflectnoderules.begin() + child.rulepos, deinflectnoderules.begin() + child.rulepos + child.rulecnt);
+    }
+
+    std::sort(matches.begin(), matches.end());
+}
+
 void initializeRomajiToKana(const char **romaji, QCharStringList &kana, int size)
 {
     kana.reserve(size);
@@ -490,6 +648,7 @@ void initializeDeinflecter()
     INITRK(r_uinf);
     INITRK(ruinf);
 
+    initializeDeinflectRules();
 
     //INITRK(zero0);
     //INITRK(ichi1);
@@ -616,14 +775,14 @@ uint convertOldFields(uint old)
     return result;
 }
 
-void deinflectedForms(QString str, QString hstr, int infsize, std::vector<InfTypes> inf, WordTypes oldtype, smartvector<InflectionForm> &results);
+void deinflectedForms(QString str, QString hstr, int infsize, std::vector<InfTypes> inf, WordTypes oldtype, smartvector<InflectionForm> &results, bool baseline);
 
 // Both str and hstr contain the same kana word, but hstr is hiraganized for checks. They are still
 // in their original inflected forms. Str is kept in case the result should keep the original katakana.
 // Newlen is the new length of the deinflected word without the suffix, which is added in this step
 // of deinflection. Infsize is the number of characters before deinflection, that were changed
-// in previous steps.
-void addInflectionVariant(QString str, QString hstr, int newlen, QString suffix, int infsize, WordTypes type, WordTypes oldtype, std::vector<InfTypes> inf, InfTypes inftype, smartvector<InflectionForm> &results)
+// in previous steps. Baseline is passed on to deinflectedForms().
+void addInflectionVariant(QString str, QString hstr, int newlen, QString suffix, int infsize, WordTypes type, WordTypes oldtype, std::vector<InfTypes> inf, InfTypes inftype, smartvector<InflectionForm> &results, bool baseline)
 {
     static const QString dekirukana = toKana("dekiru", 6);
     static const QString irukana = toKana("iru", 3);
@@ -705,38 +864,28 @@ void addInflectionVariant(QString str, QString hstr, int newlen, QString suffix,
 
     if ((type == WordTypes::TakesSuru || type == WordTypes::IchidanVerb || type == WordTypes::GodanVerb ||
         type == WordTypes::TrueAdj /*|| type == WordTypes::AuxAdj*/) && (inftype != InfTypes::I || type != WordTypes::IchidanVerb))
-        deinflectedForms(str, hstr, infsize, inf, type, results);
+        deinflectedForms(str, hstr, infsize, inf, type, results, baseline);
 }
 
-void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &results);
+void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &results, bool baseline);
 
-// Called recursively to deinflect a word. Str is the current word form that might be deinflected further.
-// infl is the list of previous results which gets expanded in every iteration. Type contains the required
-// grammatical type of the form passed in str. If type is -1 no type is set.
-void deinflectedForms(QString str, QString hstr, int infsize, std::vector<InfTypes> inf, WordTypes oldtype, smartvector<InflectionForm> &results)
+// Deinflects hstr with the verb inflection tables by comparing its end with every inflected
+// suffix, the way deinflectedForms() did before the suffix trie. Only used by
+// benchmarkDeinflect() to compare the results and speed of the two.
+void deinflectedFormsBaseline(QString str, QString hstr, int infsize, std::vector<InfTypes> inf, WordTypes oldtype, smartvector<InflectionForm> &results)
 {
     static const QString surukana = toKana("suru", 4);
     static const QString kurukana = toKana("kuru", 4);
 
-    if (hstr.isEmpty())
-        return;
-
-    if (inf.empty())
-        deinflectAdjective(str, hstr, results);
-
-    // If the "inflection" is the -na ending of a na adjective, it is added as the sole possible inflection.
-    if (inf.empty() && (hstr.at(hstr.size() - 1).unicode() == 0x306A /* na */ || hstr.at(hstr.size() - 1).unicode() == 0x306B /* ni */ || hstr.at(hstr.size() - 1).unicode() == 0x3067 /* de */))
-        addInflectionVariant(str, hstr, hstr.size() - 1, QString(), infsize, WordTypes::NaAdj, oldtype, std::vector<InfTypes>(), hstr.at(hstr.size() - 1).unicode() == 0x306A ? InfTypes::Na : hstr.at(hstr.size() - 1).unicode() == 0x306B ? InfTypes::Ku : InfTypes::Te, results);
-
     for (int ix = 0, siz = tosigned(ikuinf.size()); ix != siz; ++ix)
         if (hstr.right(ikuinf[ix].size()) == ikuinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - ikuinf[ix].size(), QChar(0x304f) /* ku */, infsize, WordTypes::IkuVerb, oldtype, inf, ikuinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - ikuinf[ix].size(), QChar(0x304f) /* ku */, infsize, WordTypes::IkuVerb, oldtype, inf, ikuinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(suruinf.size()); ix != siz; ++ix)
         if (hstr.right(suruinf[ix].size()) == suruinf[ix])
         {
-            addInflectionVariant(str, hstr, hstr.size() - suruinf[ix].size(), surukana, infsize, WordTypes::SuruVerb, oldtype, inf, suruinftype[ix], results);
-            addInflectionVariant(str, hstr, hstr.size() - suruinf[ix].size(), QString(), infsize, WordTypes::TakesSuru, oldtype, inf, suruinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - suruinf[ix].size(), surukana, infsize, WordTypes::SuruVerb, oldtype, inf, suruinftype[ix], results, true);
+            addInflectionVariant(str, hstr, hstr.size() - suruinf[ix].size(), QString(), infsize, WordTypes::TakesSuru, oldtype, inf, suruinftype[ix], results, true);
         }
 
     if (hstr.size() != 1)
@@ -747,58 +896,118 @@ void deinflectedForms(QString str, QString hstr, int infsize, std::vector<InfTyp
             if (hstr.size() >= len && qcharncmp(hstr.right(len - 1).constData(), kuruinf[ix].rightData(len - 1), len - 1) == 0)
             {
                 if (hstr.at(hstr.size() - len) == kuruinf[ix][0])
-                    addInflectionVariant(str, hstr, hstr.size() - len, kurukana, infsize, WordTypes::KuruVerb, oldtype, inf, kuruinftype[ix], results);
+                    addInflectionVariant(str, hstr, hstr.size() - len, kurukana, infsize, WordTypes::KuruVerb, oldtype, inf, kuruinftype[ix], results, true);
                 else if (hstr.at(hstr.size() - len) == QChar(0x6765) /* kuru kanji */ || hstr.at(hstr.size() - len) == QChar(0x4F86) /* kuru kanji variant */ )
-                    addInflectionVariant(str, hstr, hstr.size() - len + 1, QChar(0x308B) /* ru */, infsize, WordTypes::KuruVerb, oldtype, inf, kuruinftype[ix], results);
+                    addInflectionVariant(str, hstr, hstr.size() - len + 1, QChar(0x308B) /* ru */, infsize, WordTypes::KuruVerb, oldtype, inf, kuruinftype[ix], results, true);
             }
         }
     }
 
     for (int ix = 0, siz = tosigned(uinf.size()); ix != siz; ++ix)
         if (hstr.right(uinf[ix].size()) == uinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - uinf[ix].size(), QChar(0x3046) /* u */, infsize, WordTypes::GodanVerb, oldtype, inf, uinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - uinf[ix].size(), QChar(0x3046) /* u */, infsize, WordTypes::GodanVerb, oldtype, inf, uinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(kuinf.size()); ix != siz; ++ix)
         if (hstr.right(kuinf[ix].size()) == kuinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - kuinf[ix].size(), QChar(0x304f) /* ku */, infsize, WordTypes::GodanVerb, oldtype, inf, kuinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - kuinf[ix].size(), QChar(0x304f) /* ku */, infsize, WordTypes::GodanVerb, oldtype, inf, kuinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(guinf.size()); ix != siz; ++ix)
         if (hstr.right(guinf[ix].size()) == guinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - guinf[ix].size(), QChar(0x3050) /* gu */, infsize, WordTypes::GodanVerb, oldtype, inf, guinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - guinf[ix].size(), QChar(0x3050) /* gu */, infsize, WordTypes::GodanVerb, oldtype, inf, guinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(suinf.size()); ix != siz; ++ix)
         if (hstr.right(suinf[ix].size()) == suinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - suinf[ix].size(), QChar(0x3059) /* su */, infsize, WordTypes::GodanVerb, oldtype, inf, suinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - suinf[ix].size(), QChar(0x3059) /* su */, infsize, WordTypes::GodanVerb, oldtype, inf, suinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(tuinf.size()); ix != siz; ++ix)
         if (hstr.right(tuinf[ix].size()) == tuinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - tuinf[ix].size(), QChar(0x3064) /* tu */, infsize, WordTypes::GodanVerb, oldtype, inf, tuinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - tuinf[ix].size(), QChar(0x3064) /* tu */, infsize, WordTypes::GodanVerb, oldtype, inf, tuinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(nuinf.size()); ix != siz; ++ix)
         if (hstr.right(nuinf[ix].size()) == nuinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - nuinf[ix].size(), QChar(0x306C) /* nu */, infsize, WordTypes::GodanVerb, oldtype, inf, nuinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - nuinf[ix].size(), QChar(0x306C) /* nu */, infsize, WordTypes::GodanVerb, oldtype, inf, nuinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(buinf.size()); ix != siz; ++ix)
         if (hstr.right(buinf[ix].size()) == buinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - buinf[ix].size(), QChar(0x3076) /* bu */, infsize, WordTypes::GodanVerb, oldtype, inf, buinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - buinf[ix].size(), QChar(0x3076) /* bu */, infsize, WordTypes::GodanVerb, oldtype, inf, buinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(muinf.size()); ix != siz; ++ix)
         if (hstr.right(muinf[ix].size()) == muinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - muinf[ix].size(), QChar(0x3080) /* mu */, infsize, WordTypes::GodanVerb, oldtype, inf, muinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - muinf[ix].size(), QChar(0x3080) /* mu */, infsize, WordTypes::GodanVerb, oldtype, inf, muinftype[ix], results, true);
 
     for (int ix = 0, siz = tosigned(r_uinf.size()); ix != siz; ++ix)
         if (hstr.right(r_uinf[ix].size()) == r_uinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - r_uinf[ix].size(), QChar(0x308B) /* ru */, infsize, WordTypes::GodanVerb, oldtype, inf, r_uinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - r_uinf[ix].size(), QChar(0x308B) /* ru */, infsize, WordTypes::GodanVerb, oldtype, inf, r_uinftype[ix], results, true);
 
     if (inf.empty())
-        addInflectionVariant(str, hstr, hstr.size(), QChar(0x308B) /* ru */, infsize, WordTypes::IchidanVerb, oldtype, inf, InfTypes::I, results);
+        addInflectionVariant(str, hstr, hstr.size(), QChar(0x308B) /* ru */, infsize, WordTypes::IchidanVerb, oldtype, inf, InfTypes::I, results, true);
 
     for (int ix = 0, siz = tosigned(ruinf.size()); ix != siz; ++ix)
         if (hstr.right(ruinf[ix].size()) == ruinf[ix])
-            addInflectionVariant(str, hstr, hstr.size() - ruinf[ix].size(), QChar(0x308B) /* ru */, infsize, WordTypes::IchidanVerb, oldtype, inf, ruinftype[ix], results);
+            addInflectionVariant(str, hstr, hstr.size() - ruinf[ix].size(), QChar(0x308B) /* ru */, infsize, WordTypes::IchidanVerb, oldtype, inf, ruinftype[ix], results, true);
 }
 
-void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &results)
+// Called recursively to deinflect a word. Str is the current word form that might be deinflected further.
+// infl is the list of previous results which gets expanded in every iteration. Type contains the required
+// grammatical type of the form passed in str. If type is -1 no type is set.
+// The suffix rules matching hstr are looked up in the suffix trie. Set baseline to true to
+// check the inflection tables one by one instead, like before the suffix trie was added. It's
+// only used for comparison in benchmarkDeinflect().
+void deinflectedForms(QString str, QString hstr, int infsize, std::vector<InfTypes> inf, WordTypes oldtype, smartvector<InflectionForm> &results, bool baseline)
+{
+    if (hstr.isEmpty())
+        return;
+
+    if (inf.empty())
+        deinflectAdjective(str, hstr, results, baseline);
+
+    // If the "inflection" is the -na ending of a na adjective, it is added as the sole possible inflection.
+    if (inf.empty() && (hstr.at(hstr.size() - 1).unicode() == 0x306A /* na */ || hstr.at(hstr.size() - 1).unicode() == 0x306B /* ni */ || hstr.at(hstr.size() - 1).unicode() == 0x3067 /* de */))
+        addInflectionVariant(str, hstr, hstr.size() - 1, QString(), infsize, WordTypes::NaAdj, oldtype, std::vector<InfTypes>(), hstr.at(hstr.size() - 1).unicode() == 0x306A ? InfTypes::Na : hstr.at(hstr.size() - 1).unicode() == 0x306B ? InfTypes::Ku : InfTypes::Te, results, baseline);
+
+    if (baseline)
+    {
+        deinflectedFormsBaseline(str, hstr, infsize, inf, oldtype, results);
+        return;
+    }
+
+    std::vector<int> matches;
+    findDeinflectRules(hstr, matches);
+
+    // The -i form of ichidan verbs has no suffix to match. It's tried in its original place
+    // between the godan and the ichidan rules.
+    bool ichidan = inf.empty();
+
+    for (int ix : matches)
+    {
+        if (ichidan && ix >= ichidanrulepos)
+        {
+            addInflectionVariant(str, hstr, hstr.size(), QChar(0x308B) /* ru */, infsize, WordTypes::IchidanVerb, oldtype, inf, InfTypes::I, results, baseline);
+            ichidan = false;
+        }
+
+        const DeinflectRule &rule = deinflectrules[ix];
+        int len = rule.inflected->size();
+        if (!rule.kuru)
+        {
+            addInflectionVariant(str, hstr, hstr.size() - len, rule.suffix, infsize, rule.type, oldtype, inf, rule.inftype, results, baseline);
+            continue;
+        }
+
+        if (hstr.size() == 1 || hstr.size() < len)
+            continue;
+
+        if (hstr.at(hstr.size() - len) == (*rule.inflected)[0])
+            addInflectionVariant(str, hstr, hstr.size() - len, rule.suffix, infsize, WordTypes::KuruVerb, oldtype, inf, rule.inftype, results, baseline);
+        else if (hstr.at(hstr.size() - len) == QChar(0x6765) /* kuru kanji */ || hstr.at(hstr.size() - len) == QChar(0x4F86) /* kuru kanji variant */)
+            addInflectionVariant(str, hstr, hstr.size() - len + 1, QChar(0x308B) /* ru */, infsize, WordTypes::KuruVerb, oldtype, inf, rule.inftype, results, baseline);
+    }
+
+    if (ichidan)
+        addInflectionVariant(str, hstr, hstr.size(), QChar(0x308B) /* ru */, infsize, WordTypes::IchidanVerb, oldtype, inf, InfTypes::I, results, baseline);
+}
+
+void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &results, bool baseline)
 {
     static constexpr char16_t iikana[] { 0x3044, 0x3044, 0 };
     static constexpr char16_t waiikana[] { 0x308f, 0x3044, 0x3044, 0 };
@@ -852,9 +1061,9 @@ void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &
                 // in the word "abunai" listed as being inflected with -sou when "abunasasou" is incorrect.
                 // Only allow this ending if there are other inflections affecting the word too.
                 bool na = hstr.at(hstr.size() - 3) == QChar(0x306A) /* na */;
-                addInflectionVariant(str, hstr, hstr.size() - 2, QChar(0x3044), infsize, na ? WordTypes::Count : WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results);
+                addInflectionVariant(str, hstr, hstr.size() - 2, QChar(0x3044), infsize, na ? WordTypes::Count : WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results, baseline);
                 if (!na)
-                    addInflectionVariant(str, hstr, hstr.size() - 3, QString::fromUtf16(iikana), infsize, WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results);
+                    addInflectionVariant(str, hstr, hstr.size() - 3, QString::fromUtf16(iikana), infsize, WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results, baseline);
                 infsize = std::max(0, infsize - adjlen) + 1;
 
                 // Replace -sai with -i to get nai or yoi.
@@ -871,9 +1080,9 @@ void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &
             // Special handling for i-adjectives ending in yoi. Add ii ending words too.
             for (int iy = 0, sizy = tosigned(adjyoi.size()); iy != sizy; ++iy)
                 if (hstr.right(adjyoi[iy].size()) == adjyoi[iy] && (iy != sizy - 1 || hstr.size() == 2))
-                    addInflectionVariant(str, hstr, hstr.size() - 2, QString::fromUtf16(iikana), infsize, WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results);
+                    addInflectionVariant(str, hstr, hstr.size() - 2, QString::fromUtf16(iikana), infsize, WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results, baseline);
 
-            addInflectionVariant(str, hstr, hstr.size(), QString(), infsize, WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results);
+            addInflectionVariant(str, hstr, hstr.size(), QString(), infsize, WordTypes::TrueAdj, oldtype, inflist, adjinft[ix], results, baseline);
 
             oldtype = WordTypes::TrueAdj;
             inflist.push_back(adjinft[ix]);
@@ -884,7 +1093,72 @@ void deinflectAdjective(QString str, QString hstr, smartvector<InflectionForm> &
 void deinflect(QString str, smartvector<InflectionForm> &result)
 {
     //smartvector<InflectionForm> inflections;
-    deinflectedForms(str, hiraganize(str), 0, std::vector<InfTypes>(), WordTypes::Count, result);
+    deinflectedForms(str, hiraganize(str), 0, std::vector<InfTypes>(), WordTypes::Count, result, false);
     //return inflections;
 }
 
+QString benchmarkDeinflect(const QStringList &words, int repeat)
+{
+    QStringList list = words;
+    if (list.isEmpty())
+    {
+        list << QStringLiteral("たべさせられなかった") << QStringLiteral("食べさせられなかった") <<
+            QStringLiteral("いきたくなかった") << QStringLiteral("よまれています") <<
+            QStringLiteral("かかせてください") << QStringLiteral("みられませんでした") <<
+            QStringLiteral("のんでしまった") << QStringLiteral("こなければならない") <<
+            QStringLiteral("来させられた") << QStringLiteral("いわれたくない") <<
+            QStringLiteral("しなければなりませんでした") << QStringLiteral("べんきょうさせられている") <<
+            QStringLiteral("たかくなかった") << QStringLiteral("よさそう") <<
+            QStringLiteral("あぶなさそう") << QStringLiteral("しずかな") <<
+            QStringLiteral("およいでいる") << QStringLiteral("まっていてください") <<
+            QStringLiteral("はなさなかった") << QStringLiteral("かえらなきゃ");
+    }
+
+    QString report;
+    QTextStream out(&report);
+    out << "Word\tRule tables (ns)\tSuffix trie (ns)\tForms\tEqual\n";
+
+    qint64 sumtables = 0;
+    qint64 sumtrie = 0;
+    int mismatches = 0;
+
+    for (const QString &word : list)
+    {
+        QString hword = hiraganize(word);
+
+        qint64 times[2];
+        smartvector<InflectionForm> results[2];
+        for (int pass = 0; pass != 2; ++pass)
+        {
+            QElapsedTimer t;
+            t.start();
+            for (int ix = 0; ix != repeat; ++ix)
+            {
+                results[pass].clear();
+                deinflectedForms(word, hword, 0, std::vector<InfTypes>(), WordTypes::Count, results[pass], pass == 0);
+            }
+            times[pass] = t.nsecsElapsed() / std::max(1, repeat);
+        }
+
+        bool equal = results[0].size() == results[1].size();
+        for (int ix = 0, siz = tosigned(results[0].size()); equal && ix != siz; ++ix)
+        {
+            const InflectionForm *a = results[0][ix];
+            const InflectionForm *b = results[1][ix];
+            equal = a->form == b->form && a->infsize == b->infsize && a->type == b->type && a->inf == b->inf;
+        }
+
+        if (!equal)
+            ++mismatches;
+
+        sumtables += times[0];
+        sumtrie += times[1];
+        out << word << "\t" << times[0] << "\t" << times[1] << "\t" << tosigned(results[1].size()) << "\t" << (equal ? "yes" : "no") << "\n";
+    }
+
+    out << "Average\t" << sumtables / std::max<qint64>(1, list.size()) << "\t" << sumtrie / std::max<qint64>(1, list.size()) << "\n";
+    out << "Mismatches\t" << mismatches << "\n";
+    out.flush();
+
+    return report;
+}
@@ -28,6 +28,28 @@
 //-------------------------------------------------------------
 
 
+// Records an edit of the items in group g in the user data journal. The data written by func
+// follows the group's type and full name.
+static void addGroupOp(GroupBase *g, Dictionary::UserDataOp op, const std::function<void(QDataStream&)> &func)
+{
+    g->dictionary()->addUserDataOp(Dictionary::UserData::Groups, op, [g, &func](QDataStream &stream) {
+        stream << (quint8)(g->groupType() == GroupTypes::Kanji ? 1 : 0) << g->fullEncodedName();
+        func(stream);
+    });
+}
+
+// Writes ranges for a group edit recorded with addGroupOp().
+static void writeGroupRanges(QDataStream &stream, const smartvector<Range> &ranges)
+{
+    stream << (qint32)ranges.size();
+    for (int ix = 0, siz = tosigned(ranges.size()); ix != siz; ++ix)
+        stream << (qint32)ranges[ix]->first << (qint32)ranges[ix]->last;
+}
+
+
+//-------------------------------------------------------------
+
+
 GroupBase::GroupBase(GroupCategoryBase *parent) : parent(parent)
 {
 
@@ -108,7 +130,7 @@ void GroupBase::setName(QString newname)
     // whether the / character or some other should be forbidden and used as path separator.
 
     _name = newname;
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 const QString GroupBase::fullEncodedName() const
@@ -332,7 +354,7 @@ int GroupCategoryBase::addCategory(QString name)
 {
     list.push_back(createCategory(name));
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     emit owner->categoryAdded(this, tosigned(list.size()) - 1);
     return tosigned(list.size()) - 1;
 }
@@ -341,7 +363,7 @@ int GroupCategoryBase::addGroup(QString name)
 {
     groups.push_back(createGroup(name));
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     emit owner->groupAdded(this, tosigned(groups.size()) - 1);
 
     return tosigned(groups.size()) - 1;
@@ -360,7 +382,7 @@ void GroupCategoryBase::deleteCategory(int index)
     emit owner->categoryAboutToBeDeleted(this, index, list[index]);
 
     list.erase(list.begin() + index);
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 
     emit owner->categoryDeleted(this, index, oldptr);
 }
@@ -382,7 +404,7 @@ void GroupCategoryBase::deleteGroup(int index)
     emit owner->groupAboutToBeDeleted(this, index, groups[index]);
 
     groups.erase(groups.begin() + index);
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 
     owner->emitGroupDeleted(this, index, oldptr);
     //emit owner->groupDeleted(this, index, oldptr);
@@ -416,7 +438,7 @@ void GroupCategoryBase::remove(const std::vector<GroupBase*> &which)
         }
     }
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 bool GroupCategoryBase::moveCategory(GroupCategoryBase *what, GroupCategoryBase *destparent, int destindex)
@@ -463,7 +485,7 @@ bool GroupCategoryBase::moveCategory(GroupCategoryBase *what, GroupCategoryBase
         destparent->list.insert(destparent->list.begin() + destindex, what);
     }
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     emit categoryMoved(p, ix, destparent, destindex);
 
     return true;
@@ -513,7 +535,7 @@ bool GroupCategoryBase::moveGroup(GroupBase *what, GroupCategoryBase *destparent
         destparent->groups.insert(destparent->groups.begin() + destindex, what);
     }
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     emit groupMoved(p, ix, destparent, destindex);
 
     return true;
@@ -573,7 +595,7 @@ void GroupCategoryBase::moveCategories(const std::vector<GroupCategoryBase*> &mo
         }
     }
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 void GroupCategoryBase::moveGroups(const std::vector<GroupBase*> &moved, GroupCategoryBase *destparent, int destindex)
@@ -631,7 +653,7 @@ void GroupCategoryBase::moveGroups(const std::vector<GroupBase*> &moved, GroupCa
         }
     }
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 int GroupCategoryBase::categoryIndex(GroupCategoryBase *child)
@@ -1077,15 +1099,15 @@ void WordGroup::copy(GroupBase *src)
     study.copy(&((WordGroup*)src)->study);
 }
 
-void WordGroup::applyChanges(const std::map<int, int> &changes)
+void WordGroup::applyChanges(const std::vector<int> &changes)
 {
     QSet<int> found;
 
     bool changed = false;
     for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
     {
-        auto it = changes.find(list[ix]);
-        if (it == changes.end() || it->second == -1 || found.contains(it->second))
+        int newindex = changes[list[ix]];
+        if (newindex == -1 || found.contains(newindex))
         {
             list.erase(list.begin() + ix);
             --siz;
@@ -1093,24 +1115,28 @@ void WordGroup::applyChanges(const std::map<int, int> &changes)
             changed = true;
             continue;
         }
-        list[ix] = it->second;
+        list[ix] = newindex;
         changed = true;
-        found.insert(it->second);
+        found.insert(newindex);
     }
 
     study.applyChanges(changes);
 
     if (changed)
-        dictionary()->setToUserModified();
+        dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 void WordGroup::processRemovedWord(int windex)
 {
     study.processRemovedWord(windex);
 
-    int pos = removeIndexFromList(windex, list);
-    if (pos != -1)
-        emit owner().itemsRemoved(this, { { pos, pos } });
+    auto it = std::find(list.begin(), list.end(), windex);
+    if (it == list.end())
+        return;
+
+    int pos = tosigned(it - list.begin());
+    list.erase(it);
+    emit owner().itemsRemoved(this, { { pos, pos } });
 }
 
 void WordGroup::clear()
@@ -1348,7 +1374,9 @@ int WordGroup::insert(int windex, int pos)
     // The wg list holds which groups have the word entry. It must be updated.
     wg.push_front(this);
 
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupInsert, [windex, pos](QDataStream &stream) {
+        stream << (qint32)1 << (qint32)windex << (qint32)pos;
+    });
     emit owner().itemsInserted(this, { { pos, 1 } });
 
     return pos;
@@ -1479,7 +1507,9 @@ int WordGroup::insert(const std::vector<int> &windexes, int pos, std::vector<int
 
     if (added != 0)
     {
-        dictionary()->setToUserModified();
+        addGroupOp(this, Dictionary::UserDataOp::GroupInsert, [&windexes, pos](QDataStream &stream) {
+            stream << make_zvec<qint32, qint32>(windexes) << (qint32)pos;
+        });
         emit owner().itemsInserted(this, { { pos, added } });
     }
 
@@ -1544,7 +1574,9 @@ void WordGroup::remove(const smartvector<Range> &ranges)
         //}
     }
 
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupRemove, [&ranges](QDataStream &stream) {
+        writeGroupRanges(stream, ranges);
+    });
     emit owner().itemsRemoved(this, ranges);
 }
 
@@ -1557,7 +1589,10 @@ void WordGroup::move(const smartvector<Range> &ranges, int pos)
         pos = tosigned(list.size());
 
     if (_moveRanges(ranges, pos, list))
-        dictionary()->setToUserModified();
+        addGroupOp(this, Dictionary::UserDataOp::GroupMove, [&ranges, pos](QDataStream &stream) {
+            writeGroupRanges(stream, ranges);
+            stream << (qint32)pos;
+        });
     emit owner().itemsMoved(this, ranges, pos);
 }
 
@@ -1568,7 +1603,9 @@ void WordGroup::removeAt(int index)
     //emit owner().beginItemsRemove(this, index, index);
 
     list.erase(list.begin() + index);
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupRemove, [index](QDataStream &stream) {
+        stream << (qint32)1 << (qint32)index << (qint32)index;
+    });
 
     emit owner().itemsRemoved(this, { { index, 1 } }/*, index, index*/);
 }
@@ -1586,7 +1623,9 @@ void WordGroup::removeRange(int first, int last)
         removeFromGroup(ix);
 
     list.erase(list.begin() + first, list.begin() + last + 1);
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupRemove, [first, last](QDataStream &stream) {
+        stream << (qint32)1 << (qint32)first << (qint32)last;
+    });
 
     emit owner().itemsRemoved(this, { { first, last } }/*, first, last*/);
 }
@@ -2000,20 +2039,20 @@ void WordGroups::clear()
     emit groupsReseted();
 }
 
-void WordGroups::applyChanges(const std::map<int, int> &changes)
+void WordGroups::applyChanges(const std::vector<int> &changes)
 {
     // Fix the words' groups listing.
     std::map<int, std::forward_list<WordGroup*>> tmp;
     for (auto it = wordsgroups.begin(); it != wordsgroups.end(); ++it)
     {
-        auto ch = changes.find(it->first);
-        if (ch->second != -1)
+        int newindex = changes[it->first];
+        if (newindex != -1)
         {
-            std::forward_list<WordGroup*> &tmplist = tmp[ch->second];
+            std::forward_list<WordGroup*> &tmplist = tmp[newindex];
             if (tmplist.empty())
             {
                 tmplist = std::move(it->second);
-                dictionary()->wordEntry(ch->second)->dat |= (1 << (int)WordRuntimeData::InGroup);
+                dictionary()->wordEntry(newindex)->dat |= (1 << (int)WordRuntimeData::InGroup);
             }
             else
                 tmplist.insert_after(tmplist.before_begin(), it->second.begin(), it->second.end());
@@ -2043,22 +2082,17 @@ void WordGroups::copy(WordGroups *src)
 
 void WordGroups::processRemovedWord(int windex)
 {
-    // Rebuilding the wordsgroups mapping.
+    // Only the groups containing the word are notified. The indexes of other words don't
+    // change until the dictionary is compacted.
+    auto it = wordsgroups.find(windex);
+    if (it == wordsgroups.end())
+        return;
 
-    std::map<int, std::forward_list<WordGroup*>> tmp;
-    std::swap(tmp, wordsgroups);
+    std::forward_list<WordGroup*> glist = std::move(it->second);
+    wordsgroups.erase(it);
 
-    for (auto it = tmp.begin(); it != tmp.end(); ++it)
-    {
-        if (it->first < windex)
-            wordsgroups[it->first] = std::move(it->second);
-        else if (it->first > windex)
-            wordsgroups[it->first - 1] = std::move(it->second);
-    }
-    tmp.clear();
-
-    // Removing the word from each group.
-    walkGroups([windex](GroupBase *g) { ((WordGroup*)g)->processRemovedWord(windex); });
+    for (WordGroup *g : glist)
+        g->processRemovedWord(windex);
 }
 
 Dictionary* WordGroups::dictionary()
@@ -2135,7 +2169,7 @@ void WordGroups::emitGroupDeleted(GroupCategoryBase *p, int index, void *oldaddr
         lastgroup = nullptr;
 }
 
-void WordGroups::groupsApplyChanges(GroupCategoryBase *cat, const std::map<int, int> &changes)
+void WordGroups::groupsApplyChanges(GroupCategoryBase *cat, const std::vector<int> &changes)
 {
     for (int ix = 0, siz = tosigned(cat->size()); ix != siz; ++ix)
         ((WordGroup*)cat->items(ix))->applyChanges(changes);
@@ -2354,7 +2388,9 @@ int KanjiGroup::insert(ushort kindex, int pos)
         return it - list.begin();
 
     list.insert(list.begin() + pos, kindex);
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupInsert, [kindex, pos](QDataStream &stream) {
+        stream << (qint32)1 << (qint32)kindex << (qint32)pos;
+    });
     emit owner().itemsInserted(this, { { pos, 1 } });
 
     return pos;
@@ -2403,7 +2439,9 @@ void KanjiGroup::remove(const smartvector<Range> &ranges)
         //        pos = prev;
     }
 
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupRemove, [&ranges](QDataStream &stream) {
+        writeGroupRanges(stream, ranges);
+    });
     emit owner().itemsRemoved(this, ranges);
 }
 
@@ -2518,7 +2556,9 @@ int KanjiGroup::insert(const std::vector<ushort> &kindexes, int pos, std::vector
         ++aix;
     }
 
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupInsert, [&kindexes, pos](QDataStream &stream) {
+        stream << make_zvec<qint32, qint32>(kindexes) << (qint32)pos;
+    });
     emit owner().itemsInserted(this, { { pos, added } });
 
     return added;
@@ -2530,7 +2570,10 @@ void KanjiGroup::move(const smartvector<Range> &ranges, int pos)
         return;
 
     if (_moveRanges(ranges, pos, list))
-        dictionary()->setToUserModified();
+        addGroupOp(this, Dictionary::UserDataOp::GroupMove, [&ranges, pos](QDataStream &stream) {
+            writeGroupRanges(stream, ranges);
+            stream << (qint32)pos;
+        });
 
     emit owner().itemsMoved(this, ranges, pos);
 }
@@ -2544,7 +2587,9 @@ void KanjiGroup::removeAt(int index)
 
     //emit owner().beginItemsRemove(this, index, index);
     list.erase(list.begin() + index);
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupRemove, [index](QDataStream &stream) {
+        stream << (qint32)1 << (qint32)index << (qint32)index;
+    });
 
     emit owner().itemsRemoved(this, { { index, index } }/*, first, last*/);
 }
@@ -2558,7 +2603,9 @@ void KanjiGroup::removeRange(int first, int last)
 
     //emit owner().beginItemsRemove(this, first, last);
     list.erase(list.begin() + first, list.begin() + last + 1);
-    dictionary()->setToUserModified();
+    addGroupOp(this, Dictionary::UserDataOp::GroupRemove, [first, last](QDataStream &stream) {
+        stream << (qint32)1 << (qint32)first << (qint32)last;
+    });
 
     emit owner().itemsRemoved(this, { { first, last } }/*, first, last*/);
 }
@@ -2769,7 +2816,7 @@ const Dictionary* Groups::dictionary() const
     return dict;
 }
 
-void Groups::applyChanges(std::map<int, int> &changes)
+void Groups::applyChanges(const std::vector<int> &changes)
 {
     wordgroups.applyChanges(changes);
 }
@@ -406,13 +406,13 @@ public:
 
     virtual void copy(GroupBase *src) override;
 
-    // Changes the word indexes from the original values to the mapped values.
-    // Words with no original or a mapped value of -1 will be removed.
+    // Changes the word indexes from the original values to the mapped values. The new index
+    // of a word is at its original index in changes. Words mapped to -1 will be removed.
     // Duplicates are removed too.
-    void applyChanges(const std::map<int, int> &changes);
+    void applyChanges(const std::vector<int> &changes);
 
-    // Removes the passed index from the group's words list, decrements the index of words
-    // above this value, and checks whether study is valid after the removal.
+    // Removes the passed index from the group's words list, and checks whether study is valid
+    // after the removal. The index of other words is not changed.
     void processRemovedWord(int windex);
 
     void clear();
@@ -552,12 +552,12 @@ public:
     void loadLegacy(QDataStream &stream, bool study, int version);
     // End legacy load functions
 
-    void applyChanges(const std::map<int, int> &changes);
+    void applyChanges(const std::vector<int> &changes);
 
     void copy(WordGroups *src);
 
-    // Removes any data of the passed word index from groups and decrements the index of words
-    // above this value.
+    // Removes any data of the passed word index from the groups containing it. The index of
+    // other words is not changed.
     void processRemovedWord(int windex);
 
     virtual Dictionary* dictionary() override;
@@ -594,7 +594,7 @@ private:
     virtual void emitGroupDeleted(GroupCategoryBase *parent, int index, void *oldaddress) override;
 
     // Calls applyChanges for the passed category's items and sub categories.
-    void groupsApplyChanges(GroupCategoryBase *cat, const std::map<int, int> &changes);
+    void groupsApplyChanges(GroupCategoryBase *cat, const std::vector<int> &changes);
 
     // Newly creates the data in wordsgroups.
     void fixWordsGroups();
@@ -793,11 +793,11 @@ public:
     Dictionary* dictionary();
     const Dictionary* dictionary() const;
 
-    // Changes the original index to the new index after a dictionary update. The changes map
-    // contains the words' original index in the old dictionary, and the new index in newdict.
+    // Changes the original index to the new index after a dictionary update. The changes list
+    // holds the words' new index in newdict at their original index in the old dictionary.
     // If the new index is -1, the word was not found in the new dictionary and its data
     // should be removed.
-    void applyChanges(std::map<int, int> &changes);
+    void applyChanges(const std::vector<int> &changes);
 
     void copy(Groups *src);
 
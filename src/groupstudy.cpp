@@ -215,7 +215,7 @@ WordGroup* WordStudy::getOwner()
     return owner;
 }
 
-void WordStudy::applyChanges(const std::map<int, int> &changes)
+void WordStudy::applyChanges(const std::vector<int> &changes)
 {
     std::set<int> found;
 
@@ -224,33 +224,32 @@ void WordStudy::applyChanges(const std::map<int, int> &changes)
     list.reserve(tmp.size());
     for (int ix = 0, siz = tosigned(tmp.size()); ix != siz; ++ix)
     {
-        auto it = changes.find(tmp[ix].windex);
-        if (it == changes.end() || it->second == -1 || found.count(it->second))
+        int newindex = changes[tmp[ix].windex];
+        if (newindex == -1 || found.count(newindex))
         {
-            if (it != changes.end())
+            // The testitems positions of items already removed were decremented, so the
+            // removed item is at the position it would get in the updated list.
+            int pos = tosigned(list.size());
+            for (int iy = tosigned(testitems.size()) - 1; iy != -1; --iy)
             {
-                for (int iy = tosigned(testitems.size()) - 1; iy != -1; --iy)
+                if (testitems[iy].pos > pos)
+                    --testitems[iy].pos;
+                else if (testitems[iy].pos == pos)
                 {
-                    if (testitems[iy].pos > ix)
-                        --testitems[iy].pos;
-                    else if (testitems[iy].pos == ix)
+                    testitems.erase(testitems.begin() + iy);
+
+                    if (state != nullptr && !state->itemRemoved(iy, testSize()))
                     {
-                        testitems.erase(testitems.begin() + iy);
-
-                        if (state != nullptr && !state->itemRemoved(iy, testSize()))
-                        {
-                            // TODO: notify the user that the study of the group has been abandoned.
-                            // If possible in a single message about every group.
-                            state.reset();
-                        }
+                        // TODO: notify the user that the study of the group has been abandoned.
+                        // If possible in a single message about every group.
+                        state.reset();
                     }
                 }
-                --ix;
             }
             continue;
         }
-        found.insert(it->second);
-        tmp[ix].windex = it->second;
+        found.insert(newindex);
+        tmp[ix].windex = newindex;
         list.push_back(tmp[ix]);
     }
 
@@ -282,12 +281,10 @@ void WordStudy::processRemovedWord(int windex)
     int indexindex = -1;
     int posindex = -1;
 
-    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
+    for (int ix = 0, siz = tosigned(list.size()); indexindex == -1 && ix != siz; ++ix)
     {
         if (list[ix].windex == windex)
             indexindex = ix;
-        else if (list[ix].windex > windex)
-            --list[ix].windex;
     }
 
     if (indexindex != -1)
@@ -450,19 +447,19 @@ void WordStudy::initTest()
     }
 
     state->init(testSize());
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 bool WordStudy::initNext()
 {
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     return state->initNext(testSize());
 }
 
 void WordStudy::finish()
 {
     state->finish(testSize());
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 const WordStudySettings& WordStudy::studySettings() const
@@ -492,7 +489,7 @@ void WordStudy::setup(const WordStudySettings &newsettings, const std::vector<Wo
 
     state.reset();
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 void WordStudy::abort()
@@ -503,7 +500,7 @@ void WordStudy::abort()
 
     state.reset();
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 void WordStudy::excludeWord(int windex)
@@ -512,7 +509,7 @@ void WordStudy::excludeWord(int windex)
     if (it == list.end() || it->excluded)
         return;
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     it->excluded = true;
 }
 
@@ -521,7 +518,7 @@ void WordStudy::includeWord(int windex)
     auto it = std::find_if(list.begin(), list.end(), [windex](const WordStudyItem &item) { return item.windex == windex; });
     if (it == list.end() || !it->excluded)
         return;
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     it->excluded = false;
 }
 
@@ -599,14 +596,14 @@ void WordStudy::answer(bool correct)
     if (!correct)
         ++testitems[pos].incorrect;
     state->answer(correct, testSize());
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 void WordStudy::changeAnswer(bool correct)
 {
     int p = state->roundPosition() - 1;
     setTestedCorrect(p, correct);
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 bool WordStudy::canUndo() const
@@ -644,7 +641,7 @@ void WordStudy::applyScore()
         titem.correct = titem.incorrect = 0;
     }
     if (changed)
-        dictionary()->setToUserModified();
+        dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 int WordStudy::testedCount() const
@@ -705,7 +702,7 @@ void WordStudy::setTestedCorrect(int pos, bool correct)
         --testitems[p].correct;
         ++testitems[p].incorrect;
     }
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
 }
 
 bool WordStudy::previousCorrect() const
@@ -730,7 +727,7 @@ int WordStudy::newCount() const
 {
     if (settings.method != WordStudyMethod::Gradual)
         return 0;
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Groups);
     return ((const WordStudyGradual*)state.get())->newCount(testSize());
 }
 
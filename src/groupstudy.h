@@ -124,16 +124,16 @@ public:
 
     WordGroup *getOwner();
 
-    // Changes the word indexes from the original values to the mapped values. Words with no
-    // original or a mapped value of -1 will be removed. Duplicates are removed too.
+    // Changes the word indexes from the original values to the mapped values at the original
+    // index in changes. Words mapped to -1 will be removed. Duplicates are removed too.
     // It's possible a suspended study becomes unusable after too many changes.
-    void applyChanges(const std::map<int, int> &changes);
+    void applyChanges(const std::vector<int> &changes);
 
     // Creates an exact copy of source, apart from the owner group, which stays the same.
     void copy(WordStudy *src);
 
-    // Called when a word has been removed from the main dictionary. Updates the indexes of
-    // studied words, decrementing those with a higher value. 
+    // Called when a word has been removed from the main dictionary. Removes the word from the
+    // studied words. The index of other words is not changed.
     void processRemovedWord(int windex);
 
     // Returns the list of the current words and their states.
@@ -9,8 +9,10 @@
 #include <QInputDialog>
 #include <QDir>
 #include <QtEndian>
+#include <QThreadPool>
 
 #include <set>
+#include <cstring>
 
 #include "import.h"
 
@@ -36,7 +38,7 @@
 
 
 extern char ZKANJI_PROGRAM_VERSION[];
-static char ZKANJI_EXAMPLES_FILE_VERSION[] = "002";
+static char ZKANJI_EXAMPLES_FILE_VERSION[] = "003";
 
 // When changed: also update exportDictionary() in words.cpp.
 static const char JMDictInfoText[] = "This program uses a compilation of the <a href=\"http://www.edrdg.org/jmdict/j_jmdict.html\">JMdict</a> "
@@ -169,6 +171,7 @@ void ImportFileHandler::close()
     linenum = 0;
     skipread = false;
     line = QString();
+    buffer = QByteArray();
 }
 
 bool ImportFileHandler::isOpen() const
@@ -236,6 +239,30 @@ QString ImportFileHandler::lastLine() const
     return line;
 }
 
+const char* ImportFileHandler::data(qint64 &size)
+{
+    size = 0;
+    if (fail || f == nullptr)
+        return nullptr;
+
+    size = f->size();
+    if (size == 0)
+        return "";
+
+    uchar *mapped = f->map(0, size);
+    if (mapped != nullptr)
+        return reinterpret_cast<const char*>(mapped);
+
+    if (!f->seek(0))
+    {
+        size = 0;
+        return nullptr;
+    }
+    buffer = f->readAll();
+    size = buffer.size();
+    return buffer.constData();
+}
+
 //bool ImportFileHandler::atEnd() const
 //{
 //    return fail || f == nullptr || (!skipread && stream.atEnd());
@@ -275,11 +302,49 @@ void ImportFileHandler::guardClose(ImportFileHandlerGuard *guard)
 }
 
 
+//-------------------------------------------------------------
+
+
+ImportLineSplitter::ImportLineSplitter(const char *data, qint64 size) : data(data), size(size), p(0)
+{
+
+}
+
+bool ImportLineSplitter::next(const char *&line, int &len)
+{
+    if (p >= size)
+        return false;
+
+    line = data + p;
+    const char *end = (const char*)memchr(line, '\n', size - p);
+    if (end == nullptr)
+    {
+        len = (int)(size - p);
+        p = size;
+    }
+    else
+    {
+        len = (int)(end - line);
+        p += len + 1;
+    }
+
+    if (len != 0 && line[len - 1] == '\r')
+        --len;
+
+    return true;
+}
+
+qint64 ImportLineSplitter::pos() const
+{
+    return p;
+}
+
+
 
 //-------------------------------------------------------------
 
 
-DictImport::DictImport(QWidget *parent) : base(parent, false), ui(new Ui::DictImport), modified(false), stepcnt(0), step(1), kcurrent(nullptr), rcurrent(nullptr), scurrent(nullptr),
+DictImport::DictImport(QWidget *parent) : base(parent, false), ui(new Ui::DictImport), modified(false), stepcnt(0), step(1),
         /*entryr(0), entrys(0),*/ counter(0)
 {
     ui->setupUi(this);
@@ -478,6 +543,7 @@ bool DictImport::event(QEvent *e)
                 if (fullimport)
                 {
                     ZKanji::kanjis.clear();
+                    ZKanji::kanjistrings.clear();
                     ZKanji::validkanji.clear();
                     ZKanji::radklist.clear();
                     ZKanji::radlist.clear();
@@ -702,6 +768,8 @@ bool DictImport::doImportExamples()
 
     // Japanese and English id pairs in order they are found in the imported and created data.
     std::vector<std::pair<int, int>> ids;
+    // Search index of the sentences saved at the end of the file.
+    ExampleIndex index;
 
     // Index of the current block. Incremented at every 100 sentences.
     ushort blockix = 0;
@@ -889,7 +957,7 @@ bool DictImport::doImportExamples()
             std::vector<int> wordsfound;
             if (kanaform != nullptr)
             {
-                int wix = dict->findKanjiKanaWord(kanjiform, kanaform, nullptr, kanjisiz, kanasiz, -1);
+                int wix = dict->findKanjiKanaWord(kanjiform, kanaform, kanjisiz, kanasiz);
                 if (wix != -1)
                 {
                     WordEntry *e = dict->wordEntry(wix);
@@ -961,6 +1029,7 @@ bool DictImport::doImportExamples()
         std::pair<int, int> sid = std::make_pair(id_jp, id_tr);
         idtaken.insert(sid);
         ids.push_back(sid);
+        index.add(jpn, trans);
 
         doImportExamplesSentenceHelper(buff, jpn, trans, exwords);
 
@@ -1070,6 +1139,17 @@ bool DictImport::doImportExamples()
     ostream << (qint32)dat.size();
     ostream.writeRawData(dat.constData(), dat.size());
 
+    // The search index.
+    QByteArray idat;
+    QDataStream istream(&idat, QIODevice::WriteOnly);
+    istream.setVersion(QDataStream::Qt_5_5);
+    istream.setByteOrder(QDataStream::LittleEndian);
+    index.save(istream);
+
+    dat = qCompress(idat);
+    ostream << (qint32)dat.size();
+    ostream.writeRawData(dat.constData(), dat.size());
+
     //ostream << (qint32)0;
 
     ostream << (quint32)(of.pos() + 4);
@@ -1659,16 +1739,25 @@ Dictionary* DictImport::importJMdict()
     qint64 s = file.size();
     ui->progressBar->setMaximum(s);
 
-    QString str;
+    // The file is split into lines without decoding it first. Only lines that are parsed
+    // are converted to QString.
+    qint64 datasize;
+    const char *data = file.data(datasize);
+    if (data == nullptr)
+    {
+        setErrorText(tr("Couldn't open JMdict."));
+        return nullptr;
+    }
+    ImportLineSplitter lines(data, datasize);
+
+    const char *line;
+    int len;
 
     bool linefound = false;
     // Skip till the start of data.
-    while (file.getLine(str))
+    while (lines.next(line, len))
     {
-        if (!nextUpdate(file.pos()))
-            return nullptr;
-
-        if (str == "<JMdict>")
+        if (len == 8 && strncmp(line, "<JMdict>", 8) == 0)
         {
             linefound = true;
             break;
@@ -1687,209 +1776,73 @@ Dictionary* DictImport::importJMdict()
         return nullptr;
     ++step;
 
-    // Current line.
+    // Entries are parsed in batches on separate threads. The file is cut at <entry> lines
+    // into batches, which are parsed in rounds of several batches at a time. The words of
+    // each round are added in the order of the batches, so the result is the same as if the
+    // file was parsed in a single pass.
 
-    // Inside kanji element.
-    bool kele = false;
-    // Inside reading element.
-    bool rele = false;
-    // Inside sense element.
-    bool sense = false;
+    // Number of entries parsed by a single parser.
+    const int batchentries = 500;
+    const int roundbatches = std::max(1, QThreadPool::globalInstance()->maxThreadCount()) * 2;
 
-    // Skipping word because of an error.
-    bool skip = false;
+    // The kanji index is filled on first use, which is not safe from several threads.
+    ZKanji::kanjiIndex(QChar());
 
-#ifdef COLLECT_WORD_DATA
-    // Word data in JMdict from 2015.08.26:
-    // Types 84: adj-f adj-i adj-ix adj-ku adj-na adj-nari adj-no adj-pn
-    // adj-shiku adj-t adv adv-to aux aux-adj aux-v conj cop-da ctr exp int n
-    // n-adv n-pr n-pref n-suf n-t num pn pref prt suf unc v1 v1-s v2a-s v2b-k
-    // v2d-s v2g-k v2g-s v2h-k v2h-s v2k-k v2k-s v2m-s v2n-s v2r-k v2r-s v2s-s
-    // v2t-k v2t-s v2w-s v2y-k v2y-s v2z-s v4b v4h v4k v4m v4r v4s v4t v5aru
-    // v5b v5g v5k v5k-s v5m v5n v5r v5r-i v5s v5t v5u v5u-s vi vk vn vr vs
-    // vs-c vs-i vs-s vt vz 
-
-    // Fields 30: Buddh MA Shinto anat archit astron baseb biol bot bus chem
-    // comp econ engr finc food geol geom law ling mahj math med mil music
-    // physics shogi sports sumo zool 
-
-    // Notes 32 : abbr arch ateji chn col derog fam fem gikun hon hum iK id ik
-    // io joc m-sl male oK obs obsc ok on-mim poet pol proverb rare sens
-    // sl uk vulg yoji
-
-    std::set<QString> fields;
-    std::set<QString> types;
-    std::set<QString> notes;
-#endif
+    // Start and end positions of the batches in the current round.
+    std::vector<std::pair<qint64, qint64>> batches;
+    batches.reserve(roundbatches);
+    std::vector<std::unique_ptr<JMdictEntryParser>> parsers;
+    parsers.reserve(roundbatches);
 
-    while (file.getLine(str))
+    qint64 batchstart = lines.pos();
+    int entrycnt = 0;
+    bool atend = false;
+    while (!atend)
     {
-        if (str != "<entry>")
+        batches.clear();
+        while ((int)batches.size() != roundbatches)
         {
-            if (!nextUpdate(file.pos()))
-                return nullptr;
-            continue;
-        }
-
-#ifdef COLLECT_WORD_DATA
-        if (str.startsWith("<field>") && str.endsWith("</field>"))
-            fields.insert(str.mid(8, str.size() - 8 - 9));
-        else if (str.startsWith("<ke_inf>") && str.endsWith("</ke_inf>"))
-            notes.insert(str.mid(9, str.size() - 9 - 10));
-        else if (str.startsWith("<re_inf>") && str.endsWith("</re_inf>"))
-            notes.insert(str.mid(9, str.size() - 9 - 10));
-        else if (str.startsWith("<misc>") && str.endsWith("</misc>"))
-            notes.insert(str.mid(7, str.size() - 7 - 8));
-        else if (str.startsWith("<pos>") && str.endsWith("</pos>"))
-            types.insert(str.mid(6, str.size() - 6 - 7));
-#endif
-
-        if (skip == true)
-            skip = false;
-        newEntry();
-        skip = false;
-
-        kele = false;
-        rele = false;
-        sense = false;
-
-        linefound = false;
-        while (!skip && file.getLine(str))
-        {
-            // Inside an entry. Look for the possible kanji and kana pairs.
-            if (str != "</entry>" && str != "<k_ele>" && str != "<r_ele>" && str != "<sense>")
+            qint64 linestart = lines.pos();
+            if (!lines.next(line, len))
             {
-                if (!nextUpdate(file.pos()))
-                    return nullptr;
-                continue;
-            }
-
-            if (str == "</entry>")
-            {
-                linefound = true;
-                saveEntry();
+                atend = true;
+                if (linestart != batchstart)
+                    batches.push_back(std::make_pair(batchstart, linestart));
                 break;
             }
 
-            kele = (str == "<k_ele>");
-            // Writing tag is not valid after a reading or a sense part.
-            if (kele && (rele || sense))
-                skip = true;
-            rele = (str == "<r_ele>");
-            // Reading tag is not valid after a sense part.
-            if (rele && sense)
-                skip = true;
-            sense = (str == "<sense>");
-
-            if (!skip && kele)
-                skip = !newKElement();
-            if (!skip && rele)
-                skip = !newRElement();
-            if (!skip && sense)
-                skip = !newSElement();
+            if (len != 7 || strncmp(line, "<entry>", 7) != 0)
+                continue;
 
-            while (kele && !skip && file.getLine(str))
+            if (entrycnt == batchentries)
             {
-                if (!nextUpdate(file.pos()))
-                    return nullptr;
-
-                if (str == "</k_ele>")
-                {
-                    saveKElement();
-                    break;
-                }
-                else if (str.startsWith("<keb>"))
-                    skip = !addKeb(str);
-                else if (str.startsWith("<ke_inf>&"))
-                    skip = !addKInf(str);
-                else if (str.startsWith("<ke_pri>"))
-                    skip = !addKPri(str);
-                // Possible error in file format, skip the whole word.
-                else if (!str.startsWith("<ke") && !str.startsWith("</ke"))
-                    skip = true;
+                batches.push_back(std::make_pair(batchstart, linestart));
+                batchstart = linestart;
+                entrycnt = 0;
             }
+            ++entrycnt;
+        }
 
-            while (rele && !skip && file.getLine(str))
-            {
-                if (!nextUpdate(file.pos()))
-                    return nullptr;
+        parsers.clear();
+        for (int ix = 0, siz = tosigned(batches.size()); ix != siz; ++ix)
+            parsers.push_back(std::make_unique<JMdictEntryParser>(lang));
 
-                if (str == "</r_ele>")
-                {
-                    saveRElement();
-                    break;
-                }
-                else if (str.startsWith("<reb>"))
-                    skip = !addReb(str);
-                else if (str.startsWith("<re_restr"))
-                    skip = !addRRestr(str);
-                else if (str.startsWith("<re_inf>&"))
-                    skip = !addRInf(str);
-                else if (str.startsWith("<re_pri>"))
-                    skip = !addRPri(str);
-                // Possible error in file format, skip the whole word.
-                else if (!str.startsWith("<re") && !str.startsWith("</re"))
-                    skip = true;
-            }
+        ZKanji::parallelFor(tosigned(batches.size()), [&batches, &parsers, data](int ix) {
+            parsers[ix]->parse(data + batches[ix].first, batches[ix].second - batches[ix].first);
+        });
 
-            while (sense && !skip && file.getLine(str))
-            {
-                if (!nextUpdate(file.pos()))
-                    return nullptr;
-                if (str == "</sense>")
-                {
-                    saveSElement();
-                    break;
-                }
-                else if (str.startsWith("<stagk>"))
-                    skip = !addSTagK(str);
-                else if (str.startsWith("<stagr>"))
-                    skip = !addSTagR(str);
-                else if (str.startsWith("<pos>&"))
-                    skip = !addSPos(str);
-                else if (str.startsWith("<field>&"))
-                    skip = !addSField(str);
-                else if (str.startsWith("<misc>&"))
-                    skip = !addSMisc(str);
-                else if (str.startsWith("<dial>&"))
-                    skip = !addSDial(str);
-                else if ((lang.isEmpty() && str.startsWith("<gloss>")) || (!lang.isEmpty() && str.startsWith(QStringLiteral("<gloss xml:lang=\"%1\">").arg(lang))))
-                    skip = !addGloss(str);
-                // Possible error in file format, skip the whole word.
-                else if (!str.startsWith("<") || str.startsWith("<ke_") || str.startsWith("<k_") || str.startsWith("<re_") || str.startsWith("<entry>") ||
-                        str.startsWith("</ke_") || str.startsWith("</k_") || str.startsWith("</re_") || str.startsWith("</entry>"))
-                    skip = true;
-            }
+        for (auto &parser : parsers)
+        {
+            std::vector<WordEntry*> found;
+            parser->words().swap(found);
+            for (WordEntry *w : found)
+                words.push_back(w);
         }
 
-        if (!linefound)
-            saveEntry();
+        if (!nextUpdate(lines.pos(), true))
+            return nullptr;
     }
 
-#ifdef COLLECT_WORD_DATA
-    str.clear();
-    str += "Types " + QString::number(types.size()) + ": ";
-    for (const QString &s : types)
-        str += s + " ";
-
-    str += "\n\n";
-
-    str += "Fields " + QString::number(fields.size()) + ": ";
-    for (const QString &s : fields)
-        str += s + " ";
-
-    str += "\n\n";
-
-    str += "Notes " + QString::number(notes.size()) + ": ";
-    for (const QString &s : notes)
-        str += s + " ";
-
-
-    str = str.trimmed();
-
-    QMessageBox::information(this, "Types, notes, fields:", str, QMessageBox::Ok);
-#endif
-
     file.close();
 
     TextSearchTree ktree(nullptr, true, false);
@@ -1906,17 +1859,16 @@ Dictionary* DictImport::importJMdict()
 
             while (tok.next())
                 texts << QString(tok.token(), tok.tokenSize());
-        }},
-        [this]() { return nextUpdate(); });
+        }});
     TreeBuilder iktree(ktree, tosigned(words.size()),
-        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); },
-        [this]() { return nextUpdate(); });
+        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); });
     TreeBuilder ibtree(btree, tosigned(words.size()),
-        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); },
-        [this]() { return nextUpdate(); });
+        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); });
+    // The three trees are built at the same time on separate threads.
+    std::vector<TreeBuilder*> builders = { &iktree, &ibtree, &idtree };
     smartvector<KanjiDictData> kanjidata;
-    std::map<ushort, std::vector<int>> symdata;
-    std::map<ushort, std::vector<int>> kanadata;
+    std::map<ushort, PostingList> symdata;
+    std::map<ushort, PostingList> kanadata;
     std::vector<int> abcde;
     std::vector<int> aiueo;
 
@@ -1929,7 +1881,7 @@ Dictionary* DictImport::importJMdict()
 
     ui->progressBar->setMaximum(iktree.initSize() + ibtree.initSize() + idtree.initSize());
 
-    while (iktree.initNext() || ibtree.initNext() || idtree.initNext())
+    while (TreeBuilder::initNext(builders))
     {
         if (!nextUpdate(iktree.initPos() + ibtree.initPos() + idtree.initPos(), true))
             return nullptr;
@@ -1944,7 +1896,7 @@ Dictionary* DictImport::importJMdict()
 
     ui->progressBar->setMaximum(iktree.importSize() + ibtree.importSize() + idtree.importSize());
 
-    while (iktree.sortNext() || ibtree.sortNext() || idtree.sortNext())
+    while (TreeBuilder::sortNext(builders))
     {
         if (!nextUpdate(iktree.importPos() + ibtree.importPos() + idtree.importPos(), true))
             return nullptr;
@@ -1976,7 +1928,7 @@ Dictionary* DictImport::importJMdict()
             {
                 int kix = ZKanji::kanjiIndex(kanji[iy]);
 
-                std::vector<int> &wvec = kanjidata[kix]->words;
+                PostingList &wvec = kanjidata[kix]->words;
                 if (!wvec.empty() && wvec.back() == ix)
                     continue;
                 wvec.push_back(ix);
@@ -1985,7 +1937,7 @@ Dictionary* DictImport::importJMdict()
             }
             else if (!KANA(kanji[iy].unicode()) && UNICODE_J(kanji[iy].unicode()))
             {
-                std::vector<int> &svec = symdata[kanji[iy].unicode()];
+                PostingList &svec = symdata[kanji[iy].unicode()];
                 if (!svec.empty() && svec.back() == ix)
                     continue;
                 svec.push_back(ix);
@@ -2005,7 +1957,7 @@ Dictionary* DictImport::importJMdict()
             if (!kanavowelize(ch, dummy, romaji + iy, len - iy))
                 continue;
 
-            std::vector<int> &kvec = kanadata[ch];
+            PostingList &kvec = kanadata[ch];
             if (!kvec.empty() && kvec.back() == ix)
                 continue;
             kvec.push_back(ix);
@@ -2022,7 +1974,7 @@ Dictionary* DictImport::importJMdict()
             if (KATAKANA(ch) && ch <= 0x30F4)
                 ch -= 0x60;
 
-            std::vector<int> &kvec = kanadata[ch];
+            PostingList &kvec = kanadata[ch];
             if (!kvec.empty() && kvec.back() == ix)
                 continue;
             kvec.push_back(ix);
@@ -2319,8 +2271,8 @@ bool DictImport::doImportFromExport()
     QString infotext;
     smartvector<KanjiDictData> kanjidata;
     kanjidata.resize(ZKanji::kanjicount, KanjiDictData());
-    std::map<ushort, std::vector<int>> symdata;
-    std::map<ushort, std::vector<int>> kanadata;
+    std::map<ushort, PostingList> symdata;
+    std::map<ushort, PostingList> kanadata;
     std::vector<int> abcde;
     std::vector<int> aiueo;
 
@@ -2438,14 +2390,13 @@ bool DictImport::doImportFromExport()
 
         while (tok.next())
             texts << QString(tok.token(), tok.tokenSize());
-    }},
-        [this]() { return nextUpdate(); });
+    }});
     TreeBuilder iktree(ktree, tosigned(words.size()),
-        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); },
-        [this]() { return nextUpdate(); });
+        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); });
     TreeBuilder ibtree(btree, tosigned(words.size()),
-        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); },
-        [this]() { return nextUpdate(); });
+        [this](int wix, QStringList& texts) { texts << words[wix]->romaji.toQStringRaw(); });
+    // The three trees are built at the same time on separate threads.
+    std::vector<TreeBuilder*> builders = { &iktree, &ibtree, &idtree };
 
     ui->progressBar->setValue(0);
     ui->progressBar->setMaximum(6);
@@ -2456,7 +2407,7 @@ bool DictImport::doImportFromExport()
 
     ui->progressBar->setMaximum(iktree.initSize() + ibtree.initSize() + idtree.initSize());
 
-    while (iktree.initNext() || ibtree.initNext() || idtree.initNext())
+    while (TreeBuilder::initNext(builders))
     {
         if (!nextUpdate(iktree.initPos() + ibtree.initPos() + idtree.initPos(), true))
             return false;
@@ -2471,7 +2422,7 @@ bool DictImport::doImportFromExport()
 
     ui->progressBar->setMaximum(iktree.importSize() + ibtree.importSize() + idtree.importSize());
 
-    while (iktree.sortNext() || ibtree.sortNext() || idtree.sortNext())
+    while (TreeBuilder::sortNext(builders))
     {
         if (!nextUpdate(iktree.importPos() + ibtree.importPos() + idtree.importPos(), true))
             return false;
@@ -2500,7 +2451,7 @@ bool DictImport::doImportFromExport()
             {
                 int kix = ZKanji::kanjiIndex(kanji[iy]);
 
-                std::vector<int> &wvec = kanjidata[kix]->words;
+                PostingList &wvec = kanjidata[kix]->words;
                 if (!wvec.empty() && wvec.back() == ix)
                     continue;
                 wvec.push_back(ix);
@@ -2510,7 +2461,7 @@ bool DictImport::doImportFromExport()
             }
             else if (!KANA(kanji[iy].unicode()) && UNICODE_J(kanji[iy].unicode()))
             {
-                std::vector<int> &svec = symdata[kanji[iy].unicode()];
+                PostingList &svec = symdata[kanji[iy].unicode()];
                 if (!svec.empty() && svec.back() == ix)
                     continue;
                 svec.push_back(ix);
@@ -2530,7 +2481,7 @@ bool DictImport::doImportFromExport()
             if (!kanavowelize(ch, dummy, romaji + iy, len - iy))
                 continue;
 
-            std::vector<int> &kvec = kanadata[ch];
+            PostingList &kvec = kanadata[ch];
             if (!kvec.empty() && kvec.back() == ix)
                 continue;
             kvec.push_back(ix);
@@ -2547,7 +2498,7 @@ bool DictImport::doImportFromExport()
             if (KATAKANA(ch) && ch <= 0x30F4)
                 ch -= 0x60;
 
-            std::vector<int> &kvec = kanadata[ch];
+            PostingList &kvec = kanadata[ch];
             if (!kvec.empty() && kvec.back() == ix)
                 continue;
             kvec.push_back(ix);
@@ -2728,7 +2679,7 @@ bool DictImport::doImportFromExportPartial()
     for (int ix = 0, siz = tosigned(words.size()); ix != siz; ++ix)
     {
         WordEntry *e = words[ix];
-        int windex = dict->findKanjiKanaWord(e->kanji.data(), e->kana.data(), e->romaji.data());
+        int windex = dict->findKanjiKanaWord(e);
         if (windex != -1)
             dict->cloneWordData(windex, words[ix], false, false);
         else
@@ -3577,7 +3528,157 @@ bool DictImport::kanjiKana(const QString &str, int p, QString &kanji, QString &k
     return true;
 }
 
-void DictImport::newEntry()
+JMdictEntryParser::JMdictEntryParser(const QString &lang) : lang(lang), kcurrent(nullptr), rcurrent(nullptr), scurrent(nullptr)
+{
+
+}
+
+void JMdictEntryParser::parse(const char *data, qint64 size)
+{
+    ImportLineSplitter lines(data, size);
+
+    QString str;
+    auto getLine = [&lines, &str]() {
+        const char *line;
+        int len;
+        if (!lines.next(line, len))
+            return false;
+        str = QString::fromUtf8(line, len);
+        return true;
+    };
+
+    // Inside kanji element.
+    bool kele = false;
+    // Inside reading element.
+    bool rele = false;
+    // Inside sense element.
+    bool sense = false;
+
+    // Skipping word because of an error.
+    bool skip = false;
+
+    bool linefound;
+
+    while (getLine())
+    {
+        if (str != "<entry>")
+            continue;
+
+        newEntry();
+        skip = false;
+
+        kele = false;
+        rele = false;
+        sense = false;
+
+        linefound = false;
+        while (!skip && getLine())
+        {
+            // Inside an entry. Look for the possible kanji and kana pairs.
+            if (str != "</entry>" && str != "<k_ele>" && str != "<r_ele>" && str != "<sense>")
+                continue;
+
+            if (str == "</entry>")
+            {
+                linefound = true;
+                saveEntry();
+                break;
+            }
+
+            kele = (str == "<k_ele>");
+            // Writing tag is not valid after a reading or a sense part.
+            if (kele && (rele || sense))
+                skip = true;
+            rele = (str == "<r_ele>");
+            // Reading tag is not valid after a sense part.
+            if (rele && sense)
+                skip = true;
+            sense = (str == "<sense>");
+
+            if (!skip && kele)
+                skip = !newKElement();
+            if (!skip && rele)
+                skip = !newRElement();
+            if (!skip && sense)
+                skip = !newSElement();
+
+            while (kele && !skip && getLine())
+            {
+                if (str == "</k_ele>")
+                {
+                    saveKElement();
+                    break;
+                }
+                else if (str.startsWith("<keb>"))
+                    skip = !addKeb(str);
+                else if (str.startsWith("<ke_inf>&"))
+                    skip = !addKInf(str);
+                else if (str.startsWith("<ke_pri>"))
+                    skip = !addKPri(str);
+                // Possible error in file format, skip the whole word.
+                else if (!str.startsWith("<ke") && !str.startsWith("</ke"))
+                    skip = true;
+            }
+
+            while (rele && !skip && getLine())
+            {
+                if (str == "</r_ele>")
+                {
+                    saveRElement();
+                    break;
+                }
+                else if (str.startsWith("<reb>"))
+                    skip = !addReb(str);
+                else if (str.startsWith("<re_restr"))
+                    skip = !addRRestr(str);
+                else if (str.startsWith("<re_inf>&"))
+                    skip = !addRInf(str);
+                else if (str.startsWith("<re_pri>"))
+                    skip = !addRPri(str);
+                // Possible error in file format, skip the whole word.
+                else if (!str.startsWith("<re") && !str.startsWith("</re"))
+                    skip = true;
+            }
+
+            while (sense && !skip && getLine())
+            {
+                if (str == "</sense>")
+                {
+                    saveSElement();
+                    break;
+                }
+                else if (str.startsWith("<stagk>"))
+                    skip = !addSTagK(str);
+                else if (str.startsWith("<stagr>"))
+                    skip = !addSTagR(str);
+                else if (str.startsWith("<pos>&"))
+                    skip = !addSPos(str);
+                else if (str.startsWith("<field>&"))
+                    skip = !addSField(str);
+                else if (str.startsWith("<misc>&"))
+                    skip = !addSMisc(str);
+                else if (str.startsWith("<dial>&"))
+                    skip = !addSDial(str);
+                else if ((lang.isEmpty() && str.startsWith("<gloss>")) || (!lang.isEmpty() && str.startsWith(QStringLiteral("<gloss xml:lang=\"%1\">").arg(lang))))
+                    skip = !addGloss(str);
+                // Possible error in file format, skip the whole word.
+                else if (!str.startsWith("<") || str.startsWith("<ke_") || str.startsWith("<k_") || str.startsWith("<re_") || str.startsWith("<entry>") ||
+                        str.startsWith("</ke_") || str.startsWith("</k_") || str.startsWith("</re_") || str.startsWith("</entry>"))
+                    skip = true;
+            }
+        }
+
+        if (!linefound)
+            saveEntry();
+    }
+}
+
+smartvector<WordEntry>& JMdictEntryParser::words()
+{
+    return list;
+}
+
+void JMdictEntryParser::newEntry()
 {
     entry.saved = false;
     entry.kusage = 0;
@@ -3609,7 +3710,7 @@ namespace {
 }
 
 void fixDefTypes(const QChar *kanjiform, fastarray<WordDefinition> &defs);
-void DictImport::saveEntry()
+void JMdictEntryParser::saveEntry()
 {
     // Ignore saved and invalid entries.
     if (entry.saved || entry.rusage == 0 || entry.susage == 0)
@@ -3656,7 +3757,7 @@ void DictImport::saveEntry()
 
             // Kanji, reading and sense are all good. Add a new word entry
             WordEntry *w = new WordEntry;
-            words.push_back(w);
+            list.push_back(w);
 
             // Frequency set below only after the definitions.
             w->freq = 0;
@@ -3762,7 +3863,7 @@ void DictImport::saveEntry()
     entry.saved = true;
 }
 
-bool DictImport::newKElement()
+bool JMdictEntryParser::newKElement()
 {
     if (entry.kusage == 100)
         return false;
@@ -3788,7 +3889,7 @@ bool DictImport::newKElement()
     return true;
 }
 
-bool DictImport::newRElement()
+bool JMdictEntryParser::newRElement()
 {
     if (entry.rusage == 100)
         return false;
@@ -3815,7 +3916,7 @@ bool DictImport::newRElement()
     return true;
 }
 
-bool DictImport::newSElement()
+bool JMdictEntryParser::newSElement()
 {
     if (entry.susage == 255)
         return false;
@@ -3840,7 +3941,7 @@ bool DictImport::newSElement()
     return true;
 }
 
-void DictImport::saveKElement()
+void JMdictEntryParser::saveKElement()
 {
     if (kcurrent != nullptr && kcurrent->str.isEmpty())
     {
@@ -3849,7 +3950,7 @@ void DictImport::saveKElement()
     }
 }
 
-void DictImport::saveRElement()
+void JMdictEntryParser::saveRElement()
 {
     if (rcurrent != nullptr && rcurrent->str.isEmpty())
     {
@@ -3858,7 +3959,7 @@ void DictImport::saveRElement()
     }
 }
 
-void DictImport::saveSElement()
+void JMdictEntryParser::saveSElement()
 {
     if (scurrent != nullptr && scurrent->glosses.isEmpty())
     {
@@ -3867,7 +3968,7 @@ void DictImport::saveSElement()
     }
 }
 
-bool DictImport::addKeb(QString str)
+bool JMdictEntryParser::addKeb(QString str)
 {
     if (!kcurrent || !kcurrent->str.isEmpty() || !str.endsWith("</keb>"))
         return false;
@@ -3889,7 +3990,7 @@ bool DictImport::addKeb(QString str)
     return true;
 }
 
-bool DictImport::addKInf(QString str)
+bool JMdictEntryParser::addKInf(QString str)
 {
     if (!kcurrent || !str.endsWith(";</ke_inf>"))
         return false;
@@ -3914,7 +4015,7 @@ bool DictImport::addKInf(QString str)
     return true;
 }
 
-bool DictImport::addKPri(QString str)
+bool JMdictEntryParser::addKPri(QString str)
 {
     if (!kcurrent || !str.endsWith("</ke_pri>"))
         return false;
@@ -3947,7 +4048,7 @@ bool DictImport::addKPri(QString str)
     return true;
 }
 
-bool DictImport::addReb(QString str)
+bool JMdictEntryParser::addReb(QString str)
 {
     if (!rcurrent || !rcurrent->str.isEmpty() || !str.endsWith("</reb>"))
         return false;
@@ -3967,7 +4068,7 @@ bool DictImport::addReb(QString str)
     return true;
 }
 
-bool DictImport::addRRestr(QString str)
+bool JMdictEntryParser::addRRestr(QString str)
 {
     if (!rcurrent || rcurrent->kusage == 255 || !str.endsWith("</re_restr>"))
         return false;
@@ -3980,7 +4081,7 @@ bool DictImport::addRRestr(QString str)
     return true;
 }
 
-bool DictImport::addRInf(QString str)
+bool JMdictEntryParser::addRInf(QString str)
 {
     if (!rcurrent || !str.endsWith(";</re_inf>"))
         return false;
@@ -4005,7 +4106,7 @@ bool DictImport::addRInf(QString str)
     return true;
 }
 
-bool DictImport::addRPri(QString str)
+bool JMdictEntryParser::addRPri(QString str)
 {
     if (!rcurrent || !str.endsWith("</re_pri>"))
         return false;
@@ -4039,7 +4140,7 @@ bool DictImport::addRPri(QString str)
     return true;
 }
 
-bool DictImport::addSTagK(QString str)
+bool JMdictEntryParser::addSTagK(QString str)
 {
     if (!scurrent || scurrent->kusage == 255 || !str.endsWith("</stagk>"))
         return false;
@@ -4052,7 +4153,7 @@ bool DictImport::addSTagK(QString str)
     return true;
 }
 
-bool DictImport::addSTagR(QString str)
+bool JMdictEntryParser::addSTagR(QString str)
 {
     if (!scurrent || scurrent->rusage == 255 || !str.endsWith("</stagr>"))
         return false;
@@ -4065,7 +4166,7 @@ bool DictImport::addSTagR(QString str)
     return true;
 }
 
-bool DictImport::addSPos(QString str)
+bool JMdictEntryParser::addSPos(QString str)
 {
     if (!scurrent || !str.endsWith(";</pos>"))
         return false;
@@ -4162,7 +4263,7 @@ bool DictImport::addSPos(QString str)
     return true;
 }
 
-bool DictImport::addSField(QString str)
+bool JMdictEntryParser::addSField(QString str)
 {
     if (!scurrent || !str.endsWith(";</field>"))
         return false;
@@ -4233,7 +4334,7 @@ bool DictImport::addSField(QString str)
     return true;
 }
 
-bool DictImport::addSMisc(QString str)
+bool JMdictEntryParser::addSMisc(QString str)
 {
     if (!scurrent || !str.endsWith(";</misc>"))
         return false;
@@ -4309,7 +4410,7 @@ bool DictImport::addSMisc(QString str)
     return true;
 }
 
-bool DictImport::addSDial(QString str)
+bool JMdictEntryParser::addSDial(QString str)
 {
     if (!scurrent || !str.endsWith(";</dial>"))
         return false;
@@ -4341,7 +4442,7 @@ bool DictImport::addSDial(QString str)
     return true;
 }
 
-bool DictImport::addGloss(QString str)
+bool JMdictEntryParser::addGloss(QString str)
 {
     if (!scurrent || scurrent->gusage == 511 || !str.endsWith("</gloss>"))
         return false;
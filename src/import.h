@@ -180,6 +180,11 @@ public:
     QString lastLine() const;
     //// Returns whether there are no more lines to read.
     //bool atEnd() const;
+
+    // Returns the undecoded contents of the whole file, setting its length in size. The file
+    // is memory mapped if possible, otherwise it's read into memory. The data is valid until
+    // the file is closed. Don't mix with getLine(). Returns null on error.
+    const char* data(qint64 &size);
 private:
     // Puts the guard in the list of guards.
     void addGuard(ImportFileHandlerGuard *guard);
@@ -208,9 +213,102 @@ private:
 
     QSet<ImportFileHandlerGuard*> guards;
 
+    // Contents of the file returned by data() when it couldn't be memory mapped.
+    QByteArray buffer;
+
     friend class ImportFileHandlerGuard;
 };
 
+// Splits UTF-8 text in memory into lines without decoding it. Lines can end with \n or \r\n.
+class ImportLineSplitter
+{
+public:
+    ImportLineSplitter(const char *data, qint64 size);
+
+    // Sets line to the start of the next line and len to its length in bytes without the
+    // line break, returning true. Returns false when there are no more lines.
+    bool next(const char *&line, int &len);
+    // Byte position after the last line returned by next().
+    qint64 pos() const;
+private:
+    const char *data;
+    qint64 size;
+    qint64 p;
+};
+
+// Builds word entries from JMdict entries. Parsers only use their own data, so separate
+// parts of JMdict can be parsed on several threads at the same time.
+class JMdictEntryParser
+{
+public:
+    JMdictEntryParser(const JMdictEntryParser&) = delete;
+    JMdictEntryParser& operator=(const JMdictEntryParser&) = delete;
+
+    // Lang is the language of glosses to import, or empty for English.
+    JMdictEntryParser(const QString &lang);
+
+    // Parses the lines of whole entries in size bytes of data, adding the found words to
+    // words().
+    void parse(const char *data, qint64 size);
+
+    // Word entries created by parse(), in the order they were found.
+    smartvector<WordEntry>& words();
+private:
+    // Clears any cached word entry data. Call saveEntry() before this if the
+    // word entry had no errors before the closing tag. Otherwise the unsaved
+    // entry will be lost.
+    void newEntry();
+    // Saves the entry if enough information is found to insert it in the
+    // dictionary.
+    void saveEntry();
+    // Deletes any data of the current entry if it's unsaved.
+    //void clearEntryCache();
+    // Creates a new element for the written word part.
+    bool newKElement();
+    // Creates a new temporary element for the reading part. If a previous
+    // temporary reading element exists it is deleted.
+    bool newRElement();
+    // Creates a new temporary element for the sense part. If a previous
+    // temporary sense element exists it is deleted.
+    bool newSElement();
+    // Cleanup after the kanji element <keb> is closed.
+    void saveKElement();
+    // Cleanup after the kana element <reb> is closed.
+    void saveRElement();
+    // Cleanup after the sense element is closed.
+    void saveSElement();
+
+
+    // Functions called inside kanji, reading or sense parts to add new data.
+
+    bool addKeb(QString str);
+    bool addKInf(QString str);
+    bool addKPri(QString str);
+    bool addReb(QString str);
+    bool addRRestr(QString str);
+    bool addRInf(QString str);
+    bool addRPri(QString str);
+    bool addSTagK(QString str);
+    bool addSTagR(QString str);
+    bool addSPos(QString str);
+    bool addSField(QString str);
+    bool addSMisc(QString str);
+    bool addSDial(QString str);
+    bool addGloss(QString str);
+
+    QString lang;
+
+    // Current entry.
+    ImportEntry entry;
+    // Current written part.
+    ImportKElement *kcurrent;
+
+    ImportRElement *rcurrent;
+    ImportSElement *scurrent;
+
+    smartvector<WordEntry> list;
+};
+
 struct WordEntry;
 struct ExampleWordsData;
 class Dictionary;
@@ -356,48 +454,6 @@ private:
     // abort.
     bool kanjiKana(const QString &str, int pos, QString &kanji, QString &kana, int &endpos);
 
-    // Clears any cached word entry data. Call saveEntry() before this if the
-    // word entry had no errors before the closing tag. Otherwise the unsaved
-    // entry will be lost.
-    void newEntry();
-    // Saves the entry if enough information is found to insert it in the
-    // dictionary.
-    void saveEntry();
-    // Deletes any data of the current entry if it's unsaved.
-    //void clearEntryCache();
-    // Creates a new element for the written word part.
-    bool newKElement();
-    // Creates a new temporary element for the reading part. If a previous
-    // temporary reading element exists it is deleted.
-    bool newRElement();
-    // Creates a new temporary element for the sense part. If a previous
-    // temporary sense element exists it is deleted.
-    bool newSElement();
-    // Cleanup after the kanji element <keb> is closed.
-    void saveKElement();
-    // Cleanup after the kana element <reb> is closed.
-    void saveRElement();
-    // Cleanup after the sense element is closed.
-    void saveSElement();
-
-
-    // Functions called inside kanji, reading or sense parts to add new data.
-
-    bool addKeb(QString str);
-    bool addKInf(QString str);
-    bool addKPri(QString str);
-    bool addReb(QString str);
-    bool addRRestr(QString str);
-    bool addRInf(QString str);
-    bool addRPri(QString str);
-    bool addSTagK(QString str);
-    bool addSTagR(QString str);
-    bool addSPos(QString str);
-    bool addSField(QString str);
-    bool addSMisc(QString str);
-    bool addSDial(QString str);
-    bool addGloss(QString str);
-
     Ui::DictImport *ui;
 
     ImportFileHandler file;
@@ -416,14 +472,6 @@ private:
     int stepcnt;
     int step;
 
-    // Current entry.
-    ImportEntry entry;
-    // Current written part.
-    ImportKElement *kcurrent;
-
-    ImportRElement *rcurrent;
-    ImportSElement *scurrent;
-
     smartvector<WordEntry> words;
 
     Dictionary *dict;
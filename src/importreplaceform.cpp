@@ -5,6 +5,7 @@
 **/
 
 #include <QMessageBox>
+#include <algorithm>
 #include "importreplaceform.h"
 #include "ui_importreplaceform.h"
 #include "zui.h"
@@ -86,7 +87,7 @@ bool ImportReplaceForm::exec()
     return true;
 }
 
-std::map<int, int>& ImportReplaceForm::changes()
+std::vector<int>& ImportReplaceForm::changes()
 {
     return list;
 }
@@ -270,22 +271,14 @@ bool ImportReplaceForm::init()
     std::vector<int> l;
 
     // Creating word index mapping of words (that were added to groups, study data etc.) of
-    // the original dictionary to indexes in the new dictionary. Result in list is:
-    // [old word index, new word index]. The new word index is set to -1 if the same word is
-    // not found.
+    // the original dictionary to indexes in the new dictionary. The new word index in list
+    // is set to -1 if the same word is not found.
     olddir->listUsedWords(l);
     list = newdir->mapWords(olddir, l);
     dlg.hide();
 
-    // Fill l to contain words in need of a replacement.
-    std::vector<int>().swap(l);
-    int ix = 0;
-    for (auto p : list)
-    {
-        if (p.second == -1)
-            l.push_back(p.first);
-        ++ix;
-    }
+    // Keep only the words in l that need a replacement.
+    l.erase(std::remove_if(l.begin(), l.end(), [this](int windex) { return list[windex] != -1; }), l.end());
     if (l.empty())
         return false;
 
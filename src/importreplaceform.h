@@ -44,9 +44,9 @@ public:
     // accepted by the user, and false on cancel.
     bool exec();
 
-    // Indexes of words in olddir from groups and study lists, and the index
-    // they should be changed to in the new dictionary.
-    std::map<int, int>& changes();
+    // Index in the new dictionary for every word in olddir that was used in groups and study
+    // lists. The value is -1 for the other words.
+    std::vector<int>& changes();
     Dictionary* dictionary();
     OriginalWordsList& originals();
 protected:
@@ -81,10 +81,9 @@ private:
 
     OriginalWordsList orig;
 
-    // List of word indexes in olddir and their corresponding indexes in
-    // newdir. If a word is only found in olddir, the other index is
-    // set to -1.
-    std::map<int, int> list;
+    // Indexes of words in newdir at the index of their corresponding words in olddir. If a
+    // word is only found in olddir, or it's not used, the index is set to -1.
+    std::vector<int> list;
 
     typedef DialogWindow    base;
 };
@@ -83,6 +83,8 @@ namespace ZKanji
 
 
     KanjiRadicalList radlist;
+    // Declared before kanjis to be destroyed after them.
+    QCharStringArena kanjistrings;
     smartvector<KanjiEntry> kanjis;
 
     std::map<ushort, std::pair<int, int>> radkmap;
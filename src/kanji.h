@@ -149,6 +149,8 @@ namespace ZKanji
 {
     extern KanjiRadicalList radlist;
 
+    // Character data of the kanji readings and meanings loaded from the base dictionary.
+    extern QCharStringArena kanjistrings;
     // TODO: replace with a continuous array or vector. There's no need to dynamically
     // allocate each kanji.
     extern smartvector<KanjiEntry> kanjis;
@@ -11,6 +11,7 @@
 #include <QStringBuilder>
 #include <QStylePainter>
 #include <QMenu>
+#include <QtAlgorithms>
 
 #include "kanjisearchwidget.h"
 #include "ui_kanjisearchwidget.h"
@@ -1286,494 +1287,484 @@ bool KanjiSearchWidget::filtersEmpty(const RuntimeKanjiFilters &f)
         f.data.fromtype == KanjiFromT::All;
 }
 
-void KanjiSearchWidget::listFilteredKanji(const RuntimeKanjiFilters &f, std::vector<ushort> &list)
+namespace
 {
-    list.clear();
+    // Set of kanji indexes in ZKanji::kanjis stored as bits. Kanji filters are combined with
+    // bitwise operations on whole words, instead of merging sorted lists of kanji.
+    class KanjiBits
+    {
+    public:
+        // Creates a set with every kanji if all is true, or an empty set.
+        KanjiBits(bool all = false) : bits((ZKanji::kanjicount + 63) / 64, all ? ~quint64(0) : 0)
+        {
+            if (all && (ZKanji::kanjicount % 64) != 0)
+                bits.back() = (quint64(1) << (ZKanji::kanjicount % 64)) - 1;
+        }
 
-    RadicalFilter rads = f.data.rads;
+        bool test(int ix) const
+        {
+            return (bits[ix / 64] & (quint64(1) << (ix % 64))) != 0;
+        }
 
-    if (!filterActive(f.data.filters, KanjiFilters::Radicals) || rads.groups.empty())
-    {
-        for (int ix = 0; ix != ZKanji::kanjicount; ++ix)
-            list.push_back(ix);
-    }
-    else if (rads.mode == RadicalFilterModes::Radicals)
-    {
-        std::vector<ushort> group;
-        for (int ix = 0; ix != ZKanji::kanjicount; ++ix)
+        void set(int ix)
         {
-            auto it = std::find(rads.groups[0].begin(), rads.groups[0].end(), ZKanji::kanjis[ix]->rad);
-            if (it != rads.groups[0].end())
-                group.push_back(ix);
+            bits[ix / 64] |= quint64(1) << (ix % 64);
         }
-        if (list.empty())
-            list = group;
-        else
+
+        // Adds every kanji index in [first, last) to the set.
+        template<typename Iter>
+        void set(Iter first, Iter last)
         {
-            std::vector<ushort> temp;
-            temp.swap(list);
-            list.resize(group.size());
-            list.resize(std::set_intersection(group.begin(), group.end(), temp.begin(), temp.end(), list.begin()) - list.begin());
+            for (; first != last; ++first)
+                set(*first);
         }
-        group.clear();
-    }
-    else if (rads.mode == RadicalFilterModes::Parts)
-    {
-        std::vector<ushort> group;
-        for (int ix = 0, siz = tosigned(rads.groups.size()); ix != siz; ++ix)
+
+        KanjiBits& operator&=(const KanjiBits &other)
         {
-            const std::vector<ushort> &g = rads.groups[ix];
-            for (int iy = 0, sizy = tosigned(g.size()); iy != sizy; ++iy)
-                group.insert(group.end(), ZKanji::radklist[g[iy]].second.begin(), ZKanji::radklist[g[iy]].second.end());
-            std::sort(group.begin(), group.end());
-            group.resize(std::unique(group.begin(), group.end()) - group.begin());
-
-            if (list.empty())
-                list = group;
-            else
-            {
-                std::vector<ushort> temp;
-                temp.swap(list);
-                list.resize(group.size());
-                list.resize(std::set_intersection(group.begin(), group.end(), temp.begin(), temp.end(), list.begin()) - list.begin());
-            }
-            group.clear();
+            for (int ix = 0, siz = tosigned(bits.size()); ix != siz; ++ix)
+                bits[ix] &= other.bits[ix];
+            return *this;
         }
-    }
-    else // NamedRadicals
-    {
-        std::vector<ushort> group;
-        for (int ix = 0, siz = tosigned(rads.groups.size()); ix != siz; ++ix)
+
+        KanjiBits& operator|=(const KanjiBits &other)
+        {
+            for (int ix = 0, siz = tosigned(bits.size()); ix != siz; ++ix)
+                bits[ix] |= other.bits[ix];
+            return *this;
+        }
+
+        // Calls func with every kanji index in the set in increasing order.
+        template<typename Func>
+        void forEach(Func func) const
         {
-            const std::vector<ushort> &g = rads.groups[ix];
-            for (int iy = 0, sizy = tosigned(g.size()); iy != sizy; ++iy)
+            for (int ix = 0, siz = tosigned(bits.size()); ix != siz; ++ix)
             {
-                if (!rads.grouped)
-                    group.insert(group.end(), ZKanji::radlist[g[iy]]->kanji.begin(), ZKanji::radlist[g[iy]]->kanji.end());
-                else
+                quint64 w = bits[ix];
+                while (w != 0)
                 {
-                    for (int j = g[iy], sizj = tosigned(ZKanji::radlist.size()); j != sizj; ++j)
-                        if (j != g[iy] && ZKanji::radlist[j]->radical != ZKanji::radlist[j - 1]->radical)
-                            break;
-                        else
-                            group.insert(group.end(), ZKanji::radlist[j]->kanji.begin(), ZKanji::radlist[j]->kanji.end());
+                    func(ix * 64 + qCountTrailingZeroBits(w));
+                    w &= w - 1;
                 }
             }
-            std::sort(group.begin(), group.end());
-            group.resize(std::unique(group.begin(), group.end()) - group.begin());
-
-            if (list.empty())
-                list = group;
-            else
-            {
-                std::vector<ushort> temp;
-                temp.swap(list);
-                list.resize(group.size());
-                list.resize(std::set_intersection(group.begin(), group.end(), temp.begin(), temp.end(), list.begin()) - list.begin());
-            }
-            group.clear();
         }
+    private:
+        std::vector<quint64> bits;
+    };
+
+    // Sets of kanji with the same value of a filterable property. Created on first use, when
+    // the kanji data can no longer change.
+    struct KanjiFilterBits
+    {
+        // Kanji by radical number.
+        std::vector<KanjiBits> rads;
+        // Kanji by index of parts in ZKanji::radklist.
+        std::vector<KanjiBits> parts;
+        std::vector<KanjiBits> strokes;
+        std::vector<KanjiBits> jlpt;
+        std::vector<KanjiBits> jouyou;
+        // Kanji by the values of the three parts of the SKIP code.
+        std::vector<KanjiBits> skips[3];
+        // Kanji by KanjiFromT. The sets of All and Clipbrd are left empty.
+        std::vector<KanjiBits> from;
+    };
+
+    // Adds kanji ix to the set at list[val], creating the sets up to val if needed.
+    void addKanjiBit(std::vector<KanjiBits> &list, int val, int ix)
+    {
+        if (tosigned(list.size()) <= val)
+            list.resize(val + 1);
+        list[val].set(ix);
     }
 
-    if (list.empty())
-        return;
+    const KanjiFilterBits& kanjiFilterBits()
+    {
+        static KanjiFilterBits fb;
+        static bool created = false;
+        if (created)
+            return fb;
+        created = true;
 
-    Dictionary *dict = ui->kanjiGrid->dictionary();
+        fb.parts.resize(ZKanji::radklist.size());
+        for (int ix = 0, siz = tosigned(ZKanji::radklist.size()); ix != siz; ++ix)
+            fb.parts[ix].set(ZKanji::radklist[ix].second.begin(), ZKanji::radklist[ix].second.end());
 
-    QSet<QChar> clpbrd;
-    if (f.data.fromtype == KanjiFromT::Clipbrd)
-    {
-        QString tmp = qApp->clipboard()->text();
-        for (int ix = 0; ix != tmp.size(); ++ix)
+        fb.from.resize((int)KanjiFromT::Tuttle + 1);
+        for (int ix = 0; ix != ZKanji::kanjicount; ++ix)
         {
-            if (KANJI(tmp.at(ix).unicode()))
-                clpbrd.insert(tmp.at(ix));
+            const KanjiEntry *k = ZKanji::kanjis[ix];
+            addKanjiBit(fb.rads, k->rad, ix);
+            addKanjiBit(fb.strokes, k->strokes, ix);
+            addKanjiBit(fb.jlpt, k->jlpt, ix);
+            addKanjiBit(fb.jouyou, k->jouyou, ix);
+            for (int iy = 0; iy != 3; ++iy)
+                addKanjiBit(fb.skips[iy], k->skips[iy], ix);
+
+            // In the order of KanjiFromT.
+            const bool from[] = { false, false, k->frequency != 0, k->jouyou != 0, k->jlpt != 0,
+                k->oneil != 0, k->gakken != 0, k->halpern != 0, k->heisig != 0, k->heisign != 0, k->heisigf != 0, k->henshall != 0,
+                k->nelson != 0, k->newnelson != 0, k->snh[0] != 0, k->knk != 0, k->knk != 0 && k->knk <= 1945, k->busy[0] != 0, k->crowley != 0, k->flashc != 0, k->kguide != 0,
+                k->halpernn != 0, k->deroo != 0, k->sakade != 0, k->henshallg != 0, k->context != 0, k->halpernk != 0, k->halpernl != 0,
+                k->tuttle != 0 };
+            static_assert(sizeof(from) == (int)KanjiFromT::Tuttle + 1, "Update the list when KanjiFromT changes.");
+            for (int iy = 0; iy != (int)KanjiFromT::Tuttle + 1; ++iy)
+                if (from[iy])
+                    fb.from[iy].set(ix);
         }
+
+        return fb;
     }
 
-    for (int ix = tosigned(list.size()) - 1; ix != -1; --ix)
+    // Returns the kanji with a property value between first and last, where list holds the
+    // set of kanji for each value.
+    KanjiBits kanjiBitsRange(const std::vector<KanjiBits> &list, int first, int last)
     {
-        KanjiEntry *k = ZKanji::kanjis[list[ix]];
-
-        bool match;
+        KanjiBits result;
+        for (int ix = std::max(first, 0), siz = std::min(last + 1, tosigned(list.size())); ix < siz; ++ix)
+            result |= list[ix];
+        return result;
+    }
 
-        if (f.data.fromtype != KanjiFromT::All)
+    // Returns the kanji containing any of the radicals in group. The values in group are
+    // interpreted by the mode of rads.
+    KanjiBits kanjiBitsRadicals(const KanjiFilterBits &fb, const RadicalFilter &rads, const std::vector<ushort> &group)
+    {
+        KanjiBits result;
+        for (int r : group)
         {
-            match = false;
-            switch (f.data.fromtype)
+            if (rads.mode == RadicalFilterModes::Radicals)
             {
-            case KanjiFromT::Clipbrd:
-                match = clpbrd.contains(k->ch);
-                break;
-            case KanjiFromT::Common:
-                match = k->frequency != 0;
-                break;
-            case KanjiFromT::Jouyou:
-                match = k->jouyou != 0;
-                break;
-            case KanjiFromT::JLPT:
-                match = k->jlpt != 0;
-                break;
-            case KanjiFromT::Oneil:
-                match = k->oneil != 0;
-                break;
-            case KanjiFromT::Gakken:
-                match = k->gakken != 0;
-                break;
-            case KanjiFromT::Halpern:
-                match = k->halpern != 0;
-                break;
-            case KanjiFromT::Heisig:
-                match = k->heisig != 0;
-                break;
-            case KanjiFromT::HeisigN:
-                match = k->heisign != 0;
-                break;
-            case KanjiFromT::HeisigF:
-                match = k->heisigf != 0;
-                break;
-            case KanjiFromT::Henshall:
-                match = k->henshall != 0;
-                break;
-            case KanjiFromT::Nelson:
-                match = k->nelson != 0;
-                break;
-            case KanjiFromT::NewNelson:
-                match = k->newnelson != 0;
-                break;
-            case KanjiFromT::SnH:
-                match = k->snh[0] != 0;
-                break;
-            case KanjiFromT::KnK:
-                match = k->knk != 0;
-                break;
-            case KanjiFromT::KnKOld:
-                match = k->knk != 0 && k->knk <= 1945;
-                break;
-            case KanjiFromT::Busy:
-                match = k->busy[0] != 0;
-                break;
-            case KanjiFromT::Crowley:
-                match = k->crowley != 0;
-                break;
-            case KanjiFromT::FlashC:
-                match = k->flashc != 0;
-                break;
-            case KanjiFromT::KGuide:
-                match = k->kguide != 0;
-                break;
-            case KanjiFromT::HalpernN:
-                match = k->halpernn != 0;
-                break;
-            case KanjiFromT::Deroo:
-                match = k->deroo != 0;
-                break;
-            case KanjiFromT::Sakade:
-                match = k->sakade != 0;
-                break;
-            case KanjiFromT::HenshallG:
-                match = k->henshallg != 0;
-                break;
-            case KanjiFromT::Context:
-                match = k->context != 0;
-                break;
-            case KanjiFromT::HalpernK:
-                match = k->halpernk != 0;
-                break;
-            case KanjiFromT::HalpernL:
-                match = k->halpernl != 0;
-                break;
-            case KanjiFromT::Tuttle:
-                match = k->tuttle != 0;
-                break;
-            default:
-                break;
+                if (r < tosigned(fb.rads.size()))
+                    result |= fb.rads[r];
             }
-            if (!match)
+            else if (rads.mode == RadicalFilterModes::Parts)
+                result |= fb.parts[r];
+            else if (!rads.grouped)
+                result.set(ZKanji::radlist[r]->kanji.begin(), ZKanji::radlist[r]->kanji.end());
+            else
             {
-                list.erase(list.begin() + ix);
-                continue;
+                for (int j = r, sizj = tosigned(ZKanji::radlist.size()); j != sizj; ++j)
+                {
+                    if (j != r && ZKanji::radlist[j]->radical != ZKanji::radlist[j - 1]->radical)
+                        break;
+                    result.set(ZKanji::radlist[j]->kanji.begin(), ZKanji::radlist[j]->kanji.end());
+                }
             }
         }
+        return result;
+    }
 
-        if (filterActive(f.data, KanjiFilters::Index) && !f.data.index.isEmpty())
+    bool kanjiIndexMatches(const KanjiFilterData &f, const KanjiEntry *k)
+    {
+        QString str;
+        bool match = false;
+        switch (f.indextype)
         {
-            QString str;
-            match = false;
-            switch (f.data.indextype)
+        case KanjiIndexT::Unicode:
+            if ((f.index.size() == 1 && f.index == "0") || (f.index.size() == 2 && f.index == "0x"))
+                match = true;
+            else
             {
-            case KanjiIndexT::Unicode:
-                if ((f.data.index.size() == 1 && f.data.index == "0") || (f.data.index.size() == 2 && f.data.index == "0x"))
-                    match = true;
-                else
-                {
-                    str = QString::number(k->ch.unicode(), 16);
-                    if (f.data.index.left(2) == "0x")
-                        str = "0x" + str;
-                    match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                }
-                break;
-            case KanjiIndexT::EUCJP:
-                if ((f.data.index.size() == 1 && f.data.index == "0") || (f.data.index.size() == 2 && f.data.index == "0x"))
-                    match = true;
-                else
-                {
-                    str = QString::number(JIStoEUC(k->jis), 16);
-                    if (f.data.index.left(2) == "0x")
-                        str = "0x" + str;
-                    match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                }
-                break;
-            case KanjiIndexT::ShiftJIS:
-                if ((f.data.index.size() == 1 && f.data.index == "0") || (f.data.index.size() == 2 && f.data.index == "0x"))
-                    match = true;
-                else
-                {
-                    str = QString::number(JIStoShiftJIS(k->jis), 16);
-                    if (f.data.index.left(2) == "0x")
-                        str = "0x" + str;
-                    match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                }
-                break;
-            case KanjiIndexT::JISX0208:
-                if ((f.data.index.size() == 1 && f.data.index == "0") || (f.data.index.size() == 2 && f.data.index == "0x"))
-                    match = true;
-                else
-                {
-                    str = QString::number(k->jis, 16);
-                    if (f.data.index.left(2) == "0x")
-                        str = "0x" + str;
-                    match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                }
-                break;
-            case KanjiIndexT::Kuten:
-                str = JIStoKuten(k->jis);
-                match = f.data.index == str;
-                break;
-            case KanjiIndexT::Oneil:
-                str = QString::number(k->oneil);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Gakken:
-                str = QString::number(k->gakken);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Halpern:
-                str = QString::number(k->halpern);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Heisig:
-                str = QString::number(k->heisig);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::HeisigN:
-                str = QString::number(k->heisign);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::HeisigF:
-                str = QString::number(k->heisigf);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Henshall:
-                str = QString::number(k->henshall);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Nelson:
-                str = QString::number(k->nelson);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::NewNelson:
-                str = QString::number(k->newnelson);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::SnH:
-                // Check whether the snh code is null terminated or not,
-                // because it might take up the size of the whole buffer.
-                if (memchr(k->snh, 0, 8) != nullptr)
-                    str = QString::fromLatin1(k->snh);
-                else
-                    str = QString::fromLatin1(k->snh, 8);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::KnK:
-                str = QString::number(k->knk);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Busy:
-                // Might not be null terminated, check for that.
-                if (memchr(k->busy, 0, 4) != nullptr)
-                    str = QString::fromLatin1(k->busy);
-                else
-                    str = QString::fromLatin1(k->busy, 4);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Crowley:
-                str = QString::number(k->crowley);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::FlashC:
-                str = QString::number(k->flashc);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::KGuide:
-                str = QString::number(k->kguide);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::HalpernN:
-                str = QString::number(k->halpernn);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Deroo:
-                str = QString::number(k->deroo);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Sakade:
-                str = QString::number(k->sakade);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::HenshallG:
-                str = QString::number(k->henshallg);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Context:
-                str = QString::number(k->context);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::HalpernK:
-                str = QString::number(k->halpernk);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::HalpernL:
-                str = QString::number(k->halpernl);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
-            case KanjiIndexT::Tuttle:
-                str = QString::number(k->tuttle);
-                match = qcharncmp(f.data.index.constData(), str.constData(), std::min(f.data.index.size(), str.size())) == 0;
-                break;
+                str = QString::number(k->ch.unicode(), 16);
+                if (f.index.left(2) == "0x")
+                    str = "0x" + str;
+                match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
             }
-
-            if (!match)
+            break;
+        case KanjiIndexT::EUCJP:
+            if ((f.index.size() == 1 && f.index == "0") || (f.index.size() == 2 && f.index == "0x"))
+                match = true;
+            else
             {
-                list.erase(list.begin() + ix);
-                continue;
+                str = QString::number(JIStoEUC(k->jis), 16);
+                if (f.index.left(2) == "0x")
+                    str = "0x" + str;
+                match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            }
+            break;
+        case KanjiIndexT::ShiftJIS:
+            if ((f.index.size() == 1 && f.index == "0") || (f.index.size() == 2 && f.index == "0x"))
+                match = true;
+            else
+            {
+                str = QString::number(JIStoShiftJIS(k->jis), 16);
+                if (f.index.left(2) == "0x")
+                    str = "0x" + str;
+                match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
             }
+            break;
+        case KanjiIndexT::JISX0208:
+            if ((f.index.size() == 1 && f.index == "0") || (f.index.size() == 2 && f.index == "0x"))
+                match = true;
+            else
+            {
+                str = QString::number(k->jis, 16);
+                if (f.index.left(2) == "0x")
+                    str = "0x" + str;
+                match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            }
+            break;
+        case KanjiIndexT::Kuten:
+            str = JIStoKuten(k->jis);
+            match = f.index == str;
+            break;
+        case KanjiIndexT::Oneil:
+            str = QString::number(k->oneil);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Gakken:
+            str = QString::number(k->gakken);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Halpern:
+            str = QString::number(k->halpern);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Heisig:
+            str = QString::number(k->heisig);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::HeisigN:
+            str = QString::number(k->heisign);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::HeisigF:
+            str = QString::number(k->heisigf);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Henshall:
+            str = QString::number(k->henshall);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Nelson:
+            str = QString::number(k->nelson);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::NewNelson:
+            str = QString::number(k->newnelson);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::SnH:
+            // Check whether the snh code is null terminated or not,
+            // because it might take up the size of the whole buffer.
+            if (memchr(k->snh, 0, 8) != nullptr)
+                str = QString::fromLatin1(k->snh);
+            else
+                str = QString::fromLatin1(k->snh, 8);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::KnK:
+            str = QString::number(k->knk);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Busy:
+            // Might not be null terminated, check for that.
+            if (memchr(k->busy, 0, 4) != nullptr)
+                str = QString::fromLatin1(k->busy);
+            else
+                str = QString::fromLatin1(k->busy, 4);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Crowley:
+            str = QString::number(k->crowley);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::FlashC:
+            str = QString::number(k->flashc);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::KGuide:
+            str = QString::number(k->kguide);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::HalpernN:
+            str = QString::number(k->halpernn);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Deroo:
+            str = QString::number(k->deroo);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Sakade:
+            str = QString::number(k->sakade);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::HenshallG:
+            str = QString::number(k->henshallg);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Context:
+            str = QString::number(k->context);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::HalpernK:
+            str = QString::number(k->halpernk);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::HalpernL:
+            str = QString::number(k->halpernl);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
+        case KanjiIndexT::Tuttle:
+            str = QString::number(k->tuttle);
+            match = qcharncmp(f.index.constData(), str.constData(), std::min(f.index.size(), str.size())) == 0;
+            break;
         }
 
-        if (filterActive(f.data, KanjiFilters::Strokes) && ((f.data.strokemin != 0 && k->strokes < f.data.strokemin) || (f.data.strokemax != 0 && k->strokes > f.data.strokemax) || (f.data.strokemax == 0 && f.data.strokemin != 0 && k->strokes != f.data.strokemin)))
-        {
-            list.erase(list.begin() + ix);
-            continue;
-        }
+        return match;
+    }
 
-        if (filterActive(f.data, KanjiFilters::JLPT) && ((f.data.jlptmin != -1 && k->jlpt < f.data.jlptmin) || (f.data.jlptmax != -1 && k->jlpt > f.data.jlptmax) || (f.data.jlptmax == -1 && f.data.jlptmin != -1 && k->jlpt != f.data.jlptmin)))
+    bool kanjiReadingMatches(const KanjiFilterData &f, const KanjiEntry *k)
+    {
+        bool match = false;
+        bool ron = true;
+        bool rkun = true;
+        if (f.readingstrict)
         {
-            list.erase(list.begin() + ix);
-            continue;
+            for (int iy = 0, sizy = f.reading.size(); (ron || rkun) && iy != sizy; ++iy)
+            {
+                if (KATAKANA(f.reading.at(iy).unicode()))
+                    rkun = false;
+                if (HIRAGANA(f.reading.at(iy).unicode()))
+                    ron = false;
+            }
         }
 
-        if (filterActive(f.data, KanjiFilters::SKIP) && ((f.data.skip1 != 0 && f.data.skip1 != k->skips[0]) || (f.data.skip2 > 0 && f.data.skip2 != k->skips[1]) || (f.data.skip3 > 0 && f.data.skip3 != k->skips[2])))
+        QString str = hiraganize(f.reading);
+        if (ron)
         {
-            list.erase(list.begin() + ix);
-            continue;
+            for (int iy = 0, sizy = k->on.size(); !match && iy != sizy; ++iy)
+            {
+                QString str1 = hiraganize(k->on[iy].toQString());
+                if (!f.readingafter && str1.size() != str.size())
+                    continue;
+                match = qcharncmp(str1.constData(), str.constData(), str.size()) == 0;
+            }
         }
-
-        if (filterActive(f.data, KanjiFilters::Jouyou) && (f.data.jouyou != 0 && (k->jouyou == 0 || (f.data.jouyou != 7 && f.data.jouyou != k->jouyou) || (f.data.jouyou == 7 && k->jouyou > 6))))
+        if (!match && rkun)
         {
-            list.erase(list.begin() + ix);
-            continue;
+            for (int iy = 0, sizy = k->kun.size(); !match && iy != sizy; ++iy)
+            {
+                QString kunstr = QString::fromRawData(k->kun[iy].data(), tosigned(qcharlen(k->kun[iy].data())));
+                int p = kunstr.indexOf('.');
+                if (p != -1)
+                    kunstr = kunstr.left(p) + (!f.readingoku ? QString() : kunstr.right(kunstr.size() - p - 1));
+                kunstr = hiraganize(kunstr);
+
+                if (!f.readingafter && kunstr.size() != str.size())
+                    continue;
+
+                match = qcharncmp(kunstr.constData(), str.constData(), str.size()) == 0;
+            }
         }
 
-        if (filterActive(f.data, KanjiFilters::Reading) && !f.data.reading.isEmpty())
+        return match;
+    }
+
+    // There is no tree for kanji meanings, so the only way is to go through each of them and
+    // check for matches.
+    bool kanjiMeaningMatches(const KanjiFilterData &f, Dictionary *dict, const KanjiEntry *k)
+    {
+        const int mlen = f.meaning.size();
+        const QString fmeaning = f.meaning.toLower();
+        const QChar *fmeaningdat = fmeaning.constData();
+
+        bool match = false;
+        const QString kmeaning = dict->kanjiMeaning(k->index).toLower();
+        const QChar *kmeaningdat = kmeaning.constData();
+        const int datlen = kmeaning.size();
+
+        // Go through each character one by one. The match is only valid if it's at the
+        // front of the meaning, or it comes after a delimiter. When meaningafter is
+        // false, the match must be directly followed by a delimiter or must tail the
+        // meaning.
+        for (int pos = 0; !match && pos <= datlen - mlen; ++pos)
         {
-            match = false;
-            bool ron = true;
-            bool rkun = true;
-            if (f.data.readingstrict)
+            if (qcharisdelim(kmeaningdat[pos]) == QCharKind::Delimiter)
+                continue;
+            if (qcharncmp(kmeaningdat + pos, fmeaningdat, mlen) == 0)
             {
-                for (int iy = 0, sizy = f.data.reading.size(); (ron || rkun) && iy != sizy; ++iy)
-                {
-                    if (KATAKANA(f.data.reading.at(iy).unicode()))
-                        rkun = false;
-                    if (HIRAGANA(f.data.reading.at(iy).unicode()))
-                        ron = false;
-                }
+                if (!f.meaningafter)
+                    match = pos + mlen == datlen || qcharisdelim(kmeaningdat[pos + mlen]) == QCharKind::Delimiter;
+                else
+                    match = true;
             }
 
-            QString str = hiraganize(f.data.reading);
-            if (ron)
-            {
-                for (int iy = 0, sizy = k->on.size(); !match && iy != sizy; ++iy)
-                {
-                    QString str1 = hiraganize(k->on[iy].toQString());
-                    if (!f.data.readingafter && str1.size() != str.size())
-                        continue;
-                    match = qcharncmp(str1.constData(), str.constData(), str.size()) == 0;
-                }
-            }
-            if (!match && rkun)
-            {
-                for (int iy = 0, sizy = k->kun.size(); !match && iy != sizy; ++iy)
-                {
-                    QString kunstr = QString::fromRawData(k->kun[iy].data(), tosigned(qcharlen(k->kun[iy].data())));
-                    int p = kunstr.indexOf('.');
-                    if (p != -1)
-                        kunstr = kunstr.left(p) + (!f.data.readingoku ? QString() : kunstr.right(kunstr.size() - p - 1));
-                    kunstr = hiraganize(kunstr);
+            while (pos < datlen - mlen && qcharisdelim(kmeaningdat[++pos]) != QCharKind::Delimiter)
+                ;
+        }
 
-                    if (!f.data.readingafter && kunstr.size() != str.size())
-                        continue;
+        return match;
+    }
+}
 
-                    match = qcharncmp(kunstr.constData(), str.constData(), str.size()) == 0;
-                }
-            }
+void KanjiSearchWidget::listFilteredKanji(const RuntimeKanjiFilters &f, std::vector<ushort> &list)
+{
+    list.clear();
 
-            if (!match)
-            {
-                list.erase(list.begin() + ix);
-                continue;
-            }
-        }
+    const KanjiFilterBits &fb = kanjiFilterBits();
+    RadicalFilter rads = f.data.rads;
+
+    // Filters that only depend on the kanji data are sets of kanji, and the result is their
+    // intersection.
+    KanjiBits bits(true);
 
-        // Throw out anything not matching the meaning. There is no tree for kanji meanings,
-        // so the only way is to go through each of them and check for matches.
-        if (filterActive(f.data, KanjiFilters::Meaning) && !f.data.meaning.isEmpty())
+    if (filterActive(f.data.filters, KanjiFilters::Radicals) && !rads.groups.empty())
+    {
+        if (rads.mode == RadicalFilterModes::Radicals)
+            bits = kanjiBitsRadicals(fb, rads, rads.groups[0]);
+        else
         {
-            const int mlen = f.data.meaning.size();
-            const QString fmeaning = f.data.meaning.toLower();
-            const QChar *fmeaningdat = fmeaning.constData();
-
-            match = false;
-            const QString kmeaning = dict->kanjiMeaning(list[ix]).toLower();
-            const QChar *kmeaningdat = kmeaning.constData();
-            const int datlen = kmeaning.size();
-
-            // Go through each character one by one. The match is only valid if it's at the
-            // front of the meaning, or it comes after a delimiter. When meaningafter is
-            // false, the match must be directly followed by a delimiter or must tail the
-            // meaning.
-            for (int pos = 0; !match && pos <= datlen - mlen; ++pos)
-            {
-                if (qcharisdelim(kmeaningdat[pos]) == QCharKind::Delimiter)
-                    continue;
-                if (qcharncmp(kmeaningdat + pos, fmeaningdat, mlen) == 0)
-                {
-                    if (!f.data.meaningafter)
-                        match = pos + mlen == datlen || qcharisdelim(kmeaningdat[pos + mlen]) == QCharKind::Delimiter;
-                    else
-                        match = true;
-                }
+            for (const std::vector<ushort> &g : rads.groups)
+                bits &= kanjiBitsRadicals(fb, rads, g);
+        }
+    }
 
-                while (pos < datlen - mlen && qcharisdelim(kmeaningdat[++pos]) != QCharKind::Delimiter)
-                    ;
-            }
-            if (!match)
-            {
-                list.erase(list.begin() + ix);
-                continue;
-            }
+    if (f.data.fromtype == KanjiFromT::Clipbrd)
+    {
+        KanjiBits clpbrd;
+        QString tmp = qApp->clipboard()->text();
+        for (int ix = 0; ix != tmp.size(); ++ix)
+        {
+            int kix = KANJI(tmp.at(ix).unicode()) ? ZKanji::kanjiIndex(tmp.at(ix)) : -1;
+            if (kix != -1)
+                clpbrd.set(kix);
         }
+        bits &= clpbrd;
     }
+    else if (f.data.fromtype != KanjiFromT::All)
+        bits &= fb.from[(int)f.data.fromtype];
+
+    if (filterActive(f.data, KanjiFilters::Strokes) && (f.data.strokemin != 0 || f.data.strokemax != 0))
+        bits &= kanjiBitsRange(fb.strokes, f.data.strokemin, f.data.strokemax != 0 ? f.data.strokemax : f.data.strokemin);
+
+    if (filterActive(f.data, KanjiFilters::JLPT) && (f.data.jlptmin != -1 || f.data.jlptmax != -1))
+        bits &= kanjiBitsRange(fb.jlpt, f.data.jlptmin, f.data.jlptmax != -1 ? f.data.jlptmax : f.data.jlptmin);
+
+    if (filterActive(f.data, KanjiFilters::SKIP))
+    {
+        if (f.data.skip1 != 0)
+            bits &= kanjiBitsRange(fb.skips[0], f.data.skip1, f.data.skip1);
+        if (f.data.skip2 > 0)
+            bits &= kanjiBitsRange(fb.skips[1], f.data.skip2, f.data.skip2);
+        if (f.data.skip3 > 0)
+            bits &= kanjiBitsRange(fb.skips[2], f.data.skip3, f.data.skip3);
+    }
+
+    // Jouyou filter 7 stands for every elementary school grade.
+    if (filterActive(f.data, KanjiFilters::Jouyou) && f.data.jouyou != 0)
+        bits &= f.data.jouyou == 7 ? kanjiBitsRange(fb.jouyou, 1, 6) : kanjiBitsRange(fb.jouyou, f.data.jouyou, f.data.jouyou);
+
+    // Filters comparing strings are only checked for the kanji left in the set.
+    bool index = filterActive(f.data, KanjiFilters::Index) && !f.data.index.isEmpty();
+    bool reading = filterActive(f.data, KanjiFilters::Reading) && !f.data.reading.isEmpty();
+    bool meaning = filterActive(f.data, KanjiFilters::Meaning) && !f.data.meaning.isEmpty();
+
+    Dictionary *dict = ui->kanjiGrid->dictionary();
+    bits.forEach([&](int ix) {
+        const KanjiEntry *k = ZKanji::kanjis[ix];
+        if ((!index || kanjiIndexMatches(f.data, k)) && (!reading || kanjiReadingMatches(f.data, k)) && (!meaning || kanjiMeaningMatches(f.data, dict, k)))
+            list.push_back(ix);
+    });
 
     if (filterActive(f.data, KanjiFilters::Radicals) && radform != nullptr)
     {
@@ -1785,60 +1776,8 @@ void KanjiSearchWidget::listFilteredKanji(const RuntimeKanjiFilters &f, std::vec
         if (f.tmprads.empty() || list.empty())
             return;
 
-        if (rads.mode == RadicalFilterModes::Radicals)
-        {
-            std::vector<ushort> group;
-            for (int ix = 0; ix != ZKanji::kanjicount; ++ix)
-            {
-                auto it = std::find(f.tmprads.begin(), f.tmprads.end(), ZKanji::kanjis[ix]->rad);
-                if (it != f.tmprads.end())
-                    group.push_back(ix);
-            }
-            std::vector<ushort> temp;
-            temp.swap(list);
-            list.resize(group.size());
-            list.resize(std::set_intersection(group.begin(), group.end(), temp.begin(), temp.end(), list.begin()) - list.begin());
-        }
-        else if (rads.mode == RadicalFilterModes::Parts)
-        {
-            std::vector<ushort> group;
-            for (int ix = 0, siz = tosigned(f.tmprads.size()); ix != siz; ++ix)
-                group.insert(group.end(), ZKanji::radklist[f.tmprads[ix]].second.begin(), ZKanji::radklist[f.tmprads[ix]].second.end());
-            std::sort(group.begin(), group.end());
-            group.resize(std::unique(group.begin(), group.end()) - group.begin());
-
-            std::vector<ushort> temp;
-            temp.swap(list);
-            list.resize(group.size());
-            list.resize(std::set_intersection(group.begin(), group.end(), temp.begin(), temp.end(), list.begin()) - list.begin());
-        }
-        else // NamedRadicals
-        {
-            std::vector<ushort> group;
-
-            for (int ix = 0, siz = tosigned(f.tmprads.size()); ix != siz; ++ix)
-            {
-                if (!rads.grouped)
-                    group.insert(group.end(), ZKanji::radlist[f.tmprads[ix]]->kanji.begin(), ZKanji::radlist[f.tmprads[ix]]->kanji.end());
-                else
-                {
-                    for (int iy = f.tmprads[ix], sizy = tosigned(ZKanji::radlist.size()); iy != sizy; ++iy)
-                    {
-                        if (iy != f.tmprads[ix] && ZKanji::radlist[iy]->radical != ZKanji::radlist[iy - 1]->radical)
-                            break;
-                        else
-                            group.insert(group.end(), ZKanji::radlist[iy]->kanji.begin(), ZKanji::radlist[iy]->kanji.end());
-                    }
-                }
-            }
-            std::sort(group.begin(), group.end());
-            group.resize(std::unique(group.begin(), group.end()) - group.begin());
-
-            std::vector<ushort> temp;
-            temp.swap(list);
-            list.resize(group.size());
-            list.resize(std::set_intersection(group.begin(), group.end(), temp.begin(), temp.end(), list.begin()) - list.begin());
-        }
+        KanjiBits tmpbits = kanjiBitsRadicals(fb, rads, f.tmprads);
+        list.erase(std::remove_if(list.begin(), list.end(), [&tmpbits](ushort ix) { return !tmpbits.test(ix); }), list.end());
     }
 }
 
@@ -803,6 +803,11 @@ void StrokeList::resize(int newsize)
     if (newsize < 0 || newsize >= tosigned(list.size()))
         return;
     list.resize(newsize);
+    cmplist.shrink(newsize);
+
+    dim = QRectF();
+    for (const auto &p : list)
+        dim = dim.isEmpty() ? p.first.bounds() : dim.united(p.first.bounds());
 }
 
 StrokeList::size_type StrokeList::size() const
@@ -1173,6 +1178,26 @@ ElementPointT ElementTransform::transformed(const ElementPoint &pt) const
 //-------------------------------------------------------------
 
 
+RecognizerSession::RecognizerSession() : valid(0)
+{
+
+}
+
+void RecognizerSession::clear()
+{
+    steps.clear();
+    valid = 0;
+}
+
+void RecognizerSession::removeStrokes(int first)
+{
+    valid = std::max(0, std::min(valid, first));
+}
+
+
+//-------------------------------------------------------------
+
+
 KanjiElementList::KanjiElementList() : version(0)
 {
 
@@ -1451,19 +1476,12 @@ void KanjiElementList::compareToModels(const Stroke &stroke, RecognizerCompariso
 {
     result.setSize(models.size() + cmodels.size());
     int ssiz = tosigned(models.size());
-    for (int ix = 0; ix != ssiz; ++ix)
-    {
-        //RecognizerComparison cmp;
-        result[ix].index = ix;
-        result[ix].distance = models[ix].compare(stroke);
-    }
 
-    for (int ix = 0, siz = tosigned(cmodels.size()); ix != siz; ++ix)
-    {
-        //RecognizerComparison cmp;
-        result[ssiz + ix].index = ssiz + ix;
-        result[ssiz + ix].distance = cmodels[ix].compare(stroke);
-    }
+    // Each model is compared on its own, so the comparisons are split between threads.
+    ZKanji::parallelFor(tosigned(result.size()), [this, &stroke, &result, ssiz](int ix) {
+        result[ix].index = ix;
+        result[ix].distance = ix < ssiz ? models[ix].compare(stroke) : cmodels[ix - ssiz].compare(stroke);
+    });
 }
 
 /*Positions:
@@ -1555,12 +1573,12 @@ void KanjiElementList::computeStrokePositions(BitArray &bits, QRectF orig, QRect
         bits.set(15, true);
 }
 
-void KanjiElementList::findCandidates(const StrokeList &strokes, std::vector<int> &result, int strokecnt, bool kanji, bool kana, bool other)
+void KanjiElementList::findCandidates(const StrokeList &strokes, std::vector<int> &result, int strokecnt, bool kanji, bool kana, bool other, RecognizerSession *session)
 {
     // Number of items to include in result at most.
     const int cntlimit = 256;
-    // Drawn stroke order can be different for each stroke by swplimit position.
-    const int swplimit = 1;
+    // Number of elements compared by a single thread at a time.
+    const int chunksize = 128;
 
     if (strokecnt == -1)
         strokecnt = tosigned(strokes.size());
@@ -1587,158 +1605,86 @@ void KanjiElementList::findCandidates(const StrokeList &strokes, std::vector<int
         value[ix].distance = 2147483647;
     }
 
-    int pos = 0;
-    int lowest = 999999;
-
-    int used[255];
-    try
+    std::vector<CandidateDistance> dist;
+    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
     {
-        for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
-        {
-            KanjiElement *e = list[ix];
-
-            if (e->recdata.empty() || (e->owner != (ushort)-1 && !kanji) || ((cntlimit >= 0 && abs(e->variants[0]->strokecnt - strokecnt) > cntlimit) || (!cntlimit && e->variants[0]->strokecnt < std::max(1, std::min(strokecnt - 3, strokecnt / 2)))) || (e->unicode != 0 && ((KANA(e->unicode) && !kana) || (VALIDCODE(e->unicode) && !other) || (!other && !kana) )))
-                continue;
-
-            memset(used, -1, sizeof(int) * 255);
-            value[pos].distance = std::max(0, strokecnt - e->variants[0]->strokecnt) * 40000;
-            value[pos].index = ix;
-            for (int iy = 0; iy < std::min(e->variants[0]->strokecnt + swplimit, strokecnt) && value[pos].distance < std::max(10000, lowest) * 1.5; ++iy)
-            {
-                int distmin = -1;
-                int sindex = -1;
-                for (int k = iy - swplimit; k < iy + swplimit + 1; ++k)
-                {
-                    if (k < 0 || k >= e->variants[0]->strokecnt || (used[k] >= 0 && (k == 0 || k != iy || used[k - 1] >= 0)))
-                        continue;
-                    double dval;
-
-                    dval = strokes.cmpItems(iy)[e->recdata[k].data.index].distance / 2.;
-
-                    dval += abs(k - iy) * 300;
-
-                    if (distmin < 0 || distmin > dval)
-                    {
-                        distmin = dval;
-                        sindex = k;
-                    }
-                }
-                if (distmin < 0)
-                    distmin = 0;
-                else
-                {
-                    if (used[sindex] >= 0 && used[sindex - 1] < 0)
-                        used[sindex - 1] = sindex - 1;
-#ifdef _DEBUG
-                    else if (used[sindex] >= 0)
-                        throw "?";
-#endif
-                    used[sindex] = iy;
-                }
-                value[pos].distance += std::min(100000, distmin);
-            }
-
-            int compdist = std::max(3000, value[pos].distance);
-
-            int n = std::min(strokecnt, (int)e->variants[0]->strokecnt);
-            double posw;
-            for (int iy = 0; iy < n && value[pos].distance < std::max(10000, lowest) * 1.5; ++iy)
-            {
-                int c = used[iy];
-                if (c < 0)
-                {
-                    value[pos].distance += (double)compdist * 0.2 * 196 / n; //maximum pos difference. this should be changed if difference changes
-                    continue;
-                }
-
-                int c2;
-                double dval;
+        KanjiElement *e = list[ix];
 
-                for (int iz = iy + 1; iz < std::min(n, iy + 3); ++iz)
-                {
-                    c2 = used[iz];
-                    if (c2 >= 0)
-                    {
-                        posw = iz - iy == 1 ? 0.09 : 0.03;
+        if (e->recdata.empty() || (e->owner != (ushort)-1 && !kanji) || ((cntlimit >= 0 && abs(e->variants[0]->strokecnt - strokecnt) > cntlimit) || (!cntlimit && e->variants[0]->strokecnt < std::max(1, std::min(strokecnt - 3, strokecnt / 2)))) || (e->unicode != 0 && ((KANA(e->unicode) && !kana) || (VALIDCODE(e->unicode) && !other) || (!other && !kana) )))
+            continue;
 
-                        dval = ((double)(posDiff(e->recdata[iy].pos[iz - 1], strokes.posItems(c)[c2 - (c2 > c ? 1 : 0)])) * ((double)compdist * posw)) / n;
-                        if (swplimit > 0 && iz == iy + 1 && c == iy && c2 == iz && e->recdata[iy].data.index == e->recdata[iz].data.index)
-                        {
-                            double dtmp = ((double)(posDiff(e->recdata[iy].pos[iz - 1], strokes.posItems(c2)[c])) * ((double)compdist * posw)) / n;
-                            if (dtmp < dval)
-                            {
-                                dval = dtmp;
-                                int k = c;
-                                c = used[iy] = c2;
-                                used[iz] = k;
-                            }
-                        }
-                        value[pos].distance += dval;
-                    }
-                }
-                for (int iz = iy - 1; iz >= std::max(0, iy - 2); --iz)
-                {
-                    c2 = used[iz];
-                    if (c2 >= 0)
-                    {
-                        posw = iy - iz == 1 ? 0.09 : 0.03;
+        dist.push_back(CandidateDistance());
+        dist.back().index = ix;
+    }
 
-                        dval = ((double)(posDiff(e->recdata[iy].pos[iz], strokes.posItems(c)[c2 - (c2 > c ? 1 : 0)])) * ((double)compdist * posw)) / n;
-                        value[pos].distance += dval;
-                    }
-                }
+    if (session != nullptr)
+    {
+        if (tosigned(session->steps.size()) != tosigned(list.size()))
+        {
+            session->steps.clear();
+            session->steps.resize(list.size());
+        }
+        else
+        {
+            for (std::vector<RecognizerSession::Step> &s : session->steps)
+                if (tosigned(s.size()) > session->valid)
+                    s.resize(session->valid);
+        }
+        session->valid = tosigned(strokes.size());
+    }
 
-            }
+    // The bound of each element's computation depends on the lowest distance of the elements
+    // before it. The elements are compared in chunks on separate threads, each chunk only
+    // using the lowest distance found in it for the bound. This bound is never lower than
+    // the real one, so the real result can be derived from the saved checks.
+    ZKanji::parallelFor((tosigned(dist.size()) + chunksize - 1) / chunksize, [this, &dist, &strokes, strokecnt, session, chunksize](int chunk) {
+        std::vector<RecognizerSession::Step> steps;
+        int lowest = 999999;
+        for (int ix = chunk * chunksize, siz = std::min(tosigned(dist.size()), ix + chunksize); ix != siz; ++ix)
+        {
+            CandidateDistance &r = dist[ix];
+            steps.clear();
+            candidateDistance(list[r.index], strokes, strokecnt, lowest, r, session != nullptr ? session->steps[r.index] : steps);
+            if (!r.failed && lowest > r.distance)
+                lowest = r.distance;
+        }
+    });
 
-            if (e->variants[0]->width < 5000 && e->variants[0]->height < 5000)
-            {
-                if (strokes.width() < 0.35 && strokes.height() < 0.35)
-                    value[pos].distance = std::max(0.0, value[pos].distance - compdist * 0.05);
-                else if (strokes.width() > 0.5 || strokes.height() > 0.5)
-                    value[pos].distance += compdist * 0.05;
-            }
-            else if (e->variants[0]->width > 5000 && e->variants[0]->height > 5000)
-            {
-                if (strokes.width() < 0.35 && strokes.height() < 0.35)
-                    value[pos].distance += compdist * 0.05;
-                else if (strokes.width() > 0.5 || strokes.height() > 0.5)
-                    value[pos].distance = std::max(0.0, value[pos].distance - compdist * 0.05);
-            }
+    std::vector<RecognizerSession::Step> steps;
 
-            if (e->variants[0]->strokecnt > strokecnt)
-            {
-                int d = std::min(4, e->variants[0]->strokecnt - strokecnt);
-                value[pos].distance += d * 2500 + std::min((d - 1) * 3333, 10000);
-            }
+    int pos = 0;
+    int lowest = 999999;
+    for (CandidateDistance &r : dist)
+    {
+        if (r.failed)
+            continue;
 
-            if (value[pos].distance >= std::max(10000, lowest) * 1.5)
-            {
+        const KanjiElement *e = list[r.index];
 
-                if (lowest > value[pos].distance)
-                {
-                    lowest = value[pos].distance;
-                }
-                else
-                {
-                    value[pos].index = (ushort)-1;
-                    value[pos].distance = 2147483647;
-                }
-            }
-            else
-            {
+        // The computation in the chunk can stop too early when the lowest distance of the
+        // chunk is not the real lowest.
+        if (r.cut && r.bound < std::max(10000, lowest) * 1.5)
+        {
+            steps.clear();
+            candidateDistance(e, strokes, strokecnt, lowest, r, session != nullptr ? session->steps[r.index] : steps);
+            if (r.failed)
+                continue;
+        }
 
-                if (lowest > value[pos].distance)
-                    lowest = value[pos].distance;
+        int d = candidateResult(e, strokes, strokecnt, lowest, r);
+        bool found = d < std::max(10000, lowest) * 1.5;
 
-                pos++;
-            }
+        if (lowest > d)
+            lowest = d;
 
+        if (found)
+        {
+            value[pos].index = r.index;
+            value[pos].distance = d;
+            pos++;
         }
     }
-    catch (...)
-    {
-        ;
-    }
+
     std::sort(value.data(), value.data() + value.size(), [](const RecognizerComparison &a, const RecognizerComparison &b) {
         return a.distance < b.distance;
     });
@@ -1761,6 +1707,11 @@ KanjiElementList::size_type KanjiElementList::size() const
     return list.size();
 }
 
+bool KanjiElementList::hasRecognizerData(int index) const
+{
+    return !list[index]->recdata.empty();
+}
+
 KanjiEntry* KanjiElementList::itemKanji(int index) const
 {
     ushort o = list[index]->owner;
@@ -2010,6 +1961,48 @@ void KanjiElementList::drawStrokePart(QPainter &painter, bool partialline, int e
     drawStrokePart(painter, partialline, strokew, s, tr, parts, part, startcolor, endcolor);
 }
 
+void KanjiElementList::strokePoints(int element, int variant, int stroke, const QRectF &rect, int segcnt, std::vector<QPointF> &points) const
+{
+    points.clear();
+
+    const KanjiElement *e = list[element];
+    const ElementVariant *v = e->variants[variant];
+
+    // Same placement as when drawing the variant, without leaving space for the pen.
+    double div = std::min(rect.width() / 42500, rect.height() / 40000);
+    QRectF r = QRectF(rect.left() + (rect.width() - v->width * div) / 2.0, rect.top() + (rect.height() - v->height * div) / 2.0, v->width * div, v->height * div);
+
+    ElementTransform tr;
+    const ElementStroke *s = findStroke(e, v, stroke, r, tr);
+    if (s == nullptr || s->points.empty())
+        return;
+
+    ElementPointT pastpoint = tr.transformed(s->points[0]);
+    points.push_back(QPointF(pastpoint.x, pastpoint.y));
+
+    for (int ix = 1, siz = tosigned(s->points.size()); ix != siz; ++ix)
+    {
+        ElementPointT point = tr.transformed(s->points[ix]);
+
+        if (point.type == ElementPoint::Curve)
+        {
+            for (int iy = 1; iy < segcnt; ++iy)
+            {
+                double t = double(iy) / segcnt;
+                double mt = 1.0 - t;
+                double a = mt * mt * mt;
+                double b = 3 * mt * mt * t;
+                double c = 3 * mt * t * t;
+                double d = t * t * t;
+                points.push_back(QPointF(a * pastpoint.x + b * point.c1x + c * point.c2x + d * point.x, a * pastpoint.y + b * point.c1y + c * point.c2y + d * point.y));
+            }
+        }
+        points.push_back(QPointF(point.x, point.y));
+
+        pastpoint = point;
+    }
+}
+
 const ElementStroke* KanjiElementList::findStroke(const KanjiElement *e, const ElementVariant *v, int sindex, QRectF r, ElementTransform &tr) const
 {
     if (v->standalone)
@@ -2608,6 +2601,205 @@ void KanjiElementList::loadVariantNames(QDataStream &stream)
     }
 }
 
+void KanjiElementList::candidateDistance(const KanjiElement *e, const StrokeList &strokes, int strokecnt, int lowest, CandidateDistance &r, std::vector<RecognizerSession::Step> &steps)
+{
+    // Drawn stroke order can be different for each stroke by swplimit position.
+    const int swplimit = 1;
+
+    const ElementVariant *v = e->variants[0];
+
+    r.bound = std::max(10000, lowest) * 1.5;
+    r.checks.clear();
+    r.strokechecks = 0;
+    r.strokedist = 0;
+    r.distance = 0;
+    r.cut = false;
+    r.failed = false;
+
+    int distance = std::max(0, strokecnt - v->strokecnt) * 40000;
+
+    // Saves the distance before checking it against the bound.
+    auto checkBound = [&r, &distance]() {
+        r.checks.push_back(distance);
+        r.cut = distance >= r.bound;
+        return !r.cut;
+    };
+
+    int used[255];
+    try
+    {
+        memset(used, -1, sizeof(int) * 255);
+        for (int iy = 0; iy < std::min(v->strokecnt + swplimit, strokecnt) && checkBound(); ++iy)
+        {
+            if (iy == tosigned(steps.size()))
+                steps.push_back(candidateStep(e, strokes, iy, used));
+
+            const RecognizerSession::Step &step = steps[iy];
+            if (step.sindex >= 0)
+            {
+                if (step.prev)
+                    used[step.sindex - 1] = step.sindex - 1;
+                used[step.sindex] = iy;
+            }
+            distance += step.distance;
+        }
+
+        r.strokechecks = tosigned(r.checks.size());
+        r.strokedist = distance;
+
+        int compdist = std::max(3000, distance);
+
+        int n = std::min(strokecnt, (int)v->strokecnt);
+        double posw;
+        for (int iy = 0; iy < n && !r.cut && checkBound(); ++iy)
+        {
+            int c = used[iy];
+            if (c < 0)
+            {
+                distance += (double)compdist * 0.2 * 196 / n; //maximum pos difference. this should be changed if difference changes
+                continue;
+            }
+
+            int c2;
+            double dval;
+
+            for (int iz = iy + 1; iz < std::min(n, iy + 3); ++iz)
+            {
+                c2 = used[iz];
+                if (c2 >= 0)
+                {
+                    posw = iz - iy == 1 ? 0.09 : 0.03;
+
+                    dval = ((double)(posDiff(e->recdata[iy].pos[iz - 1], strokes.posItems(c)[c2 - (c2 > c ? 1 : 0)])) * ((double)compdist * posw)) / n;
+                    if (swplimit > 0 && iz == iy + 1 && c == iy && c2 == iz && e->recdata[iy].data.index == e->recdata[iz].data.index)
+                    {
+                        double dtmp = ((double)(posDiff(e->recdata[iy].pos[iz - 1], strokes.posItems(c2)[c])) * ((double)compdist * posw)) / n;
+                        if (dtmp < dval)
+                        {
+                            dval = dtmp;
+                            int k = c;
+                            c = used[iy] = c2;
+                            used[iz] = k;
+                        }
+                    }
+                    distance += dval;
+                }
+            }
+            for (int iz = iy - 1; iz >= std::max(0, iy - 2); --iz)
+            {
+                c2 = used[iz];
+                if (c2 >= 0)
+                {
+                    posw = iy - iz == 1 ? 0.09 : 0.03;
+
+                    dval = ((double)(posDiff(e->recdata[iy].pos[iz], strokes.posItems(c)[c2 - (c2 > c ? 1 : 0)])) * ((double)compdist * posw)) / n;
+                    distance += dval;
+                }
+            }
+
+        }
+
+        r.distance = candidateSizeDistance(e, strokes, strokecnt, distance, compdist);
+    }
+    catch (...)
+    {
+        r.failed = true;
+    }
+}
+
+RecognizerSession::Step KanjiElementList::candidateStep(const KanjiElement *e, const StrokeList &strokes, int index, const int *used) const
+{
+    // Drawn stroke order can be different for each stroke by swplimit position.
+    const int swplimit = 1;
+
+    const ElementVariant *v = e->variants[0];
+
+    int distmin = -1;
+    int sindex = -1;
+    for (int k = index - swplimit; k < index + swplimit + 1; ++k)
+    {
+        if (k < 0 || k >= v->strokecnt || (used[k] >= 0 && (k == 0 || k != index || used[k - 1] >= 0)))
+            continue;
+        double dval;
+
+        dval = strokes.cmpItems(index)[e->recdata[k].data.index].distance / 2.;
+
+        dval += abs(k - index) * 300;
+
+        if (distmin < 0 || distmin > dval)
+        {
+            distmin = dval;
+            sindex = k;
+        }
+    }
+
+    RecognizerSession::Step step;
+    step.sindex = sindex;
+    step.prev = false;
+    if (distmin < 0)
+        distmin = 0;
+    else
+    {
+        if (used[sindex] >= 0 && used[sindex - 1] < 0)
+            step.prev = true;
+#ifdef _DEBUG
+        else if (used[sindex] >= 0)
+            throw "?";
+#endif
+    }
+    step.distance = std::min(100000, distmin);
+
+    return step;
+}
+
+int KanjiElementList::candidateResult(const KanjiElement *e, const StrokeList &strokes, int strokecnt, int lowest, const CandidateDistance &r) const
+{
+    double bound = std::max(10000, lowest) * 1.5;
+    if (bound >= r.bound)
+        return r.distance;
+
+    // With the lower bound the computation stops at the first check that fails. When that's
+    // while comparing the strokes, the positions are not compared.
+    for (int ix = 0, siz = tosigned(r.checks.size()); ix != siz; ++ix)
+    {
+        int distance = r.checks[ix];
+        if (distance < bound)
+            continue;
+        int compdist = std::max(3000, ix < r.strokechecks ? distance : r.strokedist);
+        return candidateSizeDistance(e, strokes, strokecnt, distance, compdist);
+    }
+
+    return r.distance;
+}
+
+int KanjiElementList::candidateSizeDistance(const KanjiElement *e, const StrokeList &strokes, int strokecnt, int dist, int compdist) const
+{
+    const ElementVariant *v = e->variants[0];
+
+    if (v->width < 5000 && v->height < 5000)
+    {
+        if (strokes.width() < 0.35 && strokes.height() < 0.35)
+            dist = std::max(0.0, dist - compdist * 0.05);
+        else if (strokes.width() > 0.5 || strokes.height() > 0.5)
+            dist += compdist * 0.05;
+    }
+    else if (v->width > 5000 && v->height > 5000)
+    {
+        if (strokes.width() < 0.35 && strokes.height() < 0.35)
+            dist += compdist * 0.05;
+        else if (strokes.width() > 0.5 || strokes.height() > 0.5)
+            dist = std::max(0.0, dist - compdist * 0.05);
+    }
+
+    if (v->strokecnt > strokecnt)
+    {
+        int d = std::min(4, v->strokecnt - strokecnt);
+        dist += d * 2500 + std::min((d - 1) * 3333, 10000);
+    }
+
+    return dist;
+}
+
 int KanjiElementList::posDiff(const BitArray &p1, const BitArray &p2)
 {
     int diff = 0;
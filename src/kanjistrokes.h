@@ -522,6 +522,41 @@ struct KanjiEntry;
 
 enum class StrokeDirection { Unset, Left, Up, Right, Down, UpLeft, UpRight, DownLeft, DownRight  };
 
+// Work saved between calls to KanjiElementList::findCandidates() while the user draws a
+// character. The drawn strokes are compared with the strokes of each element one after the
+// other, so when a stroke is added, only the comparison of the new stroke is computed. The
+// positions of the strokes relative to each other change with every new stroke, and those
+// are compared every time.
+class RecognizerSession
+{
+public:
+    RecognizerSession();
+
+    // Forgets every saved comparison. Call when the stroke list is cleared.
+    void clear();
+    // Forgets the saved comparisons of the strokes from index first. Call before the strokes
+    // at and after first are removed or replaced in the stroke list.
+    void removeStrokes(int first);
+private:
+    // Result of comparing a single drawn stroke with the strokes of an element.
+    struct Step
+    {
+        // Distance added by the drawn stroke.
+        int distance;
+        // The element's stroke matched with the drawn stroke or -1.
+        short sindex;
+        // The element's stroke in front of sindex was marked as used too.
+        bool prev;
+    };
+
+    // Saved comparisons for each element, one step for each drawn stroke.
+    std::vector<std::vector<Step>> steps;
+    // Number of drawn strokes the saved steps are valid for.
+    int valid;
+
+    friend class KanjiElementList;
+};
+
 // Main class for handwriting recognition. Contains model strokes (to match with user drawn
 // strokes), kanji elements (reusable group of strokes), and kanji data made up of elements.
 class KanjiElementList
@@ -555,13 +590,17 @@ public:
 
     // Matches the strokes in stroke list with characters that have recognizer data. Stores
     // the indexes of possible character element matches in their order of similarity to
-    // strokes in results.
-    void findCandidates(const StrokeList &strokes, std::vector<int> &result, int strokecnt = -1, bool includekanji = true, bool includekana = true, bool includeother = true);
+    // strokes in results. Pass a session when the strokes are drawn one by one, to reuse the
+    // comparison of strokes from the previous call.
+    void findCandidates(const StrokeList &strokes, std::vector<int> &result, int strokecnt = -1, bool includekanji = true, bool includekana = true, bool includeother = true, RecognizerSession *session = nullptr);
 
     // Number of elements in the recognizer list. Not all elements correspond to a valid
     // character, many are parts of others.
     size_type size() const;
 
+    // Whether the item at index can be found by findCandidates().
+    bool hasRecognizerData(int index) const;
+
     // The kanji owner of the item at index. If no owner is set for an element the returned
     // value is null. 
     KanjiEntry* itemKanji(int index) const;
@@ -610,6 +649,12 @@ public:
     // rectangle.
     void strokeData(int element, int variant, int stroke, const QRectF &rect, StrokeDirection &dir, QPoint &startpoint) const;
 
+    // Fills points with points along the stroke of an element's variant, if it is to be
+    // drawn in the passed rectangle. Curves are approximated with segcnt line segments. The
+    // rectangle should be given in pixel size units, as parts of elements are positioned on
+    // whole coordinates.
+    void strokePoints(int element, int variant, int stroke, const QRectF &rect, int segcnt, std::vector<QPointF> &points) const;
+
     // Returns the width of the pen used for the middle weight lines depending on minsize,
     // which should be the smaller size of the rectangle where the element will be drawn.
     double basePenWidth(int minsize) const;
@@ -713,6 +758,45 @@ private:
     // Difference in position betwee two position bit arrays. Used in handwriting recognition.
     int posDiff(const BitArray &p1, const BitArray &p2);
 
+    // Distance of drawn strokes from an element in findCandidates. The computation stops
+    // when the distance reaches a bound that depends on the lowest distance found before the
+    // element. The distance values checked against the bound are saved, so the result can be
+    // derived for any lower bound without comparing the strokes again.
+    struct CandidateDistance
+    {
+        // Index of the element.
+        int index;
+        // Bound used when computing the distance.
+        double bound;
+        // Distance values checked against the bound, in the order they were checked.
+        std::vector<int> checks;
+        // Number of values in checks before the comparison of stroke positions.
+        int strokechecks;
+        // Distance after comparing the strokes, before comparing their positions.
+        int strokedist;
+        // Resulting distance.
+        int distance;
+        // The computation stopped because the distance reached the bound.
+        bool cut;
+        // The computation failed and the element should be skipped.
+        bool failed;
+    };
+
+    // Computes the distance of the first strokecnt strokes in strokes from element e, with
+    // the bound derived from lowest. The index in r is not changed. The comparisons of
+    // single strokes are taken from steps, and the missing ones are added to it.
+    void candidateDistance(const KanjiElement *e, const StrokeList &strokes, int strokecnt, int lowest, CandidateDistance &r, std::vector<RecognizerSession::Step> &steps);
+    // Compares the drawn stroke at index with the strokes of element e, given the element's
+    // strokes already matched in used.
+    RecognizerSession::Step candidateStep(const KanjiElement *e, const StrokeList &strokes, int index, const int *used) const;
+    // Returns the distance that candidateDistance() would compute from r with the bound
+    // derived from lowest. The bound must not be higher than the one used for r, unless
+    // the computation for r finished without reaching its bound.
+    int candidateResult(const KanjiElement *e, const StrokeList &strokes, int strokecnt, int lowest, const CandidateDistance &r) const;
+    // Adds the differences in size and stroke count between strokes and element e to dist,
+    // the distance after comparing the strokes and their positions.
+    int candidateSizeDistance(const KanjiElement *e, const StrokeList &strokes, int strokecnt, int dist, int compdist) const;
+
     // File version after loading.
     int version;
 
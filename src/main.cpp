@@ -37,6 +37,7 @@
 #include "globalui.h"
 #include "sentences.h"
 #include "kanjistrokes.h"
+#include "recognizerbenchmark.h"
 
 #include "grammar_enums.h"
 #include "languages.h"
@@ -802,6 +803,19 @@ int main(int argc, char **argv)
         out << "                               encoding." << Qt::endl;
         out << Qt::endl;
         out << "  -ie [path]      can be used when the files are located at the same path." << Qt::endl;
+        out << Qt::endl;
+        out << "  -rb [options]   measure the accuracy and speed of the handwriting recognizer" << Qt::endl;
+        out << "                  with characters generated from its own data, then quit." << Qt::endl;
+        out << "                  Options are name=value pairs: count, jitter, scale, swap and" << Qt::endl;
+        out << "                  seed. For example: -rb count=1000 jitter=0.02 swap=0.1" << Qt::endl;
+        out << Qt::endl;
+        out << "  -db [words]     measure the time of deinflecting the listed words, or a built" << Qt::endl;
+        out << "                  in list of conjugated forms when none are given, then quit." << Qt::endl;
+        out << Qt::endl;
+        out << "  -sb [words]     measure the time of searching for inflected words in the main" << Qt::endl;
+        out << "                  dictionary, with and without parallel search, then quit." << Qt::endl;
+        out << "                  Searches for the listed words, or a built in list of words" << Qt::endl;
+        out << "                  when none are given." << Qt::endl;
         out.flush();
         exit(0);
     }
@@ -813,65 +827,75 @@ int main(int argc, char **argv)
 
     try
     {
+        // The benchmarks only print their results and quit, so they can run while another
+        // instance of the program is open.
+        bool benchmarking = args.contains("-rb") || args.contains("-db") || args.contains("-sb");
+
         std::unique_ptr<QSharedMemory> singleappguard(new QSharedMemory("zkanjiSingleAppGuardSoNoMultipleZKanjiAppsGetOpened", &a));
 #ifdef Q_OS_WIN
-        if (singleappguard->attach(QSharedMemory::ReadOnly))
+        if (!benchmarking)
         {
-            if (singleappguard->lock())
+            if (singleappguard->attach(QSharedMemory::ReadOnly))
+            {
+                if (singleappguard->lock())
+                {
+                    QByteArray bb = QByteArray((const char*)singleappguard->data(), singleappguard->size());
+                    singleappguard->unlock();
+                    // Send a message to the window to restore or raise the application.
+                    HWND wnd = FindWindow(nullptr, &QString::fromLatin1(bb).toStdWString()[0]);
+                    if (wnd != NULL)
+                        PostMessage(wnd, WM_USER + 999, 0, 0);
+                }
+
+                singleappguard->detach();
+                exit(0);
+            }
+            if (!singleappguard->create(7 + tosigned(strlen(ZKANJI_PROGRAM_VERSION))) || !singleappguard->lock())
             {
-                QByteArray bb = QByteArray((const char*)singleappguard->data(), singleappguard->size());
+                // Some error occurred that prevents creating this shared memory.
+                exit(0);
+            }
+            else
+            {
+                memcpy(singleappguard->data(), "zkanji ", 7);
+                memcpy((byte*)singleappguard->data() + 7, ZKANJI_PROGRAM_VERSION, strlen(ZKANJI_PROGRAM_VERSION));
                 singleappguard->unlock();
-                // Send a message to the window to restore or raise the application.
-                HWND wnd = FindWindow(nullptr, &QString::fromLatin1(bb).toStdWString()[0]);
-                if (wnd != NULL)
-                    PostMessage(wnd, WM_USER + 999, 0, 0);
             }
-
-            singleappguard->detach();
-            exit(0);
-        }
-        if (!singleappguard->create(7 + tosigned(strlen(ZKANJI_PROGRAM_VERSION))) || !singleappguard->lock())
-        {
-            // Some error occurred that prevents creating this shared memory.
-            exit(0);
-        }
-        else
-        {
-            memcpy(singleappguard->data(), "zkanji ", 7);
-            memcpy((byte*)singleappguard->data() + 7, ZKANJI_PROGRAM_VERSION, strlen(ZKANJI_PROGRAM_VERSION));
-            singleappguard->unlock();
         }
 
 #else
         QLocalServer server;
-        if (singleappguard->attach(QSharedMemory::ReadOnly))
-            singleappguard->detach();
-        // Attach/detach done twice, because on Linux it seems this removes the shared memory
-        // object if a previous instance of the program crashed and is not holding onto it.
-        if (singleappguard->attach(QSharedMemory::ReadOnly))
+        if (!benchmarking)
         {
-            QLocalSocket socket;
-            socket.connectToServer("zkanjiSingleAppServer");
-            socket.waitForConnected(1000);
-            socket.disconnectFromServer();
+            if (singleappguard->attach(QSharedMemory::ReadOnly))
+                singleappguard->detach();
+            // Attach/detach done twice, because on Linux it seems this removes the shared memory
+            // object if a previous instance of the program crashed and is not holding onto it.
+            if (singleappguard->attach(QSharedMemory::ReadOnly))
+            {
+                QLocalSocket socket;
+                socket.connectToServer("zkanjiSingleAppServer");
+                socket.waitForConnected(1000);
+                socket.disconnectFromServer();
 
-            singleappguard->detach();
-            exit(0);
-        }
-        if (!singleappguard->create(1))
-        {
-            // Some error occurred that prevents creating this shared memory.
-            exit(0);
-        }
+                singleappguard->detach();
+                exit(0);
+            }
+            if (!singleappguard->create(1))
+            {
+                // Some error occurred that prevents creating this shared memory.
+                exit(0);
+            }
 
-        // TODO: add something specific to the server name for each user, so different users
-        // can run their own instances. Better alternative to include the path where zkanji
-        // will save its data, as that should limit the instances running.
-        QLocalServer::removeServer("zkanjiSingleAppServer");
-        //server.setSocketOptions(); - Use this if the specific user mode is implemented by
-        // setting different name to the server for each user/data save location.
-        server.listen("zkanjiSingleAppServer");
-        gUI->connect(&server, &QLocalServer::newConnection, gUI, &GlobalUI::secondAppStarted);
+            // TODO: add something specific to the server name for each user, so different users
+            // can run their own instances. Better alternative to include the path where zkanji
+            // will save its data, as that should limit the instances running.
+            QLocalServer::removeServer("zkanjiSingleAppServer");
+            //server.setSocketOptions(); - Use this if the specific user mode is implemented by
+            // setting different name to the server for each user/data save location.
+            server.listen("zkanjiSingleAppServer");
+            gUI->connect(&server, &QLocalServer::newConnection, gUI, &GlobalUI::secondAppStarted);
+        }
 #endif
 
         a.setApplicationName("zkanji");
@@ -897,6 +921,24 @@ int main(int argc, char **argv)
 
         loadRecognizerData();
 
+        int rbpos = args.indexOf("-rb");
+        if (rbpos != -1)
+        {
+            QTextStream out(stdout);
+            ZKanji::benchmarkRecognizer(args.mid(rbpos + 1), out);
+            out.flush();
+            exit(0);
+        }
+
+        int dbpos = args.indexOf("-db");
+        if (dbpos != -1)
+        {
+            QTextStream out(stdout);
+            out << benchmarkDeinflect(args.mid(dbpos + 1));
+            out.flush();
+            exit(0);
+        }
+
         handleArguments(args);
 
         checkAppFolder();
@@ -939,6 +981,15 @@ int main(int argc, char **argv)
         loadDictionaries();
         ZKanji::loadSimilarKanji(ZKanji::appFolder() + "/data/similar.txt");
 
+        int sbpos = args.indexOf("-sb");
+        if (sbpos != -1)
+        {
+            QTextStream out(stdout);
+            out << ZKanji::benchmarkFindWords(args.mid(sbpos + 1));
+            out.flush();
+            exit(0);
+        }
+
         if (!expath.isEmpty())
         {
             // Importing example sentences.
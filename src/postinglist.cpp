@@ -0,0 +1,466 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#include <algorithm>
+#include <limits>
+#include "postinglist.h"
+#include "zkanjimain.h"
+
+#include "checked_cast.h"
+
+
+//-------------------------------------------------------------
+
+
+// Decodes a single value at pos in data, and moves pos after it. The data is not checked.
+static inline int decodeDelta(const uchar *data, int &pos)
+{
+    uchar b = data[pos++];
+    int result = b & 0x7f;
+    int shift = 7;
+    while ((b & 0x80) != 0)
+    {
+        b = data[pos++];
+        result |= (b & 0x7f) << shift;
+        shift += 7;
+    }
+    return result;
+}
+
+// Encodes delta in 7 bit groups to buf, which must hold at least 5 bytes. Returns the
+// number of bytes written.
+static inline int encodeDelta(int delta, uchar *buf)
+{
+    uint u = delta;
+    int len = 0;
+    while (u >= 0x80)
+    {
+        buf[len++] = uchar((u & 0x7f) | 0x80);
+        u >>= 7;
+    }
+    buf[len++] = uchar(u);
+    return len;
+}
+
+PostingList::PostingList() : cnt(0), last(0)
+{
+}
+
+bool PostingList::empty() const
+{
+    return cnt == 0;
+}
+
+int PostingList::size() const
+{
+    return cnt;
+}
+
+int PostingList::back() const
+{
+#ifdef _DEBUG
+    if (cnt == 0)
+        throw "No values in the posting list.";
+#endif
+    return last;
+}
+
+int PostingList::at(int ix) const
+{
+#ifdef _DEBUG
+    if (ix < 0 || ix >= cnt)
+        throw "Index out of range.";
+#endif
+
+    const Block &b = blocks[ix / BlockSize];
+    int val = b.value;
+    int pos = b.offset;
+    for (int n = ix % BlockSize; n != 0; --n)
+        val += decodeDelta(data.data(), pos);
+    return val;
+}
+
+void PostingList::clear()
+{
+    data.clear();
+    data.shrink_to_fit();
+    blocks.clear();
+    blocks.shrink_to_fit();
+    cnt = 0;
+    last = 0;
+}
+
+void PostingList::push_back(int val)
+{
+#ifdef _DEBUG
+    if (val < 0 || (cnt != 0 && val <= last))
+        throw "Values must be added in increasing order.";
+#endif
+
+    encode(cnt == 0 ? val : val - last);
+    if ((cnt % BlockSize) == 0)
+        blocks.push_back({ val, tosigned(data.size()) });
+    ++cnt;
+    last = val;
+}
+
+void PostingList::remove(int val)
+{
+    if (cnt == 0 || last < val)
+        return;
+
+    // The value is found from the start of the last block starting at or before val.
+    auto bit = std::upper_bound(blocks.begin() + 1, blocks.end(), val, [](int val, const Block &b) { return val < b.value; });
+    int bix = tosigned(bit - blocks.begin()) - 1;
+
+    int ix = bix * BlockSize;
+    int cur = blocks[bix].value;
+    int pos = blocks[bix].offset;
+    // Start of the encoded value before pos. Only the last byte of an encoded value has its
+    // highest bit cleared.
+    int start = pos - 1;
+    while (start != 0 && (data[start - 1] & 0x80) != 0)
+        --start;
+    int prevpos = start;
+    int prev = cur - decodeDelta(data.data(), prevpos);
+
+    while (cur < val)
+    {
+        prev = cur;
+        start = pos;
+        cur += decodeDelta(data.data(), pos);
+        ++ix;
+    }
+
+    if (cur != val)
+        return;
+
+    if (ix == cnt - 1)
+    {
+        data.resize(start);
+        if ((ix % BlockSize) == 0)
+            blocks.pop_back();
+        --cnt;
+        last = prev;
+        return;
+    }
+
+    // The difference of the removed value is merged with the next one. The merged
+    // difference never takes more bytes than the two it replaces.
+    int next = cur + decodeDelta(data.data(), pos);
+    uchar buf[5];
+    int len = encodeDelta(next - prev, buf);
+    std::copy(buf, buf + len, data.begin() + start);
+    data.erase(data.begin() + start + len, data.begin() + pos);
+
+    --cnt;
+    updateBlocks(ix, next, start + len);
+}
+
+void PostingList::remap(const std::vector<int> &changes)
+{
+    std::vector<int> values = toVector();
+    clear();
+    for (int val : values)
+    {
+        int newval = changes[val];
+        if (newval != -1)
+            push_back(newval);
+    }
+}
+
+std::vector<int> PostingList::toVector() const
+{
+    std::vector<int> result;
+    result.reserve(cnt);
+
+    int val = 0;
+    for (int pos = 0, siz = tosigned(data.size()); pos != siz;)
+    {
+        val += decodeDelta(data.data(), pos);
+        result.push_back(val);
+    }
+    return result;
+}
+
+const std::vector<uchar>& PostingList::encoded() const
+{
+    return data;
+}
+
+bool PostingList::setEncoded(int count, const uchar *src, int size)
+{
+    clear();
+    if (count < 0 || size < count)
+        return false;
+
+    blocks.reserve((count + BlockSize - 1) / BlockSize);
+
+    qint64 val = 0;
+    int pos = 0;
+    for (int ix = 0; ix != count; ++ix)
+    {
+        quint64 delta = 0;
+        int shift = 0;
+        uchar b;
+        do
+        {
+            if (pos == size || shift > 28)
+            {
+                clear();
+                return false;
+            }
+            b = src[pos++];
+            delta |= quint64(b & 0x7f) << shift;
+            shift += 7;
+        } while ((b & 0x80) != 0);
+
+        // Values must be unique and fit in an int.
+        val += delta;
+        if ((ix != 0 && delta == 0) || val > std::numeric_limits<int>::max())
+        {
+            clear();
+            return false;
+        }
+
+        if ((ix % BlockSize) == 0)
+            blocks.push_back({ (int)val, pos });
+    }
+
+    if (pos != size)
+    {
+        clear();
+        return false;
+    }
+
+    data.assign(src, src + size);
+    cnt = count;
+    last = (int)val;
+    return true;
+}
+
+void PostingList::encode(int delta)
+{
+    uchar buf[5];
+    int len = encodeDelta(delta, buf);
+    data.insert(data.end(), buf, buf + len);
+}
+
+void PostingList::updateBlocks(int ix, int val, int pos)
+{
+    blocks.resize((ix + BlockSize - 1) / BlockSize);
+    while (true)
+    {
+        if ((ix % BlockSize) == 0)
+            blocks.push_back({ val, pos });
+        if (++ix == cnt)
+            break;
+        val += decodeDelta(data.data(), pos);
+    }
+}
+
+
+//-------------------------------------------------------------
+
+
+PostingCursor::PostingCursor(const int *data, int size) : data(data), list(nullptr), siz(size), pos(0), val(0), bytepos(0)
+{
+}
+
+PostingCursor::PostingCursor(const std::vector<int> &list) : data(list.data()), list(nullptr), siz(tosigned(list.size())), pos(0), val(0), bytepos(0)
+{
+}
+
+PostingCursor::PostingCursor(const PostingList &list) : data(nullptr), list(&list), siz(list.size()), pos(0), val(0), bytepos(0)
+{
+    if (siz != 0)
+        decodeNext();
+}
+
+bool PostingCursor::atEnd() const
+{
+    return pos >= siz;
+}
+
+int PostingCursor::value() const
+{
+    return data != nullptr ? data[pos] : val;
+}
+
+int PostingCursor::size() const
+{
+    return siz;
+}
+
+void PostingCursor::next()
+{
+    ++pos;
+    if (data == nullptr && pos < siz)
+        decodeNext();
+}
+
+void PostingCursor::seek(int val)
+{
+    if (pos >= siz || value() >= val)
+        return;
+
+    if (data == nullptr)
+    {
+        // Find the last block starting at or before val with galloping search among the
+        // blocks, then decode the values in that block.
+        const std::vector<PostingList::Block> &blocks = list->blocks;
+        int bsiz = tosigned(blocks.size());
+        int bix = pos / PostingList::BlockSize;
+
+        // Invariant: blocks[lo].value <= val. The block is searched in [lo, hi).
+        int lo = bix;
+        int step = 1;
+        int hi = lo + step;
+        while (hi < bsiz && blocks[hi].value <= val)
+        {
+            lo = hi;
+            step *= 2;
+            hi = lo + step;
+        }
+        int end = hi < bsiz ? hi : bsiz;
+
+        auto it = std::upper_bound(blocks.begin() + lo + 1, blocks.begin() + end, val, [](int val, const PostingList::Block &b) { return val < b.value; });
+        int target = tosigned(it - blocks.begin()) - 1;
+        if (target > bix)
+        {
+            pos = target * PostingList::BlockSize;
+            this->val = blocks[target].value;
+            bytepos = blocks[target].offset;
+        }
+
+        while (this->val < val)
+        {
+            if (++pos == siz)
+                return;
+            decodeNext();
+        }
+        return;
+    }
+
+    // Invariant: data[lo] < val. The item is searched in (lo, hi].
+    int lo = pos;
+    int step = 1;
+    int hi = pos + step;
+    while (hi < siz && data[hi] < val)
+    {
+        lo = hi;
+        step *= 2;
+        hi = lo + step;
+    }
+    int end = hi < siz ? hi + 1 : siz;
+
+    pos = tosigned(std::lower_bound(data + lo + 1, data + end, val) - data);
+}
+
+void PostingCursor::decodeNext()
+{
+    val += decodeDelta(list->data.data(), bytepos);
+}
+
+
+//-------------------------------------------------------------
+
+
+void intersectPostings(std::vector<PostingCursor> &cursors, const std::function<void(int)> &func)
+{
+    if (cursors.empty())
+        return;
+
+    // Starting with the shortest list means the fewest candidates to check in the others.
+    std::sort(cursors.begin(), cursors.end(), [](const PostingCursor &a, const PostingCursor &b) { return a.size() < b.size(); });
+
+    PostingCursor &first = cursors.front();
+    int cnt = tosigned(cursors.size());
+
+    while (!first.atEnd())
+    {
+        int candidate = first.value();
+        bool match = true;
+
+        for (int ix = 1; ix != cnt; ++ix)
+        {
+            PostingCursor &c = cursors[ix];
+            c.seek(candidate);
+            if (c.atEnd())
+                return;
+            if (c.value() != candidate)
+            {
+                // The candidate is missing from this list. The next possible candidate is
+                // the value found here.
+                first.seek(c.value());
+                match = false;
+                break;
+            }
+        }
+
+        if (match)
+        {
+            func(candidate);
+            first.next();
+        }
+    }
+}
+
+void intersectPostings(std::vector<PostingCursor> &cursors, std::vector<int> &result)
+{
+    intersectPostings(cursors, [&result](int val) { result.push_back(val); });
+}
+
+bool postingsContain(std::vector<PostingCursor> &cursors, int val)
+{
+    for (PostingCursor &c : cursors)
+    {
+        c.seek(val);
+        if (c.atEnd() || c.value() != val)
+            return false;
+    }
+    return true;
+}
+
+void unitePostings(std::vector<PostingCursor> &cursors, std::vector<int> &result)
+{
+    int cnt = tosigned(cursors.size());
+    if (cnt == 1)
+    {
+        PostingCursor &c = cursors.front();
+        for (; !c.atEnd(); c.next())
+            result.push_back(c.value());
+        return;
+    }
+
+    // The lists are merged by always taking the smallest value at the cursors. The number of
+    // lists is small, so the smallest one is found with a linear search.
+    while (true)
+    {
+        int minval = 0;
+        bool found = false;
+        for (int ix = 0; ix != cnt; ++ix)
+        {
+            const PostingCursor &c = cursors[ix];
+            if (!c.atEnd() && (!found || c.value() < minval))
+            {
+                minval = c.value();
+                found = true;
+            }
+        }
+
+        if (!found)
+            break;
+
+        result.push_back(minval);
+        for (int ix = 0; ix != cnt; ++ix)
+        {
+            PostingCursor &c = cursors[ix];
+            if (!c.atEnd() && c.value() == minval)
+                c.next();
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#ifndef POSTINGLIST_H
+#define POSTINGLIST_H
+
+#include <vector>
+#include <functional>
+#include <QtGlobal>
+
+// Posting lists are sorted lists of unique word indexes, like the lists of words containing
+// a kanji in a dictionary. The functions below combine several posting lists without copying
+// or sorting them, by moving a cursor in each list. The lists can be plain vectors or
+// compressed PostingList objects.
+
+// Posting list stored in compressed form. Every value is stored as its difference from the
+// previous value, encoded in 7 bit groups, where the highest bit of each byte marks that more
+// bytes follow. Word indexes of long lists are close to each other, so most values only take
+// a single byte instead of four.
+// The position of every 64th value is saved in a separate table, to be able to skip to a
+// value without decoding every item before it.
+class PostingList
+{
+public:
+    PostingList();
+    PostingList(const PostingList &src) = default;
+    PostingList(PostingList &&src) = default;
+    PostingList& operator=(const PostingList &src) = default;
+    PostingList& operator=(PostingList &&src) = default;
+
+    bool empty() const;
+    // Number of values in the list.
+    int size() const;
+    // The last and largest value in the list. The list must not be empty.
+    int back() const;
+    // Returns the value at position ix. The values in front of it are decoded from the start
+    // of its 64 item block. When all values are needed, use a PostingCursor or toVector().
+    int at(int ix) const;
+
+    void clear();
+    // Appends val to the end of the list. The value must be larger than back().
+    void push_back(int val);
+    // Removes val from the list if it's found. The other values are not changed. Only the
+    // encoded values at val and after it, and the block table are updated.
+    void remove(int val);
+    // Replaces every value in the list with the value at its position in changes. Values
+    // mapped to -1 are removed. The mapping must keep the order of the values that remain.
+    void remap(const std::vector<int> &changes);
+
+    // Returns every value in the list in a vector.
+    std::vector<int> toVector() const;
+
+    // The encoded values, as written to dictionary files.
+    const std::vector<uchar>& encoded() const;
+    // Replaces the list with count values decoded from data of size bytes. Returns false and
+    // leaves the list empty if data is not a valid encoding of a sorted list of count unique,
+    // non-negative values.
+    bool setEncoded(int count, const uchar *data, int size);
+private:
+    // Position of the first value of a block in the encoded data.
+    struct Block
+    {
+        // The first value in the block.
+        int value;
+        // Byte offset in the encoded data after the first value of the block.
+        int offset;
+    };
+
+    enum { BlockSize = 64 };
+
+    // Encodes delta at the end of the data.
+    void encode(int delta);
+    // Recreates the blocks starting at or after the value at position ix. The value is val,
+    // and its encoding ends at byte offset pos.
+    void updateBlocks(int ix, int val, int pos);
+
+    std::vector<uchar> data;
+    std::vector<Block> blocks;
+    int cnt;
+    int last;
+
+    friend class PostingCursor;
+};
+
+// Read position in a posting list.
+class PostingCursor
+{
+public:
+    PostingCursor(const int *data, int size);
+    PostingCursor(const std::vector<int> &list);
+    PostingCursor(const PostingList &list);
+
+    // Returns whether the cursor moved past the last item in the list.
+    bool atEnd() const;
+    // Value of the item at the cursor. Only valid if atEnd() is false.
+    int value() const;
+    // Number of items in the whole list.
+    int size() const;
+
+    // Moves the cursor to the next item.
+    void next();
+    // Moves the cursor forward to the first item that's not less than val. The cursor is not
+    // moved if it's already at such an item. The item is looked up with galloping search:
+    // starting from the cursor the step size is doubled until an item not less than val is
+    // found, which is followed by a binary search in the last step. This makes skipping few
+    // items nearly as fast as a linear step, while skipping many is logarithmic.
+    void seek(int val);
+private:
+    // Decodes the value after the current one at bytepos in a compressed list.
+    void decodeNext();
+
+    // Values of an uncompressed list, or null.
+    const int *data;
+    // Compressed list when data is null.
+    const PostingList *list;
+    int siz;
+    int pos;
+
+    // Value at pos in a compressed list.
+    int val;
+    // Byte offset after the current value in a compressed list.
+    int bytepos;
+};
+
+// Calls func with every value that's found in all the cursors' lists, in increasing order.
+// The cursors are moved in the process. Nothing is found when cursors is empty.
+void intersectPostings(std::vector<PostingCursor> &cursors, const std::function<void(int)> &func);
+// Appends every value that's found in all the cursors' lists to result in increasing order.
+// The cursors are moved in the process.
+void intersectPostings(std::vector<PostingCursor> &cursors, std::vector<int> &result);
+// Returns whether val is found in all the cursors' lists. The cursors are only moved
+// forward, so values must be checked in increasing order when the same cursors are reused.
+bool postingsContain(std::vector<PostingCursor> &cursors, int val);
+
+// Appends every value found in any of the cursors' lists to result in increasing order,
+// without duplicates. The cursors are moved in the process.
+void unitePostings(std::vector<PostingCursor> &cursors, std::vector<int> &result);
+
+
+#endif // POSTINGLIST_H
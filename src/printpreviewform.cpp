@@ -734,6 +734,7 @@ void PrintPreviewForm::exec(Dictionary *d, const std::vector<int> &wordlist)
     list = wordlist;
 
     connect(d, &Dictionary::entryRemoved, this, &PrintPreviewForm::entryRemoved);
+    connect(d, &Dictionary::entriesCompacted, this, &PrintPreviewForm::entriesCompacted);
     connect(d, &Dictionary::entryChanged, this, &PrintPreviewForm::entryChanged);
     connect(d, &Dictionary::dictionaryReset, this, &PrintPreviewForm::close);
 
@@ -917,20 +918,18 @@ void PrintPreviewForm::pageScrolled()
 
 void PrintPreviewForm::entryRemoved(int windex, int /*abcdeindex*/, int /*aiueoindex*/)
 {
-    int wpos = -1;
-    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
-    {
-        if (list[ix] > windex)
-            --list[ix];
-        else if (list[ix] == windex)
-            wpos = ix;
-    }
+    auto it = std::find(list.begin(), list.end(), windex);
+    if (it == list.end())
+        return;
 
-    if (wpos != -1)
-    {
-        list.erase(list.begin() + wpos);
-        preview->updatePreview();
-    }
+    list.erase(it);
+    preview->updatePreview();
+}
+
+void PrintPreviewForm::entriesCompacted(const std::vector<int> &changes)
+{
+    for (int &windex : list)
+        windex = changes[windex];
 }
 
 void PrintPreviewForm::entryChanged(int windex, bool /*studydef*/)
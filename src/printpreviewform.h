@@ -185,6 +185,7 @@ protected slots:
     void pageScrolled();
 
     void entryRemoved(int windex, int abcdeindex, int aiueoindex);
+    void entriesCompacted(const std::vector<int> &changes);
     void entryChanged(int windex, bool studydef);
 
     void paintPages(QPrinter *p);
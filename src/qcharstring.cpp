@@ -472,6 +472,95 @@ QCharStringIterator::QCharStringIterator(QCharString *owner, QChar *pos) : base(
 //-------------------------------------------------------------
 
 
+namespace
+{
+    // Allocates data for length + 1 characters on the heap, after a character marking it as
+    // heap data.
+    QChar* allocChars(int length)
+    {
+        QChar *data = new QChar[length + 2];
+        data[0] = QChar(1);
+        return data + 1;
+    }
+
+    // Frees data allocated with allocChars(). Data in an arena is not freed.
+    void freeChars(QChar *arr)
+    {
+        if (arr != nullptr && arr[-1].unicode() != 0)
+            delete[] (arr - 1);
+    }
+}
+
+
+//-------------------------------------------------------------
+
+
+QCharStringArena::QCharStringArena() : pos(nullptr), left(0)
+{
+
+}
+
+QCharStringArena::QCharStringArena(QCharStringArena &&src) : pos(nullptr), left(0)
+{
+    swap(src);
+}
+
+QCharStringArena& QCharStringArena::operator=(QCharStringArena &&src)
+{
+    swap(src);
+    return *this;
+}
+
+void QCharStringArena::swap(QCharStringArena &src)
+{
+    std::swap(blocks, src.blocks);
+    std::swap(pos, src.pos);
+    std::swap(left, src.left);
+}
+
+void QCharStringArena::clear()
+{
+    blocks.clear();
+    pos = nullptr;
+    left = 0;
+}
+
+QChar* QCharStringArena::add(const QChar *str, int length)
+{
+    // Long strings get their own block, so the space left in the last block is not lost.
+    if (length + 2 > BlockSize / 2)
+    {
+        QChar *block = new QChar[length + 2];
+        blocks.push_back(std::unique_ptr<QChar[]>(block));
+        block[0] = QChar(0);
+        memcpy(block + 1, str, sizeof(QChar) * length);
+        block[length + 1] = QChar(0);
+        return block + 1;
+    }
+
+    if (length + 1 > left)
+    {
+        QChar *block = new QChar[BlockSize];
+        blocks.push_back(std::unique_ptr<QChar[]>(block));
+        block[0] = QChar(0);
+        pos = block + 1;
+        left = BlockSize - 1;
+    }
+
+    // The character before pos is always the null character after the previous string.
+    QChar *result = pos;
+    memcpy(result, str, sizeof(QChar) * length);
+    result[length] = QChar(0);
+    pos += length + 1;
+    left -= length + 1;
+
+    return result;
+}
+
+
+//-------------------------------------------------------------
+
+
 QCharString::QCharString() : arr(nullptr)
 #ifdef _DEBUG
     , siz(0)
@@ -510,7 +599,7 @@ QCharString::QCharString(const QCharString &src) : arr(nullptr)
 
     if (siz == 0)
         return;
-    arr = new QChar[siz + 1];
+    arr = allocChars(siz);
     memcpy(arr, src.arr, sizeof(QChar) * (siz + 1));
 }
 
@@ -519,7 +608,7 @@ QCharString& QCharString::operator=(const QCharString &src)
     if (&src == this)
         return *this;
 
-    delete[] arr;
+    freeChars(arr);
     arr = nullptr;
 
 #ifdef _DEBUG
@@ -530,7 +619,7 @@ QCharString& QCharString::operator=(const QCharString &src)
 
     if (siz == 0)
         return *this;
-    arr = new QChar[siz + 1];
+    arr = allocChars(siz);
 
     memcpy(arr, src.arr, sizeof(QChar) * (siz + 1));
 
@@ -539,7 +628,7 @@ QCharString& QCharString::operator=(const QCharString &src)
 
 QCharString::~QCharString()
 {
-    delete[] arr;
+    freeChars(arr);
 }
 
 QCharString::iterator QCharString::begin()
@@ -622,9 +711,9 @@ void QCharString::copy(const QChar *str, int length)
 {
     if (length == -1)
         length = tosigned(qcharlen(str));
-    delete[] arr;
+    freeChars(arr);
 
-    arr = new QChar[length + 1];
+    arr = allocChars(length);
     memcpy(arr, str, sizeof(QChar) * length);
     arr[length] = QChar(0);
 #ifdef _DEBUG
@@ -632,18 +721,52 @@ void QCharString::copy(const QChar *str, int length)
 #endif
 }
 
+void QCharString::copy(const QChar *str, int length, QCharStringArena &arena)
+{
+    if (length == -1)
+        length = tosigned(qcharlen(str));
+    freeChars(arr);
+
+    arr = arena.add(str, length);
+#ifdef _DEBUG
+    siz = length;
+#endif
+}
+
+void QCharString::setArenaData(QChar *str)
+{
+#ifdef _DEBUG
+    if (str == nullptr || str[-1].unicode() != 0)
+        throw "Data not in an arena.";
+    siz = tosigned(qcharlen(str));
+#endif
+
+    freeChars(arr);
+    arr = str;
+}
+
+void QCharString::moveToArena(QCharStringArena &arena)
+{
+    if (arr == nullptr || arr[-1].unicode() == 0)
+        return;
+
+    QChar *tmp = arr;
+    arr = arena.add(tmp, size());
+    freeChars(tmp);
+}
+
 void QCharString::setSize(size_type length)
 {
 #ifdef _DEBUG
     siz = length;
 #endif
-    delete[] arr;
+    freeChars(arr);
     if (length <= 0)
     {
         arr = nullptr;
         return;
     }
-    arr = new QChar[length + 1];
+    arr = allocChars(length);
     arr[length] = QChar(0);
     for (size_type ix = 0; ix != length; ++ix)
         arr[ix] = QChar(' ');
@@ -657,7 +780,7 @@ void QCharString::resize(size_type length)
 
     if (length <= 0)
     {
-        delete[] arr;
+        freeChars(arr);
         arr = nullptr;
         return;
     }
@@ -668,12 +791,12 @@ void QCharString::resize(size_type length)
         return;
 
     QChar *tmp = arr;
-    arr = new QChar[length + 1];
+    arr = allocChars(length);
     arr[length] = QChar(0);
 
     if (oldsize != 0)
         memcpy(arr, tmp, sizeof(QChar) * std::min(length, oldsize));
-    delete[] tmp;
+    freeChars(tmp);
 
     if (oldsize < length)
         for (size_type ix = oldsize; ix != length; ++ix)
@@ -694,7 +817,7 @@ bool QCharString::empty() const
 
 void QCharString::clear()
 {
-    delete[] arr;
+    freeChars(arr);
     arr = nullptr;
 #ifdef _DEBUG
     siz = 0;
@@ -1514,6 +1637,12 @@ void QCharStringList::copy(const QStringList &src)
         arr[ix].copy(src.at(ix).constData());
 }
 
+void QCharStringList::moveToArena(QCharStringArena &arena)
+{
+    for (size_type ix = 0; ix != used; ++ix)
+        arr[ix].moveToArena(arena);
+}
+
 QCharStringList::size_type QCharStringList::size() const
 {
     return used;
@@ -9,6 +9,8 @@
 
 #include <QChar>
 #include <QString>
+#include <vector>
+#include <memory>
 
 enum class QCharKind;
 
@@ -136,6 +138,41 @@ QCharStringIterator operator+(QCharStringIterator::difference_type n, const QCha
 QCharStringConstIterator operator+(QCharStringConstIterator::difference_type n, const QCharStringConstIterator &b);
 
 
+// Storage for the character data of QCharString objects that are loaded once and rarely
+// change, like the words of a dictionary. The strings are copied one after the other into
+// large blocks, which are only freed together when the arena is cleared or destroyed.
+// A QCharString using arena data copies it to the heap when its data is reallocated, and the
+// space in the arena is not reused. The arena must outlive the strings using its data.
+class QCharStringArena
+{
+public:
+    QCharStringArena(const QCharStringArena&) = delete;
+    QCharStringArena& operator=(const QCharStringArena&) = delete;
+
+    QCharStringArena();
+    QCharStringArena(QCharStringArena &&src);
+    QCharStringArena& operator=(QCharStringArena &&src);
+
+    void swap(QCharStringArena &src);
+
+    // Frees every block. Strings using data in the arena must be destroyed or cleared first.
+    void clear();
+
+    // Copies length number of characters from str to the arena and returns the address of the
+    // copy. The copy is followed by a null character. The character before the copy is also
+    // null, so str can be a block of null terminated strings, and each string in the block
+    // can be used by QCharString::setArenaData().
+    QChar* add(const QChar *str, int length);
+private:
+    enum { BlockSize = 32768 };
+
+    std::vector<std::unique_ptr<QChar[]>> blocks;
+
+    // Unused space at the end of the last block of BlockSize.
+    QChar *pos;
+    int left;
+};
+
 // Class for storing qstring like strings. These strings are meant to be faster compared
 // to qstring and should take less memory. There is no shared pointer, and the only data stored
 // is an array of QChars. (Which only holds a single ushort itself).
@@ -183,6 +220,19 @@ public:
     // qcharlen() is called on str, so it must be null terminated in that case.
     void copy(const QChar *str, int length = -1);
 
+    // Fills the array with a copy of str to at most length characters, placing the copy in
+    // arena. If length is -1, first qcharlen() is called on str, so it must be null
+    // terminated in that case.
+    void copy(const QChar *str, int length, QCharStringArena &arena);
+
+    // Uses the null terminated str as the data of the string without copying it. The string
+    // must be in a block returned by QCharStringArena::add(), and must come after a null
+    // character.
+    void setArenaData(QChar *str);
+
+    // Moves the data of the string to arena, if it's not in an arena already.
+    void moveToArena(QCharStringArena &arena);
+
     // Allocates data for length + 1 characters filled with space and the trailing zero. Use
     // the non constant data() function to access the allocated string. Does not copy old
     // contents.
@@ -253,6 +303,8 @@ public:
     // Returns the first index of ch in the string if found. Otherwise returns -1.
     int find(QChar ch) const;
 private:
+    // The character before the first character of the data is null if it's in an arena, and
+    // not null if it was allocated on the heap.
     QChar *arr;
 
     template <typename STR>
@@ -448,6 +500,9 @@ public:
     bool contains(const QChar *str, bool exact);
     // Sets the contents to match src.
     void copy(const QStringList &src);
+    // Moves the data of every string in the list to arena. The list itself is not placed in
+    // the arena.
+    void moveToArena(QCharStringArena &arena);
 
     size_type size() const;
     bool empty() const;
@@ -0,0 +1,146 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <random>
+#include <algorithm>
+#include "recognizerbenchmark.h"
+#include "kanjistrokes.h"
+
+#include "checked_cast.h"
+
+
+namespace ZKanji
+{
+    void benchmarkRecognizer(const QStringList &options, QTextStream &out)
+    {
+        int count = 500;
+        double jitter = 0.01;
+        double scale = 0.15;
+        double swap = 0;
+        uint seed = 1;
+
+        for (const QString &opt : options)
+        {
+            int pos = opt.indexOf('=');
+            if (pos == -1)
+                continue;
+            QString name = opt.left(pos);
+            QString val = opt.mid(pos + 1);
+            if (name == "count")
+                count = std::max(1, val.toInt());
+            else if (name == "jitter")
+                jitter = std::max(0.0, val.toDouble());
+            else if (name == "scale")
+                scale = std::max(0.0, std::min(0.9, val.toDouble()));
+            else if (name == "swap")
+                swap = std::max(0.0, std::min(1.0, val.toDouble()));
+            else if (name == "seed")
+                seed = val.toUInt();
+        }
+
+        KanjiElementList *rec = elements();
+
+        // Elements that are characters and can be recognized.
+        std::vector<int> chars;
+        for (int ix = 0, siz = tosigned(rec->size()); ix != siz; ++ix)
+            if (rec->hasRecognizerData(ix) && (rec->itemKanjiIndex(ix) != -1 || rec->itemUnicode(ix).unicode() != 0))
+                chars.push_back(ix);
+
+        if (chars.empty())
+        {
+            out << "No recognizer data found." << Qt::endl;
+            return;
+        }
+
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<int> pick(0, tosigned(chars.size()) - 1);
+        std::uniform_real_distribution<double> rnd(-1.0, 1.0);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+        // The elements are drawn on a large area, because parts of elements are positioned on
+        // whole coordinates. The points are then scaled down to the [0, 1] area used by the
+        // recognizer window.
+        const double areasize = 10000;
+
+        int top1 = 0;
+        int top10 = 0;
+        // Time taken in nanoseconds to add each stroke and list the candidates.
+        std::vector<qint64> times;
+
+        std::vector<int> result;
+        std::vector<QPointF> points;
+        std::vector<int> order;
+        QElapsedTimer timer;
+
+        for (int ix = 0; ix != count; ++ix)
+        {
+            int element = chars[pick(gen)];
+            int strokecnt = rec->strokeCount(element, 0);
+
+            order.resize(strokecnt);
+            for (int iy = 0; iy != strokecnt; ++iy)
+                order[iy] = iy;
+            for (int iy = 0; iy < strokecnt - 1; ++iy)
+            {
+                if (chance(gen) < swap)
+                {
+                    std::swap(order[iy], order[iy + 1]);
+                    ++iy;
+                }
+            }
+
+            double siz = 0.8 * (1.0 + scale * rnd(gen));
+            QRectF r((1.0 - siz) / 2.0 * areasize, (1.0 - siz) / 2.0 * areasize, siz * areasize, siz * areasize);
+
+            // Characters whose strokes have no points are counted as not recognized.
+            result.clear();
+
+            StrokeList strokes;
+            RecognizerSession session;
+            for (int iy = 0; iy != strokecnt; ++iy)
+            {
+                rec->strokePoints(element, 0, order[iy], r, 8, points);
+                if (points.empty())
+                    continue;
+
+                Stroke s;
+                for (const QPointF &pt : points)
+                    s.add(QPointF(pt.x() / areasize + jitter * rnd(gen), pt.y() / areasize + jitter * rnd(gen)));
+                if (s.size() == 1)
+                    s.add(QPointF(s[0].x() + 0.0005, s[0].y() + 0.0005));
+
+                timer.start();
+                strokes.add(std::move(s), false);
+                rec->findCandidates(strokes, result, tosigned(strokes.size()), true, true, true, &session);
+                times.push_back(timer.nsecsElapsed());
+            }
+
+            auto it = std::find(result.begin(), result.end(), element);
+            if (it == result.begin())
+                ++top1;
+            if (it != result.end() && it - result.begin() < 10)
+                ++top10;
+        }
+
+        out << "Characters: " << count << ", jitter: " << jitter << ", scale: " << scale << ", swap: " << swap << ", seed: " << seed << Qt::endl;
+        out << "Top 1: " << QString::number(top1 * 100.0 / count, 'f', 2) << "%" << Qt::endl;
+        out << "Top 10: " << QString::number(top10 * 100.0 / count, 'f', 2) << "%" << Qt::endl;
+
+        if (times.empty())
+            return;
+
+        std::sort(times.begin(), times.end());
+        auto percentile = [&times](double p) {
+            int pos = std::min(tosigned(times.size()) - 1, int(p * times.size()));
+            return QString::number(times[pos] / 1000000.0, 'f', 3);
+        };
+
+        out << "Strokes: " << tosigned(times.size()) << Qt::endl;
+        out << "Time per stroke (ms) p50: " << percentile(0.5) << ", p90: " << percentile(0.9) << ", p99: " << percentile(0.99) << ", max: " << percentile(1.0) << Qt::endl;
+    }
+}
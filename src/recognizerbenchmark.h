@@ -0,0 +1,35 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#ifndef RECOGNIZERBENCHMARK_H
+#define RECOGNIZERBENCHMARK_H
+
+#include <QStringList>
+
+class QTextStream;
+
+namespace ZKanji
+{
+    // Measures the accuracy and speed of the handwriting recognizer with characters drawn
+    // from the recognizer's own stroke data. The strokes of each character are distorted
+    // randomly and added one by one, listing candidates after every stroke like the
+    // recognizer window. Writes the ratio of characters found first and among the first 10
+    // candidates, and the percentiles of the time taken for each stroke to out.
+    // The options are a list of name=value pairs:
+    //  count:  number of characters to draw. (Default: 500)
+    //  jitter: largest random shift of the points of strokes, relative to the size of the
+    //          drawing area. (Default: 0.01)
+    //  scale:  largest random change in character size, relative to its normal size.
+    //          (Default: 0.15)
+    //  swap:   probability of drawing two neighboring strokes in the wrong order.
+    //          (Default: 0)
+    //  seed:   seed of the random generator, to repeat the same benchmark. (Default: 1)
+    // The recognizer data must be loaded.
+    void benchmarkRecognizer(const QStringList &options, QTextStream &out);
+}
+
+
+#endif // RECOGNIZERBENCHMARK_H
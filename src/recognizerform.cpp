@@ -137,6 +137,7 @@ void RecognizerArea::next()
 void RecognizerArea::clear()
 {
     strokes.clear();
+    session.clear();
     strokepos = 0;
     updateCandidates();
 }
@@ -282,6 +283,7 @@ void RecognizerArea::stopDrawing()
             newstroke.add(pt);
         }
 
+        session.removeStrokes(strokepos);
         strokes.resize(strokepos);
         strokes.add(std::move(newstroke), true);
         ++strokepos;
@@ -297,7 +299,7 @@ void RecognizerArea::updateCandidates()
 {
     std::vector<int> l;
     if (strokepos != 0)
-        ZKanji::elements()->findCandidates(strokes, l, strokepos, match.testFlag(Kanji), match.testFlag(Kana), match.testFlag(Other));
+        ZKanji::elements()->findCandidates(strokes, l, strokepos, match.testFlag(Kanji), match.testFlag(Kana), match.testFlag(Other), &session);
 
     emit changed(l);
 
@@ -143,6 +143,9 @@ private:
 
     StrokeList strokes;
 
+    // Comparisons of strokes saved between candidate searches.
+    RecognizerSession session;
+
     typedef QFrame base;
 };
 
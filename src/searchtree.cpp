@@ -8,6 +8,7 @@
 #include "searchtree.h"
 #include "zkanjimain.h"
 #include "treebuilder.h"
+#include "flatdata.h"
 
 #include "checked_cast.h"
 
@@ -403,6 +404,37 @@ int TextNodeList::removeLine(int line, bool deleted)
     return removed;
 }
 
+int TextNodeList::remapLines(const std::vector<int> &changes)
+{
+    int removed = 0;
+    for (int ix = tosigned(size()) - 1; ix != -1; --ix)
+    {
+        removed += list[ix]->nodes.remapLines(changes);
+        if (list[ix]->lines.empty() && list[ix]->nodes.empty() && owner != nullptr)
+            list.erase(list.begin() + ix);
+    }
+
+    if (owner != nullptr)
+    {
+        auto it = owner->lines.begin();
+        while (it != owner->lines.end())
+        {
+            int newline = changes[*it];
+            if (newline == -1)
+            {
+                it = owner->lines.erase(it);
+                ++removed;
+                continue;
+            }
+            *it = newline;
+            ++it;
+        }
+
+        owner->sum -= removed;
+    }
+    return removed;
+}
+
 int TextNodeList::nodePosition(const QChar *label, int length)
 {
     if (length == -1)
@@ -442,7 +474,7 @@ const int TextSearchTreeBase::NODEFULLCOUNT = 300;
 //const int TextSearchTreeBase::NODETOOMUCHCOUNT = 5000;
 
 TextSearchTreeBase::TextSearchTreeBase(/*bool createbase,*/) : nodes(nullptr),
-/*createbase(createbase),*/ cache(nullptr)
+/*createbase(createbase),*/ isfrozen(false), cache(nullptr)
 {
     //if (createbase)
     //{
@@ -475,6 +507,7 @@ TextSearchTreeBase::~TextSearchTreeBase()
 void TextSearchTreeBase::load(QDataStream& stream)
 {
     cache = nullptr;
+    clearFrozen();
     qint32 nodecnt;
 
     quint16 ui;
@@ -492,22 +525,275 @@ void TextSearchTreeBase::load(QDataStream& stream)
 
 void TextSearchTreeBase::save(QDataStream &stream) const
 {
+#ifdef _DEBUG
+    if (isfrozen)
+        throw "Only saveFlat() can write a frozen tree.";
+#endif
+
     stream << (quint16)nodes.size();
     for (int ix = 0, siz = tosigned(nodes.size()); ix != siz; ++ix)
         nodes.items(ix)->save(stream);
 
 }
 
+// Fills node n and creates its child nodes from the pre-order records of dictionary files
+// of version 2.
+static void loadPreorderRecords(TextNode *n, const QChar *pool, quint32 poolsize, const std::vector<quint32> &records, size_t &recpos, const std::vector<qint32> &lines, size_t &linepos)
+{
+    if (recpos + 3 > records.size())
+        throw ZException("Invalid search tree data.");
+
+    quint32 label = records[recpos];
+    quint32 linecnt = records[recpos + 1];
+    quint32 childcnt = records[recpos + 2];
+    recpos += 3;
+
+    if (label >= poolsize || linepos + linecnt > lines.size())
+        throw ZException("Invalid search tree data.");
+
+    if (pool[label].unicode() != 0)
+        n->label.copy(pool + label);
+
+    n->lines.assign(lines.begin() + linepos, lines.begin() + (linepos + linecnt));
+    linepos += linecnt;
+    n->sum = linecnt;
+
+    n->nodes.reserve(childcnt);
+    for (quint32 ix = 0; ix != childcnt; ++ix)
+    {
+        TextNode *c = new TextNode(n);
+        n->nodes.addNode(c, false);
+        loadPreorderRecords(c, pool, poolsize, records, recpos, lines, linepos);
+        n->sum += c->sum;
+    }
+}
+
+void TextSearchTreeBase::loadFlat(FlatReader &reader, int version)
+{
+    TextSearchTreeBase::clear();
+
+    if (version < 3)
+    {
+        quint32 rootcnt = reader.read<quint32>();
+        quint32 nodecnt = reader.read<quint32>();
+        quint32 linecnt = reader.read<quint32>();
+
+        quint32 poolsize;
+        const QChar *pool = FlatStringPool::read(reader, poolsize);
+
+        if ((qint64)nodecnt * 3 * 4 + (qint64)linecnt * 4 > reader.remaining())
+            throw ZException("Invalid search tree data.");
+
+        // Label offset, number of lines and number of child nodes for every node.
+        std::vector<quint32> records((size_t)nodecnt * 3);
+        reader.readArray(records.data(), records.size());
+        std::vector<qint32> lines(linecnt);
+        reader.readArray(lines.data(), lines.size());
+        for (qint32 line : lines)
+            if (line < 0 || line >= tosigned(size()))
+                throw ZException("Invalid search tree data.");
+
+        size_t recpos = 0;
+        size_t linepos = 0;
+
+        nodes.reserve(rootcnt);
+        for (quint32 ix = 0; ix != rootcnt; ++ix)
+        {
+            TextNode *n = nodes.addNode();
+            n->parent = nullptr;
+            loadPreorderRecords(n, pool, poolsize, records, recpos, lines, linepos);
+        }
+
+        if (recpos != records.size() || linepos != lines.size())
+            throw ZException("Invalid search tree data.");
+        return;
+    }
+
+    FrozenData &data = frozendata;
+
+    data.rootcnt = reader.read<quint32>();
+    quint32 nodecnt = reader.read<quint32>();
+    quint32 linecnt = reader.read<quint32>();
+
+    quint32 labelcnt;
+    const QChar *labels = FlatStringPool::read(reader, labelcnt);
+    data.labels.assign(labels, labels + labelcnt);
+
+    if ((qint64)nodecnt * 8 * 4 + (qint64)linecnt * 4 > reader.remaining() || data.rootcnt > nodecnt)
+        throw ZException("Invalid search tree data.");
+
+    data.nodes.resize(nodecnt);
+    for (quint32 ix = 0; ix != nodecnt; ++ix)
+    {
+        FrozenNode &n = data.nodes[ix];
+        n.label = reader.read<quint32>();
+        n.labellen = reader.read<quint32>();
+        n.lines = reader.read<quint32>();
+        n.linecnt = reader.read<quint32>();
+        n.children = reader.read<quint32>();
+        n.childcnt = reader.read<quint32>();
+        n.parent = reader.read<qint32>();
+        n.sum = reader.read<qint32>();
+
+        // Child nodes always come after their parent, which makes sure the tree has no
+        // cycles.
+        if ((quint64)n.label + n.labellen >= labelcnt || labels[n.label + n.labellen].unicode() != 0 ||
+            (quint64)n.lines + n.linecnt > linecnt || (n.childcnt != 0 && n.children <= ix) ||
+            (quint64)n.children + n.childcnt > nodecnt || n.parent >= (qint64)ix || (n.parent < 0 && ix >= data.rootcnt))
+            throw ZException("Invalid search tree data.");
+    }
+
+    data.lines.resize(linecnt);
+    reader.readArray(data.lines.data(), data.lines.size());
+    for (int line : data.lines)
+        if (line < 0 || line >= tosigned(size()))
+            throw ZException("Invalid search tree data.");
+
+    isfrozen = true;
+}
+
+void TextSearchTreeBase::saveFlat(FlatWriter &writer) const
+{
+    FrozenData tmp;
+    if (!isfrozen)
+        buildFrozen(tmp);
+    const FrozenData &data = isfrozen ? frozendata : tmp;
+
+    writer.write<quint32>(data.rootcnt);
+    writer.write<quint32>((quint32)data.nodes.size());
+    writer.write<quint32>((quint32)data.lines.size());
+
+    // Same layout as FlatStringPool::write().
+    writer.write<quint32>((quint32)data.labels.size());
+    writer.writeChars(data.labels.data(), data.labels.size());
+    writer.align(4);
+
+    for (const FrozenNode &n : data.nodes)
+    {
+        writer.write<quint32>(n.label);
+        writer.write<quint32>(n.labellen);
+        writer.write<quint32>(n.lines);
+        writer.write<quint32>(n.linecnt);
+        writer.write<quint32>(n.children);
+        writer.write<quint32>(n.childcnt);
+        writer.write<qint32>(n.parent);
+        writer.write<qint32>(n.sum);
+    }
+
+    writer.writeArray(data.lines.data(), data.lines.size());
+}
+
 void TextSearchTreeBase::clear()
 {
     cache = nullptr;
     nodes.clear();
+    clearFrozen();
+}
+
+void TextSearchTreeBase::freeze()
+{
+    if (isfrozen)
+        return;
+
+    buildFrozen(frozendata);
+    cache = nullptr;
+    nodes.clear();
+    isfrozen = true;
+}
+
+bool TextSearchTreeBase::frozen() const
+{
+    return isfrozen;
+}
+
+void TextSearchTreeBase::buildFrozen(FrozenData &data) const
+{
+    data.rootcnt = (quint32)nodes.size();
+    data.nodes.clear();
+    data.labels.clear();
+    data.lines.clear();
+
+    // The labels array starts with an empty string for nodes without a label.
+    data.labels.push_back(QChar(0));
+
+    // Nodes in the order they are placed in data.nodes. The tree is walked breadth first, so
+    // the child nodes of the same parent are added next to each other.
+    std::vector<const TextNode*> order;
+
+    auto addNode = [&data, &order](const TextNode *n, int parent) {
+        FrozenNode f;
+        f.labellen = (quint32)n->label.size();
+        if (f.labellen == 0)
+            f.label = 0;
+        else
+        {
+            f.label = (quint32)data.labels.size();
+            data.labels.insert(data.labels.end(), n->label.data(), n->label.data() + f.labellen + 1);
+        }
+        f.lines = (quint32)data.lines.size();
+        f.linecnt = (quint32)n->lines.size();
+        data.lines.insert(data.lines.end(), n->lines.begin(), n->lines.end());
+        f.children = 0;
+        f.childcnt = 0;
+        f.parent = parent;
+        f.sum = n->sum;
+
+        data.nodes.push_back(f);
+        order.push_back(n);
+    };
+
+    for (int ix = 0, siz = tosigned(nodes.size()); ix != siz; ++ix)
+        addNode(nodes.items(ix), -1);
+
+    for (int ix = 0; ix != tosigned(order.size()); ++ix)
+    {
+        const TextNode *n = order[ix];
+        data.nodes[ix].children = (quint32)data.nodes.size();
+        data.nodes[ix].childcnt = (quint32)n->nodes.size();
+        for (int iy = 0, sizy = tosigned(n->nodes.size()); iy != sizy; ++iy)
+            addNode(n->nodes.items(iy), ix);
+    }
+}
+
+void TextSearchTreeBase::thaw()
+{
+    if (!isfrozen)
+        return;
+
+    cache = nullptr;
+    nodes.clear();
+
+    const FrozenData &data = frozendata;
+    std::vector<TextNode*> created(data.nodes.size(), nullptr);
+    for (int ix = 0, siz = tosigned(data.nodes.size()); ix != siz; ++ix)
+    {
+        const FrozenNode &f = data.nodes[ix];
+        TextNodeList &list = f.parent == -1 ? nodes : created[f.parent]->nodes;
+
+        TextNode *n = f.labellen == 0 ? list.addNode() : list.addNode(data.labels.data() + f.label, f.labellen, false);
+        if (f.parent == -1)
+            n->parent = nullptr;
+        n->lines.assign(data.lines.begin() + f.lines, data.lines.begin() + (f.lines + f.linecnt));
+        n->sum = f.sum;
+        created[ix] = n;
+    }
+
+    clearFrozen();
+}
+
+void TextSearchTreeBase::clearFrozen()
+{
+    frozendata = FrozenData();
+    isfrozen = false;
 }
 
 void TextSearchTreeBase::swap(TextSearchTreeBase &src)
 {
     nodes.swap(src.nodes, nullptr);
+    std::swap(frozendata, src.frozendata);
+    std::swap(isfrozen, src.isfrozen);
     cache = nullptr;
+    src.cache = nullptr;
 }
 
 void TextSearchTreeBase::copy(TextSearchTreeBase *src)
@@ -515,17 +801,155 @@ void TextSearchTreeBase::copy(TextSearchTreeBase *src)
     if (this == src)
         return;
 
-    nodes.copy(&src->nodes);
+    if (src->isfrozen)
+    {
+        nodes.clear();
+        frozendata = src->frozendata;
+        isfrozen = true;
+    }
+    else
+    {
+        clearFrozen();
+        nodes.copy(&src->nodes);
+    }
     cache = nullptr;
 }
 
 TextNodeList& TextSearchTreeBase::getNodes()
 {
+    thaw();
     return nodes;
 }
 
+bool TextSearchTreeBase::findNode(const QChar *str, int length, NodeRef &result) const
+{
+    result = NodeRef();
+
+    if (!isfrozen)
+    {
+        const TextNode *n;
+        bool r = findContainer(str, length, n);
+        result.node = n;
+        return r;
+    }
+
+    if (str == nullptr || length == 0) // Error
+        throw "Replace throws with some other thingy.";
+
+    if (length == -1)
+        length = tosigned(qcharlen(str));
+
+    const FrozenData &data = frozendata;
+
+    // Root nodes have single character labels.
+    int min = 0;
+    int max = tosigned(data.rootcnt) - 1;
+    int mid = 0;
+    while (min <= max)
+    {
+        mid = (max + min) / 2;
+        int cmp = str[0].unicode() - data.labels[data.nodes[mid].label].unicode();
+        if (cmp < 0)
+            max = mid - 1;
+        else if (cmp > 0)
+            min = mid + 1;
+        else
+            break;
+    }
+    if (min > max)
+        return false;
+
+    int index = mid;
+    int child;
+    while ((child = frozenChild(index, str, length)) != -1)
+        index = child;
+
+    result.index = index;
+
+    const FrozenNode &n = data.nodes[index];
+    return tosigned(n.labellen) == length && !qcharncmp(str, data.labels.data() + n.label, length);
+}
+
+int TextSearchTreeBase::nodeSum(const NodeRef &ref) const
+{
+    if (ref.node != nullptr)
+        return ref.node->sum;
+    if (ref.index != -1)
+        return frozendata.nodes[ref.index].sum;
+    return 0;
+}
+
+void TextSearchTreeBase::nodeLines(const NodeRef &ref, std::vector<int> &result, bool children, const QChar *str, int length) const
+{
+    if (ref.node != nullptr)
+    {
+        result.insert(result.end(), ref.node->lines.begin(), ref.node->lines.end());
+        if (children)
+            const_cast<TextNode*>(ref.node)->nodes.collectLines(result, str, length);
+        return;
+    }
+
+    if (ref.index == -1)
+        return;
+
+    const FrozenNode &n = frozendata.nodes[ref.index];
+    result.insert(result.end(), frozendata.lines.begin() + n.lines, frozendata.lines.begin() + (n.lines + n.linecnt));
+    if (children)
+    {
+        if (length == -1)
+            length = tosigned(qcharlen(str));
+        frozenCollect(ref.index, result, str, length);
+    }
+}
+
+int TextSearchTreeBase::frozenChild(int index, const QChar *str, int length) const
+{
+    const FrozenData &data = frozendata;
+    const FrozenNode &n = data.nodes[index];
+
+    int min = n.children;
+    int max = tosigned(n.children + n.childcnt) - 1;
+    while (min <= max)
+    {
+        int mid = (min + max) / 2;
+
+        const FrozenNode &c = data.nodes[mid];
+        int lblen = tosigned(c.labellen);
+        int cmp = qcharncmp(data.labels.data() + c.label, str, std::min(lblen, length));
+        if (length < lblen && cmp == 0)
+            cmp = 1;
+
+        if (cmp > 0)
+            max = mid - 1;
+        else if (cmp < 0)
+            min = mid + 1;
+        else
+            return mid;
+    }
+
+    return -1;
+}
+
+void TextSearchTreeBase::frozenCollect(int index, std::vector<int> &result, const QChar *str, int length) const
+{
+    const FrozenData &data = frozendata;
+    const FrozenNode &n = data.nodes[index];
+
+    for (int ix = n.children, siz = tosigned(n.children + n.childcnt); ix != siz; ++ix)
+    {
+        const FrozenNode &c = data.nodes[ix];
+        if (qcharncmp(str, data.labels.data() + c.label, std::min(length, tosigned(c.labellen))))
+            continue;
+
+        result.insert(result.end(), data.lines.begin() + c.lines, data.lines.begin() + (c.lines + c.linecnt));
+        frozenCollect(ix, result, str, length);
+    }
+}
+
 bool TextSearchTreeBase::findContainer(const QChar *str, int length, TextNode* &result)
 {
+    thaw();
+
     if (str == nullptr || length == 0) // Error
         throw "Replace throws with some other thingy.";
 
@@ -600,6 +1024,11 @@ bool TextSearchTreeBase::findContainer(const QChar *str, int length, TextNode* &
 
 bool TextSearchTreeBase::findContainer(const QChar *str, int length, const TextNode* &result) const
 {
+#ifdef _DEBUG
+    if (isfrozen)
+        throw "Use findNode() for frozen trees.";
+#endif
+
     if (str == nullptr || length == 0) // Error
         throw "Replace throws with some other thingy.";
 
@@ -1120,9 +1549,16 @@ void TextSearchTreeBase::distributeChildren(TextNode *parent)
 
 void TextSearchTreeBase::removeLine(int line, bool deleted)
 {
+    thaw();
     nodes.removeLine(line, deleted);
 }
 
+void TextSearchTreeBase::remapLines(const std::vector<int> &changes)
+{
+    thaw();
+    nodes.remapLines(changes);
+}
+
 void TextSearchTreeBase::walkReq(TextNode *n, intptr_t data, std::function<void(TextNode*, intptr_t)> func)
 {
     func(n, data);
@@ -1132,6 +1568,7 @@ void TextSearchTreeBase::walkReq(TextNode *n, intptr_t data, std::function<void(
 
 void TextSearchTreeBase::walkthrough(intptr_t data, std::function<void(TextNode*, intptr_t)> afunc)
 {
+    thaw();
     for (int ix = 0, siz = tosigned(nodes.size()); ix != siz; ++ix)
         walkReq(nodes.items(ix), data, afunc);
 }
@@ -1140,6 +1577,7 @@ void TextSearchTreeBase::rebuild(const std::function<bool()> &callback)
 {
     cache = nullptr;
     nodes.clear();
+    clearFrozen();
 
     TreeBuilder rebuilder(*this, tosigned(size()), [this](int ix, QStringList &list) { doGetWord(ix, list); }, callback);
 
@@ -1157,16 +1595,11 @@ void TextSearchTreeBase::rebuild(const std::function<bool()> &callback)
 
 void TextSearchTreeBase::getSiblings(std::vector<int> &result, const QChar *c, int clen)
 {
-    TextNode *n;
-    findContainer(c, clen, n);
-
-    if (n == nullptr)
-    {
-        result.clear();
-        return;
-    }
+    result.clear();
 
-    result = n->lines;
+    NodeRef n;
+    findNode(c, clen, n);
+    nodeLines(n, result, false);
 }
 
 
@@ -12,6 +12,8 @@
 #include "smartvector.h"
 #include "qcharstring.h"
 
+class FlatWriter;
+class FlatReader;
 
 // The abstract class TextSearchTreeBase holds 'line' indexes in a tree
 // structure. It is used for fast lookup of these indexes by a search string.
@@ -124,6 +126,9 @@ public:
     // Removes a word from every node with the passed line index. If the word is deleted, all other
     // indices are decremented by one. Returns the number of items removed.
     int removeLine(int line, bool deleted);
+    // Replaces every line index with the value at its position in changes. Lines mapped to -1
+    // are removed. Returns the number of items removed.
+    int remapLines(const std::vector<int> &changes);
 private:
     int nodePosition(const QChar *label, int labellength = -1);
 
@@ -189,6 +194,14 @@ public:
 
     virtual void clear();
 
+    // Converts the tree to a compacted, read-only representation with every node in a single
+    // array, the labels in one character array and the lines of all nodes in another. Searches
+    // work the same on the frozen tree, but functions that change the nodes convert it back to
+    // the mutable representation first.
+    void freeze();
+    // Returns whether the tree is in the read-only representation created by freeze().
+    bool frozen() const;
+
     void swap(TextSearchTreeBase &src);
 
     void copy(TextSearchTreeBase *src);
@@ -208,6 +221,10 @@ public:
     // Removes a word from every node with the passed line index. If the word is deleted, all
     // higher indices are decremented by one.
     void removeLine(int line, bool deleted);
+    // Changes every line index in the tree to the value at its position in changes, removing
+    // the lines mapped to -1. Used when many lines are removed at once, instead of calling
+    // removeLine() for each.
+    void remapLines(const std::vector<int> &changes);
 
     // Executes a function with every TextNode in the tree. Data will be/ passed to the
     // function as second argument.
@@ -220,6 +237,14 @@ protected:
     virtual void loadLegacy(QDataStream &stream, int version);
     virtual void load(QDataStream &stream);
     virtual void save(QDataStream &stream) const;
+    // Loads the nodes written by saveFlat(), replacing the current contents of the tree. The
+    // tree is frozen after loading, unless version is the dictionary file version 2, which
+    // stored the nodes in pre-order.
+    virtual void loadFlat(FlatReader &reader, int version);
+    // Writes the nodes in the flat format of dictionary files. The arrays of the frozen tree
+    // are written as they are: the node labels in a single string pool, the nodes as fixed
+    // size records, and the lines of every node in one shared array.
+    virtual void saveFlat(FlatWriter &writer) const;
 
     // Searches for a TextNode which matches the passed string, and updates result to point to
     // it. The string must be all lowercase with a generic lowercase function that works the
@@ -232,6 +257,25 @@ protected:
     // string.
     bool findContainer(const QChar *str, int strlength, const TextNode* &result) const;
 
+    // Identifies a node in either the mutable or the frozen tree. Returned by findNode().
+    struct NodeRef
+    {
+        const TextNode *node = nullptr;
+        // Index of the node in the frozen tree or -1.
+        int index = -1;
+
+        bool isNull() const { return node == nullptr && index == -1; }
+    };
+
+    // Same as findContainer(), but works with the frozen representation too. Updates result
+    // to refer to the found node or sets it to null if no node was found.
+    bool findNode(const QChar *str, int strlength, NodeRef &result) const;
+    // Returns the number of lines in the node and its child nodes.
+    int nodeSum(const NodeRef &ref) const;
+    // Appends the lines of the node to result. If children is true, the lines in child nodes
+    // with labels matching str are added too, the same way as in TextNodeList::collectLines().
+    void nodeLines(const NodeRef &ref, std::vector<int> &result, bool children, const QChar *str = nullptr, int strlength = -1) const;
+
     // Creates a root node. The caller must make sure no node with the
     // starting character of ch exists, or a duplicate will be added.
     TextNode* createRoot(QChar ch);
@@ -275,6 +319,51 @@ private:
     // Used in walkthrough.
     void walkReq(TextNode *n, intptr_t data, std::function<void(TextNode*, intptr_t)> func);
 
+    // Node in the frozen representation of the tree. Child nodes of the same parent are
+    // placed next to each other in the nodes array, in the same order as in the mutable tree.
+    struct FrozenNode
+    {
+        // Position of the null terminated label in the labels array and its length.
+        quint32 label;
+        quint32 labellen;
+        // Position of the first line of the node in the lines array and the number of lines.
+        quint32 lines;
+        quint32 linecnt;
+        // Index of the first child node and the number of child nodes.
+        quint32 children;
+        quint32 childcnt;
+        // Index of the parent node, or -1 for root nodes.
+        qint32 parent;
+        // Number of lines inside this node, including those in child nodes.
+        qint32 sum;
+    };
+
+    struct FrozenData
+    {
+        // Number of root nodes at the front of the nodes array.
+        quint32 rootcnt = 0;
+        std::vector<FrozenNode> nodes;
+        std::vector<QChar> labels;
+        std::vector<int> lines;
+    };
+
+    // Fills data with the frozen representation of the mutable tree.
+    void buildFrozen(FrozenData &data) const;
+    // Converts the frozen tree back to the mutable representation. Called before any change.
+    void thaw();
+    // Throws away the frozen tree without converting it.
+    void clearFrozen();
+
+    // Looks up the child node of the frozen node at index, whose label is the longest
+    // leading substring of str. Returns -1 if no such child exists.
+    int frozenChild(int index, const QChar *str, int strlength) const;
+    // Adds the lines of child nodes matching str, like collectLines() for the frozen tree.
+    void frozenCollect(int index, std::vector<int> &result, const QChar *str, int strlength) const;
+
+    // Data of the frozen tree. Only valid when isfrozen is true.
+    FrozenData frozendata;
+    bool isfrozen;
+
     // Has nodes a to z on top of the nodes list.
     //bool createbase;
 
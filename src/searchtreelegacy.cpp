@@ -52,6 +52,7 @@ void TextNode::loadLegacy(QDataStream &stream, int version)
 void TextSearchTreeBase::loadLegacy(QDataStream& stream, int version)
 {
     cache = nullptr;
+    clearFrozen();
     qint32 nodecnt;
 
     int nversion = 4;
@@ -4,6 +4,7 @@
 ** GNU General Public License version 3. See the file LICENSE for details.
 **/
 
+#include <QThreadPool>
 #include "sentences.h"
 #include "zkanjimain.h"
 #include "zui.h"
@@ -13,28 +14,242 @@
 //-------------------------------------------------------------
 
 
-Sentences::Sentences() : usedsize(0), loaded(false)
+ExampleSentence::ExampleSentence()
+{
+    static const std::shared_ptr<const ExampleSentenceData> empty = std::make_shared<ExampleSentenceData>();
+    data = empty;
+}
+
+ExampleSentence::ExampleSentence(std::shared_ptr<const ExampleBlock> block, int line) : data(block, block->lines[line])
+{
+
+}
+
+const ExampleSentenceData& ExampleSentence::operator*() const
+{
+    return *data;
+}
+
+const ExampleSentenceData* ExampleSentence::operator->() const
+{
+    return data.get();
+}
+
+
+//-------------------------------------------------------------
+
+
+ExampleIndex::ExampleIndex()
+{
+
+}
+
+void ExampleIndex::clear()
+{
+    jplen.clear();
+    trlen.clear();
+    jpkeys.clear();
+    trwords.clear();
+}
+
+bool ExampleIndex::empty() const
+{
+    return jplen.empty();
+}
+
+void ExampleIndex::add(const QString &japanese, const QString &translated)
+{
+    int num = tosigned(jplen.size());
+    jplen.push_back(std::min(japanese.size(), (qsizetype)USHRT_MAX));
+    trlen.push_back(std::min(translated.size(), (qsizetype)USHRT_MAX));
+
+    // The same key can be found several times in a sentence, but only added once.
+    auto addKey = [num](PostingList &list) {
+        if (list.empty() || list.back() != num)
+            list.push_back(num);
+    };
+
+    for (int ix = 0, siz = japanese.size(); ix != siz; ++ix)
+    {
+        quint32 ch = japanese.at(ix).unicode();
+        addKey(jpkeys[ch]);
+        if (ix != siz - 1)
+            addKey(jpkeys[(ch << 16) | japanese.at(ix + 1).unicode()]);
+    }
+
+    QStringList words;
+    translationWords(translated, words);
+    for (const QString &w : words)
+        addKey(trwords[w]);
+}
+
+void ExampleIndex::save(QDataStream &stream) const
+{
+    auto saveList = [&stream](const PostingList &list) {
+        const std::vector<uchar> &data = list.encoded();
+        stream << (qint32)list.size() << (qint32)data.size();
+        stream.writeRawData((const char*)data.data(), tosigned(data.size()));
+    };
+
+    stream << (qint32)jplen.size();
+    for (int ix = 0, siz = tosigned(jplen.size()); ix != siz; ++ix)
+        stream << (quint16)jplen[ix] << (quint16)trlen[ix];
+
+    stream << (qint32)jpkeys.size();
+    for (const auto &p : jpkeys)
+    {
+        stream << (quint32)p.first;
+        saveList(p.second);
+    }
+
+    stream << (qint32)trwords.size();
+    for (const auto &p : trwords)
+    {
+        QString w = p.first;
+        stream << make_zstr(w, ZStrFormat::Byte);
+        saveList(p.second);
+    }
+}
+
+void ExampleIndex::load(QDataStream &stream)
+{
+    clear();
+
+    std::vector<uchar> data;
+    auto loadList = [&stream, &data](PostingList &list) {
+        qint32 cnt;
+        qint32 siz;
+        stream >> cnt >> siz;
+        if (siz < 0)
+            throw ZException("Invalid example sentences index.");
+        data.resize(siz);
+        if (stream.readRawData((char*)data.data(), siz) != siz || !list.setEncoded(cnt, data.data(), siz))
+            throw ZException("Invalid example sentences index.");
+    };
+
+    qint32 cnt;
+    stream >> cnt;
+    if (cnt < 0)
+        throw ZException("Invalid example sentences index.");
+    jplen.resize(cnt);
+    trlen.resize(cnt);
+    for (int ix = 0; ix != cnt; ++ix)
+        stream >> jplen[ix] >> trlen[ix];
+
+    stream >> cnt;
+    jpkeys.reserve(std::max(0, cnt));
+    for (int ix = 0; ix < cnt; ++ix)
+    {
+        quint32 key;
+        stream >> key;
+        loadList(jpkeys[key]);
+    }
+
+    stream >> cnt;
+    for (int ix = 0; ix < cnt; ++ix)
+    {
+        QString w;
+        stream >> make_zstr(w, ZStrFormat::Byte);
+        loadList(trwords[w]);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        throw ZException("Invalid example sentences index.");
+}
+
+void ExampleIndex::candidates(const QString &str, bool japanese, std::vector<int> &result) const
+{
+    result.clear();
+    if (str.isEmpty() || jplen.empty())
+        return;
+
+    std::vector<PostingCursor> cursors;
+    if (japanese)
+    {
+        std::vector<quint32> keys;
+        if (str.size() == 1)
+            keys.push_back(str.at(0).unicode());
+        for (int ix = 0, siz = str.size(); ix < siz - 1; ++ix)
+            keys.push_back(((quint32)str.at(ix).unicode() << 16) | str.at(ix + 1).unicode());
+
+        for (quint32 key : keys)
+        {
+            auto it = jpkeys.find(key);
+            if (it == jpkeys.end())
+                return;
+            cursors.push_back(PostingCursor(it->second));
+        }
+    }
+    else
+    {
+        QStringList words;
+        translationWords(str, words);
+        if (words.isEmpty())
+            return;
+        for (const QString &w : words)
+        {
+            auto it = trwords.find(w);
+            if (it == trwords.end())
+                return;
+            cursors.push_back(PostingCursor(it->second));
+        }
+    }
+
+    intersectPostings(cursors, result);
+
+    const std::vector<ushort> &lens = japanese ? jplen : trlen;
+    std::stable_sort(result.begin(), result.end(), [&lens](int a, int b) { return lens[a] < lens[b]; });
+}
+
+void ExampleIndex::translationWords(const QString &str, QStringList &words)
+{
+    words.clear();
+
+    QString lower = str.toLower();
+    QCharTokenizer tok(lower.constData(), lower.size());
+    while (tok.next())
+    {
+        QString w(tok.token(), tok.tokenSize());
+        if (!words.contains(w))
+            words << w;
+    }
+}
+
+
+//-------------------------------------------------------------
+
+
+Sentences::Sentences() : mapped(nullptr), usedsize(0), maxsize(DefaultCacheSize), loaded(false)
 {
     ;
 }
 
 Sentences::~Sentences()
 {
-    ;
+    waitPrefetch();
 }
 
 void Sentences::reset()
 {
+    waitPrefetch();
+
+    mapped = nullptr;
     if (f.isOpen())
         f.close();
 
     blockpos.clear();
     blocks.clear();
+    lru.clear();
     ids.clear();
     usedsize = 0;
     creation = QDateTime();
     loaded = false;
 
+    {
+        QMutexLocker locker(&indexmutex);
+        index.clear();
+    }
+
     ZKanji::commons.clearExamplesData();
     ZKanji::wordexamples.reset();
 }
@@ -98,6 +313,11 @@ void Sentences::load(const QString &filename)
     // 4 bytes: little endian unsigned English sentence ID
     // This is repeated for every sentence until the end of the uncompressed data.
     //
+    // Search index (from version 3):
+    // Compressed like the other blocks. Written by ExampleIndex::save(), which lists the
+    // sentences' lengths, then the posting lists of sentence numbers for each Japanese
+    // character and character pair, and for each word in the translations.
+    //
     // 4 byte unsigned integer: the size of the sentences file. If this doesn't match the file
     // position after this is read the file was corrupted.
 
@@ -119,7 +339,7 @@ void Sentences::load(const QString &filename)
             return;
 
         int ver = atol(tmp + 3);
-        if (ver != 2)
+        if (ver != 2 && ver != 3)
             return;
 
         stream >> make_zdate(creation);
@@ -185,12 +405,33 @@ void Sentences::load(const QString &filename)
         for (int ix = 0, siz = tosigned(ids.size()); ix != siz; ++ix)
             ids[ix] = std::make_pair(getInt(data, pos), getInt(data, pos));
 
+        // Sentence search index from version 3.
+
+        if (ver >= 3)
+        {
+            stream >> i;
+
+            data.resize(i);
+            stream.readRawData(data.data(), i);
+            data = qUncompress(data);
+
+            QDataStream istream(data);
+            istream.setVersion(QDataStream::Qt_5_5);
+            istream.setByteOrder(QDataStream::LittleEndian);
+
+            QMutexLocker locker(&indexmutex);
+            index.load(istream);
+        }
+
         quint32 ui;
         stream >> ui;
         if (f.pos() != ui)
             reset();
         else
+        {
             loaded = true;
+            mapped = f.map(0, f.size());
+        }
 
         ZKanji::wordexamples.rebuild();
     }
@@ -199,7 +440,9 @@ void Sentences::load(const QString &filename)
         usedsize = 0;
         blockpos.clear();
         blocks.clear();
+        lru.clear();
         ids.clear();
+        index.clear();
         creation = QDateTime();
         ZKanji::commons.clearExamplesData();
         ZKanji::wordexamples.reset();
@@ -218,36 +461,129 @@ QString Sentences::programVersion() const
     return prgversion;
 }
 
-ExampleSentenceData Sentences::getSentence(ushort block, uchar line)
+ExampleSentence Sentences::getSentence(ushort block, uchar line)
 {
 #ifdef _DEBUG
     if (block >= blockpos.size() - 1)
         throw "Requesting not existing block.";
 #endif
 
-    // If the sentence block is loaded, move it forward and hand it to the
-    // user.
-    auto it = std::find_if(blocks.begin(), blocks.end(), [block](const ExampleBlock &b) { return b.block == block; });
+    std::shared_ptr<const ExampleBlock> b = cachedBlock(block);
+
+    // Sentences of a word are usually looked at in order, which continue in the next block.
+    if (block + 1 < tosigned(blockpos.size()) - 1)
+    {
+        QMutexLocker locker(&cachemutex);
+        prefetchBlock(block + 1);
+    }
+
+    return ExampleSentence(b, line);
+}
+
+int Sentences::cacheSize() const
+{
+    return maxsize;
+}
+
+void Sentences::setCacheSize(int bytes)
+{
+    QMutexLocker locker(&cachemutex);
+    maxsize = bytes;
+    trimCache();
+}
+
+std::shared_ptr<const ExampleBlock> Sentences::cachedBlock(ushort index)
+{
+    {
+        QMutexLocker locker(&cachemutex);
+        auto it = blocks.find(index);
+        if (it != blocks.end())
+        {
+            touchBlock(it->second);
+            return it->second.block;
+        }
+    }
+
+    // The block is uncompressed without locking the cache, so other threads can use the
+    // blocks already loaded.
+    std::shared_ptr<ExampleBlock> newblock = std::make_shared<ExampleBlock>();
+    loadBlock(index, *newblock);
+
+    QMutexLocker locker(&cachemutex);
+    return cacheBlock(std::move(newblock));
+}
+
+std::shared_ptr<const ExampleBlock> Sentences::cacheBlock(std::shared_ptr<ExampleBlock> &&block)
+{
+    auto it = blocks.find(block->block);
     if (it != blocks.end())
     {
-        if (it != blocks.begin())
-            blocks.splice(blocks.begin(), blocks, it);
-        return *it->lines[line];
+        touchBlock(it->second);
+        return it->second.block;
     }
 
-    ExampleBlock newblock;
-    loadBlock(block, newblock);
+    lru.push_front(block->block);
+    usedsize += block->size;
+
+    CacheItem &item = blocks[block->block];
+    item.block = std::move(block);
+    item.lrupos = lru.begin();
+
+    trimCache();
+
+    return item.block;
+}
 
-    while (usedsize + newblock.size > 1024 * 1024)
+void Sentences::touchBlock(CacheItem &item)
+{
+    if (item.lrupos != lru.begin())
+        lru.splice(lru.begin(), lru, item.lrupos);
+}
+
+void Sentences::trimCache()
+{
+    while (usedsize > maxsize && lru.size() > 1)
     {
-        usedsize -= blocks.back().size;
-        blocks.pop_back();
+        auto it = blocks.find(lru.back());
+        usedsize -= it->second.block->size;
+        blocks.erase(it);
+        lru.pop_back();
     }
+}
 
-    usedsize += newblock.size;
-    blocks.push_front(std::move(newblock));
+void Sentences::prefetchBlock(ushort index)
+{
+    if (blocks.find(index) != blocks.end() || prefetching.count(index) != 0)
+        return;
+
+    prefetching.insert(index);
+    QThreadPool::globalInstance()->start([this, index]() {
+        std::shared_ptr<ExampleBlock> newblock = std::make_shared<ExampleBlock>();
+        loadBlock(index, *newblock);
+
+        QMutexLocker locker(&cachemutex);
+        // A block loaded in the background is not yet used, so it shouldn't push out the
+        // blocks in use. It's added at the back of the cache.
+        if (blocks.find(index) == blocks.end() && usedsize + newblock->size <= maxsize)
+        {
+            lru.push_back(index);
+            usedsize += newblock->size;
+
+            CacheItem &item = blocks[index];
+            item.block = std::move(newblock);
+            item.lrupos = std::prev(lru.end());
+        }
 
-    return *blocks.front().lines[line];
+        prefetching.erase(index);
+        prefetchdone.wakeAll();
+    });
+}
+
+void Sentences::waitPrefetch()
+{
+    QMutexLocker locker(&cachemutex);
+    while (!prefetching.empty())
+        prefetchdone.wait(&cachemutex);
 }
 
 const std::vector<std::pair<int, int>>& Sentences::getIdList() const
@@ -255,6 +591,48 @@ const std::vector<std::pair<int, int>>& Sentences::getIdList() const
     return ids;
 }
 
+std::vector<ExampleHit> Sentences::search(const QString &str, int limit)
+{
+    std::vector<ExampleHit> result;
+    if (!loaded || str.isEmpty())
+        return result;
+
+    bool japanese = false;
+    for (int ix = 0, siz = str.size(); !japanese && ix != siz; ++ix)
+        japanese = JAPAN(str.at(ix).unicode());
+
+    std::vector<int> found;
+    {
+        QMutexLocker locker(&indexmutex);
+        if (index.empty())
+        {
+            // Older data files have no index. It's built from every block without adding
+            // them to the cache.
+            for (int ix = 0, siz = tosigned(blockpos.size()) - 1; ix < siz; ++ix)
+            {
+                ExampleBlock b;
+                loadBlock(ix, b);
+                for (int iy = 0, sizy = tosigned(b.lines.size()); iy != sizy; ++iy)
+                    index.add(b.lines[iy]->japanese.toQString(), b.lines[iy]->translated.toQString());
+            }
+        }
+        index.candidates(str, japanese, found);
+    }
+
+    // Only the candidates of Japanese searches longer than a character pair need checking.
+    bool check = japanese && str.size() > 2;
+    for (int ix = 0, siz = tosigned(found.size()); ix != siz && tosigned(result.size()) < limit; ++ix)
+    {
+        ushort block = found[ix] / 100;
+        uchar line = found[ix] % 100;
+        if (check && getSentence(block, line)->japanese.toQStringRaw().indexOf(str) == -1)
+            continue;
+        result.push_back({ block, line });
+    }
+
+    return result;
+}
+
 bool Sentences::isLoaded() const
 {
     return loaded;
@@ -265,13 +643,20 @@ void Sentences::loadBlock(ushort index, ExampleBlock &block)
     block.block = index;
     block.size = 0;
 
-    f.seek(blockpos[index]);
     int compsize = blockpos[index + 1] - blockpos[index];
 
     QByteArray data;
-    data.resize(compsize);
-    stream.readRawData(data.data(), compsize);
-    data = qUncompress(data);
+    if (mapped != nullptr)
+        data = qUncompress(mapped + blockpos[index], compsize);
+    else
+    {
+        QMutexLocker locker(&filemutex);
+        f.seek(blockpos[index]);
+        data.resize(compsize);
+        stream.readRawData(data.data(), compsize);
+        locker.unlock();
+        data = qUncompress(data);
+    }
 
     int pos = 0;
 
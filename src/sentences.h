@@ -8,9 +8,14 @@
 #define SENTENCES_H
 
 #include <QtCore>
+#include <memory>
+#include <unordered_map>
+#include <set>
+#include <map>
 #include "qcharstring.h"
 #include "fastarray.h"
 #include "smartvector.h"
+#include "postinglist.h"
 
 // Structure storing word data for a single sentence in an examples data block.
 struct ExampleWordsData
@@ -45,12 +50,78 @@ struct ExampleBlock
     smartvector<ExampleSentenceData> lines;
 };
 
-// Class for loading and managing the example sentences data. At most 1 MB of example
-// sentences are kept in memory at a time. When a new sentence is requested, the block of the
-// last accessed sentence can be unloaded to stay below that limit.
+// Shared read-only reference to a sentence in a loaded example block. The block is kept in
+// memory while any of its sentences are referenced, even if the sentences cache unloads it.
+// Default constructed references point to an empty sentence.
+class ExampleSentence
+{
+public:
+    ExampleSentence();
+    ExampleSentence(std::shared_ptr<const ExampleBlock> block, int line);
+
+    const ExampleSentenceData& operator*() const;
+    const ExampleSentenceData* operator->() const;
+private:
+    std::shared_ptr<const ExampleSentenceData> data;
+};
+
+// Position of a sentence in the examples data.
+struct ExampleHit
+{
+    ushort block;
+    uchar line;
+};
+
+// Inverted index for searching the text of the example sentences. Japanese sentences are
+// indexed by every character and every pair of neighboring characters, translations by their
+// lower case words. Sentences are identified by their number in the examples data, which is
+// block * 100 + line, as every block but the last holds exactly 100 sentences.
+class ExampleIndex
+{
+public:
+    ExampleIndex();
+
+    void clear();
+    bool empty() const;
+
+    // Adds the next sentence to the index. Sentences must be added in their order in the
+    // examples data.
+    void add(const QString &japanese, const QString &translated);
+
+    void save(QDataStream &stream) const;
+    // Reads index data written by save(). Throws a ZException on invalid data.
+    void load(QDataStream &stream);
+
+    // Fills result with the numbers of sentences that can contain str, ordered by the length
+    // of the sentences, shorter first. When japanese is true, the Japanese sentences are
+    // searched for str. The result can contain sentences which have every character pair of
+    // str but not str itself. Otherwise the translations are searched for every word in str.
+    void candidates(const QString &str, bool japanese, std::vector<int> &result) const;
+
+    // Splits str into lower case words, the same way the translations are indexed.
+    static void translationWords(const QString &str, QStringList &words);
+private:
+    // Length of the Japanese and translated text of each sentence.
+    std::vector<ushort> jplen;
+    std::vector<ushort> trlen;
+
+    // Sentences by a single character or a character pair in the Japanese text. Single
+    // characters are stored as their unicode value, pairs as (first << 16) | second.
+    std::unordered_map<quint32, PostingList> jpkeys;
+    // Sentences by words in the translated text.
+    std::map<QString, PostingList> trwords;
+};
+
+// Class for loading and managing the example sentences data. Loaded blocks of sentences are
+// kept in a cache of limited size, and the least recently used blocks are unloaded when the
+// cache is full. Blocks are uncompressed from the memory mapped examples file, and sentences
+// can be requested from any thread.
 class Sentences final
 {
 public:
+    // Default size of the blocks cache in bytes.
+    enum { DefaultCacheSize = 4 * 1024 * 1024 };
+
     Sentences();
     ~Sentences();
 
@@ -62,37 +133,85 @@ public:
     // The version string of the program the sentences database was built with.
     QString programVersion() const;
 
-    // Returns a copy of a sentence data from the passed block and line. Sentences can be
-    // unloaded at any time, so a direct pointer can't be returned here.
-    ExampleSentenceData getSentence(ushort block, uchar line);
+    // Returns a reference to the sentence data at the passed block and line. The block is
+    // loaded if it's not in the cache, and the next block is loaded in the background.
+    ExampleSentence getSentence(ushort block, uchar line);
+
+    // Maximum size in bytes of the sentence blocks kept in the cache. The last requested
+    // block is kept even if it's larger.
+    int cacheSize() const;
+    // Sets the maximum size of the cache in bytes. Blocks over the limit are unloaded.
+    void setCacheSize(int bytes);
 
     // Returns the list of example sentence ids.
     const std::vector<std::pair<int, int>> &getIdList() const;
 
+    // Returns the position of at most limit example sentences containing str, shorter
+    // sentences first. If str has Japanese characters, the Japanese sentences are searched,
+    // otherwise the translations must contain every word in str. Examples data files written
+    // before the search index was added are indexed on the first search.
+    std::vector<ExampleHit> search(const QString &str, int limit = 1000);
+
     bool isLoaded() const;
 private:
+    struct CacheItem
+    {
+        std::shared_ptr<const ExampleBlock> block;
+        // Position of the block in lru.
+        std::list<ushort>::iterator lrupos;
+    };
+
+    // Returns the block at index from the cache or loads it. The cache mutex must not be
+    // locked.
+    std::shared_ptr<const ExampleBlock> cachedBlock(ushort index);
+    // Adds a loaded block to the cache, unloading the least recently used blocks that don't
+    // fit. If the block was already added by another thread, the cached block is returned.
+    // The cache mutex must be locked.
+    std::shared_ptr<const ExampleBlock> cacheBlock(std::shared_ptr<ExampleBlock> &&block);
+    // Moves the block of item to the front of lru. The cache mutex must be locked.
+    void touchBlock(CacheItem &item);
+    // Unloads blocks that don't fit in the cache. The block at the front of lru is kept.
+    // The cache mutex must be locked.
+    void trimCache();
+    // Starts loading a block on a thread of the global thread pool if it's not cached yet.
+    // The cache mutex must be locked.
+    void prefetchBlock(ushort index);
+    // Waits until the blocks being loaded in the background are added to the cache.
+    void waitPrefetch();
+
     void loadBlock(ushort index, ExampleBlock &block);
 
     // Helper function for loadBlock. Takes two bytes from arr at pos and returns them as a
     // short value. Pos is incremented by 2. The bytes should be in little endian order in the
     // array.
-    quint16 getShort(const QByteArray &arr, int &pos);
+    static quint16 getShort(const QByteArray &arr, int &pos);
 
     // Helper function for loadBlock. Takes four bytes from arr at pos and returns them as an
     // int value. Pos is incremented by 4. The bytes should be in little endian order in the
     // array.
-    qint32 getInt(const QByteArray &arr, int &pos);
+    static qint32 getInt(const QByteArray &arr, int &pos);
 
     // Helper function for loadBlock. Reads the length of a UTF-8 sring and the string itself,
     // converts it to 2 byte unicode and returns it as a QCharString. Updates pos to point
     // after the last used character.
-    QCharString getByteArrayString(const QByteArray &arr, int &pos);
+    static QCharString getByteArrayString(const QByteArray &arr, int &pos);
 
     QFile f;
     QDataStream stream;
+    // The examples file mapped to memory after it was loaded. When the file couldn't be
+    // mapped, blocks are read from the file while filemutex is locked.
+    const uchar *mapped;
+    QMutex filemutex;
+
+    // Locked while accessing the cache.
+    QMutex cachemutex;
+    // Signaled when a block loading in the background is added to the cache.
+    QWaitCondition prefetchdone;
 
     // Number of bytes all the loaded blocks take.
     int usedsize;
+    // Maximum size of the loaded blocks.
+    int maxsize;
 
     // Whether the sentences data file has been correctly loaded.
     bool loaded;
@@ -105,7 +224,16 @@ private:
     // Position of each block in the examples file.
     std::vector<int> blockpos;
 
-    std::list<ExampleBlock> blocks;
+    // Loaded blocks by block index.
+    std::unordered_map<ushort, CacheItem> blocks;
+    // Indexes of loaded blocks, starting with the last accessed one.
+    std::list<ushort> lru;
+    // Indexes of blocks being loaded in the background.
+    std::set<ushort> prefetching;
+
+    // Text search index of the sentences, and the mutex locked while it's used.
+    ExampleIndex index;
+    QMutex indexmutex;
 
     // Sentence ids in order.
     std::vector<std::pair<int, int>> ids;
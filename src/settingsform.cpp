@@ -36,6 +36,7 @@
 #include "zkanjimain.h"
 #include "zui.h"
 #include "romajizer.h"
+#include "words.h"
 #include "languages.h"
 #include "languagesettings.h"
 
@@ -761,6 +762,8 @@ void SettingsForm::applyClicked()
 
     Settings::dictionary.autosize = ui->autoSizeBox->isChecked();
     Settings::dictionary.inflection = (DictionarySettings::InflectionShow)ui->inflectionCBox->currentIndex();
+    // Searches running in the background use the result order when sorting.
+    ZKanji::stopBackgroundSearches();
     Settings::dictionary.resultorder = (ResultOrder)ui->resultOrderCBox->currentIndex();
     Settings::dictionary.browseorder = (BrowseOrder)ui->browseOrderCBox->currentIndex();
     Settings::dictionary.showingroup = ui->wordGroupBox->isChecked();
@@ -8,6 +8,7 @@
 #include <QMessageBox>
 #include <QTimeZone>
 #include <QSet>
+#include <limits>
 #include "studydecks.h"
 #include "zkanjimain.h"
 #include "zui.h"
@@ -65,6 +66,130 @@ QDataStream& operator>>(QDataStream &stream, StudyCardStat &stat)
 //-------------------------------------------------------------
 
 
+StudyCardStatList::StudyCardStatList()
+{
+
+}
+
+void StudyCardStatList::clear()
+{
+    days.clear();
+    values.clear();
+    multipliers.clear();
+}
+
+void StudyCardStatList::reserve(int cnt)
+{
+    days.reserve(cnt);
+    values.reserve(cnt);
+    multipliers.reserve(cnt);
+}
+
+int StudyCardStatList::size() const
+{
+    return tosigned(days.size());
+}
+
+QDate StudyCardStatList::day(int pos) const
+{
+    return QDate::fromJulianDay(days[pos]);
+}
+
+qint32 StudyCardStatList::julianDay(int pos) const
+{
+    return days[pos];
+}
+
+uchar StudyCardStatList::level(int pos) const
+{
+    return values[pos] >> 24;
+}
+
+float StudyCardStatList::multiplier(int pos) const
+{
+    return multipliers[pos];
+}
+
+ushort StudyCardStatList::timeSpent(int pos) const
+{
+    return values[pos] & 0xffff;
+}
+
+StudyCardStat StudyCardStatList::items(int pos) const
+{
+    StudyCardStat stat;
+    stat.day = day(pos);
+    stat.level = level(pos);
+    stat.multiplier = multipliers[pos];
+    stat.timespent = timeSpent(pos);
+    return stat;
+}
+
+void StudyCardStatList::set(int pos, const StudyCardStat &stat)
+{
+    days[pos] = stat.day.toJulianDay();
+    values[pos] = (quint32(stat.level) << 24) | stat.timespent;
+    multipliers[pos] = stat.multiplier;
+}
+
+int StudyCardStatList::append(const StudyCardStat &stat)
+{
+    days.push_back(stat.day.toJulianDay());
+    values.push_back((quint32(stat.level) << 24) | stat.timespent);
+    multipliers.push_back(stat.multiplier);
+    return tosigned(days.size()) - 1;
+}
+
+int StudyCardStatList::add(int pos, int cnt, const StudyCardStat &stat)
+{
+    if (cnt != 0 && pos + cnt != tosigned(days.size()))
+        pos = copy(*this, pos, cnt);
+    int r = append(stat);
+    return cnt == 0 ? r : pos;
+}
+
+int StudyCardStatList::copy(const StudyCardStatList &src, int pos, int cnt)
+{
+    int r = tosigned(days.size());
+
+    // The source can be this list, which is reallocated when growing.
+    reserve(r + cnt);
+    for (int ix = 0; ix != cnt; ++ix)
+    {
+        days.push_back(src.days[pos + ix]);
+        values.push_back(src.values[pos + ix]);
+        multipliers.push_back(src.multipliers[pos + ix]);
+    }
+    return r;
+}
+
+void StudyCardStatList::load(QDataStream &stream, int &pos, int &cnt)
+{
+    qint32 i;
+    stream >> i;
+    pos = tosigned(days.size());
+    cnt = i;
+
+    reserve(pos + cnt);
+    StudyCardStat stat;
+    for (int ix = 0; ix != cnt; ++ix)
+    {
+        stream >> stat;
+        append(stat);
+    }
+}
+
+void StudyCardStatList::save(QDataStream &stream, int pos, int cnt) const
+{
+    stream << (qint32)cnt;
+    for (int ix = 0; ix != cnt; ++ix)
+        stream << items(pos + ix);
+}
+
+
+//-------------------------------------------------------------
+
+
 // Unique id given to each study card by their deck. Only unique within its own deck.
 //bool operator==(const CardId &a, const CardId &b);
 //bool operator!=(const CardId &a, const CardId &b);
@@ -124,7 +249,6 @@ CardId::CardId(int data) : data(data)
 
 QDataStream& operator<<(QDataStream& stream, const StudyCard &c)
 {
-    stream << make_zvec<qint32, StudyCardStat>(c.stats);
     stream << make_zdate(c.testdate);
     stream << make_zdate(c.itemdate);
     stream.writeRawData((const char*)c.answers, 4);
@@ -152,7 +276,6 @@ QDataStream& operator>>(QDataStream& stream, StudyCard &c)
     //quint16 s;
     quint32 ui;
 
-    stream >> make_zvec<qint32, StudyCardStat>(c.stats);
     stream >> make_zdate(c.testdate);
     stream >> make_zdate(c.itemdate);
     stream.readRawData((char*)c.answers, 4);
@@ -165,6 +288,7 @@ QDataStream& operator>>(QDataStream& stream, StudyCard &c)
     stream >> ui;
     c.spacing = ui;
     c.nexttestdate = QDateTime();
+    c.nexttesttime = 0;
     //stream >> s;
     //c.answercnt = s;
     //stream >> s;
@@ -487,7 +611,7 @@ void DeckDayStatList::save(QDataStream &stream) const
     stream << make_zvec<qint32, DeckDayStat>(list);
 }
 
-void DeckDayStatList::fixStats(const std::vector<std::tuple<StudyCard*, int, bool>> &cards)
+void DeckDayStatList::fixStats(const StudyCardStatList &stats, const std::vector<std::tuple<StudyCard*, int, bool>> &cards)
 {
     // Recreates the daily stats from scratch, only bringing over the time spent testing from
     // the old statistics.
@@ -502,7 +626,7 @@ void DeckDayStatList::fixStats(const std::vector<std::tuple<StudyCard*, int, boo
     {
         StudyCard *card = std::get<0>(cards[ix]);
         int cardstatix = std::get<1>(cards[ix]);
-        QDate carddate = card->stats[cardstatix].day;
+        QDate carddate = stats.day(card->statpos + cardstatix);
         bool cardgood = std::get<2>(cards[ix]);
         while (statpos < tosigned(tmp.size()) && tmp[statpos].day <= carddate)
         {
@@ -550,7 +674,7 @@ void DeckDayStatList::fixStats(const std::vector<std::tuple<StudyCard*, int, boo
         if (!cardgood)
             ++stat.testwrong;
 
-        bool newlearned = cardgood && cardstatix != 0 && card->stats[cardstatix - 1].day.daysTo(card->stats[cardstatix].day) >= 61;
+        bool newlearned = cardgood && cardstatix != 0 && stats.julianDay(card->statpos + cardstatix) - stats.julianDay(card->statpos + cardstatix - 1) >= 61;
         if (!card->learned && newlearned)
         {
             ++stat.testlearned;
@@ -803,6 +927,7 @@ void StudyDeck::load(QDataStream &stream)
     {
         list.push_back(new StudyCard);
         list.back()->index = ix;// .reset(new CardId(ix));
+        cardstats.load(stream, list.back()->statpos, list.back()->statcnt);
         stream >> *list.back();
         ids.push_back(new CardId(ix));
     }
@@ -831,7 +956,10 @@ void StudyDeck::save(QDataStream &stream) const
 
     stream << (qint32)list.size();
     for (auto *sc : list)
+    {
+        cardstats.save(stream, sc->statpos, sc->statcnt);
         stream << *sc;
+    }
 
     timestats.save(stream);
     daystats.save(stream);
@@ -851,6 +979,7 @@ void StudyDeck::copy(StudyDeck *src, std::map<CardId*, CardId*> &map)
 
     list.clear();
     ids.clear();
+    cardstats.clear();
 
     list.reserve(src->list.size());
     ids.reserve(src->ids.size());
@@ -869,6 +998,7 @@ void StudyDeck::copy(StudyDeck *src, std::map<CardId*, CardId*> &map)
         *c = *csrc;
         c->data = 0;
         c->next = nullptr;
+        c->statpos = cardstats.copy(src->cardstats, csrc->statpos, csrc->statcnt);
 
         list.push_back(c);
     }
@@ -932,30 +1062,31 @@ void StudyDeck::fixDayStats()
         //c->wrongcnt = 0;
 
         //incl[c] = 0;
-        for (int iy = 0, sizy = tosigned(c->stats.size()); iy != sizy; ++iy)
+        for (int iy = 0, pos = c->statpos; iy != c->statcnt; ++iy, ++pos)
         {
-            if (iy != 0 && c->stats[iy - 1].day == c->stats[iy].day)
+            if (iy != 0 && cardstats.julianDay(pos - 1) == cardstats.julianDay(pos))
                 continue;
-            tmp.push_back(std::make_tuple(c, iy, iy == 0 || c->stats[iy].level > c->stats[iy - 1].level));
+            tmp.push_back(std::make_tuple(c, iy, iy == 0 || cardstats.level(pos) > cardstats.level(pos - 1)));
         }
 
         c->learned = false;
     }
 
-    std::sort(tmp.begin(), tmp.end(), [](const std::tuple<StudyCard*, int, bool> &a, const std::tuple<StudyCard*, int, bool> &b) {
+    std::sort(tmp.begin(), tmp.end(), [this](const std::tuple<StudyCard*, int, bool> &a, const std::tuple<StudyCard*, int, bool> &b) {
         StudyCard *ca = std::get<0>(a);
         StudyCard *cb = std::get<0>(b);
-        return ca->stats[std::get<1>(a)].day < cb->stats[std::get<1>(b)].day;
+        return cardstats.julianDay(ca->statpos + std::get<1>(a)) < cardstats.julianDay(cb->statpos + std::get<1>(b));
     });
 
     if (!tmp.empty())
     {
-        QDate cdate = std::get<0>(tmp.back())->stats.back().day;
+        const StudyCard *clast = std::get<0>(tmp.back());
+        qint32 cdate = cardstats.julianDay(clast->statpos + clast->statcnt - 1);
         auto it = tmp.end();
         while (it != tmp.begin())
         {
             auto pit = std::prev(it);
-            if (std::get<0>(*pit)->stats[std::get<1>(*pit)].day == cdate)
+            if (cardstats.julianDay(std::get<0>(*pit)->statpos + std::get<1>(*pit)) == cdate)
                 testcards.push_back(std::get<0>(*pit)->index);
             it = pit;
         }
@@ -963,7 +1094,7 @@ void StudyDeck::fixDayStats()
 
     std::sort(testcards.begin(), testcards.end(), [this](int a, int b) { return list[a]->itemdate < list[b]->itemdate; });
 
-    daystats.fixStats(tmp);
+    daystats.fixStats(cardstats, tmp);
 
 }
 
@@ -1089,6 +1220,8 @@ CardId* StudyDeck::createCard(CardId *cardid_group, intptr_t data)
     StudyCard *group = fromId(cardid_group);
     StudyCard *card = new StudyCard;
     card->data = data;
+    card->statpos = 0;
+    card->statcnt = 0;
     memset(card->answers, 0, sizeof(uchar) * 4);
 
     //card->problematic = false;
@@ -1320,10 +1453,10 @@ const DeckDayStat& StudyDeck::dayStat(int index) const
 uchar StudyDeck::cardLevelOld(CardId *cardid) const
 {
     const StudyCard *card = fromId(cardid);
-    if (card == nullptr || card->stats.empty())
+    if (card == nullptr || card->statcnt == 0)
         return 0;
 
-    return card->stats.size() > 1 ? std::prev(card->stats.end(), 2)->level : card->level;
+    return card->statcnt > 1 ? cardstats.level(card->statpos + card->statcnt - 2) : card->level;
 }
 
 uchar StudyDeck::cardLevel(CardId *cardid) const
@@ -1364,7 +1497,7 @@ ushort StudyDeck::cardInclusion(CardId *cardid) const
     if (card == nullptr)
         return 0;
 
-    return tounsigned<ushort>(card->stats.size());// inclusion;
+    return tounsigned<ushort>(card->statcnt);// inclusion;
 }
 
 QDateTime StudyDeck::cardTestDate(CardId *cardid) const
@@ -1379,10 +1512,10 @@ QDateTime StudyDeck::cardTestDate(CardId *cardid) const
 QDate StudyDeck::cardFirstStatDate(CardId *cardid) const
 {
     const StudyCard *card = fromId(cardid);
-    if (card == nullptr || card->stats.empty())
+    if (card == nullptr || card->statcnt == 0)
         return QDate();
 
-    return card->stats[0].day;
+    return cardstats.day(card->statpos);
 }
 
 QDateTime StudyDeck::cardItemDate(CardId *cardid) const
@@ -1401,10 +1534,27 @@ QDateTime StudyDeck::cardNextTestDate(CardId *cardid) const
         return QDateTime();
 
     if (!card->nexttestdate.isValid())
+    {
         card->nexttestdate = card->testdate.addSecs(card->spacing);
+        card->nexttesttime = card->nexttestdate.toMSecsSinceEpoch();
+    }
     return card->nexttestdate;
 }
 
+qint64 StudyDeck::cardNextTestTime(CardId *cardid) const
+{
+    const StudyCard *card = fromId(cardid);
+    if (card == nullptr || !card->testdate.isValid())
+        return std::numeric_limits<qint64>::min();
+
+    if (!card->nexttestdate.isValid())
+    {
+        card->nexttestdate = card->testdate.addSecs(card->spacing);
+        card->nexttesttime = card->nexttestdate.toMSecsSinceEpoch();
+    }
+    return card->nexttesttime;
+}
+
 quint32 StudyDeck::cardSpacing(CardId *cardid) const
 {
     const StudyCard *card = fromId(cardid);
@@ -1420,7 +1570,7 @@ quint32 StudyDeck::increasedSpacing(CardId *cardid) const
     if (card == nullptr)
         return 0;
 
-    if (card->stats.empty())
+    if (card->statcnt == 0)
         return card->spacing;
 
     quint32 spacing = card->spacing * card->multiplier;
@@ -1434,7 +1584,7 @@ quint32 StudyDeck::decreasedSpacing(CardId *cardid) const
     if (card == nullptr)
         return 0;
 
-    if (card->stats.empty())
+    if (card->statcnt == 0)
         return card->spacing;
 
     if (card->level < 2)
@@ -1447,7 +1597,7 @@ quint32 StudyDeck::decreasedSpacing(CardId *cardid) const
 void StudyDeck::increaseSpacingLevel(CardId *cardid)
 {
     StudyCard *card = fromId(cardid);
-    if (card == nullptr || card->stats.empty())
+    if (card == nullptr || card->statcnt == 0)
         return;
 
     if (card->level >= 3)
@@ -1462,14 +1612,14 @@ void StudyDeck::increaseSpacingLevel(CardId *cardid)
     if (card->level >= 3)
         ZKanji::profile().addMultiplier(card->multiplier);
 
-    if (!card->stats.empty())
+    if (card->statcnt != 0)
         updateCardStat(card, 0);
 }
 
 void StudyDeck::decreaseSpacingLevel(CardId *cardid)
 {
     StudyCard *card = fromId(cardid);
-    if (card == nullptr || card->level < 2 || card->stats.empty())
+    if (card == nullptr || card->level < 2 || card->statcnt == 0)
         return;
 
     if (card->level >= 3)
@@ -1484,7 +1634,7 @@ void StudyDeck::decreaseSpacingLevel(CardId *cardid)
     if (card->level >= 3)
         ZKanji::profile().addMultiplier(card->multiplier);
 
-    if (!card->stats.empty())
+    if (card->statcnt != 0)
         updateCardStat(card, 0);
 }
 
@@ -1499,7 +1649,7 @@ void StudyDeck::resetCardStudyData(CardId *cardid)
     if (card->learned)
         --daystats.back().itemlearned;
 
-    card->stats.clear();
+    card->statcnt = 0;
     memset(card->answers, 0, sizeof(uchar) * 4);
     card->spacing = 0;
     card->repeats = 0;
@@ -1522,9 +1672,9 @@ void StudyDeck::resetCardStudyData(CardId *cardid)
 float StudyDeck::cardMultiplierOld(CardId *cardid) const
 {
     const StudyCard *card = fromId(cardid);
-    if (card == nullptr || card->stats.empty())
+    if (card == nullptr || card->statcnt == 0)
         return 0;
-    return card->stats.size() > 1 ? std::prev(card->stats.end(), 2)->multiplier : card->multiplier;
+    return card->statcnt > 1 ? cardstats.multiplier(card->statpos + card->statcnt - 2) : card->multiplier;
 }
 
 float StudyDeck::cardMultiplier(CardId *cardid) const
@@ -1549,16 +1699,16 @@ quint32 StudyDeck::newCardEta() const
     return timestats.estimate(0, 0);
 }
 
-bool StudyDeck::startTestDay()
+bool StudyDeck::startTestDay(const QDateTime &now)
 {
     // TODO: don't allow testing if the dates are invalid compared to past statistics.
 
-    QDateTime now = QDateTime::currentDateTimeUtc();
     QDate testday = ltDay(now);
     if (testdate.isValid() && ltDay(testdate).daysTo(testday) <= 0)
         return false;
 
     undodata.card = nullptr;
+    compactCardStats();
 
     testdate = now;
 
@@ -1613,7 +1763,7 @@ CardId* StudyDeck::testCard(int index) const
     return const_cast<CardId*>(ids[testcards[index]]);
 }
 
-quint32 StudyDeck::answer(CardId *cardid, StudyCard::AnswerType a, qint64 answertime, /*bool &postponed,*/ bool simulate)
+quint32 StudyDeck::answer(CardId *cardid, StudyCard::AnswerType a, qint64 answertime, /*bool &postponed,*/ bool simulate, const QDateTime &now)
 {
     if (simulate && (a == StudyCard::Wrong || a == StudyCard::Retry))
         throw "Don't simulate in case of negative answer.";
@@ -1622,7 +1772,7 @@ quint32 StudyDeck::answer(CardId *cardid, StudyCard::AnswerType a, qint64 answer
     StudyCard *card = fromId(cardid);
 
     QDate testday = ltDay(testdate);
-    QDateTime oldtestdate = card->stats.size() >= 2 && testdate == card->testdate ? QDateTime(card->stats[card->stats.size() - 2].day, QTime(12, 01, 01), QTimeZone::utc()) : card->testdate;
+    QDateTime oldtestdate = card->statcnt >= 2 && testdate == card->testdate ? QDateTime(cardstats.day(card->statpos + card->statcnt - 2), QTime(12, 01, 01), QTimeZone::utc()) : card->testdate;
     //qint64 oldinterval = card->interval;
     //uchar oldlevel = card->level;
 
@@ -1646,7 +1796,7 @@ quint32 StudyDeck::answer(CardId *cardid, StudyCard::AnswerType a, qint64 answer
 
         card->answers[(int)a] = std::min(255, card->answers[(int)a] + 1);
 
-        card->itemdate = QDateTime::currentDateTimeUtc();
+        card->itemdate = now.isValid() ? now : QDateTime::currentDateTimeUtc();
 
         timestats.addTime(card->testlevel, card->repeats, answertime / 100);
         if (a == StudyCard::Easy || a == StudyCard::Correct)
@@ -1658,13 +1808,14 @@ quint32 StudyDeck::answer(CardId *cardid, StudyCard::AnswerType a, qint64 answer
         if (card->repeats == 1)
         {
             // Add new empty stats that will be updated.
-            card->stats.resize(card->stats.size() + 1);
-            StudyCardStat &cardstat = card->stats[card->stats.size() - 1];
+            StudyCardStat cardstat;
             cardstat.day = testday;
             cardstat.level = card->level;
             cardstat.multiplier = card->multiplier;
             cardstat.timespent = 0;
             //cardstat.status = /*card->problematic ? (int)StudyCardStatus::Problematic :*/ 0;
+            card->statpos = cardstats.add(card->statpos, card->statcnt, cardstat);
+            ++card->statcnt;
 
             daystats.cardTested(testday, answertime / 100, a == StudyCard::Wrong || a == StudyCard::Retry, card->testlevel == 0, card->learned, oldtestdate.secsTo(QDateTime(testday, QTime(12, 01, 01), QTimeZone::utc())) >= s_1_month * 2);
         }
@@ -1990,6 +2141,8 @@ void StudyDeck::createUndo(StudyCard *card, StudyCard::AnswerType a, qint64 answ
 
     undodata.card = card;
     undodata.cardundo = *card;
+    if (card->statcnt != 0)
+        undodata.statundo = cardstats.items(card->statpos + card->statcnt - 1);
     undodata.answertime = answertime;
     undodata.lastanswer = a;
 }
@@ -2002,11 +2155,14 @@ void StudyDeck::revertUndo()
     daystats.revertUndo();
 
     *undodata.card = undodata.cardundo;
+    if (undodata.card->statcnt != 0)
+        cardstats.set(undodata.card->statpos + undodata.card->statcnt - 1, undodata.statundo);
 }
 
 void StudyDeck::updateCardStat(StudyCard *card, /*StudyCard::AnswerType a,*/ int time)
 {
-    StudyCardStat &cardstat = card->stats[card->stats.size() - 1];
+    int pos = card->statpos + card->statcnt - 1;
+    StudyCardStat cardstat = cardstats.items(pos);
     //if (a == StudyCard::Correct || a == StudyCard::Easy)
     //    cardstat.status |= (int)StudyCardStatus::Finished;
     //if (card->problematic)
@@ -2014,6 +2170,23 @@ void StudyDeck::updateCardStat(StudyCard *card, /*StudyCard::AnswerType a,*/ int
     cardstat.level = card->level;
     cardstat.multiplier = card->multiplier;
     cardstat.timespent = std::min<ushort>(65535, cardstat.timespent + time);
+    cardstats.set(pos, cardstat);
+}
+
+void StudyDeck::compactCardStats()
+{
+    int used = 0;
+    for (const StudyCard *c : list)
+        used += c->statcnt;
+
+    if (cardstats.size() - used <= used)
+        return;
+
+    StudyCardStatList tmp;
+    tmp.reserve(used);
+    for (StudyCard *c : list)
+        c->statpos = tmp.copy(cardstats, c->statpos, c->statcnt);
+    std::swap(cardstats, tmp);
 }
 
 void StudyDeck::fixCardSpacing(const StudyCard *card, QDateTime cardtestdate, uchar cardlevel, quint32 &cardspacing) const
@@ -60,6 +60,52 @@ struct StudyCardStat // - ex TRepStat
 QDataStream& operator<<(QDataStream &stream, const StudyCardStat &stat);
 QDataStream& operator>>(QDataStream &stream, StudyCardStat &stat);
 
+// StudyCardStatList: the StudyCardStat items of every card in a study deck. Each field is
+// stored in a separate array, days as julian day numbers, and the level and time spent packed
+// in a single value. The items of a card are next to each other, and the card only holds the
+// position and number of its items.
+// Items are never removed. When a card whose items are not at the end of the list gets a new
+// item, its items are copied to the end first, leaving the old ones unused.
+class StudyCardStatList
+{
+public:
+    StudyCardStatList();
+
+    void clear();
+    void reserve(int cnt);
+    // Number of items in the list, including the unused ones.
+    int size() const;
+
+    QDate day(int pos) const;
+    // Day of the item at pos as a julian day number.
+    qint32 julianDay(int pos) const;
+    uchar level(int pos) const;
+    float multiplier(int pos) const;
+    ushort timeSpent(int pos) const;
+
+    StudyCardStat items(int pos) const;
+    void set(int pos, const StudyCardStat &stat);
+
+    // Appends stat to the end of the list and returns its position.
+    int append(const StudyCardStat &stat);
+    // Adds stat after the cnt items of a card at pos. The items are copied to the end of the
+    // list if they are not already there. Returns the new position of the card's items.
+    int add(int pos, int cnt, const StudyCardStat &stat);
+    // Appends the cnt items at pos in src to the end of the list. Returns their new position.
+    int copy(const StudyCardStatList &src, int pos, int cnt);
+
+    // Reads the items of a single card and appends them to the list. Sets pos and cnt to the
+    // position and number of the new items.
+    void load(QDataStream &stream, int &pos, int &cnt);
+    // Writes the cnt items at pos in the format of a vector of StudyCardStat.
+    void save(QDataStream &stream, int pos, int cnt) const;
+private:
+    std::vector<qint32> days;
+    // Level of the card in the highest 8 bits, time spent in the lowest 16 bits.
+    std::vector<quint32> values;
+    std::vector<float> multipliers;
+};
+
 // An id given to the users of study decks for each item they store in a deck. Must be stored
 // as a pointer.
 struct CardId
@@ -76,8 +122,10 @@ struct StudyCard // - ex TRepetitionItem
     // Indexes in answers.
     enum AnswerType { Retry = 0, Correct = 1, Wrong = 2, Easy = 3 };
 
-    // Statistics for each day the card was tested.
-    fastarray<StudyCardStat> stats;
+    // Position of the statistics for each day the card was tested in the deck's
+    // StudyCardStatList, and the number of statistics.
+    int statpos;
+    int statcnt;
 
     // User defined data for the study card. This is usually a pointer to the item that was
     // tested. This data is NOT saved. It's the user's task to restore this on load.
@@ -91,6 +139,9 @@ struct StudyCard // - ex TRepetitionItem
     // testdate. This value is not saved and is invalid until needed. When the testdate or
     // interval changes, this date should be invalidated.
     mutable QDateTime nexttestdate;
+    // Same as nexttestdate in milliseconds since the epoch, computed at the same time. Used
+    // when ordering cards, as comparing integers is faster. Only valid while nexttestdate is.
+    mutable qint64 nexttesttime;
 
     // Exact date and time when the item was tested the last time. This is NOT used for
     // determining when it's tested again. Only used, when searching for the next item to
@@ -290,7 +341,8 @@ public:
     // each card tested at a day in order of their date. The cards learned status is fixed as
     // well.
     // [study card, index of card stat, answer was correct]
-    void fixStats(const std::vector<std::tuple<StudyCard*, int, bool>> &cards);
+    // The card statistics are found in stats.
+    void fixStats(const StudyCardStatList &stats, const std::vector<std::tuple<StudyCard*, int, bool>> &cards);
 
     bool empty() const;
     DeckDayStat& back();
@@ -483,6 +535,9 @@ public:
     // Returns the date of the card when it's due next, by adding its interval
     // to its testdate.
     QDateTime cardNextTestDate(CardId *cardid) const;
+    // Returns the date of the card when it's due next in milliseconds since the epoch. If
+    // the card was never tested, the lowest possible value is returned.
+    qint64 cardNextTestTime(CardId *cardid) const;
 
     // Returns the spacing of the card in seconds.
     quint32 cardSpacing(CardId *cardid) const;
@@ -517,7 +572,8 @@ public:
     // Must be called when the test starts for the day. It's not an error to call this
     // repeatedly in the same day but it only has an effect the first time.
     // Returns whether a new test day was started, and not just testing again on the same day.
-    bool startTestDay();
+    // Pass the current time in now.
+    bool startTestDay(const QDateTime &now);
 
     // Returns the number of days passed since the last time new items have been included.
     // Returns -1 if the statistics don't have a day when items were included.
@@ -544,7 +600,8 @@ public:
     // -1. Its value is ignored when simulating.
     // When simulating and the answer was wrong, the returned value should be ignored and only
     // the new value of postponed should be used.
-    quint32 answer(CardId *cardid, StudyCard::AnswerType a, qint64 answertime, /*bool &postponed,*/ bool simulate = false);
+    // The time of the answer is now, or the current time if now is not valid.
+    quint32 answer(CardId *cardid, StudyCard::AnswerType a, qint64 answertime, /*bool &postponed,*/ bool simulate = false, const QDateTime &now = QDateTime());
 
     // Returns the answer passed to answer() the last time it was called during the current
     // running test. Only valid when a test is running and answer() was called at least once
@@ -587,6 +644,10 @@ private:
     // be tested on the day.
     void fixCardSpacing(const StudyCard *card, QDateTime cardtestdate, uchar cardlevel, quint32 &cardspacing) const;
 
+    // Rebuilds cardstats without the unused items, if they take up more space than the
+    // statistics of the cards. Any undo data must be invalid when calling this.
+    void compactCardStats();
+
     // Temporary container of undo data.
     struct Undo
     {
@@ -594,6 +655,8 @@ private:
 
         // Copy of the original card. The easiest way to undo is to copy the data back.
         StudyCard cardundo;
+        // Copy of the last statistics of the card, which are updated in place.
+        StudyCardStat statundo;
 
         qint64 answertime;
 
@@ -620,6 +683,9 @@ private:
     // List of stored card ids corresponding to same index in list.
     smartvector<CardId> ids;
 
+    // Statistics of every card in list.
+    StudyCardStatList cardstats;
+
     // Card indexes in list that were tested during the last test. The list is ordered by the
     // card's last test time.
     std::vector<int> testcards;
@@ -181,7 +181,7 @@ void StudyDeck::loadLegacy(QDataStream &stream, int version)
 
         qint32 cnt;
         stream >> cnt;
-        item->stats.resize(cnt);
+        std::vector<StudyCardStat> stats(cnt);
 
         // The time spent on each test day on a card is not saved originally, so it'll just be
         // the same value for each day in the imported stats.
@@ -189,7 +189,7 @@ void StudyDeck::loadLegacy(QDataStream &stream, int version)
         float multipl = ZKanji::profile().baseMultiplier();
         for (int j = 0; j != cnt; ++j)
         {
-            StudyCardStat &stat = item->stats[j];
+            StudyCardStat &stat = stats[j];
 
             stream >> val;
             stat.day = ZKanji::QDateTimeUTCFromTDateTime(val).date();
@@ -203,7 +203,7 @@ void StudyDeck::loadLegacy(QDataStream &stream, int version)
 
             if (j != 0)
             {
-                const StudyCardStat &prev = item->stats[j - 1];
+                const StudyCardStat &prev = stats[j - 1];
 
                 //if (prev.level + 1 < stat.level)
                 //    multipl += 0.15;
@@ -219,13 +219,18 @@ void StudyDeck::loadLegacy(QDataStream &stream, int version)
                 }
 
                 if (j > 1 && prev.level < stat.level)
-                    multipl = std::max(1.3f, std::min(multipl, float(prev.day.daysTo(stat.day)) / float(item->stats[j - 2].day.daysTo(prev.day))));
+                    multipl = std::max(1.3f, std::min(multipl, float(prev.day.daysTo(stat.day)) / float(stats[j - 2].day.daysTo(prev.day))));
             }
 
             stat.multiplier = multipl;
             //stat.status = 0;
         }
         item->multiplier = multipl;
+
+        item->statpos = cardstats.size();
+        item->statcnt = cnt;
+        for (const StudyCardStat &stat : stats)
+            cardstats.append(stat);
         if (item->level >= 3)
             ZKanji::profile().addMultiplier(item->multiplier);
     }
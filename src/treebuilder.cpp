@@ -6,6 +6,7 @@
 
 #include <QMessageBox>
 #include <set>
+#include <algorithm>
 
 #include "zkanjimain.h"
 #include "treebuilder.h"
@@ -17,7 +18,7 @@
 
 TreeBuilder::TreeBuilder(TextSearchTreeBase &tree, int size, const std::function<void (int, QStringList&)> &func, const std::function<bool()> &callback)
     :
-    tree(tree), size(size), func(func), callback(callback), initpos(0), current(nullptr), lablen(1), pos(0)
+    tree(tree), size(size), func(func), callback(callback), initpos(0), pos(0)
 {
     if (tree.isKana())
     {
@@ -38,6 +39,40 @@ bool TreeBuilder::initNext()
     if (initpos == size)
         return false;
 
+    initItem();
+
+    if (initpos == size)
+    {
+        initSort(true);
+        return false;
+    }
+    return true;
+}
+
+bool TreeBuilder::initNext(const std::vector<TreeBuilder*> &list)
+{
+    ZKanji::parallelFor(tosigned(list.size()), [&list](int ix) {
+        TreeBuilder *b = list[ix];
+        if (b->initpos == b->size)
+            return;
+
+        // Every call adds a part of the items, to let the caller update the
+        // user interface in between.
+        for (int cnt = std::max(1000, b->size / 32); cnt != 0 && b->initpos != b->size; --cnt)
+            b->initItem();
+
+        if (b->initpos == b->size)
+            b->initSort(false);
+    });
+
+    for (TreeBuilder *b : list)
+        if (b->initpos != b->size)
+            return true;
+    return false;
+}
+
+void TreeBuilder::initItem()
+{
     if (tree.isKana())
     {
         indexes[initpos] = initpos;
@@ -101,43 +136,49 @@ bool TreeBuilder::initNext()
 
         ++initpos;
     }
+}
 
-    if (initpos == size)
+void TreeBuilder::initSort(bool interruptible)
+{
+    added.clear();
+
+    if (!tree.isKana())
     {
-        added.clear();
+        list.shrink_to_fit();
+        indexes.resize(list.size());
+        for (int ix = 0, siz = tosigned(indexes.size()); ix != siz; ++ix)
+            indexes[ix] = ix;
+    }
 
-        if (!tree.isKana())
+    const QChar *textdata = textmap.data();
+    const Item *listdata = list.data();
+
+    auto cmp = [textdata, listdata](int a, int b) {
+        int val = qcharncmp(textdata + (listdata + a)->strpos, textdata + (listdata + b)->strpos, std::min((listdata + a)->len, (listdata + b)->len));
+        if (val == 0)
         {
-            list.shrink_to_fit();
-            indexes.resize(list.size());
-            for (int ix = 0, siz = tosigned(indexes.size()); ix != siz; ++ix)
-                indexes[ix] = ix;
+            if ((listdata + a)->len != (listdata + b)->len)
+                return (listdata + a)->len < (listdata + b)->len;
+            return (listdata + a)->index < (listdata + b)->index;
         }
+        return val < 0;
+    };
 
-        const QChar *textdata = textmap.data();
-        const Item *listdata = list.data();
-
-        interruptSort(indexes.begin(), indexes.end(), [this, textdata, listdata](int a, int b, bool &stop) {
-            // There's a callback function and it returned false (=suspend).
-            if (callback && !callback())
-            {
-                stop = true;
-                return false;
-            }
-
-            int val = qcharncmp(textdata + (listdata + a)->strpos, textdata + (listdata + b)->strpos, std::min((listdata + a)->len, (listdata + b)->len));
-            if (val == 0)
-            {
-                if ((listdata + a)->len != (listdata + b)->len)
-                    return (listdata + a)->len < (listdata + b)->len;
-                return (listdata + a)->index < (listdata + b)->index;
-            }
-            return val < 0;
-        });
-
-        return false;
+    if (!interruptible || !callback)
+    {
+        std::sort(indexes.begin(), indexes.end(), cmp);
+        return;
     }
-    return true;
+
+    interruptSort(indexes.begin(), indexes.end(), [this, &cmp](int a, int b, bool &stop) {
+        // The callback function returned false (=suspend).
+        if (!callback())
+        {
+            stop = true;
+            return false;
+        }
+        return cmp(a, b);
+    });
 }
 
 int TreeBuilder::initSize() const
@@ -152,13 +193,82 @@ int TreeBuilder::initPos() const
 
 bool TreeBuilder::sortNext()
 {
-    if (pos == tosigned(indexes.size()))
-        return false;
+    return sortNext({ this });
+}
+
+bool TreeBuilder::sortNext(const std::vector<TreeBuilder*> &list)
+{
+    std::vector<SortRange> ranges;
+    for (TreeBuilder *b : list)
+    {
+        // Every call places a part of the items, to let the caller update the
+        // user interface in between.
+        b->pos = b->nextRanges(ranges, std::max(5000, b->importSize() / 16));
+    }
+
+    ZKanji::parallelFor(tosigned(ranges.size()), [&ranges](int ix) {
+        ranges[ix].builder->sortRange(ranges[ix]);
+    });
+
+    // The root nodes are added in the same order as if they were built one by one.
+    for (SortRange &r : ranges)
+    {
+        TextNodeList &nodes = r.builder->tree.getNodes();
+        for (TextNode *n : r.roots)
+            nodes.addNode(n, false);
+    }
 
-    int *ixdata = &indexes[0];
-    Item *listdata = &list[0];
+    for (TreeBuilder *b : list)
+        if (b->pos != b->importSize())
+            return true;
+    return false;
+}
+
+int TreeBuilder::nextRanges(std::vector<SortRange> &ranges, int count)
+{
+    const int *ixdata = indexes.data();
+    const Item *listdata = list.data();
+    const QChar *textdata = textmap.data();
+
+    int end = pos;
+    int siz = tosigned(indexes.size());
+    while (end != siz && end - pos < count)
+    {
+        // Items are sorted, so the items starting with the same character
+        // follow each other.
+        QChar ch = textdata[listdata[ixdata[end]].strpos];
+        int last = tosigned(std::upper_bound(ixdata + end, ixdata + siz, ch, [textdata, listdata](QChar ch, int ix) {
+            return ch < textdata[listdata[ix].strpos];
+        }) - ixdata);
+
+        ranges.push_back({ this, end, last, std::vector<TextNode*>() });
+        end = last;
+    }
+    return end;
+}
 
-    Item &positem = listdata[ixdata[pos]];
+void TreeBuilder::sortRange(SortRange &range) const
+{
+    // The root nodes are created in a temporary list, and only added to the tree after
+    // every thread has finished.
+    TextNodeList roots(nullptr);
+
+    TextNode *current = nullptr;
+    int lablen = 1;
+    int p = range.first;
+    while (p != range.last)
+        sortStep(roots, current, lablen, p, range.last);
+
+    while (!roots.empty())
+        range.roots.push_back(roots.removeNode(0));
+}
+
+void TreeBuilder::sortStep(TextNodeList &roots, TextNode *&current, int &lablen, int &pos, int end) const
+{
+    const int *ixdata = &indexes[0];
+    const Item *listdata = &list[0];
+
+    const Item &positem = listdata[ixdata[pos]];
 
     const QChar *textdata = textmap.data();
 
@@ -172,13 +282,13 @@ bool TreeBuilder::sortNext()
     else
         lablen = current->label.size() + 1;
 
-    TextNodeList &nodelist = (current == nullptr) ? tree.getNodes() : current->nodes;
+    TextNodeList &nodelist = (current == nullptr) ? roots : current->nodes;
 
     // Finding the number of words starting at pos, that start with the
     // same string as 'positem', up to lablen characters.
-    int maxpos = std::min(pos + 5000, (int)indexes.size() - 1);
-    while (maxpos != tosigned(indexes.size()) - 1 && listdata[ixdata[maxpos]].len >= lablen && !qcharncmp(textdata + listdata[ixdata[maxpos]].strpos, textdata + positem.strpos, lablen))
-        maxpos = std::min(int(maxpos * 1.5), tosigned(indexes.size()) - 1);
+    int maxpos = std::min(pos + 5000, end - 1);
+    while (maxpos != end - 1 && listdata[ixdata[maxpos]].len >= lablen && !qcharncmp(textdata + listdata[ixdata[maxpos]].strpos, textdata + positem.strpos, lablen))
+        maxpos = std::min(int(maxpos * 1.5), end - 1);
 
     int min = pos;
     int max = maxpos;
@@ -258,8 +368,6 @@ bool TreeBuilder::sortNext()
     }
 
     ++lablen;
-
-    return pos != tosigned(indexes.size());
 }
 
 int TreeBuilder::importSize() const
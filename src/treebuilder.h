@@ -15,6 +15,10 @@ class DictImport;
 // add every item one by one.
 // Start with calling initNext() until it returns false. Then do the same with
 // sortNext().
+// Nodes under different root nodes don't depend on each other, so the items
+// starting with different characters are placed in the tree on separate
+// threads. The static initNext() and sortNext() build several trees at the
+// same time.
 class TreeBuilder
 {
 public:
@@ -31,21 +35,60 @@ public:
     // Call initNext() until it returns false to collect the strings of
     // every item.
     bool initNext();
+    // Collects the strings of the items in every builder in list, each
+    // builder on a separate thread. Returns true if some builders are not
+    // initialized yet. Call until it returns false. The callback functions of
+    // the builders are not called.
+    static bool initNext(const std::vector<TreeBuilder*> &list);
     // Number of words to init.
     int initSize() const;
     // Position in the initialization process.
     int initPos() const;
 
-    // Creates a new node and places the unprocessed items in it that fit.
-    // Returns true if the job is not finished yet. Call sortNext() until it
-    // returns false to place every item in their correct node.
+    // Places the unprocessed items in the nodes of the next few root nodes,
+    // building the separate root nodes on separate threads. Returns true if
+    // the job is not finished yet. Call sortNext() until it returns false to
+    // place every item in their correct node.
     bool sortNext();
+    // Same as sortNext(), but places items in the trees of every builder in
+    // list at the same time. Returns true if any of the builders haven't
+    // finished yet.
+    static bool sortNext(const std::vector<TreeBuilder*> &list);
 
     // Number of items that were imported and need to be sorted in the tree.
     int importSize() const;
     // Current item position.
     int importPos() const;
 private:
+    // Adds the strings of the next item to textmap.
+    void initItem();
+    // Sorts the items after every string has been added. When interruptible
+    // is true, the callback is called during the sort.
+    void initSort(bool interruptible);
+
+    // Items at [first, last) positions of indexes that start with the same
+    // character, and the root nodes built from them.
+    struct SortRange
+    {
+        TreeBuilder *builder;
+        int first;
+        int last;
+        std::vector<TextNode*> roots;
+    };
+
+    // Adds the ranges of the next root nodes of this builder to ranges, with
+    // at least count items if there are enough. Returns the position after
+    // the last added range.
+    int nextRanges(std::vector<SortRange> &ranges, int count);
+    // Builds the nodes of every item in range, placing the created root nodes
+    // in range.roots.
+    void sortRange(SortRange &range) const;
+    // Creates a new node and places the unprocessed items in it that fit,
+    // starting at position pos in indexes until end. The new node is created
+    // under current, or in roots when current is null. Updates current, lablen
+    // and pos for the next call.
+    void sortStep(TextNodeList &roots, TextNode *&current, int &lablen, int &pos, int end) const;
+
     TextSearchTreeBase &tree;
     
     int size;
@@ -82,10 +125,6 @@ private:
     // An ordering of list. Each value represents an index in list.
     std::vector<int> indexes;
 
-    // The text node that will be the parent of the indexes added in it.
-    TextNode *current;
-    // Length of the labels being considered for insertion in current.
-    int lablen;
     // Position in indexes. Items before pos are distributed in nodes already.
     int pos;
 
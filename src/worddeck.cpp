@@ -89,7 +89,7 @@ bool WordDeckItems<T>::empty() const
 }
 
 template<typename T>
-void WordDeckItems<T>::applyChanges(const std::map<int, int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<WordDeckWord*, int> &kept)
+void WordDeckItems<T>::applyChanges(const std::vector<int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<WordDeckWord*, int> &kept)
 {
     auto it = list.begin();
     while (it != list.end())
@@ -101,7 +101,7 @@ void WordDeckItems<T>::applyChanges(const std::map<int, int> &changes, const std
             it = list.erase(it);
         else
         {
-            int newindex = changes.at(keptit->first->index);
+            int newindex = changes[keptit->first->index];
             (*it)->data = mainword.at(newindex);
             ++it;
         }
@@ -339,7 +339,7 @@ ReadingTestList::size_type ReadingTestList::size() const
     return list.size();
 }
 
-void ReadingTestList::applyChanges(const std::map<int, int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<int, bool> &match)
+void ReadingTestList::applyChanges(const std::vector<int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<int, bool> &match)
 {
     undoindex = -1;
     words.clear();
@@ -350,7 +350,7 @@ void ReadingTestList::applyChanges(const std::map<int, int> &changes, const std:
         auto it2 = itwords.begin();
         while (it2 != itwords.end())
         {
-            int newindex = changes.at((*it2)->windex);
+            int newindex = changes[(*it2)->windex];
             if (newindex == -1 || !match.at(newindex) || mainword.at(newindex)->index != (*it2)->windex)
                 it2 = itwords.erase(it2);
             else
@@ -392,28 +392,38 @@ void ReadingTestList::copy(ReadingTestList *src)
 void ReadingTestList::processRemovedWord(int windex)
 {
     undoindex = -1;
+    words.remove(windex);
 
-    QSet<int> tmp;
-    std::swap(tmp, words);
-    for (auto it = tmp.begin(); it != tmp.end(); ++it)
+    for (int ix = tosigned(list.size()) - 1; ix != -1; --ix)
     {
-        int index = *it;
-        if (index < windex)
-            words.insert(index);
-        else if (index > windex)
-            words.insert(index - 1);
+        KanjiReadingItem *item = list[ix];
+        for (int iy = tosigned(item->words.size()) - 1; iy != -1; --iy)
+        {
+            if (item->words[iy]->windex == windex)
+                item->words.erase(item->words.begin() + iy);
+        }
+        if (item->words.empty())
+            list.erase(list.begin() + ix);
     }
+}
 
+void ReadingTestList::processCompactedWords(const std::vector<int> &changes)
+{
+    if (undoindex != -1)
+        undoindex = changes[undoindex];
+
+    words.clear();
     for (int ix = tosigned(list.size()) - 1; ix != -1; --ix)
     {
         KanjiReadingItem *item = list[ix];
-        for (int iy = tosigned(item->words.size()); iy != -1; --iy)
+        for (int iy = tosigned(item->words.size()) - 1; iy != -1; --iy)
         {
             int &wix = item->words[iy]->windex;
-            if (wix == windex)
+            wix = changes[wix];
+            if (wix == -1)
                 item->words.erase(item->words.begin() + iy);
-            else if (wix > windex)
-                --wix;
+            else
+                words.insert(wix);
         }
         if (item->words.empty())
             list.erase(list.begin() + ix);
@@ -546,8 +556,6 @@ void ReadingTestList::add(int windex, bool newitem, bool failed, bool undo)
     // hold it any more, but the words list will. This set of words is reset on each test day.
     if (!wordadded)
         words.insert(windex);
-
-    owner->dictionary()->setToUserModified();
 }
 
 void ReadingTestList::removeWord(int windex)
@@ -580,7 +588,7 @@ void ReadingTestList::removeWord(int windex)
     }
 
     if (changed)
-        owner->dictionary()->setToUserModified();
+        owner->dictionary()->setToUserModified(Dictionary::UserData::Study);
 }
 
 int ReadingTestList::nextKanji()
@@ -675,7 +683,6 @@ QString ReadingTestList::correctReading()
 void ReadingTestList::readingAnswered()
 {
     list.erase(list.begin());
-    owner->dictionary()->setToUserModified();
 }
 
 void ReadingTestList::nextWords(std::vector<int> &wlist)
@@ -726,7 +733,7 @@ void WordDeckList::clear()
     list.clear();
 }
 
-void WordDeckList::applyChanges(Dictionary *olddict, std::map<int, int> &changes)
+void WordDeckList::applyChanges(Dictionary *olddict, const std::vector<int> &changes)
 {
     //dict = newdict;
 
@@ -759,6 +766,12 @@ void WordDeckList::processRemovedWord(int windex)
         list[ix]->processRemovedWord(windex);
 }
 
+void WordDeckList::processCompactedWords(const std::vector<int> &changes)
+{
+    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
+        list[ix]->processCompactedWords(changes);
+}
+
 WordDeckList::size_type WordDeckList::size() const
 {
     return list.size();
@@ -822,7 +835,7 @@ bool WordDeckList::rename(int index, const QString &name)
 
     list[index]->setName(val);
 
-    dict->setToUserModified();
+    dict->setToUserModified(Dictionary::UserData::Study);
     emit deckRenamed(list[index], val);
     return true;
 }
@@ -836,7 +849,7 @@ bool WordDeckList::add(const QString &name)
 
     list.push_back(new WordDeck(this));
     list.back()->setName(val);
-    dict->setToUserModified();
+    dict->setToUserModified(Dictionary::UserData::Study);
     return true;
 }
 
@@ -861,7 +874,7 @@ void WordDeckList::remove(int index)
 
     list.erase(list.begin() + index);
 
-    dict->setToUserModified();
+    dict->setToUserModified(Dictionary::UserData::Study);
     emit deckRemoved(index, addr);
 }
 
@@ -875,7 +888,7 @@ void WordDeckList::move(const smartvector<Range> &ranges, int pos)
 
     _moveRanges(ranges, pos, list /*[this](const Range &r, int pos) { _moveRange(worddecks, r, pos); }*/);
 
-    dict->setToUserModified();
+    dict->setToUserModified(Dictionary::UserData::Study);
     emit decksMoved(ranges, pos);
 }
 
@@ -1046,7 +1059,7 @@ bool WordDeck::empty() const
     return freeitems.empty() && lockitems.empty();
 }
 
-void WordDeck::applyChanges(Dictionary *olddict, std::map<int, int> &changes)
+void WordDeck::applyChanges(Dictionary *olddict, const std::vector<int> &changes)
 {
     // Changes are applied in multiple steps. The words are referenced by WordDeckWord objects
     // for the items in the deck. Multiple items can share data for a single word. The change
@@ -1089,7 +1102,7 @@ void WordDeck::applyChanges(Dictionary *olddict, std::map<int, int> &changes)
 
     for (int ix = tosigned(list.size()) - 1; ix != -1; --ix)
     {
-        int newindex = changes.at(list[ix]->index);
+        int newindex = changes[list[ix]->index];
         if (newindex == -1)
             continue;
         auto it = mainword.find(newindex);
@@ -1158,7 +1171,7 @@ void WordDeck::applyChanges(Dictionary *olddict, std::map<int, int> &changes)
     // type of item, items of other word data are used.
     for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
     {
-        int newindex = changes.at(list[ix]->index);
+        int newindex = changes[list[ix]->index];
 
         // Word is not used in the new dictionary so it can be skipped.
         if (newindex == -1)
@@ -1206,7 +1219,7 @@ void WordDeck::applyChanges(Dictionary *olddict, std::map<int, int> &changes)
     // Do the same for the other word data not used after the update.
     for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
     {
-        int newindex = changes.at(list[ix]->index);
+        int newindex = changes[list[ix]->index];
 
         // New index is not set, so the word won't be used later.
         if (newindex == -1)
@@ -1385,6 +1398,10 @@ void WordDeck::processRemovedWord(int windex)
     // the other data and can be updated.
     testreadings.processRemovedWord(windex);
 
+    WordDeckWord *dw = wordFromIndex(windex);
+    if (dw == nullptr)
+        return;
+
     std::vector<int> fremoved;
     // Removing word from the freeitems list. The freeitems are items with no study data yet,
     // and only the basic word data.
@@ -1479,20 +1496,12 @@ void WordDeck::processRemovedWord(int windex)
 
     // Remove the items from the word data and their study cards.
 
-    for (int ix = tosigned(list.size()) - 1; ix != -1; --ix)
+    if (dw->groupid != nullptr)
     {
-        if (list[ix]->index > windex)
-            --list[ix]->index;
-        else if (list[ix]->index == windex)
-        {
-            if (list[ix]->groupid != nullptr)
-            {
-                StudyDeck *study = studyDeck();
-                study->deleteCardGroup(list[ix]->groupid);
-            }
-            list.erase(list.begin() + ix);
-        }
+        StudyDeck *study = studyDeck();
+        study->deleteCardGroup(dw->groupid);
     }
+    list.erase(std::find(list.begin(), list.end(), dw));
 
     if (!fremoved.empty())
         emit itemsRemoved(fremoved, true);
@@ -1500,13 +1509,24 @@ void WordDeck::processRemovedWord(int windex)
         emit itemsRemoved(lremoved, false);
 }
 
+void WordDeck::processCompactedWords(const std::vector<int> &changes)
+{
+    testreadings.processCompactedWords(changes);
+
+    // Removed words are not in the list, and the order of the rest doesn't change.
+    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
+        list[ix]->index = changes[list[ix]->index];
+}
+
 void WordDeck::initNewStudy(int num)
 {
     if (num == 0)
         return;
 
     newcnt += std::min(tosigned(freeitems.size()), num);
-    dictionary()->setToUserModified();
+    dictionary()->addUserDataOp(Dictionary::UserData::Study, Dictionary::UserDataOp::DeckNewItems, [this, num](QDataStream &stream) {
+        stream << (qint32)owner()->indexOf(this) << (qint32)num;
+    });
 }
 
 WordDeckWord* WordDeck::wordFromIndex(int windex)
@@ -1542,6 +1562,22 @@ void WordDeck::itemsToWords(const std::vector<int> &items, bool queue, std::vect
 }
 
 void WordDeck::startTest()
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    if (!startTestDay(now))
+        return;
+
+    dictionary()->addUserDataOp(Dictionary::UserData::Study, Dictionary::UserDataOp::DeckStartTest, [this, &now](QDataStream &stream) {
+        stream << (qint32)owner()->indexOf(this) << (qint64)now.toMSecsSinceEpoch();
+    });
+}
+
+void WordDeck::replayStartTest(const QDateTime &now)
+{
+    startTestDay(now);
+}
+
+bool WordDeck::startTestDay(const QDateTime &now)
 {
     //sortDueList();
 
@@ -1550,8 +1586,8 @@ void WordDeck::startTest()
     currentix.reset();
     nextix.reset();
 
-    if (!study->startTestDay())
-        return;
+    if (!study->startTestDay(now))
+        return false;
 
 #ifdef _DEBUG
     //sortDueList();
@@ -1580,7 +1616,7 @@ void WordDeck::startTest()
 
     lastday = study->testDay();
 
-    dictionary()->setToUserModified();
+    return true;
 }
 
 int WordDeck::daysSinceLastInclude() const
@@ -1694,11 +1730,11 @@ int WordDeck::queueSize() const
 int WordDeck::dueSize() const
 {
     const StudyDeck *study = studyDeck();
-    QDate now = ltDay(QDateTime::currentDateTimeUtc());
+    // Items due after this moment are not due today.
+    qint64 dueend = ltDayStart(ltDay(QDateTime::currentDateTimeUtc()).addDays(1));
 
-    auto endit = std::upper_bound(duelist.begin(), duelist.end(), now, [this, study](QDate now, int ix) {
-        QDateTime d = study->cardNextTestDate(lockitems.items(ix)->cardid);
-        return now < ltDay(d);
+    auto endit = std::upper_bound(duelist.begin(), duelist.end(), dueend, [this, study](qint64 dueend, int ix) {
+        return dueend <= study->cardNextTestTime(lockitems.items(ix)->cardid);
     });
 
     return tosigned(failedlist.size()) + (endit - duelist.begin());
@@ -1764,7 +1800,7 @@ void WordDeck::removeQueuedItems(const std::vector<int> &items)
             removeWordData(dat);
     }
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
     emit itemsRemoved(ordered, true);
 }
 
@@ -1811,7 +1847,7 @@ void WordDeck::removeStudiedItems(const std::vector<int> &items)
             removeWordData(dat);
     }
     
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
     emit itemsRemoved(ordered, false);
 }
 
@@ -1832,7 +1868,7 @@ void WordDeck::requeueStudiedItems(const std::vector<int> &items)
     removeStudiedItems(items);
     queueWordItems(parts);
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
 }
 
 void WordDeck::queuedPriorities(const std::vector<int> &items, QSet<uchar> &priorities) const
@@ -1864,7 +1900,7 @@ void WordDeck::setQueuedPriority(const std::vector<int> &items, uchar priority)
     std::sort(changed.begin(), changed.end());
     if (!changed.empty())
     {
-        dictionary()->setToUserModified();
+        dictionary()->setToUserModified(Dictionary::UserData::Study);
         emit itemDataChanged(changed, true);
     }
 }
@@ -1901,7 +1937,7 @@ void WordDeck::setItemHints(const std::vector<int> &items, bool queue, WordParts
     std::sort(changed.begin(), changed.end());
     if (!changed.empty())
     {
-        dictionary()->setToUserModified();
+        dictionary()->setToUserModified(Dictionary::UserData::Study);
         emit itemDataChanged(changed, queue);
     }
 }
@@ -1911,7 +1947,7 @@ void WordDeck::increaseSpacingLevel(int ix)
     StudyDeck *study = studyDeck();
     study->increaseSpacingLevel(lockitems.items(ix)->cardid);
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
     emit itemDataChanged({ ix }, false);
 }
 
@@ -1920,7 +1956,7 @@ void WordDeck::decreaseSpacingLevel(int ix)
     StudyDeck *study = studyDeck();
     study->decreaseSpacingLevel(lockitems.items(ix)->cardid);
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
     emit itemDataChanged({ ix }, false);
 }
 
@@ -1933,7 +1969,7 @@ void WordDeck::resetCardStudyData(const std::vector<int> &items)
     for (int ix : items)
         study->resetCardStudyData(lockitems.items(ix)->cardid);
 
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
     emit itemDataChanged(items, false);
 }
 
@@ -1987,7 +2023,7 @@ int WordDeck::queueWordItems(const std::vector<std::pair<int, int>> &parts)
 
     if (added != 0)
     {
-        dictionary()->setToUserModified();
+        dictionary()->setToUserModified(Dictionary::UserData::Study);
         emit itemsQueued(added);
     }
     return added;
@@ -2100,36 +2136,15 @@ void WordDeck::sortDueList()
 {
     StudyDeck *study = studyDeck();
 
-    // Computing the due time is slow. The map caches the result.
-    // [word index, due time]
-    std::map<int, QDateTime> datecache;
-
-    std::sort(duelist.begin(), duelist.end(), [this, study, &datecache](int aix, int bix){
+    std::sort(duelist.begin(), duelist.end(), [this, study](int aix, int bix){
         if (aix == bix)
             return false;
 
         const LockedWordDeckItem *a = lockitems.items(aix);
         const LockedWordDeckItem *b = lockitems.items(bix);
 
-        QDateTime ta;
-        auto it = datecache.find(aix);
-        if (it == datecache.end())
-        {
-            ta = study->cardNextTestDate(a->cardid);
-            datecache.insert(std::make_pair(aix, ta));
-        }
-        else
-            ta = it->second;
-
-        QDateTime tb;
-        it = datecache.find(bix);
-        if (it == datecache.end())
-        {
-            tb = study->cardNextTestDate(b->cardid);
-            datecache.insert(std::make_pair(bix, tb));
-        }
-        else
-            tb = it->second;
+        qint64 ta = study->cardNextTestTime(a->cardid);
+        qint64 tb = study->cardNextTestTime(b->cardid);
 
         if (ta == tb)
         {
@@ -2146,37 +2161,16 @@ int WordDeck::dueIndex(int lockindex) const
 {
     const StudyDeck *study = studyDeck();
 
-    // Computing the due time is slow. The map caches the result.
-    std::map<int, QDateTime> datecache;
-    QDateTime lockdate = study->cardNextTestDate(lockitems.items(lockindex)->cardid);
-    datecache.insert(std::make_pair(lockindex, lockdate));
+    qint64 lockdate = study->cardNextTestTime(lockitems.items(lockindex)->cardid);
 
-    auto it = std::lower_bound(duelist.begin(), duelist.end(), lockindex, [this, study, lockdate, &datecache](int aix, int lockindex){
+    auto it = std::lower_bound(duelist.begin(), duelist.end(), lockindex, [this, study, lockdate](int aix, int lockindex){
         if (aix == lockindex)
             return false;
 
         const LockedWordDeckItem *a = lockitems.items(aix);
         const LockedWordDeckItem *b = lockitems.items(lockindex);
 
-        QDateTime ta;
-        auto it = datecache.find(aix);
-        if (it == datecache.end())
-        {
-            ta = study->cardNextTestDate(a->cardid);
-            datecache.insert(std::make_pair(aix, ta));
-        }
-        else
-            ta = it->second;
-
-        //QDateTime tb = lockdate;
-        //it = datecache.find(bix);
-        //if (it == datecache.end())
-        //{
-        //    tb = study->cardNextTestDate(b->cardid);
-        //    datecache.insert(std::make_pair(bix, tb));
-        //}
-        //else
-        //    tb = it->second;
+        qint64 ta = study->cardNextTestTime(a->cardid);
 
         if (ta == lockdate)
         {
@@ -2207,13 +2201,13 @@ void WordDeck::checkDueList()
 
     StudyDeck *study = studyDeck();
 
-    QDateTime prevdate = study->cardNextTestDate(lockitems.items(duelist[0])->cardid);
+    qint64 prevdate = study->cardNextTestTime(lockitems.items(duelist[0])->cardid);
     for (int ix = 1, siz = tosigned(duelist.size()); ix < siz; ++ix)
     {
         const LockedWordDeckItem *a = lockitems.items(duelist[ix - 1]);
         const LockedWordDeckItem *b = lockitems.items(duelist[ix]);
 
-        QDateTime thisdate = study->cardNextTestDate(lockitems.items(duelist[ix])->cardid);
+        qint64 thisdate = study->cardNextTestTime(lockitems.items(duelist[ix])->cardid);
         if (thisdate == prevdate)
         {
             // This is an error, items with the same word index shouldn't share the question type.
@@ -2403,6 +2397,32 @@ void WordDeck::generateNextItem()
 }
 
 void WordDeck::answer(StudyCard::AnswerType a, qint64 answertime)
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    FLIndex ix = currentix;
+
+    answerItem(a, answertime, now);
+
+    dictionary()->addUserDataOp(Dictionary::UserData::Study, Dictionary::UserDataOp::DeckAnswer, [this, &ix, a, answertime, &now](QDataStream &stream) {
+        stream << (qint32)owner()->indexOf(this) << (qint32)ix.free << (qint32)ix.locked << (quint8)a << (qint64)answertime << (qint64)now.toMSecsSinceEpoch();
+    });
+}
+
+void WordDeck::replayAnswer(int freeindex, int lockedindex, StudyCard::AnswerType a, qint64 answertime, const QDateTime &now)
+{
+    if (freeindex != -1 ? freeindex < 0 || freeindex >= tosigned(freeitems.size()) : lockedindex < 0 || lockedindex >= tosigned(lockitems.size()))
+        return;
+
+    currentix.free = freeindex;
+    currentix.locked = freeindex != -1 ? -1 : lockedindex;
+    nextix.reset();
+
+    answerItem(a, answertime, now);
+
+    currentix.reset();
+}
+
+void WordDeck::answerItem(StudyCard::AnswerType a, qint64 answertime, const QDateTime &now)
 {
     waitForNextItem();
 
@@ -2417,7 +2437,7 @@ void WordDeck::answer(StudyCard::AnswerType a, qint64 answertime)
     StudyDeck *study = studyDeck();
 
     WordDeckItem *current = currentItem();
-    current->data->lastinclude = QDateTime::currentDateTimeUtc();
+    current->data->lastinclude = now;
 
     // If a new item was tested, it has to be "converted" to a locked item and added to
     // lockitems. Existing items will be removed from either the failedlist or duelist.
@@ -2483,7 +2503,7 @@ void WordDeck::answer(StudyCard::AnswerType a, qint64 answertime)
 #ifdef _DEBUG
     checkDueList();
 #endif
-    study->answer(item->cardid, a, answertime);
+    study->answer(item->cardid, a, answertime, false, now);
 
     if (a == StudyCard::Correct || a == StudyCard::Easy)
     {
@@ -2511,8 +2531,6 @@ void WordDeck::answer(StudyCard::AnswerType a, qint64 answertime)
 #ifdef _DEBUG
     checkDueList();
 #endif
-
-    dictionary()->setToUserModified();
 }
 
 StudyCard::AnswerType WordDeck::lastAnswer() const
@@ -2559,7 +2577,7 @@ void WordDeck::changeLastAnswer(StudyCard::AnswerType a)
         failedlist.push_back(lastindex);
 
     generateNextItem();
-    dictionary()->setToUserModified();
+    dictionary()->setToUserModified(Dictionary::UserData::Study);
 }
 
 bool WordDeck::canUndo() const
@@ -2591,6 +2609,9 @@ QString WordDeck::correctReading()
 void WordDeck::practiceReadingAnswered()
 {
     testreadings.readingAnswered();
+    dictionary()->addUserDataOp(Dictionary::UserData::Study, Dictionary::UserDataOp::DeckReadingAnswered, [this](QDataStream &stream) {
+        stream << (qint32)owner()->indexOf(this);
+    });
 }
 
 void WordDeck::nextPracticeReadingWords(std::vector<int> &words)
@@ -2660,21 +2681,19 @@ void WordDeck::doGenerateNextItem()
     StudyDeck *study = studyDeck();
     //const StudyCard *c;
 
-    // Holds every item that was tested in the previous 10 minutes in the order
-    // they were tested.
-    std::vector<LockedWordDeckItem*> past;
-
     QDateTime now = QDateTime::currentDateTimeUtc();
     QDate testday = study->testDay(); //ltDay(now);
 
+    // Items due after this moment are not due today.
+    qint64 dueend = ltDayStart(testday.addDays(1));
+
     // Get the number of possible items for today's test for convenience.
-    auto dueit = interruptUpperBound(duelist.begin(), duelist.end(), testday, [this, study](QDate &testday, int ix, bool &stop){
+    auto dueit = interruptUpperBound(duelist.begin(), duelist.end(), dueend, [this, study](qint64 &dueend, int ix, bool &stop){
         stop = abortgenerating;
         if (stop)
             return false;
 
-        QDateTime d = study->cardNextTestDate(lockitems.items(ix)->cardid);
-        return testday < ltDay(d);
+        return dueend <= study->cardNextTestTime(lockitems.items(ix)->cardid);
     });
 
     int duecnt = dueit - duelist.begin();
@@ -2691,46 +2710,30 @@ void WordDeck::doGenerateNextItem()
     //    ++duecnt;
     //}
 
-    // Collect items tested in past 10 minutes. The currentitem is also one
-    // of those, even if its data is not updated yet.
-    for (int ix = 0; ix != duecnt && !abortgenerating; ++ix)
-    {
-        LockedWordDeckItem *item = lockitems.items(duelist[ix]);
-        if (item == current || item->data->lastinclude.msecsTo(now) < 60 * 1000 * minutestowait)
-            past.push_back(item);
-    }
-    for (int ix = 0, siz = tosigned(failedlist.size()); ix != siz && !abortgenerating; ++ix)
-    {
-        LockedWordDeckItem *item = lockitems.items(failedlist[ix]);
-        if (item == current || item->data->lastinclude.msecsTo(now) < 60 * 1000 * minutestowait)
-            past.push_back(item);
-    }
-
-    if (abortgenerating)
-        return;
-
-    // The past items are sorted in the order their group was last included in
-    // the test today. Those come first that were tested the shortest time
-    // ago. The current item and its group is the first one even though its
-    // lastinclude is not updated yet.
-    if (interruptSort(past.begin(), past.end(), [this, current](LockedWordDeckItem *a, LockedWordDeckItem *b, bool &aborted) {
-        aborted = abortgenerating;
-        if (current != nullptr)
-        {
-            if (a->data == current->data && b->data != current->data)
-                return true;
-            if (b->data == current->data)
-                return false;
-        }
-        return a->data->lastinclude > b->data->lastinclude;
-    }))
-        return;
-
     // New items are tested first. Look for one with the highest priority that
     // wasn't tested today, then for one not tested in the past 10 minutes. If
     // none are found try to get one that was tested the earliest.
     if (newcnt - (currentix.free != -1 ? 1 : 0) != 0)
     {
+        // Groups of the due and failed items tested in the previous 10 minutes. The current
+        // item's group is also one of those, even if its data is not updated yet.
+        QSet<WordDeckWord*> past;
+        for (int ix = 0; ix != duecnt && !abortgenerating; ++ix)
+        {
+            LockedWordDeckItem *item = lockitems.items(duelist[ix]);
+            if (item == current || item->data->lastinclude.msecsTo(now) < 60 * 1000 * minutestowait)
+                past.insert(item->data);
+        }
+        for (int ix = 0, siz = tosigned(failedlist.size()); ix != siz && !abortgenerating; ++ix)
+        {
+            LockedWordDeckItem *item = lockitems.items(failedlist[ix]);
+            if (item == current || item->data->lastinclude.msecsTo(now) < 60 * 1000 * minutestowait)
+                past.insert(item->data);
+        }
+
+        if (abortgenerating)
+            return;
+
         // Count the number of items in each priority group and go from highest to lowest.
         int priorities[9];
         memset(priorities, 0, sizeof(int) * 9);
@@ -2770,7 +2773,7 @@ void WordDeck::doGenerateNextItem()
                 }
 
                 // Group was not tested in past 10 minutes.
-                if ((current == nullptr || item->data != current->data) && std::find_if(past.begin(), past.end(), [item](LockedWordDeckItem *a) { return (a->data == item->data); }) == past.end())
+                if ((current == nullptr || item->data != current->data) && !past.contains(item->data))
                     foundix = ix;
                 else if (previx == -1 || previx == currentix.free || ((current == nullptr || current->data != item->data) && item->data->lastinclude < prevtime))
                 {
@@ -92,7 +92,7 @@ public:
     // types are kept, the others are deleted.
     // mainword: [new index, word data]
     // kept: [(old?) word data, question type used from that word data]
-    void applyChanges(const std::map<int, int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<WordDeckWord*, int> &kept);
+    void applyChanges(const std::vector<int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<WordDeckWord*, int> &kept);
 
     // Creates an exact copy of source, apart from the owner, which is kept unchanged. The
     // copied data will be created for this list and not just moved by pointer.
@@ -206,13 +206,16 @@ public:
     //           with the same new index is exact match.
     // Every reading for words where the match is not exact, or mergedest does not contain it
     // must be removed from the readings test.
-    void applyChanges(const std::map<int, int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<int, bool> &match);
+    void applyChanges(const std::vector<int> &changes, const std::map<int, WordDeckWord*> &mainword, const std::map<int, bool> &match);
 
     void copy(ReadingTestList *src);
 
-    // Called when a word was deleted from the dictionary. Words with an index above this
-    // value must be updated, and the word's data removed.
+    // Called when a word was deleted from the dictionary. The word's data is removed. The
+    // index of other words is not changed.
     void processRemovedWord(int windex);
+    // Updates the stored word indexes after the dictionary was compacted. The new index of a
+    // word is at its original index in changes.
+    void processCompactedWords(const std::vector<int> &changes);
 
     // Called during the long term study test, when a word is tested, to include the readings
     // of kanji found in the word to be tested. windex is the index of the word in the main
@@ -293,13 +296,14 @@ public:
 
     void clear();
 
-    void applyChanges(Dictionary *olddict, std::map<int, int> &changes);
+    void applyChanges(Dictionary *olddict, const std::vector<int> &changes);
     //void swap(WordDeckList *other);
 
     void copy(WordDeckList *src);
 
     Dictionary* dictionary();
     void processRemovedWord(int windex);
+    void processCompactedWords(const std::vector<int> &changes);
 
     // Number of long-term study decks in the dictionary.
     size_type size() const;
@@ -401,19 +405,22 @@ public:
     // Returns true if there are no words added to the deck.
     bool empty() const;
 
-    // Called when the dictionary is updated. Changes holds pairs of old and new word indexes.
-    // If more words are mapped to a single new index, their data is merged when possible.
-    // Otherwise some data will be lost. Olddict is the dictionary holding the old word
-    // entries. The dictionary() is already updated.
-    void applyChanges(Dictionary *olddict, std::map<int, int> &changes);
+    // Called when the dictionary is updated. Changes holds the new word indexes at the old
+    // indexes. If more words are mapped to a single new index, their data is merged when
+    // possible. Otherwise some data will be lost. Olddict is the dictionary holding the old
+    // word entries. The dictionary() is already updated.
+    void applyChanges(Dictionary *olddict, const std::vector<int> &changes);
 
     // Copies the deck data from source. Requests a new study deck for itself and fills the
     // deck with data copied from src as well. The owner is not changed.
     void copy(WordDeck *src);
 
-    // Called when a word was deleted from the dictionary. Words with an index above this
-    // value must be updated, and the word's data removed.
+    // Called when a word was deleted from the dictionary. The word's data is removed if it's
+    // in the deck. The index of other words is not changed.
     void processRemovedWord(int windex);
+    // Updates the stored word indexes after the dictionary was compacted. The new index of a
+    // word is at its original index in changes.
+    void processCompactedWords(const std::vector<int> &changes);
 
     // Sets up the deck for addig new items to test for the day. If the number
     // of new items is not 0, num is added to it.
@@ -429,6 +436,8 @@ public:
     // error to call this more than once when taking breaks during tests.
     // Avoid calling it in the middle of tests.
     void startTest();
+    // Applies a call to startTest() recorded in the user data journal, which was made at now.
+    void replayStartTest(const QDateTime &now);
 
     // Returns the number of days passed since the last study day.
     int daysSinceLastInclude() const;
@@ -631,6 +640,10 @@ public:
     // answer.
     // Returns whether the card has been set as postponed.
     void answer(StudyCard::AnswerType a, qint64 answertime);
+    // Applies a call to answer() recorded in the user data journal, which was made at now.
+    // The answered item was at freeindex in the free items or at lockedindex in the locked
+    // items.
+    void replayAnswer(int freeindex, int lockedindex, StudyCard::AnswerType a, qint64 answertime, const QDateTime &now);
 
     // Returns the answer passed to answer() the last time it was called during the current
     // running test. Only valid when a test is running and answer() was called at least once
@@ -678,6 +691,12 @@ private:
     // removed and the cards of its items must be deleted separately.
     void removeWordData(WordDeckWord *dat);
 
+    // Implementation of startTest() for a test started at now. Returns whether a new test day
+    // was started.
+    bool startTestDay(const QDateTime &now);
+    // Implementation of answer() for an answer given at now.
+    void answerItem(StudyCard::AnswerType a, qint64 answertime, const QDateTime &now);
+
     // Blocks the main thread while a next item is being computed, unless
     // it's already found. Returns false if the item thread was running
     // but found no items to be shown next. Returns true if no item thread
@@ -694,6 +713,10 @@ private:
     // Accesses the following values: (that must be protected in the main thread)
     //      LockedWordDeckItem::data->lastinclude.
     //      items list.
+    // The due, failed and free items are checked one by one, which takes linear time. The
+    // choice depends on the current time and on when the group of each item was last
+    // included, and a group's inclusion affects all its items at once. Because of this the
+    // items can't be kept in a priority queue ordered in advance.
     void doGenerateNextItem();
 
     // Returns an item from either freeitems or lockitems, that is currently
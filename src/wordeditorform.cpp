@@ -169,16 +169,23 @@ void WordEditorFormFactory::dictEntryRemoved(int windex) /* slot */
         dictmap.erase(it2);
         f->uncheckedClose();
     }
+}
+
+void WordEditorFormFactory::dictEntriesCompacted(const std::vector<int> &changes) /* slot */
+{
+    Dictionary *d = dynamic_cast<Dictionary*>(sender());
+    if (d == nullptr)
+        return;
+
+    auto it = editors.find(d);
+    if (it == editors.end())
+        return;
 
+    auto &dictmap = it->second;
     auto tmp = dictmap;
     dictmap.clear();
     for (auto &p : tmp)
-    {
-        if (p.first < windex)
-            dictmap.insert(p);
-        else if (p.first > windex)
-            dictmap[p.first - 1] = p.second;
-    }
+        dictmap[changes[p.first]] = p.second;
 }
 
 
@@ -204,8 +211,12 @@ void WordEditorFormFactory::addEditor(Dictionary *dict, int windex, WordEditorFo
     if (windex == -1)
         return;
 
+    // The connections are kept when the last editor of the dictionary is closed.
     if (editors.count(dict) == 0)
-        connect(dict, &Dictionary::entryRemoved, this, &WordEditorFormFactory::dictEntryRemoved);
+    {
+        connect(dict, &Dictionary::entryRemoved, this, &WordEditorFormFactory::dictEntryRemoved, Qt::UniqueConnection);
+        connect(dict, &Dictionary::entriesCompacted, this, &WordEditorFormFactory::dictEntriesCompacted, Qt::UniqueConnection);
+    }
 
     editors[dict][windex] = form;
 }
@@ -315,6 +326,7 @@ void WordEditorForm::exec(Dictionary *d, int windex, int defindex)
     index = windex;
 
     connect(dict, &Dictionary::entryChanged, this, &WordEditorForm::dictEntryChanged);
+    connect(dict, &Dictionary::entriesCompacted, this, &WordEditorForm::dictEntriesCompacted);
     connect(dict, &Dictionary::dictionaryReset, this, &WordEditorForm::uncheckedClose);
 
     WordEntry *w = windex < 0 ? nullptr : d->wordEntry(windex);
@@ -375,6 +387,7 @@ void WordEditorForm::exec(Dictionary *srcd, int srcwindex, const std::vector<int
 
     //connect(dict, &Dictionary::entryRemoved, this, &WordEditorForm::dictEntryRemoved);
     connect(dict, &Dictionary::entryChanged, this, &WordEditorForm::dictEntryChanged);
+    connect(dict, &Dictionary::entriesCompacted, this, &WordEditorForm::dictEntriesCompacted);
     connect(dict, &Dictionary::dictionaryReset, this, &WordEditorForm::uncheckedClose);
 
     WordEntry *srcw = srcd->wordEntry(srcwindex);
@@ -553,6 +566,13 @@ void WordEditorForm::dictEntryChanged(int windex, bool studydef)
     checkInput();
 }
 
+void WordEditorForm::dictEntriesCompacted(const std::vector<int> &changes)
+{
+    // The editor of a removed word is closed in WordEditorFormFactory::dictEntryRemoved().
+    if (index != -1)
+        index = changes[index];
+}
+
 void WordEditorForm::wordChanged()
 {
     if (ignoreedits)
@@ -86,6 +86,7 @@ public:
     void createForm(Dictionary *srcd, int srcwindex, const std::vector<int> &srcdindexes, Dictionary *dest, int dwindex, QWidget *parent = nullptr);
 private slots:
     void dictEntryRemoved(int windex);
+    void dictEntriesCompacted(const std::vector<int> &changes);
 private:
     // If an editor is open with the dictionary and word index, it's activated. Returns true
     // if such an editor was found.
@@ -141,6 +142,8 @@ private slots:
     void checkInput();
 
     void dictEntryChanged(int windex, bool studydef);
+    // Updates the index of the edited word after the dictionary was compacted.
+    void dictEntriesCompacted(const std::vector<int> &changes);
     //void dictEntryDefinitionAdded(int windex);
     //void dictEntryDefinitionChanged(int windex, int dindex);
     //void dictEntryDefinitionRemoved(int windex, int dindex);
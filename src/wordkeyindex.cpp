@@ -0,0 +1,143 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#include <QHash>
+#include "wordkeyindex.h"
+#include "words.h"
+
+#include "checked_cast.h"
+
+
+//-------------------------------------------------------------
+
+
+WordKeyIndex::WordKeyIndex(const smartvector<WordEntry> &words) : words(words), cnt(0), removed(0)
+{
+}
+
+int WordKeyIndex::size() const
+{
+    return cnt + removed;
+}
+
+void WordKeyIndex::clear()
+{
+    std::vector<Slot>().swap(slots);
+    cnt = 0;
+    removed = 0;
+}
+
+void WordKeyIndex::rebuild()
+{
+    int wcnt = tosigned(words.size());
+    int cap = 16;
+    while (cap < wcnt * 2)
+        cap *= 2;
+
+    slots.assign(cap, { 0, -1 });
+    cnt = 0;
+    removed = 0;
+
+    for (int ix = 0; ix != wcnt; ++ix)
+    {
+        const WordEntry *e = words[ix];
+        if ((e->dat & (1 << (int)WordRuntimeData::Removed)) != 0)
+        {
+            ++removed;
+            continue;
+        }
+        insert(hashKey(e->kanji.data(), tosigned(e->kanji.size()), e->kana.data(), tosigned(e->kana.size())), ix);
+    }
+}
+
+int WordKeyIndex::find(const QChar *kanji, int kanjilen, const QChar *kana, int kanalen) const
+{
+    if (slots.empty())
+        return -1;
+
+    uint hash = hashKey(kanji, kanjilen, kana, kanalen);
+    int mask = tosigned(slots.size()) - 1;
+
+    // Every slot up to the next empty one can hold the word. Words with the same kanji and
+    // kana are all checked to find the lowest index.
+    int result = -1;
+    for (int pos = hash & mask; slots[pos].index != -1; pos = (pos + 1) & mask)
+    {
+        const Slot &s = slots[pos];
+        if (s.hash != hash || (result != -1 && s.index > result))
+            continue;
+
+        const WordEntry *e = words[s.index];
+        if (tosigned(e->kanji.size()) != kanjilen || tosigned(e->kana.size()) != kanalen || qcharncmp(e->kanji.data(), kanji, kanjilen) || qcharncmp(e->kana.data(), kana, kanalen))
+            continue;
+        result = s.index;
+    }
+    return result;
+}
+
+void WordKeyIndex::add(int windex)
+{
+    if (cnt + removed != windex)
+    {
+        clear();
+        return;
+    }
+
+    if ((cnt + 1) * 2 > tosigned(slots.size()))
+    {
+        rebuild();
+        return;
+    }
+
+    const WordEntry *e = words[windex];
+    insert(hashKey(e->kanji.data(), tosigned(e->kanji.size()), e->kana.data(), tosigned(e->kana.size())), windex);
+}
+
+void WordKeyIndex::remove(int windex)
+{
+    if (cnt + removed != tosigned(words.size()))
+    {
+        clear();
+        return;
+    }
+
+    const WordEntry *e = words[windex];
+    uint hash = hashKey(e->kanji.data(), tosigned(e->kanji.size()), e->kana.data(), tosigned(e->kana.size()));
+    int mask = tosigned(slots.size()) - 1;
+
+    int hole = hash & mask;
+    while (slots[hole].index != windex)
+        hole = (hole + 1) & mask;
+
+    // Items after the removed one are moved back into the hole, unless the hole is in front
+    // of the position of their hash.
+    for (int pos = (hole + 1) & mask; slots[pos].index != -1; pos = (pos + 1) & mask)
+    {
+        int home = slots[pos].hash & mask;
+        if (((pos - home) & mask) < ((pos - hole) & mask))
+            continue;
+        slots[hole] = slots[pos];
+        hole = pos;
+    }
+    slots[hole].index = -1;
+    --cnt;
+    ++removed;
+}
+
+uint WordKeyIndex::hashKey(const QChar *kanji, int kanjilen, const QChar *kana, int kanalen)
+{
+    return uint(qHashBits(kana, kanalen * sizeof(QChar), qHashBits(kanji, kanjilen * sizeof(QChar))));
+}
+
+void WordKeyIndex::insert(uint hash, int windex)
+{
+    int mask = tosigned(slots.size()) - 1;
+    int pos = hash & mask;
+    while (slots[pos].index != -1)
+        pos = (pos + 1) & mask;
+    slots[pos] = { hash, windex };
+    ++cnt;
+}
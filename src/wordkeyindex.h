@@ -0,0 +1,66 @@
+/*
+** Copyright 2007-2013, 2017-2018 Sólyom Zoltán
+** This file is part of zkanji, a free software released under the terms of the
+** GNU General Public License version 3. See the file LICENSE for details.
+**/
+
+#ifndef WORDKEYINDEX_H
+#define WORDKEYINDEX_H
+
+#include <QChar>
+#include <vector>
+#include "smartvector.h"
+
+struct WordEntry;
+// Hash table of the word indexes of a dictionary, to find words by their exact written form
+// and kana. The table uses open addressing with linear probing. Removed items leave no mark
+// in the table, instead the items after them in the same run are moved back, so lookups
+// never have to skip deleted slots. Words removed from the dictionary but not yet compacted
+// are not placed in the table.
+class WordKeyIndex
+{
+public:
+    WordKeyIndex(const smartvector<WordEntry> &words);
+
+    // Number of words covered by the index, including the removed words that are not in the
+    // table. The index is up to date when this equals the size of the words list.
+    int size() const;
+
+    void clear();
+    // Adds every word in the list to the index.
+    void rebuild();
+
+    // Returns the lowest index of a word with the passed kanji and kana, or -1 if not found.
+    int find(const QChar *kanji, int kanjilen, const QChar *kana, int kanalen) const;
+
+    // Adds the word at windex, which must be the last word in the list. The index is cleared
+    // instead when it wasn't up to date before the word was added.
+    void add(int windex);
+    // Removes the word at windex from the table. The other word indexes are not changed.
+    // Must be called before the word is marked as removed in the list.
+    void remove(int windex);
+private:
+    struct Slot
+    {
+        uint hash;
+        // Index of the word, or -1 for empty slots.
+        int index;
+    };
+
+    // Computes the hash of the kanji and kana of a word.
+    static uint hashKey(const QChar *kanji, int kanjilen, const QChar *kana, int kanalen);
+    // Places windex in the first empty slot at or after the position of hash.
+    void insert(uint hash, int windex);
+
+    const smartvector<WordEntry> &words;
+
+    // The size of the table is always a power of 2, and at most half of the slots are used.
+    std::vector<Slot> slots;
+    // Number of words in the table.
+    int cnt;
+    // Number of removed words left out of the table.
+    int removed;
+};
+
+
+#endif // WORDKEYINDEX_H
@@ -12,10 +12,11 @@
 #include <QDir>
 #include <QString>
 
-#define TIMED_LOAD 0
-#if TIMED_LOAD == 1
 #include <QElapsedTimer>
-#endif
+#include <QMutex>
+#include <QWaitCondition>
+
+#define TIMED_LOAD 0
 
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
@@ -40,6 +41,8 @@
 #include "datasettings.h"
 #include "sentences.h"
 #include "zui.h"
+#include "flatdata.h"
+#include "postinglist.h"
 
 #include "checked_cast.h"
 
@@ -49,9 +52,12 @@
 extern char ZKANJI_PROGRAM_VERSION[];
 
 static char ZKANJI_BASE_FILE_VERSION[] = "002";
-static char ZKANJI_DICTIONARY_FILE_VERSION[] = "001";
+static char ZKANJI_DICTIONARY_FILE_VERSION[] = "004";
+
+static char ZKANJI_GROUP_FILE_VERSION[] = "004";
 
-static char ZKANJI_GROUP_FILE_VERSION[] = "003";
+// Order of the parts of the user data in the user data files.
+static const Dictionary::UserData ZKANJI_USER_DATA_PARTS[] = { Dictionary::UserData::Words, Dictionary::UserData::Groups, Dictionary::UserData::Study, Dictionary::UserData::Definitions, Dictionary::UserData::Kanji };
 
 // Separator character between variants of the same word definition.
 const QChar GLOSS_SEP_CHAR = QChar(0x0082);
@@ -78,24 +84,92 @@ namespace ZKanji
         return *wordfiltersinst;
     }
 
+    static bool parallelsearch = true;
+
+    void setParallelSearch(bool enable)
+    {
+        parallelsearch = enable;
+    }
+
+    bool parallelSearch()
+    {
+        return parallelsearch;
+    }
+
+    static QMutex searchmutex;
+    static QWaitCondition searchcond;
+    // Cancel flags of the searches running in the background.
+    static std::vector<std::atomic<bool>*> searches;
+
+    void beginBackgroundSearch(std::atomic<bool> *cancel)
+    {
+        // The kanji index map is filled on first use, which is not safe while other threads
+        // read it. Looking up a character that's not a kanji fills the whole map.
+        kanjiIndex(QChar());
+
+        QMutexLocker locker(&searchmutex);
+        searches.push_back(cancel);
+    }
+
+    void endBackgroundSearch(std::atomic<bool> *cancel)
+    {
+        QMutexLocker locker(&searchmutex);
+        auto it = std::find(searches.begin(), searches.end(), cancel);
+        if (it != searches.end())
+            searches.erase(it);
+        searchcond.wakeAll();
+    }
+
+    void stopBackgroundSearches()
+    {
+        QMutexLocker locker(&searchmutex);
+        for (std::atomic<bool> *cancel : searches)
+            cancel->store(true);
+        while (!searches.empty())
+            searchcond.wait(&searchmutex);
+    }
+
+    void stopBackgroundSearch(std::atomic<bool> *cancel)
+    {
+        QMutexLocker locker(&searchmutex);
+        cancel->store(true);
+        while (std::find(searches.begin(), searches.end(), cancel) != searches.end())
+            searchcond.wait(&searchmutex);
+    }
+
     void findEntriesByKana(std::vector<WordEntriesResult> &result, const QString &kana)
     {
         int oldsiz = tosigned(result.size());
 
-        std::vector<int> l;
+        int dcnt = ZKanji::dictionaryCount();
+        std::vector<std::vector<int>> found(dcnt);
+
+        bool parallel = parallelsearch && dcnt > 1;
+        for (int ix = 0; parallel && ix != dcnt; ++ix)
+            parallel = ZKanji::dictionary(ix)->threadSafeSearch();
 
-        // Add unsorted and unfiltered results from every dictionary first.
-        for (int ix = 0; ix != ZKanji::dictionaryCount(); ++ix)
+        // Unsorted and unfiltered results from every dictionary. Each dictionary is searched
+        // separately, so the searches can run on multiple threads.
+        auto findInDict = [&kana, &found](int ix) {
+            ZKanji::dictionary(ix)->findKanaWords(found[ix], kana, SearchWildcard::NoWildcard, true, nullptr, nullptr);
+        };
+
+        if (parallel)
+            parallelFor(dcnt, findInDict);
+        else
         {
-            Dictionary *dict = ZKanji::dictionary(ix);
+            for (int ix = 0; ix != dcnt; ++ix)
+                findInDict(ix);
+        }
 
-            dict->findKanaWords(l, kana, SearchWildcard::NoWildcard, true, nullptr, nullptr);
-            result.reserve(result.size() + l.size());
+        // Add results in the order of dictionaries first.
+        for (int ix = 0; ix != dcnt; ++ix)
+        {
+            Dictionary *dict = ZKanji::dictionary(ix);
 
-            for (int i : l)
+            result.reserve(result.size() + found[ix].size());
+            for (int i : found[ix])
                 result.emplace_back(i, dict);
-
-            l.clear();
         }
 
         // Sort the result list, ignoring the old contents to be able to remove duplicates.
@@ -116,6 +190,64 @@ namespace ZKanji
         result.resize(itend - result.begin());
     }
 
+    QString benchmarkFindWords(const QStringList &queries, int repeat)
+    {
+        if (dictionaryCount() == 0)
+            return QString();
+
+        QStringList list = queries;
+        if (list.isEmpty())
+        {
+            list << QStringLiteral("食べさせられなかった") << QStringLiteral("たべさせられなかった") <<
+                QStringLiteral("行きたくなかった") << QStringLiteral("読まれています") <<
+                QStringLiteral("よまれています") << QStringLiteral("書かせてください") <<
+                QStringLiteral("見られませんでした") << QStringLiteral("飲んでしまった") <<
+                QStringLiteral("来なければならない") << QStringLiteral("言われたくない") <<
+                QStringLiteral("しなければなりませんでした") << QStringLiteral("勉強させられている");
+        }
+
+        Dictionary *dict = dictionary(0);
+        bool oldparallel = parallelsearch;
+
+        QString report;
+        QTextStream out(&report);
+        out << "Query\tSequential (us)\tParallel (us)\tResults\n";
+
+        qint64 sumseq = 0;
+        qint64 sumpar = 0;
+
+        for (const QString &query : list)
+        {
+            qint64 times[2];
+            int rescnt = 0;
+            for (int pass = 0; pass != 2; ++pass)
+            {
+                parallelsearch = pass == 1;
+
+                QElapsedTimer t;
+                t.start();
+                for (int ix = 0; ix != repeat; ++ix)
+                {
+                    WordResultList result(dict);
+                    dict->findWords(result, SearchMode::Japanese, query, SearchWildcard::AnyAfter, false, true, false, nullptr, nullptr);
+                    rescnt = tosigned(result.size());
+                }
+                times[pass] = t.nsecsElapsed() / 1000 / std::max(1, repeat);
+            }
+
+            sumseq += times[0];
+            sumpar += times[1];
+            out << query << "\t" << times[0] << "\t" << times[1] << "\t" << rescnt << "\n";
+        }
+
+        parallelsearch = oldparallel;
+
+        out << "Average\t" << sumseq / std::max<qint64>(1, list.size()) << "\t" << sumpar / std::max<qint64>(1, list.size()) << "\n";
+        out.flush();
+
+        return report;
+    }
+
     //void addImportDictionary(Dictionary *dict)
     //{
     //    if (!dictionaries.empty())
@@ -318,7 +450,7 @@ namespace ZKanji
         }
     }
 
-    void saveUserData(bool forced)
+    void saveUserData(bool forced, bool journal)
     {
         if (forced || ZKanji::profile().isModified())
             ZKanji::profile().save(userFolder() + "/data/student.zkp");
@@ -326,6 +458,9 @@ namespace ZKanji
 
         for (Dictionary *d : dictionaries)
         {
+            // Removed words are erased before saving, so the saved word indexes are final.
+            d->compactEntries();
+
             if (d == dictionaries[0])
             {
                 // TODO: (later) fix in case different base dictionary is implemented.
@@ -370,7 +505,12 @@ namespace ZKanji
             }
 
             if (forced || d->isUserModified())
-                d->saveUserData(userFolder() + QString("/data/%1.zkuser").arg(d->name()));
+            {
+                if (journal && !forced)
+                    d->saveUserDataJournal(userFolder() + QString("/data/%1.zkuser").arg(d->name()));
+                else
+                    d->saveUserData(userFolder() + QString("/data/%1.zkuser").arg(d->name()));
+            }
         }
     }
 
@@ -464,6 +604,7 @@ namespace ZKanji
 
         bool fail = false;
         fail = QFile::exists(ZKanji::userFolder() + "/data/English.zkuser") && !QFile::copy(ZKanji::userFolder() + "/data/English.zkuser", dir.absolutePath() + "/Engilsh.zkuser");
+        fail = (QFile::exists(Dictionary::userDataJournalName(ZKanji::userFolder() + "/data/English.zkuser")) && !QFile::copy(Dictionary::userDataJournalName(ZKanji::userFolder() + "/data/English.zkuser"), Dictionary::userDataJournalName(dir.absolutePath() + "/Engilsh.zkuser"))) || fail;
         fail = (QFile::exists(ZKanji::userFolder() + "/data/student.zkp") && !QFile::copy(ZKanji::userFolder() + "/data/student.zkp", dir.absolutePath() + "/student.zkp")) || fail;
 
         for (int ix = 1, siz = ZKanji::dictionaryCount(); !fail && ix != siz; ++ix)
@@ -471,6 +612,7 @@ namespace ZKanji
             QString n = ZKanji::dictionary(ix)->name();
             fail = (QFile::exists(ZKanji::userFolder() + QString("/data/%1.zkdict").arg(n)) && !QFile::copy(ZKanji::userFolder() + QString("/data/%1.zkdict").arg(n), dir.absolutePath() + QString("/%1.zkdict").arg(n))) || fail;
             fail = (QFile::exists(ZKanji::userFolder() + QString("/data/%1.zkuser").arg(n)) && !QFile::copy(ZKanji::userFolder() + QString("/data/%1.zkuser").arg(n), dir.absolutePath() + QString("/%1.zkuser").arg(n))) || fail;
+            fail = (QFile::exists(Dictionary::userDataJournalName(ZKanji::userFolder() + QString("/data/%1.zkuser").arg(n))) && !QFile::copy(Dictionary::userDataJournalName(ZKanji::userFolder() + QString("/data/%1.zkuser").arg(n)), Dictionary::userDataJournalName(dir.absolutePath() + QString("/%1.zkuser").arg(n)))) || fail;
         }
 
         if (fail)
@@ -596,6 +738,8 @@ void WordAttributeFilterList::saveXMLSettings(QXmlStreamWriter &writer) const
 
 void WordAttributeFilterList::loadXMLSettings(QXmlStreamReader &reader)
 {
+    ZKanji::stopBackgroundSearches();
+
     while (reader.readNextStartElement())
     {
         if (reader.name() != "Filter")
@@ -682,6 +826,8 @@ int WordAttributeFilterList::itemIndex(const QStringView &name)
 
 void WordAttributeFilterList::erase(int index)
 {
+    ZKanji::stopBackgroundSearches();
+
     list.erase(list.begin() + index);
     emit filterErased(index);
 }
@@ -690,6 +836,9 @@ void WordAttributeFilterList::move(int index, int to)
 {
     if (to < 0 || to > tosigned(list.size()) || to == index || to == index + 1)
         return;
+
+    ZKanji::stopBackgroundSearches();
+
     WordAttributeFilter f = list[index];
     list.erase(list.begin() + index);
     list.insert(list.begin() + (to - (to > index ? 1 : 0)), f);
@@ -704,6 +853,8 @@ void WordAttributeFilterList::rename(int index, const QString &newname)
 
 void WordAttributeFilterList::update(int index, const WordDefAttrib &attrib, uchar info, uchar jlpt, FilterMatchType matchtype)
 {
+    ZKanji::stopBackgroundSearches();
+
     WordAttributeFilter &f = list[index];
     f.attrib = attrib;
     f.inf = info;
@@ -715,6 +866,8 @@ void WordAttributeFilterList::update(int index, const WordDefAttrib &attrib, uch
 
 void WordAttributeFilterList::add(const QString &name, const WordDefAttrib &attrib, uchar info, uchar jlpt, FilterMatchType matchtype)
 {
+    ZKanji::stopBackgroundSearches();
+
     if (list.size() == 255)
         return;
 
@@ -767,6 +920,22 @@ bool WordAttributeFilterList::match(const WordEntry *w, const WordFilterConditio
     return true;
 }
 
+bool WordAttributeFilterList::threadSafe(const WordFilterConditions *conditions) const
+{
+    if (conditions == nullptr)
+        return true;
+
+    // Same checks as in match() for looking up the commons data.
+    if (conditions->examples != Inclusion::Ignore)
+        return false;
+
+    for (int ix = 0, siz = tosigned(conditions->inclusions.size()); ix != siz; ++ix)
+        if (list[ix].jlpt != 0)
+            return false;
+
+    return true;
+}
+
 bool WordAttributeFilterList::domatch(const WordEntry *w, const WordCommons *commons,  int index) const
 {
     const WordAttributeFilter &f = list[index];
@@ -1041,34 +1210,27 @@ bool OriginalWordsList::revertModified(int windex, WordEntry *w)
 
 bool OriginalWordsList::processRemovedWord(int windex)
 {
-    int indexindex = -1;
-    bool changed = false;
     for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
     {
         OriginalWord *w = list[ix];
-        if (w->index == windex)
-        {
+        if (w->index != windex)
+            continue;
 #ifdef _DEBUG
-            if (w->change != OriginalWord::Added)
-                throw "Only added words should be removed by users.";
+        if (w->change != OriginalWord::Added)
+            throw "Only added words should be removed by users.";
 #endif
-            indexindex = ix;
-        }
-        else if (w->index > windex)
-        {
-            --w->index;
-            changed = true;
-        }
-    }
-    if (indexindex != -1)
-    {
-        list.erase(list.begin() + indexindex);
-        changed = true;
+        list.erase(list.begin() + ix);
+        return true;
     }
 
-    return changed;
+    return false;
 }
 
+void OriginalWordsList::processCompactedWords(const std::vector<int> &changes)
+{
+    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
+        list[ix]->index = changes[list[ix]->index];
+}
 
 //-------------------------------------------------------------
 
@@ -1134,6 +1296,44 @@ bool definitionsMatch(WordEntry *e1, WordEntry *e2)
 //-------------------------------------------------------------
 
 
+struct WordResultList::PendingSort
+{
+    // Set when the list is sorted by defSortLazy() and defdata is used. Otherwise the data is
+    // in jpdata.
+    bool def;
+
+    // Sort data of the unsorted items at the end of the list, in the same order.
+    std::vector<Dictionary::JPResultSortData> jpdata;
+    std::vector<Dictionary::DefResultSortData> defdata;
+};
+
+namespace
+{
+    // Finds the count smallest items in data with func, and fills list with their positions
+    // in sorted order. The items are removed from data, and the remaining items are reordered
+    // to match the rest of list.
+    template<typename T>
+    void sortPendingData(std::vector<T> &data, int count, bool (*func)(const T&, const T&), std::vector<int> &list)
+    {
+        list.resize(data.size());
+        std::iota(list.begin(), list.end(), 0);
+
+        auto cmp = [&data, func](int aix, int bix) {
+            return func(data[aix], data[bix]);
+        };
+
+        if (count < tosigned(list.size()))
+            std::nth_element(list.begin(), list.begin() + count, list.end(), cmp);
+        std::sort(list.begin(), list.begin() + count, cmp);
+
+        std::vector<T> tmp;
+        tmp.reserve(list.size() - count);
+        for (int ix = count, siz = tosigned(list.size()); ix != siz; ++ix)
+            tmp.push_back(data[list[ix]]);
+        data.swap(tmp);
+    }
+}
+
 //WordResultList::WordResultList() : dict(nullptr)
 //{
 //
@@ -1154,10 +1354,16 @@ WordResultList& WordResultList::operator=(WordResultList &&src)
     std::swap(dict, src.dict);
     std::swap(indexes, src.indexes);
     std::swap(infs, src.infs);
+    std::swap(pending, src.pending);
 
     return *this;
 }
 
+WordResultList::~WordResultList()
+{
+
+}
+
 Dictionary* WordResultList::dictionary()
 {
     return dict;
@@ -1180,12 +1386,14 @@ void WordResultList::set(const std::vector<int> &wordindexes)
 {
     indexes = wordindexes;
     infs.clear();
+    pending.reset();
 }
 
 void WordResultList::set(std::vector<int> &&wordindexes)
 {
     std::swap(indexes, wordindexes);
     infs.clear();
+    pending.reset();
 }
 
 inline WordEntry* WordResultList::items(int ix)
@@ -1220,6 +1428,7 @@ void WordResultList::clear()
 {
     indexes.clear();
     infs.clear();
+    pending.reset();
 }
 
 bool WordResultList::empty() const
@@ -1263,6 +1472,8 @@ const smartvector<std::vector<InfTypes>>& WordResultList::getInflections() const
 
 void WordResultList::sortByList(const std::vector<int> &list)
 {
+    pending.reset();
+
     std::vector<int> indextmp;
     std::vector<std::vector<InfTypes>*> inftmp;
     indexes.swap(indextmp);
@@ -1288,6 +1499,8 @@ void WordResultList::sortByList(const std::vector<int> &list)
 
 void WordResultList::sortByIndex()
 {
+    pending.reset();
+
     std::vector<std::pair<int, int>> ordered;
     int siz = tosigned(indexes.size());
     ordered.reserve(siz);
@@ -1322,6 +1535,8 @@ void WordResultList::jpSort(std::vector<int> *pindexes)
 {
     // When changing, also change jpInsertPos().
 
+    pending.reset();
+
     std::vector<int> list;
     std::vector<Dictionary::JPResultSortData> pairlist;
     pairlist.resize(indexes.size());
@@ -1370,6 +1585,8 @@ void WordResultList::jpSort(std::vector<int> *pindexes)
 
 int WordResultList::jpInsertPos(int windex, const std::vector<InfTypes> &winfs, int *oldpos)
 {
+    sortTo(tosigned(indexes.size()));
+
     std::vector<Dictionary::JPResultSortData> list;
 
     int wpos = -1;
@@ -1425,6 +1642,8 @@ void WordResultList::defSort(QString searchstr, std::vector<int> *pindexes)
 {
     // When changing, also change defInsertPos().
 
+    pending.reset();
+
     // Before the words can be sorted by definition, some data must be collected
     // and cached till the end of the sort to speed the sort up.
     searchstr = searchstr.toLower();
@@ -1477,6 +1696,8 @@ void WordResultList::defSort(QString searchstr, std::vector<int> *pindexes)
 
 int WordResultList::defInsertPos(QString searchstr, int windex, int *oldpos)
 {
+    sortTo(tosigned(indexes.size()));
+
     int wpos = -1;
     for (int ix = 0, siz = tosigned(indexes.size()); ix != siz; ++ix)
     {
@@ -1527,15 +1748,124 @@ int WordResultList::defInsertPos(QString searchstr, int windex, int *oldpos)
     return pos;
 }
 
+void WordResultList::jpSortLazy(int count)
+{
+    // The sort data is generated for every item, to use the same data every time more items
+    // are sorted. The result is the same as jpSort(), apart from the order of items that
+    // jpSortFunc() finds equal.
+
+    pending.reset(new PendingSort);
+    pending->def = false;
+
+    std::vector<Dictionary::JPResultSortData> &data = pending->jpdata;
+    data.resize(indexes.size());
+    for (int ix = 0, siz = tosigned(indexes.size()); ix != siz; ++ix)
+        data[ix] = Dictionary::jpSortDataGen(dict->wordEntry(indexes[ix]), tosigned(infs.size()) > ix ? infs[ix] : nullptr);
+
+    if (data.empty())
+        pending.reset();
+    else
+        sortTo(count);
+}
+
+void WordResultList::defSortLazy(QString searchstr, int count)
+{
+    // Generating the definition sort data takes longer than sorting most lists, so it's only
+    // done once, for every item.
+
+    pending.reset(new PendingSort);
+    pending->def = true;
+
+    searchstr = searchstr.toLower();
+
+    std::vector<Dictionary::DefResultSortData> &data = pending->defdata;
+    data.resize(indexes.size());
+    for (int ix = 0, siz = tosigned(indexes.size()); ix != siz; ++ix)
+        data[ix] = Dictionary::defSortDataGen(searchstr, dict->wordEntry(indexes[ix]));
+
+    if (data.empty())
+        pending.reset();
+    else
+        sortTo(count);
+}
+
+void WordResultList::sortTo(int count)
+{
+    if (!pending)
+        return;
+
+    int sorted = sortedSize();
+    if (count <= sorted)
+        return;
+
+    int rest = tosigned(indexes.size()) - sorted;
+    count = std::min(std::max(std::max(count - sorted, sorted), (int)LazySortSize), rest);
+
+    std::vector<int> list;
+    if (pending->def)
+        sortPendingData(pending->defdata, count, &Dictionary::defSortFunc, list);
+    else
+        sortPendingData(pending->jpdata, count, &Dictionary::jpSortFunc, list);
+
+    sortRange(sorted, list);
+
+    if (count == rest)
+        pending.reset();
+}
+
+int WordResultList::sortedSize() const
+{
+    if (!pending)
+        return tosigned(indexes.size());
+    return tosigned(indexes.size()) - tosigned(pending->def ? pending->defdata.size() : pending->jpdata.size());
+}
+
+void WordResultList::sortRange(int first, const std::vector<int> &list)
+{
+    std::vector<int> indextmp(indexes.begin() + first, indexes.end());
+    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
+        indexes[first + ix] = indextmp[list[ix]];
+
+    if (tosigned(infs.size()) <= first)
+        return;
+
+    std::vector<std::vector<InfTypes>*> inftmp;
+    infs.swap(inftmp);
+    inftmp.resize(indexes.size(), nullptr);
+
+    std::vector<std::vector<InfTypes>*> rangetmp(inftmp.begin() + first, inftmp.end());
+    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
+        inftmp[first + ix] = rangetmp[list[ix]];
+
+    infs.swap(inftmp);
+}
+
 void WordResultList::removeAt(int ix)
 {
+    if (pending)
+    {
+        int sorted = sortedSize();
+        if (ix >= sorted)
+        {
+            if (pending->def)
+                pending->defdata.erase(pending->defdata.begin() + (ix - sorted));
+            else
+                pending->jpdata.erase(pending->jpdata.begin() + (ix - sorted));
+        }
+    }
+
     indexes.erase(indexes.begin() + ix);
     if (tosigned(infs.size()) > ix)
         infs.erase(infs.begin() + ix);
+
+    if (pending && sortedSize() == tosigned(indexes.size()))
+        pending.reset();
 }
 
 void WordResultList::insert(int pos, int wordindex)
 {
+    sortTo(tosigned(indexes.size()));
+
     indexes.insert(indexes.begin() + pos, wordindex);
     if (tosigned(infs.size()) > pos)
         infs.insert(infs.begin() + pos, nullptr);
@@ -1549,6 +1879,8 @@ void WordResultList::insert(int pos, int wordindex, const std::vector<InfTypes>
         return;
     }
 
+    sortTo(tosigned(indexes.size()));
+
     indexes.insert(indexes.begin() + pos, wordindex);
 
     if (tosigned(infs.size()) < pos)
@@ -1565,6 +1897,7 @@ void WordResultList::reserve(int newreserve, bool infs_too)
 
 void WordResultList::add(int wordindex)
 {
+    sortTo(tosigned(indexes.size()));
     indexes.push_back(wordindex);
 }
 
@@ -1576,6 +1909,8 @@ void WordResultList::add(int wordindex, const std::vector<InfTypes> &inf)
         return;
     }
 
+    sortTo(tosigned(indexes.size()));
+
     // Items in infs should line up with items in indexes. Infs are not added
     // unnecessarily but when one is added, we have to pad the infs vector
     // with null up to the new inflection.
@@ -1640,7 +1975,7 @@ void TextSearchTree::copy(TextSearchTree *src)
 //}
 
                                
-void TextSearchTree::findWords(std::vector<int> &result, QString search, bool exact, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize) 
+void TextSearchTree::findWords(std::vector<int> &result, QString search, bool exact, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize, const std::atomic<bool> *cancel)
 {
     // When changing this: update wordMatches() as well.
 
@@ -1673,22 +2008,22 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
 
         QString match;
 
-        TextNode *selected = nullptr;
-        TextNode *n = nullptr;
+        NodeRef selected;
+        NodeRef n;
 
         //int contained = std::numeric_limits<int>::max();
         while (tokens.next())
         {
-            findContainer(tokens.token(), tokens.tokenSize(), n);
+            findNode(tokens.token(), tokens.tokenSize(), n);
 
-            if (n && (!selected || n->sum < selected->sum))
+            if (!n.isNull() && (selected.isNull() || nodeSum(n) < nodeSum(selected)))
             {
                 selected = n;
                 match = QString(tokens.token(), tokens.tokenSize());
             }
         }
 
-        if (selected == nullptr)
+        if (selected.isNull())
             return;
 
         if (!sameform)
@@ -1696,10 +2031,8 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
 
         // Every meaning of the possible results are checked for a match with the search string.
 
-        std::vector<int> lines = selected->lines;
-
-        if (!exact)
-            selected->nodes.collectLines(lines, match.constData(), match.size());
+        std::vector<int> lines;
+        nodeLines(selected, lines, !exact, match.constData(), match.size());
 
         // Lines now contains lots of words which can be duplicates too. Those must be removed.
         std::sort(lines.begin(), lines.end(), [this](int a, int b) { return wordForLine(a) < wordForLine(b); });
@@ -1708,6 +2041,9 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
 
         for (int ix = uit - lines.begin() - 1; ix != -1; --ix)
         {
+            if (cancel != nullptr && (ix % 1024) == 0 && cancel->load(std::memory_order_relaxed))
+                return;
+
             if (wordpool != nullptr)
             {
                 // Skip words not in the word filter.
@@ -1737,6 +2073,10 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
             int line = lines[ix];
             int windex = wordForLine(lines[ix]);
 
+            // Removed words stay in the tree until the dictionary is compacted.
+            if (dict->isEntryRemoved(windex))
+                continue;
+
             if (conditions != nullptr)
             {
                 const WordEntry *w = dict->wordEntry(windex);
@@ -1779,16 +2119,14 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
     if (reversed)
         std::reverse(romaji.begin(), romaji.end());
 
-    TextNode *node;
-    findContainer(romaji.constData(), romaji.size(), node);
+    NodeRef node;
+    findNode(romaji.constData(), romaji.size(), node);
 
-    if (!node)
+    if (node.isNull())
         return;
 
-    std::vector<int> lines = node->lines;
-
-    if (!exact)
-        node->nodes.collectLines(lines, romaji.constData(), romaji.size());
+    std::vector<int> lines;
+    nodeLines(node, lines, !exact, romaji.constData(), romaji.size());
 
     if (reversed)
         std::reverse(romaji.begin(), romaji.end());
@@ -1810,6 +2148,9 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
 
     for (int ix = uit - lines.begin() - 1; ix != -1; --ix)
     {
+        if (cancel != nullptr && (ix % 1024) == 0 && cancel->load(std::memory_order_relaxed))
+            return;
+
         if (wordpool != nullptr)
         {
             int line = lines[ix];
@@ -1837,6 +2178,8 @@ void TextSearchTree::findWords(std::vector<int> &result, QString search, bool ex
         }
 
         int windex = lines[ix];
+        if (dict->isEntryRemoved(windex))
+            continue;
 
         WordEntry *w = dict->wordEntry(windex);
         if (conditions != nullptr)
@@ -2154,7 +2497,7 @@ void StudyDefinitionTree::copy(StudyDefinitionTree *src)
     list = src->list;
 }
 
-void StudyDefinitionTree::applyChanges(std::map<int, int> &changes)
+void StudyDefinitionTree::applyChanges(const std::vector<int> &changes)
 {
     std::set<int> found;
     int delcnt = 0;
@@ -2190,21 +2533,20 @@ void StudyDefinitionTree::applyChanges(std::map<int, int> &changes)
 void StudyDefinitionTree::processRemovedWord(int windex)
 {
     auto it = wordIt(windex);
-    int pos = it - list.begin();
-
-    // The list is ordered by word indexes. Any item starting at pos will be equal or greater
-    // than windex.
-    for (int ix = pos, siz = tosigned(list.size()); ix != siz; ++ix)
-        --list[ix].first;
-
-    // The item's value at it was decremented above, so matching windex - 1 instead of windex.
-    if (it == list.end() || it->first != windex - 1)
+    if (it == list.end() || it->first != windex)
         return;
 
-    removeLine(pos, true);
+    removeLine(it - list.begin(), true);
     list.erase(it);
 }
 
+void StudyDefinitionTree::processCompactedWords(const std::vector<int> &changes)
+{
+    // The lines in the tree are positions in list, which don't change.
+    for (auto &item : list)
+        item.first = changes[item.first];
+}
+
 StudyDefinitionTree::size_type StudyDefinitionTree::size() const
 {
     return list.size();
@@ -2792,7 +3134,7 @@ void WordExamplesTree::linkExample(const QChar *kanji, const QChar *kana, int ex
         list.push_back(wex);
         doExpand(tosigned(list.size()) - 1);
 
-        ZKanji::dictionary(0)->setToUserModified();
+        ZKanji::dictionary(0)->setToUserModified(Dictionary::UserData::Words);
         return;
     }
 
@@ -2812,7 +3154,7 @@ void WordExamplesTree::linkExample(const QChar *kanji, const QChar *kana, int ex
     if (match == set)
         return;
 
-    ZKanji::dictionary(0)->setToUserModified();
+    ZKanji::dictionary(0)->setToUserModified(Dictionary::UserData::Words);
 
     if (set)
     {
@@ -2890,7 +3232,7 @@ int WordExamplesTree::findWordIndex(const QChar *kanji, const QChar *kana, const
 //-------------------------------------------------------------
 
 
-Dictionary::Dictionary() : mod(false), usermod(false), dtree(this, false, false), ktree(this, true, false), btree(this, true, true), wordstudydefs(this), studydecks(new StudyDeckList)
+Dictionary::Dictionary() : mod(false), removedcnt(0), usermod(false), freezequeued(false), wordindex(words), dtree(this, false, false), ktree(this, true, false), btree(this, true, true), wordstudydefs(this), studydecks(new StudyDeckList)
 {
     groups = new Groups(this);
 
@@ -2906,16 +3248,21 @@ Dictionary::Dictionary() : mod(false), usermod(false), dtree(this, false, false)
 }
 
 Dictionary::Dictionary(smartvector<WordEntry> &&words, TextSearchTree &&dtree, TextSearchTree &&ktree, TextSearchTree &&btree,
-    smartvector<KanjiDictData> &&kanjidata, std::map<ushort, std::vector<int>> &&symdata, std::map<ushort, std::vector<int>> &&kanadata,
-    std::vector<int> &&abcde, std::vector<int> &&aiueo) : words(std::move(words)), dtree(this, std::move(dtree)), ktree(this, std::move(ktree)), btree(this, std::move(btree)),
+    smartvector<KanjiDictData> &&kanjidata, std::map<ushort, PostingList> &&symdata, std::map<ushort, PostingList> &&kanadata,
+    std::vector<int> &&abcde, std::vector<int> &&aiueo) : removedcnt(0), freezequeued(false), words(std::move(words)), wordindex(this->words), dtree(this, std::move(dtree)), ktree(this, std::move(ktree)), btree(this, std::move(btree)),
     kanjidata(std::move(kanjidata)), symdata(std::move(symdata)), kanadata(std::move(kanadata)), abcde(std::move(abcde)), aiueo(std::move(aiueo)), wordstudydefs(this), studydecks(new StudyDeckList)
 {
     groups = new Groups(this);
     decks = new WordDeckList(this);
+
+    freezeTrees();
 }
 
 Dictionary::~Dictionary()
 {
+    // Searches running on other threads might still use the dictionary.
+    ZKanji::stopBackgroundSearches();
+
     delete groups;
     delete decks;
     studydecks.release();
@@ -3085,6 +3432,11 @@ void Dictionary::loadBase(QDataStream &stream)
         //stream >> k->irreg;
         stream >> k->nam;
         stream >> k->meanings;
+
+        k->on.moveToArena(ZKanji::kanjistrings);
+        k->kun.moveToArena(ZKanji::kanjistrings);
+        k->nam.moveToArena(ZKanji::kanjistrings);
+        k->meanings.moveToArena(ZKanji::kanjistrings);
     }
 
     ZKanji::generateValidKanji();
@@ -3120,6 +3472,8 @@ void Dictionary::loadBase(QDataStream &stream)
 
 void Dictionary::loadFile(const QString &filename, bool maindict, bool skiporiginals)
 {
+    ZKanji::stopBackgroundSearches();
+
     QFile f(filename);
 
     setName(QFileInfo(filename).baseName());
@@ -3153,6 +3507,8 @@ void Dictionary::loadFile(const QString &filename, bool maindict, bool skiporigi
     else
         load(stream);
 
+    freezeTrees();
+
     quint32 u32;
     stream >> u32;
     if (u32 != f.pos())
@@ -3178,6 +3534,12 @@ void Dictionary::load(QDataStream &stream)
 
     stream >> make_zstr(info);
 
+    if (version >= 2)
+    {
+        loadFlat(stream, version);
+        return;
+    }
+
     quint32 cnt;
 
     // Read the dictionary words.
@@ -3237,8 +3599,13 @@ void Dictionary::load(QDataStream &stream)
                 stream >> u16;
                 d.attrib.dialects = u16;
             }
+            d.def.moveToArena(strings);
         }
 
+        w->kanji.moveToArena(strings);
+        w->kana.moveToArena(strings);
+        w->romaji.moveToArena(strings);
+
         words.push_back(w);
     }
 
@@ -3284,7 +3651,10 @@ void Dictionary::load(QDataStream &stream)
         {
             KanjiDictData *kd = kanjidata[ix + kfirst];
 
-            dstream >> make_zvec<qint32, qint32>(kd->words);
+            std::vector<int> kwords;
+            dstream >> make_zvec<qint32, qint32>(kwords);
+            for (int w : kwords)
+                kd->words.push_back(w);
         }
         dstream >> kfirst;
     }
@@ -3303,12 +3673,11 @@ void Dictionary::load(QDataStream &stream)
     {
         dstream >> u16;
         dstream >> u32;
-        std::vector<int> &dat = symdata[u16];
-        dat.resize(u32);
-        for (int iy = 0, sizy = tosigned(dat.size()); iy != sizy; ++iy)
+        PostingList &dat = symdata[u16];
+        for (int iy = 0, sizy = tosigned(u32); iy != sizy; ++iy)
         {
             dstream >> u32;
-            dat[iy] = u32;
+            dat.push_back(u32);
         }
     }
 
@@ -3320,12 +3689,11 @@ void Dictionary::load(QDataStream &stream)
     {
         dstream >> u16;
         dstream >> u32;
-        std::vector<int> &dat = kanadata[u16];
-        dat.resize(u32);
-        for (int iy = 0, sizy = tosigned(dat.size()); iy != sizy; ++iy)
+        PostingList &dat = kanadata[u16];
+        for (int iy = 0, sizy = tosigned(u32); iy != sizy; ++iy)
         {
             dstream >> u32;
-            dat[iy] = u32;
+            dat.push_back(u32);
         }
     }
 
@@ -3364,74 +3732,291 @@ void Dictionary::load(QDataStream &stream)
 #endif
 }
 
-void Dictionary::loadUserDataFile(const QString &filename, bool emitreset)
+// Sets str to the string at offset in the flat string pool copied to an arena.
+static void flatString(QCharString &str, QChar *pool, quint32 poolsize, quint32 offset)
 {
-    QFile f(filename);
-
-    if (!f.open(QIODevice::ReadOnly))
-        return;
+    if (offset >= poolsize)
+        throw ZException("Invalid or corrupted dictionary file.");
 
-    QDataStream stream(&f);
-    stream.setVersion(QDataStream::Qt_5_5);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    if (pool[offset].unicode() == 0)
+        str.clear();
+    else if (pool[offset - 1].unicode() != 0)
+        throw ZException("Invalid or corrupted dictionary file.");
+    else
+        str.setArenaData(pool + offset);
+}
 
-    char tmp[7];
-    stream.readRawData(tmp, 6);
-    tmp[6] = 0;
+// Reads lists of word indexes written by saveFlatWordLists(). The lists are returned by
+// listForKey for each key found in the data. Files before version 4 hold the lists as
+// uncompressed arrays. Every index must be smaller than wordcnt.
+static void loadFlatWordLists(FlatReader &reader, int version, int wordcnt, const std::function<PostingList&(quint32)> &listForKey)
+{
+    quint32 cnt = reader.read<quint32>();
+    if ((qint64)cnt * 8 > reader.remaining())
+        throw ZException("Invalid or corrupted dictionary file.");
 
-    bool good = !strncmp("zgf", tmp, 3);
-    bool oldversion = good;
+    std::vector<quint32> keys(cnt);
+    std::vector<quint32> sizes(cnt);
+    reader.readArray(keys.data(), cnt);
+    reader.readArray(sizes.data(), cnt);
 
-    if (!oldversion)
-        good = !strncmp("zud", tmp, 3);
+    if (version < 4)
+    {
+        std::vector<int> vals;
+        for (int ix = 0, siz = tosigned(cnt); ix != siz; ++ix)
+        {
+            if ((qint64)sizes[ix] * 4 > reader.remaining())
+                throw ZException("Invalid or corrupted dictionary file.");
+            vals.resize(sizes[ix]);
+            reader.readArray(vals.data(), vals.size());
 
-    int version = strtol(tmp + 3, 0, 10);
+            PostingList &list = listForKey(keys[ix]);
+            for (int iy = 0, sizy = tosigned(vals.size()); iy != sizy; ++iy)
+            {
+                if (vals[iy] < 0 || vals[iy] >= wordcnt || (iy != 0 && vals[iy] <= vals[iy - 1]))
+                    throw ZException("Invalid or corrupted dictionary file.");
+                list.push_back(vals[iy]);
+            }
+        }
+        return;
+    }
 
-    if (!good || (oldversion && version < 20))
-        throw ZException("Invalid or corrupted user file version.");
+    if ((qint64)cnt * 4 > reader.remaining())
+        throw ZException("Invalid or corrupted dictionary file.");
+    std::vector<quint32> bytesizes(cnt);
+    reader.readArray(bytesizes.data(), cnt);
 
-    if (oldversion)
+    for (int ix = 0, siz = tosigned(cnt); ix != siz; ++ix)
     {
-        // The meanings for kanji was specified in the dictionary in old data files, but it
-        // was moved to the user data in newer versions (after 2015). The clear would remove
-        // the meanings loaded already from the legacy format, so those must be saved before
-        // the clear.
+        const uchar *data = reader.skip(bytesizes[ix]);
+        PostingList &list = listForKey(keys[ix]);
+        if (!list.setEncoded((int)sizes[ix], data, (int)bytesizes[ix]) || (!list.empty() && list.back() >= wordcnt))
+            throw ZException("Invalid or corrupted dictionary file.");
+    }
+    reader.align(4);
+}
 
-        std::map<int, QCharStringList> meanings;
-        for (int ix = 0, siz = tosigned(kanjidata.size()); ix != siz; ++ix)
-            if (!kanjidata[ix]->meanings.empty())
-                meanings[ix] = std::move(kanjidata[ix]->meanings);
-        clearUserData();
-        for (auto it = meanings.begin(); it != meanings.end(); ++it)
-            kanjidata[it->first]->meanings = std::move(it->second);
+// Writes lists of word indexes in the flat format. The number of lists comes first, then the
+// keys of every list, their sizes and the size of their encoded data in bytes, followed by
+// the encoded data of the lists.
+static void saveFlatWordLists(FlatWriter &writer, const std::vector<std::pair<quint32, const PostingList*>> &lists)
+{
+    writer.write<quint32>((quint32)lists.size());
+    for (const auto &p : lists)
+        writer.write<quint32>(p.first);
+    for (const auto &p : lists)
+        writer.write<quint32>((quint32)p.second->size());
+    for (const auto &p : lists)
+        writer.write<quint32>((quint32)p.second->encoded().size());
+    for (const auto &p : lists)
+        writer.writeArray(p.second->encoded().data(), p.second->encoded().size());
+    writer.align(4);
+}
 
-        loadUserDataLegacy(stream, version);
+void Dictionary::loadFlat(QDataStream &stream, int version)
+{
+    QIODevice *dev = stream.device();
+    QFile *f = qobject_cast<QFile*>(dev);
 
-        usermod = false;
-        emit userDataModified(false);
-    }
-    else
+    // The data is bulk loaded from the memory mapped file. If the file can't be mapped, its
+    // contents are read in memory instead. Everything is copied to the dictionary, so the
+    // mapping is released at the end and the file can be saved over later.
+    uchar *mapped = f != nullptr ? f->map(0, f->size()) : nullptr;
+
+    QByteArray filedata;
+    const uchar *data = mapped;
+    qint64 datasize = dev->size();
+    if (mapped == nullptr)
     {
-        clearUserData();
-        loadUserData(stream, version);
+        qint64 pos = dev->pos();
+        dev->seek(0);
+        filedata = dev->readAll();
+        dev->seek(pos);
+        data = (const uchar*)filedata.constData();
+        datasize = filedata.size();
+    }
 
-        if (version == 2)
-        {
-            studydecks->fixStats();
-            setToUserModified();
-        }
-        else
+#if TIMED_LOAD == 1
+    QElapsedTimer t;
+    t.start();
+#endif
+
+    FlatReader reader(data, datasize, dev->pos());
+    reader.align(4);
+
+    quint32 cnt = reader.read<quint32>();
+
+    quint32 poolsize;
+    const QChar *filepool = FlatStringPool::read(reader, poolsize);
+    // The strings of the words point into a single copy of the pool in the arena.
+    QChar *pool = strings.add(filepool, poolsize);
+
+    // Every word record is at least 16 bytes long.
+    if ((qint64)cnt * 16 > reader.remaining())
+        throw ZException("Invalid or corrupted dictionary file.");
+
+    words.reserve(cnt);
+    while (cnt--)
+    {
+        WordEntry *w = new WordEntry;
+        words.push_back(w);
+
+        flatString(w->kanji, pool, poolsize, reader.read<quint32>());
+        flatString(w->kana, pool, poolsize, reader.read<quint32>());
+        flatString(w->romaji, pool, poolsize, reader.read<quint32>());
+
+        w->freq = reader.read<quint16>();
+        w->inf = reader.read<quint8>();
+
+        w->defs.resize(reader.read<quint8>());
+        for (int iy = 0, sizy = tosigned(w->defs.size()); iy != sizy; ++iy)
+        {
+            WordDefinition &d = w->defs[iy];
+            flatString(d.def, pool, poolsize, reader.read<quint32>());
+            d.attrib.types = reader.read<quint32>();
+            d.attrib.notes = reader.read<quint32>();
+            d.attrib.fields = reader.read<quint32>();
+            d.attrib.dialects = reader.read<quint16>();
+            // Padding.
+            reader.read<quint16>();
+        }
+    }
+
+#if TIMED_LOAD == 1
+    qint64 t1 = t.nsecsElapsed();
+    t.invalidate();
+    t.start();
+#endif
+
+    dtree.loadFlat(reader, version);
+    ktree.loadFlat(reader, version);
+    btree.loadFlat(reader, version);
+
+#if TIMED_LOAD == 1
+    qint64 t2 = t.nsecsElapsed();
+    t.invalidate();
+    t.start();
+#endif
+
+    kanjidata.clear();
+    kanjidata.resize(ZKanji::kanjis.size(), KanjiDictData());
+
+    loadFlatWordLists(reader, version, tosigned(words.size()), [this](quint32 key) -> PostingList& {
+        if (key >= kanjidata.size())
+            throw ZException("Invalid or corrupted dictionary file.");
+        return kanjidata[key]->words;
+    });
+    loadFlatWordLists(reader, version, tosigned(words.size()), [this](quint32 key) -> PostingList& { return symdata[(ushort)key]; });
+    loadFlatWordLists(reader, version, tosigned(words.size()), [this](quint32 key) -> PostingList& { return kanadata[(ushort)key]; });
+
+#if TIMED_LOAD == 1
+    qint64 t3 = t.nsecsElapsed();
+    t.invalidate();
+    t.start();
+#endif
+
+    abcde.resize(words.size());
+    aiueo.resize(words.size());
+    reader.readArray(abcde.data(), abcde.size());
+    reader.readArray(aiueo.data(), aiueo.size());
+    for (int ix = 0, siz = tosigned(words.size()); ix != siz; ++ix)
+        if (abcde[ix] < 0 || abcde[ix] >= siz || aiueo[ix] < 0 || aiueo[ix] >= siz)
+            throw ZException("Invalid or corrupted dictionary file.");
+
+    quint32 flagsize = reader.read<quint32>();
+    if (flagsize != 0)
+    {
+        QByteArray arr((const char*)reader.skip(flagsize), flagsize);
+        ZKanji::assignDictionaryFlag(arr, dictname);
+    }
+
+    dev->seek(reader.pos());
+    if (mapped != nullptr)
+        f->unmap(mapped);
+
+#if TIMED_LOAD == 1
+    qint64 t4 = t.nsecsElapsed();
+    t.invalidate();
+
+    QMessageBox::information(nullptr, "zkanji", QString("Data: %1\n%2\n%3\n%4").arg(t1).arg(t2).arg(t3).arg(t4), QMessageBox::Ok);
+#endif
+}
+
+void Dictionary::loadUserDataFile(const QString &filename, bool emitreset)
+{
+    ZKanji::stopBackgroundSearches();
+
+    QFile f(filename);
+
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    char tmp[7];
+    stream.readRawData(tmp, 6);
+    tmp[6] = 0;
+
+    bool good = !strncmp("zgf", tmp, 3);
+    bool oldversion = good;
+
+    if (!oldversion)
+        good = !strncmp("zud", tmp, 3);
+
+    int version = strtol(tmp + 3, 0, 10);
+
+    if (!good || (oldversion && version < 20))
+        throw ZException("Invalid or corrupted user file version.");
+
+    if (oldversion)
+    {
+        // The meanings for kanji was specified in the dictionary in old data files, but it
+        // was moved to the user data in newer versions (after 2015). The clear would remove
+        // the meanings loaded already from the legacy format, so those must be saved before
+        // the clear.
+
+        std::map<int, QCharStringList> meanings;
+        for (int ix = 0, siz = tosigned(kanjidata.size()); ix != siz; ++ix)
+            if (!kanjidata[ix]->meanings.empty())
+                meanings[ix] = std::move(kanjidata[ix]->meanings);
+        clearUserData();
+        for (auto it = meanings.begin(); it != meanings.end(); ++it)
+            kanjidata[it->first]->meanings = std::move(it->second);
+
+        loadUserDataLegacy(stream, version);
+
+        usermod = false;
+        userops.clear();
+        emit userDataModified(false);
+    }
+    else
+    {
+        clearUserData();
+        loadUserData(stream, version, userDataJournalName(filename));
+
+        if (version == 2)
+        {
+            studydecks->fixStats();
+            setToUserModified();
+        }
+        else
         {
             usermod = false;
+            userops.clear();
             emit userDataModified(false);
         }
     }
 
+    // Modified and added words of the main dictionary were restored above.
+    freezeTrees();
+
     if (emitreset)
         emit dictionaryReset();
 }
 
-void Dictionary::loadUserData(QDataStream &stream, int version)
+void Dictionary::loadUserData(QDataStream &stream, int version, const QString &journalname)
 {
     QDateTime dictdate;
     stream >> make_zdate(dictdate);
@@ -3439,19 +4024,91 @@ void Dictionary::loadUserData(QDataStream &stream, int version)
     if (dictdate != lastWriteDate())
         throw ZException("User date does not match dictionary date.");
 
-    quint8 b;
-    //qint8 c;
-    qint32 i;
-
 #if TIMED_LOAD == 1
     QElapsedTimer t;
     t.start();
+    QStringList times;
+#endif
+
+    if (version < 4)
+    {
+        for (UserData part : ZKANJI_USER_DATA_PARTS)
+        {
+            loadUserDataPart(stream, part, version);
+#if TIMED_LOAD == 1
+            times << QString::number(t.nsecsElapsed());
+            t.restart();
+#endif
+        }
+    }
+    else
+    {
+        qint64 stamp;
+        stream >> stamp;
+
+        std::map<UserData, QByteArray> journal;
+        std::vector<UserDataEdit> ops;
+        int jversion;
+        if (!journalname.isEmpty())
+            readUserDataJournal(journalname, stamp, jversion, &journal, &ops);
+
+        for (UserData part : ZKANJI_USER_DATA_PARTS)
+        {
+            qint32 size;
+            stream >> size;
+
+            auto it = journal.find(part);
+            if (it == journal.end())
+                loadUserDataPart(stream, part, version);
+            else
+            {
+                // The part was saved later in the journal.
+                stream.skipRawData(size);
+
+                QDataStream jstream(it->second);
+                jstream.setVersion(QDataStream::Qt_5_5);
+                jstream.setByteOrder(QDataStream::LittleEndian);
+                loadUserDataPart(jstream, part, version);
+            }
+#if TIMED_LOAD == 1
+            times << QString::number(t.nsecsElapsed());
+            t.restart();
+#endif
+        }
+
+        if (!ops.empty())
+        {
+            // The student profile was saved with the effects of the edits already, and it
+            // must not be changed when they are applied again.
+            StudentProfile profile = ZKanji::profile();
+            for (const UserDataEdit &e : ops)
+                applyUserDataOp(e.op, e.data);
+            ZKanji::profile() = profile;
+
+            userops.clear();
+        }
+    }
+
+#if TIMED_LOAD == 1
+    QMessageBox::information(nullptr, "zkanji", "User: " + times.join("\n"), QMessageBox::Ok);
 #endif
+}
+
+void Dictionary::loadUserDataPart(QDataStream &stream, UserData part, int version)
+{
+    quint8 b;
+    //qint8 c;
+    qint32 i;
 
-    // The value written was 1 for the main dictionary and 0 for other dictionaries.
-    stream >> b;
-    if (b == 1)
+    switch (part)
     {
+    case UserData::Words:
+    {
+        // The value written was 1 for the main dictionary and 0 for other dictionaries.
+        stream >> b;
+        if (b != 1)
+            break;
+
         // Originals loading. Instead of loading the originals list, loads the updated words
         // and modifies the dictionary with them. That in turn fills the originals list. When
         // not loading the base dictionary, the words are updated, but the originals list is
@@ -3511,72 +4168,230 @@ void Dictionary::loadUserData(QDataStream &stream, int version)
 
         if (version >= 2)
             ZKanji::wordexamples.load(stream);
+        break;
+    }
+    case UserData::Groups:
+        groups->load(stream);
+        break;
+    case UserData::Study:
+        decks->clear();
+        studydecks->load(stream, version);
+        decks->load(stream);
+        break;
+    case UserData::Definitions:
+        wordstudydefs.load(stream);
+        break;
+    case UserData::Kanji:
+    {
+        quint16 us = 1;
+        while (us != 0)
+        {
+            stream >> us;
+            quint16 ix = us;
+            stream >> us;
+            quint16 endix = ix + us;
+            while (ix != endix)
+            {
+                stream >> kanjidata[ix]->meanings;
+                stream >> make_zvec<qint32, qint32>(kanjidata[ix]->ex);
+                ++ix;
+            }
+        }
+        break;
     }
+    default:
+        break;
+    }
+}
 
-#if TIMED_LOAD == 1
-    qint64 t1 = t.nsecsElapsed();
-    t.invalidate();
-    t.start();
-#endif
+qint64 Dictionary::readUserDataJournal(const QString &journalname, qint64 stamp, int &version, std::map<UserData, QByteArray> *parts, std::vector<UserDataEdit> *ops)
+{
+    version = 0;
 
-    groups->load(stream);
+    QFile f(journalname);
+    if (!f.open(QIODevice::ReadOnly))
+        return 0;
 
-#if TIMED_LOAD == 1
-    qint64 t2 = t.nsecsElapsed();
-    t.invalidate();
-    t.start();
-#endif
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream.setByteOrder(QDataStream::LittleEndian);
 
-    decks->clear();
-    studydecks->load(stream, version);
+    char tmp[7];
+    tmp[6] = 0;
+    qint64 jstamp = 0;
+    if (stream.readRawData(tmp, 6) != 6 || strncmp("zuj", tmp, 3) != 0)
+        return 0;
+    version = strtol(tmp + 3, 0, 10);
+    if (version < 1 || version > 2)
+        return 0;
+    stream >> jstamp;
+    if (stream.status() != QDataStream::Ok || jstamp != stamp)
+        return 0;
+
+    qint64 validsize = f.pos();
+
+    // Each record is the size of its data, the data, and a checksum of the data. The data is
+    // a list of entries, each with its UserData value, its UserDataOp value or 0 for a whole
+    // part, and size. Version 1 journals only hold whole parts without the UserDataOp value.
+    while (!stream.atEnd())
+    {
+        qint32 size;
+        stream >> size;
+        if (stream.status() != QDataStream::Ok || size < 0 || size > f.size() - f.pos())
+            break;
 
-#if TIMED_LOAD == 1
-    qint64 t3 = t.nsecsElapsed();
-    t.invalidate();
-    t.start();
-#endif
+        QByteArray data(size, 0);
+        quint16 checksum;
+        if (stream.readRawData(data.data(), size) != size)
+            break;
+        stream >> checksum;
+        if (stream.status() != QDataStream::Ok || checksum != qChecksum(data))
+            break;
 
-    decks->load(stream);
+        validsize = f.pos();
+        if (parts == nullptr)
+            continue;
 
-#if TIMED_LOAD == 1
-    qint64 t4 = t.nsecsElapsed();
-    t.invalidate();
-    t.start();
-#endif
+        QDataStream dstream(data);
+        dstream.setVersion(QDataStream::Qt_5_5);
+        dstream.setByteOrder(QDataStream::LittleEndian);
+        while (!dstream.atEnd())
+        {
+            quint8 part;
+            quint8 op = 0;
+            qint32 psize;
+            dstream >> part;
+            if (version >= 2)
+                dstream >> op;
+            dstream >> psize;
+
+            QByteArray pdata(psize, 0);
+            dstream.readRawData(pdata.data(), psize);
+
+            if (op != 0)
+            {
+                ops->push_back({ (UserData)part, (UserDataOp)op, std::move(pdata) });
+                continue;
+            }
 
-    wordstudydefs.load(stream);
+            // Edits written before the whole part are already in its data.
+            ops->erase(std::remove_if(ops->begin(), ops->end(), [part](const UserDataEdit &e) { return (quint8)e.part == part; }), ops->end());
+            (*parts)[(UserData)part] = std::move(pdata);
+        }
+    }
 
-#if TIMED_LOAD == 1
-    qint64 t5 = t.nsecsElapsed();
-    t.invalidate();
-    t.start();
-#endif
+    return validsize;
+}
+
+void Dictionary::applyUserDataOp(UserDataOp op, const QByteArray &data)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream.setByteOrder(QDataStream::LittleEndian);
 
-    quint16 us = 1;
-    while (us != 0)
+    qint32 i;
+    qint64 i64;
+    quint8 b;
+
+    switch (op)
     {
-        stream >> us;
-        quint16 ix = us;
-        stream >> us;
-        quint16 endix = ix + us;
-        while (ix != endix)
+    case UserDataOp::DeckStartTest:
+    case UserDataOp::DeckNewItems:
+    case UserDataOp::DeckAnswer:
+    case UserDataOp::DeckReadingAnswered:
+    {
+        stream >> i;
+        if (i < 0 || i >= tosigned(decks->size()))
+            break;
+        WordDeck *deck = decks->items(i);
+
+        if (op == UserDataOp::DeckStartTest)
         {
-            stream >> kanjidata[ix]->meanings;
-            stream >> make_zvec<qint32, qint32>(kanjidata[ix]->ex);
-            ++ix;
+            stream >> i64;
+            deck->replayStartTest(QDateTime::fromMSecsSinceEpoch(i64, QTimeZone::utc()));
         }
-    }
+        else if (op == UserDataOp::DeckNewItems)
+        {
+            stream >> i;
+            deck->initNewStudy(i);
+        }
+        else if (op == UserDataOp::DeckAnswer)
+        {
+            qint32 freeindex;
+            qint32 lockedindex;
+            qint64 answertime;
+            stream >> freeindex >> lockedindex >> b >> answertime >> i64;
+            deck->replayAnswer(freeindex, lockedindex, (StudyCard::AnswerType)b, answertime, QDateTime::fromMSecsSinceEpoch(i64, QTimeZone::utc()));
+        }
+        else if (deck->readingsQueued() != 0)
+            deck->practiceReadingAnswered();
+        break;
+    }
+    case UserDataOp::GroupInsert:
+    case UserDataOp::GroupRemove:
+    case UserDataOp::GroupMove:
+    {
+        QString name;
+        stream >> b >> name;
+        KanjiGroup *kg = b != 0 ? kanjiGroups().groupFromEncodedName(name) : nullptr;
+        WordGroup *wg = b == 0 ? wordGroups().groupFromEncodedName(name) : nullptr;
+        if (kg == nullptr && wg == nullptr)
+            break;
 
-#if TIMED_LOAD == 1
-    qint64 t6 = t.nsecsElapsed();
-    t.invalidate();
+        if (op == UserDataOp::GroupInsert)
+        {
+            std::vector<int> indexes;
+            stream >> make_zvec<qint32, qint32>(indexes) >> i;
+            if (kg != nullptr)
+                kg->insert(std::vector<ushort>(indexes.begin(), indexes.end()), i, nullptr);
+            else
+                wg->insert(indexes, i, nullptr);
+            break;
+        }
 
-    QMessageBox::information(nullptr, "zkanji", QString("User: %1\n%2\n%3\n%4\n%5\n%6").arg(t1).arg(t2).arg(t3).arg(t4).arg(t5).arg(t6), QMessageBox::Ok);
-#endif
+        qint32 cnt;
+        stream >> cnt;
+        smartvector<Range> ranges;
+        ranges.reserve(cnt);
+        for (int ix = 0; ix != cnt; ++ix)
+        {
+            qint32 first;
+            qint32 last;
+            stream >> first >> last;
+            ranges.push_back(Range{ first, last });
+        }
+
+        if (op == UserDataOp::GroupRemove)
+        {
+            if (kg != nullptr)
+                kg->remove(ranges);
+            else
+                wg->remove(ranges);
+            break;
+        }
+
+        stream >> i;
+        if (kg != nullptr)
+            kg->move(ranges, i);
+        else
+            wg->move(ranges, i);
+        break;
+    }
+    case UserDataOp::StudyDefinition:
+    {
+        QString def;
+        stream >> i >> def;
+        if (i >= 0 && i < tosigned(words.size()))
+            wordstudydefs.setDefinition(i, def);
+        break;
+    }
+    }
 }
 
 void Dictionary::clearUserData()
 {
+    ZKanji::stopBackgroundSearches();
+
     if (this == ZKanji::dictionary(0))
     {
         // Restoring dictionary from originals.
@@ -3588,6 +4403,7 @@ void Dictionary::clearUserData()
             else
                 removeEntry(o->index);
         }
+        compactEntries();
     }
 
     groups->clear();
@@ -3600,6 +4416,8 @@ void Dictionary::clearUserData()
         kanjidata[ix]->ex.clear();
         kanjidata[ix]->meanings.clear();
     }
+
+    freezeTrees();
 }
 
 QDateTime Dictionary::fileWriteDate(const QString &filename)
@@ -3778,6 +4596,8 @@ Error Dictionary::saveBase(const QString &filename)
 
 Error Dictionary::save(const QString &filename)
 {
+    compactEntries();
+
     // To avoid compatibility problems later, Qt stream is only used for the simplest data
     // types.
 
@@ -3810,171 +4630,100 @@ Error Dictionary::save(const QString &filename)
 
         errorcode = 3;
 
-        stream << (quint32)words.size();
+        // The rest of the data is written in the flat format, which is bulk loaded from the
+        // memory mapped file.
+        FlatWriter writer(&f);
+        writer.align(4);
 
-        // Writing the words.
+        // Writing the words. Every string is placed in a single pool and the words only
+        // store their offsets.
+        FlatStringPool pool;
+        std::vector<quint32> offsets;
         for (int ix = 0, siz = tosigned(words.size()); ix != siz; ++ix)
         {
             WordEntry *w = words[ix];
+            offsets.push_back(pool.add(w->kanji.data()));
+            offsets.push_back(pool.add(w->kana.data()));
+            offsets.push_back(pool.add(w->romaji.data()));
+            for (int iy = 0, sizy = tosigned(w->defs.size()); iy != sizy; ++iy)
+                offsets.push_back(pool.add(w->defs[iy].def.data()));
+        }
 
-            stream << make_zstr(w->kanji, ZStrFormat::Byte);
-            stream << make_zstr(w->kana, ZStrFormat::Byte);
-            stream << make_zstr(w->romaji, ZStrFormat::Byte);
+        writer.write<quint32>((quint32)words.size());
+        pool.write(writer);
 
-            stream << (quint16)w->freq;
-            stream << (quint8)(w->inf & 0xff);
-            quint8 cnt = tounsigned<quint8>(w->defs.size());
-            stream << cnt;
-            for (int iy = 0; iy != cnt; ++iy)
-            {
-                const WordDefinition &d = w->defs[iy];
-                stream << make_zstr(d.def, ZStrFormat::Word);
+        int opos = 0;
+        for (int ix = 0, siz = tosigned(words.size()); ix != siz; ++ix)
+        {
+            WordEntry *w = words[ix];
+
+            writer.write<quint32>(offsets[opos++]);
+            writer.write<quint32>(offsets[opos++]);
+            writer.write<quint32>(offsets[opos++]);
 
-                quint8 which = 0;
-                if (d.attrib.types != 0)
-                    which |= 1;
-                if (d.attrib.notes != 0)
-                    which |= 2;
-                if (d.attrib.fields != 0)
-                    which |= 4;
-                if (d.attrib.dialects != 0)
-                    which |= 8;
-
-                stream << which;
-
-                if (d.attrib.types != 0)
-                    stream << (quint32)d.attrib.types;
-                if (d.attrib.notes != 0)
-                    stream << (quint32)d.attrib.notes;
-                if (d.attrib.fields != 0)
-                    stream << (quint32)d.attrib.fields;
-                if (d.attrib.dialects != 0)
-                    stream << (quint16)d.attrib.dialects;
+            writer.write<quint16>(w->freq);
+            writer.write<quint8>(w->inf & 0xff);
+            writer.write<quint8>(tounsigned<quint8>(w->defs.size()));
 
+            for (int iy = 0, sizy = tosigned(w->defs.size()); iy != sizy; ++iy)
+            {
+                const WordDefinition &d = w->defs[iy];
+                writer.write<quint32>(offsets[opos++]);
+                writer.write<quint32>(d.attrib.types);
+                writer.write<quint32>(d.attrib.notes);
+                writer.write<quint32>(d.attrib.fields);
+                writer.write<quint16>(d.attrib.dialects);
+                // Padding to keep the records aligned to 4 bytes.
+                writer.write<quint16>(0);
             }
         }
 
         errorcode = 4;
 
-        // Compress write the rest of the data.
-
-        QByteArray data;
-        QDataStream dstream(&data, QIODevice::WriteOnly);
-
-        dtree.save(dstream);
-        ktree.save(dstream);
-        btree.save(dstream);
+        dtree.saveFlat(writer);
+        ktree.saveFlat(writer);
+        btree.saveFlat(writer);
 
         errorcode = 5;
 
-        // Writing words using kanji. The data is written in blocks. Each block starts with
-        // the index of the first kanji in the block and the number of kanji in the block.
-        int kfirst = -1;
-        int kend = -1;
-        KanjiDictData *kd = nullptr;
-        for (int ix = 0, siz = tosigned(ZKanji::kanjis.size()); ix != siz + 1; ++ix)
-        {
-            if (ix != siz)
-            {
-                kd = kanjidata[ix];
-
-                // Until a kanji is found with data to save, we skip everything.
-                if (kd->words.empty())
-                {
-                    if (kfirst == -1)
-                        continue;
-
-                    kend = ix;
-                }
-                else if (kfirst != -1)
-                    continue;
-            }
-            else
-                kend = ix;
-
-            if (kfirst == -1)
-            {
-                // First kanji in block found.
-                kfirst = ix;
-                continue;
-            }
-
-            dstream << (quint16)kfirst;
-            dstream << (quint16)(kend - kfirst);
-
-            // Saving block between [kfirst, kend)
-            for (ix = kfirst; ix != kend; ++ix)
-            {
-                kd = kanjidata[ix];
-                dstream << make_zvec<qint32, qint32>(kd->words);
-            }
-            kfirst = -1;
-            kend = -1;
-        }
+        // Writing words using kanji, symbols and kana. Only non-empty lists are written.
+        std::vector<std::pair<quint32, const PostingList*>> lists;
+        for (int ix = 0, siz = tosigned(ZKanji::kanjis.size()); ix != siz; ++ix)
+            if (!kanjidata[ix]->words.empty())
+                lists.push_back(std::make_pair((quint32)ix, &kanjidata[ix]->words));
+        saveFlatWordLists(writer, lists);
 
         errorcode = 6;
 
-        // To mark the end of the kanadata blocks, the number of kanji is written. No block
-        // can start at that index.
-        dstream << (quint16)ZKanji::kanjis.size();
+        lists.clear();
+        for (const auto &syms : symdata)
+            lists.push_back(std::make_pair((quint32)syms.first, &syms.second));
+        saveFlatWordLists(writer, lists);
 
         errorcode = 7;
 
-        dstream << (quint16)symdata.size();
-        // Writing symdata and kanadata.
-        for (auto syms : symdata)
-        {
-            dstream << (quint16)syms.first;
-            dstream << (quint32)syms.second.size();
-            for (int ix = 0, siz = tosigned(syms.second.size()); ix != siz; ++ix)
-                dstream << (qint32)syms.second[ix];
-        }
+        lists.clear();
+        for (const auto &kds : kanadata)
+            lists.push_back(std::make_pair((quint32)kds.first, &kds.second));
+        saveFlatWordLists(writer, lists);
 
         errorcode = 8;
 
-        dstream << (quint8)kanadata.size();
-        for (auto kds : kanadata)
-        {
-            dstream << (quint16)kds.first;
-            dstream << (quint32)kds.second.size();
-            for (int ix = 0, siz = tosigned(kds.second.size()); ix != siz; ++ix)
-                dstream << (qint32)kds.second[ix];
-        }
-
-        errorcode = 9;
-
         assert(words.size() == abcde.size() && words.size() == aiueo.size());
 
         // Writing alphabetic and aiueo ordering. They have the same size as words.
-        for (int ix = 0, siz = tosigned(words.size()); ix != siz; ++ix)
-        {
-            dstream << (qint32)abcde[ix];
-            dstream << (qint32)aiueo[ix];
-        }
+        writer.writeArray(abcde.data(), abcde.size());
+        writer.writeArray(aiueo.data(), aiueo.size());
 
-        errorcode = 10;
-
-        // The dictionary flag SVG image data if present. This must come at the end of the
-        // uncompressed data, because it is missing for dictionaries with no image.
+        errorcode = 9;
 
+        // The dictionary flag SVG image data if present, or 0 for dictionaries with no image.
         QByteArray flagdata;
+        ZKanji::getCustomDictionaryFlag(dictname, flagdata);
+        writer.write<quint32>((quint32)flagdata.size());
+        writer.writeArray((const uchar*)flagdata.constData(), flagdata.size());
 
-        if (ZKanji::getCustomDictionaryFlag(dictname, flagdata))
-        {
-            // Writes quint32 array size, and the bytes after
-            dstream << flagdata;
-        }
-
-        errorcode = 11;
-
-        data = qCompress(data);
-
-        errorcode = 12;
-
-        stream << (quint32)data.size();
-        stream.writeRawData(data.data(), data.size());
-
-        errorcode = 13;
+        errorcode = 10;
 
         stream << (quint32)(f.pos() + 4);
 
@@ -3992,6 +4741,8 @@ Error Dictionary::save(const QString &filename)
 
 Error Dictionary::saveUserData(const QString &filename)
 {
+    compactEntries();
+
     QFile f(filename);
     if (!f.open(QIODevice::WriteOnly))
         return Error::Access;
@@ -4012,70 +4763,215 @@ Error Dictionary::saveUserData(const QString &filename)
         QDateTime lastwrite = lastWriteDate();
         stream << make_zdate(lastwrite);
 
+        // Identifies this save in the journal. Journals written with a different stamp are
+        // not applied to the file.
+        stream << (qint64)QDateTime::currentMSecsSinceEpoch();
+
         errorcode = 3;
 
-        // Writing the original words list, consisting of words modified in the base
-        // dictionary.
-        if (this == ZKanji::dictionary(0))
+        // Every part is written with its size in front, so it can be skipped when loading
+        // if a newer version is found in the journal.
+        for (UserData part : ZKANJI_USER_DATA_PARTS)
         {
-            stream << (quint8)1;
-            stream << (qint32)ZKanji::originals.size();
-            for (int ix = 0, siz = tosigned(ZKanji::originals.size()); ix != siz; ++ix)
-            {
-                stream << (quint8)ZKanji::originals.items(ix)->change;
-                stream << (qint32)ZKanji::originals.items(ix)->index;
+            QByteArray data;
+            QDataStream pstream(&data, QIODevice::WriteOnly);
+            pstream.setVersion(QDataStream::Qt_5_5);
+            pstream.setByteOrder(QDataStream::LittleEndian);
+            saveUserDataPart(pstream, part);
 
-                WordEntry *w = words[ZKanji::originals.items(ix)->index];
+            stream << (qint32)data.size();
+            stream.writeRawData(data.constData(), data.size());
 
-                stream << make_zstr(w->kanji, ZStrFormat::Byte);
-                stream << make_zstr(w->kana, ZStrFormat::Byte);
-                stream << make_zstr(w->romaji, ZStrFormat::Byte);
+            ++errorcode;
+        }
+    }
+    catch (...)
+    {
+        return Error(Error::Write, errorcode);
+    }
 
-                stream << (uint16_t)w->freq;
-                stream << (uint8_t)(w->inf & 0xff);
+    f.close();
+    if (f.error() != QFileDevice::NoError)
+        return Error(Error::Write, errorcode);
 
-                uint8_t cnt = tounsigned<uint8_t>(w->defs.size());
-                stream << cnt;
-                for (int iy = 0; iy != cnt; ++iy)
-                {
-                    const WordDefinition &d = w->defs[iy];
-                    stream << make_zstr(d.def, ZStrFormat::Word);
-                    stream << (uint32_t)d.attrib.types;
-                    stream << (uint32_t)d.attrib.notes;
-                    stream << (uint32_t)d.attrib.fields;
-                    stream << (uint16_t)d.attrib.dialects;
-                }
-            }
+    // The journal's changes are all in the new file.
+    QFile::remove(userDataJournalName(filename));
 
-            ZKanji::wordexamples.save(stream);
+    // Update modified status.
+    usermod = false;
+    userops.clear();
+    emit userDataModified(false);
+
+    return true;
+}
+
+Error Dictionary::saveUserDataJournal(const QString &filename)
+{
+    compactEntries();
+
+    if (usermod == 0 && userops.empty())
+        return true;
+
+    // Reading the stamp of the saved file to check that the journal belongs to it.
+    qint64 stamp = 0;
+    qint64 filesize = 0;
+    QFile f(filename);
+    if (f.open(QIODevice::ReadOnly))
+    {
+        filesize = f.size();
+
+        QDataStream stream(&f);
+        stream.setVersion(QDataStream::Qt_5_5);
+        stream.setByteOrder(QDataStream::LittleEndian);
+
+        char tmp[7];
+        tmp[6] = 0;
+        QDateTime dictdate;
+        if (stream.readRawData(tmp, 6) == 6 && !strncmp("zud", tmp, 3) && strtol(tmp + 3, 0, 10) >= 4)
+        {
+            stream >> make_zdate(dictdate);
+            if (dictdate == lastWriteDate())
+                stream >> stamp;
+            if (stream.status() != QDataStream::Ok)
+                stamp = 0;
         }
-        else
-            stream << (quint8)0;
+        f.close();
+    }
 
-        errorcode = 4;
+    QString journalname = userDataJournalName(filename);
+    int jversion = 0;
+    qint64 validsize = stamp == 0 ? 0 : readUserDataJournal(journalname, stamp, jversion, nullptr, nullptr);
 
-        groups->save(stream);
+    // The whole file is saved when the journal can't be used, it's grown larger than the
+    // file, or it was written in an older format. This also deletes the journal.
+    if (stamp == 0 || validsize > filesize || (validsize != 0 && jversion != 2))
+        return saveUserData(filename);
 
-        errorcode = 5;
+    QFile jf(journalname);
+    if (!jf.open(QIODevice::ReadWrite))
+        return Error::Access;
 
-        // Student data must be saved before anything else which uses the spaced
-        // repetition system.
-        studydecks->save(stream);
+    // Anything after the last full record was left by an interrupted write.
+    if (!jf.resize(validsize) || !jf.seek(validsize))
+        return Error::Access;
 
-        errorcode = 6;
+    QDataStream stream(&jf);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream.setByteOrder(QDataStream::LittleEndian);
 
-        decks->save(stream);
+    if (validsize == 0)
+    {
+        stream.writeRawData("zuj002", 6);
+        stream << stamp;
+    }
 
-        errorcode = 7;
+    QByteArray data;
+    QDataStream dstream(&data, QIODevice::WriteOnly);
+    dstream.setVersion(QDataStream::Qt_5_5);
+    dstream.setByteOrder(QDataStream::LittleEndian);
+    for (UserData part : ZKANJI_USER_DATA_PARTS)
+    {
+        if ((usermod & (uchar)part) == 0)
+            continue;
 
-        wordstudydefs.save(stream);
+        QByteArray pdata;
+        QDataStream pstream(&pdata, QIODevice::WriteOnly);
+        pstream.setVersion(QDataStream::Qt_5_5);
+        pstream.setByteOrder(QDataStream::LittleEndian);
+        saveUserDataPart(pstream, part);
 
-        errorcode = 8;
+        dstream << (quint8)part << (quint8)0 << (qint32)pdata.size();
+        dstream.writeRawData(pdata.constData(), pdata.size());
+    }
+
+    // Edits of parts that were not written whole above.
+    for (const UserDataEdit &e : userops)
+    {
+        dstream << (quint8)e.part << (quint8)e.op << (qint32)e.data.size();
+        dstream.writeRawData(e.data.constData(), e.data.size());
+    }
+
+    stream << (qint32)data.size();
+    stream.writeRawData(data.constData(), data.size());
+    stream << (quint16)qChecksum(data);
+
+    jf.close();
+    if (stream.status() != QDataStream::Ok || jf.error() != QFileDevice::NoError)
+        return Error(Error::Write);
+
+    usermod = false;
+    userops.clear();
+    emit userDataModified(false);
+
+    return true;
+}
+
+QString Dictionary::userDataJournalName(const QString &filename)
+{
+    return filename + QStringLiteral(".journal");
+}
+
+void Dictionary::saveUserDataPart(QDataStream &stream, UserData part) const
+{
+    switch (part)
+    {
+    case UserData::Words:
+        // Writing the original words list, consisting of words modified in the base
+        // dictionary.
+        if (this != ZKanji::dictionary(0))
+        {
+            stream << (quint8)0;
+            break;
+        }
+
+        stream << (quint8)1;
+        stream << (qint32)ZKanji::originals.size();
+        for (int ix = 0, siz = tosigned(ZKanji::originals.size()); ix != siz; ++ix)
+        {
+            stream << (quint8)ZKanji::originals.items(ix)->change;
+            stream << (qint32)ZKanji::originals.items(ix)->index;
+
+            WordEntry *w = words[ZKanji::originals.items(ix)->index];
+
+            stream << make_zstr(w->kanji, ZStrFormat::Byte);
+            stream << make_zstr(w->kana, ZStrFormat::Byte);
+            stream << make_zstr(w->romaji, ZStrFormat::Byte);
+
+            stream << (uint16_t)w->freq;
+            stream << (uint8_t)(w->inf & 0xff);
+
+            uint8_t cnt = tounsigned<uint8_t>(w->defs.size());
+            stream << cnt;
+            for (int iy = 0; iy != cnt; ++iy)
+            {
+                const WordDefinition &d = w->defs[iy];
+                stream << make_zstr(d.def, ZStrFormat::Word);
+                stream << (uint32_t)d.attrib.types;
+                stream << (uint32_t)d.attrib.notes;
+                stream << (uint32_t)d.attrib.fields;
+                stream << (uint16_t)d.attrib.dialects;
+            }
+        }
 
-        // Save a sparse list of kanji data. Only those are saved which have examples or a custom
-        // meaning. The data is saved in blocks. Each block starts with the kanji index (16bit
-        // ushort) and number of kanji in the block (16bit ushort). Writes a 0 length block after
-        // the last one. (The kanji index is not important.)
+        ZKanji::wordexamples.save(stream);
+        break;
+    case UserData::Groups:
+        groups->save(stream);
+        break;
+    case UserData::Study:
+        // Student data must be saved before anything else which uses the spaced
+        // repetition system.
+        studydecks->save(stream);
+        decks->save(stream);
+        break;
+    case UserData::Definitions:
+        wordstudydefs.save(stream);
+        break;
+    case UserData::Kanji:
+        // Save a sparse list of kanji data. Only those are saved which have examples or a
+        // custom meaning. The data is saved in blocks. Each block starts with the kanji index
+        // (16bit ushort) and number of kanji in the block (16bit ushort). Writes a 0 length
+        // block after the last one. (The kanji index is not important.)
         for (int ix = 0, siz = tosigned(kanjidata.size()); ix != siz; ++ix)
         {
             if (kanjidata[ix]->ex.empty() && kanjidata[ix]->meanings.empty())
@@ -4101,20 +4997,11 @@ Error Dictionary::saveUserData(const QString &filename)
                 break;
         }
 
-        errorcode = 9;
-
         stream << (qint32)0;
+        break;
+    default:
+        break;
     }
-    catch (...)
-    {
-        return Error(Error::Write, errorcode);
-    }
-
-    // Update modified status.
-    usermod = false;
-    emit userDataModified(false);
-
-    return true;
 }
 
 void Dictionary::exportUserData(const QString &filename, std::vector<KanjiGroup*> &kgroups, bool kexamples, std::vector<WordGroup*> &wgroups, bool usermeanings)
@@ -4436,6 +5323,8 @@ void Dictionary::exportDictionary(const QString &filename, bool limit, const std
 
     for (int ix = 0, siz = tosigned(!limit ? words.size() : wordlimit.size()); ix != siz; ++ix)
     {
+        if (!limit && isEntryRemoved(ix))
+            continue;
         WordEntry *e = words[!limit ? ix : wordlimit[ix]];
         stream << QString("%1(%2) %3 %4\n").arg(e->kanji.toQStringRaw()).arg(e->kana.toQStringRaw()).arg(e->freq).arg(Strings::wordInfoTags(e->inf));
 
@@ -4660,15 +5549,21 @@ void Dictionary::setInfoText(QString text)
     setToModified();
 }
 
-void Dictionary::swapDictionaries(Dictionary *src, std::map<int, int> &changes)
+void Dictionary::swapDictionaries(Dictionary *src, const std::vector<int> &changes)
 {
+    ZKanji::stopBackgroundSearches();
+
     //basedate.swap(src->basedate);
 
     writedate.swap(src->writedate);
     prgversion.swap(src->prgversion);
     dictname.swap(src->dictname);
     info.swap(src->info);
+    strings.swap(src->strings);
     std::swap(words, src->words);
+    std::swap(removedcnt, src->removedcnt);
+    wordindex.clear();
+    src->wordindex.clear();
     dtree.swap(src->dtree);
     ktree.swap(src->ktree);
     btree.swap(src->btree);
@@ -4713,11 +5608,17 @@ void Dictionary::swapDictionaries(Dictionary *src, std::map<int, int> &changes)
 
 void Dictionary::restoreChanges(Dictionary *src)
 {
+    ZKanji::stopBackgroundSearches();
+
     writedate.swap(src->writedate);
     prgversion.swap(src->prgversion);
     dictname.swap(src->dictname);
     info.swap(src->info);
+    strings.swap(src->strings);
     std::swap(words, src->words);
+    std::swap(removedcnt, src->removedcnt);
+    wordindex.clear();
+    src->wordindex.clear();
     dtree.swap(src->dtree);
     ktree.swap(src->ktree);
     btree.swap(src->btree);
@@ -4751,16 +5652,37 @@ void Dictionary::setToModified()
 
 bool Dictionary::isUserModified() const
 {
-    return usermod;
+    return usermod != 0 || !userops.empty();
+}
+
+void Dictionary::setToUserModified(UserData parts)
+{
+    bool changed = !isUserModified();
+    usermod |= (uchar)parts;
+
+    // The recorded edits of the parts will be saved with their whole data.
+    userops.erase(std::remove_if(userops.begin(), userops.end(), [parts](const UserDataEdit &e) { return ((uchar)e.part & (uchar)parts) != 0; }), userops.end());
+
+    if (changed)
+        emit userDataModified(true);
 }
 
-void Dictionary::setToUserModified()
+void Dictionary::addUserDataOp(UserData part, UserDataOp op, const std::function<void(QDataStream&)> &func)
 {
-    if (usermod)
+    if ((usermod & (uchar)part) != 0)
         return;
 
-    usermod = true;
-    emit userDataModified(true);
+    bool changed = !isUserModified();
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    func(stream);
+    userops.push_back({ part, op, std::move(data) });
+
+    if (changed)
+        emit userDataModified(true);
 }
 
 WordGroups& Dictionary::wordGroups()
@@ -4800,6 +5722,8 @@ const WordEntry* Dictionary::wordEntry(int ix) const
 
 void Dictionary::removeEntry(int windex)
 {
+    ZKanji::stopBackgroundSearches();
+
     //emit entryAboutToBeRemoved(windex);
 
     if (this == ZKanji::dictionary(0))
@@ -4816,7 +5740,9 @@ void Dictionary::removeEntry(int windex)
     wordstudydefs.processRemovedWord(windex);
     decks->processRemovedWord(windex);
 
-    words.erase(words.begin() + windex);
+    // The entry is only erased in compactEntries(), so the words after it keep their index.
+    words[windex]->dat |= (1 << (int)WordRuntimeData::Removed);
+    ++removedcnt;
 
     emit entryRemoved(windex, abcdeix, aiueoix);
 
@@ -4824,6 +5750,73 @@ void Dictionary::removeEntry(int windex)
         setToModified();
 }
 
+bool Dictionary::isEntryRemoved(int windex) const
+{
+    return (words[windex]->dat & (1 << (int)WordRuntimeData::Removed)) != 0;
+}
+
+void Dictionary::compactEntries()
+{
+    if (removedcnt == 0)
+        return;
+
+    ZKanji::stopBackgroundSearches();
+
+    // New index of every word, or -1 for removed words.
+    std::vector<int> changes(words.size(), -1);
+    for (int ix = 0, pos = 0, siz = tosigned(words.size()); ix != siz; ++ix)
+        if (!isEntryRemoved(ix))
+            changes[ix] = pos++;
+
+    std::vector<WordEntry*> tmp;
+    words.removeAt(words.begin(), words.end(), tmp);
+    words.reserve(tmp.size() - removedcnt);
+    for (int ix = 0, siz = tosigned(tmp.size()); ix != siz; ++ix)
+    {
+        if (changes[ix] == -1)
+            delete tmp[ix];
+        else
+            words.push_back(tmp[ix]);
+    }
+    removedcnt = 0;
+
+    for (int &windex : abcde)
+        windex = changes[windex];
+    for (int &windex : aiueo)
+        windex = changes[windex];
+
+    for (int ix = 0, siz = tosigned(kanjidata.size()); ix != siz; ++ix)
+    {
+        kanjidata[ix]->words.remap(changes);
+        for (int &windex : kanjidata[ix]->ex)
+            windex = changes[windex];
+    }
+    for (auto &keyvalue : symdata)
+        keyvalue.second.remap(changes);
+    for (auto &keyvalue : kanadata)
+        keyvalue.second.remap(changes);
+
+    // The index is rebuilt on the next lookup.
+    wordindex.clear();
+
+    dtree.remapLines(changes);
+    ktree.remapLines(changes);
+    btree.remapLines(changes);
+    freezeLater();
+
+    if (this == ZKanji::dictionary(0))
+        ZKanji::originals.processCompactedWords(changes);
+    groups->applyChanges(changes);
+    wordstudydefs.processCompactedWords(changes);
+    decks->processCompactedWords(changes);
+
+    setToUserModified();
+    if (this != ZKanji::dictionary(0))
+        setToModified();
+
+    emit entriesCompacted(changes);
+}
+
 bool Dictionary::isUserEntry(int windex) const
 {
     if (windex == -1 || this != ZKanji::dictionary(0))
@@ -4941,11 +5934,15 @@ const QCharString* Dictionary::studyDefinition(int index) const
 
 void Dictionary::setWordStudyDefinition(int index, QString def)
 {
+    ZKanji::stopBackgroundSearches();
+
     if (def == wordDefinitionString(index, false))
         def.clear();
     if (wordstudydefs.setDefinition(index, def))
     {
-        setToUserModified();
+        addUserDataOp(UserData::Definitions, UserDataOp::StudyDefinition, [index, &def](QDataStream &stream) {
+            stream << (qint32)index << def;
+        });
         emit entryChanged(index, true);
     }
 }
@@ -4964,28 +5961,37 @@ void Dictionary::setWordStudyDefinition(int index, QString def)
 
 void Dictionary::getKanjiWords(short kindex, std::vector<int> &dest) const
 {
-    dest = kanjidata[kindex]->words;
+    dest = kanjidata[kindex]->words.toVector();
 }
 
 void Dictionary::getKanjiWords(const std::vector<ushort> &kanji, std::vector<int> &dest) const
 {
-    for (int ix = 0, siz = tosigned(kanji.size()); ix != siz; ++ix)
+    // Words already in dest are merged with the result as well.
+    std::vector<int> old;
+    if (!dest.empty())
     {
-        const std::vector<int> &w = kanjidata[kanji[ix]]->words;
-        dest.insert(dest.end(), w.begin(), w.end());
+        old.swap(dest);
+        std::sort(old.begin(), old.end());
     }
-    std::sort(dest.begin(), dest.end());
-    dest.resize(std::unique(dest.begin(), dest.end()) - dest.begin());
+
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(kanji.size() + 1);
+    for (int ix = 0, siz = tosigned(kanji.size()); ix != siz; ++ix)
+        cursors.emplace_back(kanjidata[kanji[ix]]->words);
+    if (!old.empty())
+        cursors.emplace_back(old);
+
+    unitePostings(cursors, dest);
 }
 
 int Dictionary::kanjiWordCount(short kindex) const
 {
-    return tounsigned(kanjidata[kindex]->words.size());
+    return kanjidata[kindex]->words.size();
 }
 
 int Dictionary::kanjiWordAt(short kindex, int ix) const
 {
-    return kanjidata[kindex]->words[ix];
+    return kanjidata[kindex]->words.at(ix);
 }
 
 void Dictionary::addKanjiExample(short kindex, int windex)
@@ -4995,7 +6001,7 @@ void Dictionary::addKanjiExample(short kindex, int windex)
         return;
 
     ex.push_back(windex);
-    setToUserModified();
+    setToUserModified(UserData::Kanji);
     emit kanjiExampleAdded(kindex, windex);
 }
 
@@ -5008,7 +6014,7 @@ void Dictionary::removeKanjiExample(short kindex, int windex)
 
     //emit kanjiExampleAboutToBeRemoved(kindex, windex);
     ex.erase(it);
-    setToUserModified();
+    setToUserModified(UserData::Kanji);
     emit kanjiExampleRemoved(kindex, windex);
 }
 
@@ -5045,7 +6051,7 @@ void Dictionary::setKanjiMeaning(short ix, QString str)
         kanjidata[ix]->meanings.clear();
 
     emit kanjiMeaningChanged(ix);
-    setToUserModified();
+    setToUserModified(UserData::Kanji);
 }
 
 void Dictionary::setKanjiMeaning(short ix, QStringList &list)
@@ -5061,7 +6067,7 @@ void Dictionary::setKanjiMeaning(short ix, QStringList &list)
         kanjidata[ix]->meanings.clear();
 
     emit kanjiMeaningChanged(ix);
-    setToUserModified();
+    setToUserModified(UserData::Kanji);
 }
 
 //WordResultList&& Dictionary::browseWords(WordResultList &&result, BrowseOrder order, const WordFilterConditions *conditions) const
@@ -5082,7 +6088,7 @@ void Dictionary::setKanjiMeaning(short ix, QStringList &list)
 //    return std::move(result);
 //}
 
-void Dictionary::findWords(WordResultList &result, SearchMode searchmode, QString search, SearchWildcards wildcards, bool sameform, bool inflections, bool studydefs, const std::vector<int> *wordpool, const WordFilterConditions *conditions)
+void Dictionary::findWords(WordResultList &result, SearchMode searchmode, QString search, SearchWildcards wildcards, bool sameform, bool inflections, bool studydefs, const std::vector<int> *wordpool, const WordFilterConditions *conditions, const std::atomic<bool> *cancel)
 {
 #ifdef _DEBUG
     if (searchmode == SearchMode::Browse)
@@ -5121,33 +6127,63 @@ void Dictionary::findWords(WordResultList &result, SearchMode searchmode, QStrin
         }
 
 
-        std::vector<int> lines;
-        if (kanjisearch)
-            findKanjiWords(lines, search, wildcards, sameform, wordpool != nullptr ? &wpool : nullptr, conditions);
-        else
-            findKanaWords(lines, search, wildcards, sameform, wordpool != nullptr ? &wpool : nullptr, conditions);
-
-        // Searching for deinflected results must end with the deinflected form.
-        wildcards &= ~(int)SearchWildcard::AnyAfter;
-
         smartvector<InflectionForm> deinfs;
         if (inflections)
             deinflect(search, deinfs);
 
-        result.set(lines);
+        // Results of the search for the original string at index 0, and for each deinflected
+        // form after that. The searches are independent, and run on multiple threads when
+        // it's safe. The results are merged in the same order either way.
+        std::vector<std::vector<int>> found(deinfs.size() + 1);
+
+        auto findForm = [&](int ix) {
+            const QString &form = ix == 0 ? search : deinfs[ix - 1]->form;
+            int infsize = ix == 0 ? 0 : deinfs[ix - 1]->infsize;
+
+            // Searching for deinflected results must end with the deinflected form.
+            SearchWildcards w = wildcards;
+            if (ix != 0)
+                w &= ~(int)SearchWildcard::AnyAfter;
+
+            if (kanjisearch)
+                findKanjiWords(found[ix], form, w, sameform, wordpool != nullptr ? &wpool : nullptr, conditions, infsize, cancel);
+            else
+                findKanaWords(found[ix], form, w, sameform, wordpool != nullptr ? &wpool : nullptr, conditions, infsize, cancel);
+        };
+
+        if (ZKanji::parallelSearch() && !deinfs.empty() && threadSafeSearch() && ZKanji::wordfilters().threadSafe(conditions))
+        {
+            // The kanji index map is filled on first use. Make sure every kanji that can be
+            // looked up is in it before the threads start.
+            for (int ix = 0, siz = tosigned(found.size()); ix != siz; ++ix)
+            {
+                const QString &form = ix == 0 ? search : deinfs[ix - 1]->form;
+                for (int iy = 0, sizy = form.size(); iy != sizy; ++iy)
+                    if (KANJI(form.at(iy).unicode()))
+                        ZKanji::kanjiIndex(form.at(iy));
+            }
+
+            ZKanji::parallelFor(tosigned(found.size()), findForm);
+        }
+        else
+        {
+            for (int ix = 0, siz = tosigned(found.size()); ix != siz; ++ix)
+                findForm(ix);
+        }
+
+        if (cancel != nullptr && cancel->load())
+            return;
+
+        result.set(std::move(found[0]));
         if (deinfs.empty())
             return;
 
         for (int ix = 0, siz = tosigned(deinfs.size()); ix != siz; ++ix)
         {
-            std::vector<int> tmp;
+            std::vector<int> &tmp = found[ix + 1];
             std::vector<std::vector<InfTypes>*> inftmp;
             int foundcnt = 0;
 
-            if (kanjisearch)
-                findKanjiWords(tmp, deinfs[ix]->form, wildcards, sameform, wordpool != nullptr ? &wpool : nullptr, conditions, deinfs[ix]->infsize);
-            else
-                findKanaWords(tmp, deinfs[ix]->form, wildcards, sameform, wordpool != nullptr ? &wpool : nullptr, conditions, deinfs[ix]->infsize);
             inftmp.resize(tmp.size());
 
             for (int iy = 0, sizy = tosigned(tmp.size()); iy != sizy; ++iy)
@@ -5189,7 +6225,7 @@ void Dictionary::findWords(WordResultList &result, SearchMode searchmode, QStrin
         std::vector<int> studyexclude;
         if (studydefs)
         {
-            wordstudydefs.findWords(lines, search, (wildcards & SearchWildcard::AnyAfter) == 0, sameform, wordpool != nullptr ? &wpool : nullptr, conditions);
+            wordstudydefs.findWords(lines, search, (wildcards & SearchWildcard::AnyAfter) == 0, sameform, wordpool != nullptr ? &wpool : nullptr, conditions, 0, cancel);
             wordstudydefs.listWordIndexes(studyexclude);
 
             if (wordpool != nullptr)
@@ -5218,7 +6254,10 @@ void Dictionary::findWords(WordResultList &result, SearchMode searchmode, QStrin
             }
         }
 
-        dtree.findWords(lines, search, (wildcards & SearchWildcard::AnyAfter) == 0, sameform, wordpool != nullptr ? &wpool : nullptr, conditions);
+        dtree.findWords(lines, search, (wildcards & SearchWildcard::AnyAfter) == 0, sameform, wordpool != nullptr ? &wpool : nullptr, conditions, 0, cancel);
+        if (cancel != nullptr && cancel->load())
+            return;
+
         if (studydefs && wordpool == nullptr)
         {
             // Remove anything from lines found in wordstudydefs.
@@ -5252,6 +6291,20 @@ void Dictionary::findWords(WordResultList &result, SearchMode searchmode, QStrin
     }
 }
 
+bool Dictionary::threadSafeSearch(bool studydefs) const
+{
+    // The study definitions tree is never frozen, because it's saved with the user data in
+    // the old format. Searching it is only safe when it's empty.
+    return dtree.frozen() && ktree.frozen() && btree.frozen() && (!studydefs || wordstudydefs.size() == 0);
+}
+
+void Dictionary::freezeTrees()
+{
+    dtree.freeze();
+    ktree.freeze();
+    btree.freeze();
+}
+
 bool Dictionary::wordMatches(int windex, SearchMode searchmode, QString search, SearchWildcards wildcards, bool sameform, bool inflections, bool studydefs, const WordFilterConditions *conditions, std::vector<InfTypes> *inftypes)
 {
 #ifdef _DEBUG
@@ -5369,114 +6422,24 @@ bool Dictionary::wordMatches(int windex, SearchMode searchmode, QString search,
     return false;
 }
 
-void Dictionary::findKanjiWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize) const
+void Dictionary::findKanjiWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize, const std::atomic<bool> *cancel) const
 {
     // When changing this, also update wordMatchesKanjiSearch().
 
-    // List of words for the top 3 kanji or symbol with the least number of words.
-    const std::vector<int> *symwords[3];
-
-    // Number of valid lists in symwords.
-    int symfound = 0;
-
-    // Holds already processed unicode characters so they can be skipped the second time.
-    std::set<ushort> found;
-
-    // Find the top 3 kanji or symbol in the search string that have the least number of related words.
-    for (int ix = 0; ix < search.size(); ++ix)
-    {
-        ushort ch = search.at(ix).unicode();
-        if (VALIDKANA(ch) || found.count(ch) != 0)
-            continue;
-        found.insert(ch);
-
-        const std::vector<int> *wordlist = nullptr;
-        if (KANJI(ch))
-            wordlist = &kanjidata[ZKanji::kanjiIndex(QChar(ch))]->words;
-        else
-        {
-            auto it = symdata.find(ch);
-            if (it != symdata.end())
-                wordlist = &it->second;
-        }
-
-        if (wordlist == nullptr)
-            continue;
-
-        if (symfound != 3)
-        {
-            symwords[symfound] = wordlist;
-            ++symfound;
-        }
-        else
-        {
-            for (int iy = 0; iy != 3; ++iy)
-            {
-                if (symwords[iy]->size() > wordlist->size())
-                {
-                    for (int j = iy; j != 2; ++j)
-                        symwords[j + 1] = symwords[j];
-
-                    symwords[iy] = wordlist;
-                    break;
-                }
-            }
-        }
-    }
-
-    // Make a list of indexes to every word containing the characters, and try to find those that contain all 3.
-
-    std::vector<int> wordlist;
-    for (int ix = 0; ix != symfound; ++ix)
-    {
-        wordlist.insert(wordlist.end(), (*symwords[ix]).begin(), (*symwords[ix]).end());
-
-        // A list of 200 words or less is small enough to look through. Don't bother
-        // checking more kanji.
-        if (wordlist.size() < 200)
-        {
-            symfound = ix + 1;
-            break;
-        }
-    }
-
+    // Only words found in the word lists of every kanji and symbol in the search string and
+    // in the wordpool can match.
+    std::vector<PostingCursor> cursors;
+    kanjiSearchCursors(search, cursors);
     if (wordpool != nullptr)
-    {
-        wordlist.insert(wordlist.end(), (*wordpool).begin(), (*wordpool).end());;
-        ++symfound;
-    }
-
-    // Create a new list which only holds words found in all kanji and the wordpool. Check
-    // the filter conditions too.
-    if (symfound > 1)
-    {
-        std::sort(wordlist.begin(), wordlist.end(), [](int a, int b) { return a < b; });
-        std::vector<int> temp;
-        temp.swap(wordlist);
+        cursors.emplace_back(*wordpool);
 
-        int last = -1;
-        int foundsym = 0;
-        for (int ix = 0, siz = tosigned(temp.size()); ix != siz; ++ix)
-        {
-            if (temp[ix] == last)
-                ++foundsym;
-            else
-            {
-                foundsym = 1;
-                last = temp[ix];
-            }
-            if (foundsym == symfound && (conditions == nullptr || ZKanji::wordfilters().match(words[temp[ix]], conditions)))
-                wordlist.push_back(temp[ix]);
-        }
-    }
-    else if (conditions != nullptr)
-    {
-        std::vector<int> temp;
-        temp.swap(wordlist);
-        for (int ix = 0, siz = tosigned(temp.size()); ix != siz; ++ix)
-            if (ZKanji::wordfilters().match(words[temp[ix]], conditions))
-                wordlist.push_back(temp[ix]);
-    }
+    // Create a list which only holds words found in all kanji and the wordpool. Check the
+    // filter conditions too.
+    std::vector<int> wordlist;
+    intersectPostings(cursors, [this, &wordlist, conditions](int windex) {
+        if (conditions == nullptr || ZKanji::wordfilters().match(words[windex], conditions))
+            wordlist.push_back(windex);
+    });
 
     // Words list now only contains unique items. Look for the search string the classic way.
     if (!sameform)
@@ -5486,6 +6449,9 @@ void Dictionary::findKanjiWords(std::vector<int> &result, QString search, Search
 
     for (int ix = 0, siz = tosigned(wordlist.size()); ix != siz; ++ix)
     {
+        if (cancel != nullptr && (ix % 1024) == 0 && cancel->load(std::memory_order_relaxed))
+            return;
+
         const WordEntry *e = words[wordlist[ix]];
 
         int klen;
@@ -5518,8 +6484,36 @@ void Dictionary::findKanjiWords(std::vector<int> &result, QString search, Search
     }
 }
 
+void Dictionary::kanjiSearchCursors(const QString &search, std::vector<PostingCursor> &cursors) const
+{
+    for (int ix = 0, siz = search.size(); ix != siz; ++ix)
+    {
+        ushort ch = search.at(ix).unicode();
+        if (VALIDKANA(ch))
+            continue;
+
+        if (KANJI(ch))
+        {
+            int kindex = ZKanji::kanjiIndex(QChar(ch));
+            if (kindex != -1)
+                cursors.emplace_back(kanjidata[kindex]->words);
+            continue;
+        }
+
+        auto it = symdata.find(ch);
+        if (it != symdata.end())
+            cursors.emplace_back(it->second);
+    }
+}
+
 bool Dictionary::wordMatchesKanjiSearch(int windex, QString search, SearchWildcards wildcards, bool sameform, int infsize) const
 {
+    // The word must be in the word lists of every kanji and symbol of the search string.
+    std::vector<PostingCursor> cursors;
+    kanjiSearchCursors(search, cursors);
+    if (!postingsContain(cursors, windex))
+        return false;
+
     // The word index can be found in at least the most important kanji. Look for the search string the classic way.
     if (!sameform)
         search = hiraganize(search);
@@ -5558,130 +6552,67 @@ bool Dictionary::wordMatchesKanjiSearch(int windex, QString search, SearchWildca
     return false;
 }
 
-void Dictionary::findKanaWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize)
+void Dictionary::findKanaWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize, const std::atomic<bool> *cancel)
 {
     // When changing this, also update wordMatchesKanaSearch().
 
 
     if (wildcards == (int)SearchWildcard::AnyBefore)
-        return btree.findWords(result, search, false, sameform, wordpool, conditions, infsize);
+        return btree.findWords(result, search, false, sameform, wordpool, conditions, infsize, cancel);
     if (wildcards == (int)SearchWildcard::AnyAfter)
-        return ktree.findWords(result, search, false, sameform, wordpool, conditions, infsize);
+        return ktree.findWords(result, search, false, sameform, wordpool, conditions, infsize, cancel);
     if (wildcards == 0)
-        return ktree.findWords(result, search, true, sameform, wordpool, conditions, infsize);
+        return ktree.findWords(result, search, true, sameform, wordpool, conditions, infsize, cancel);
 
     // Search for kana in the middle of the word.
 
-    // We want to make a list that holds indexes to words that contain some kana of the search string.
-    // Not all kana are used here, because it would mean more words to check later. Once the list
-    // of indexes is done, the words that were found in all of the searched kana are checked for
-    // the original search string.
-    std::vector<int> list;
-
-    // The result is built up in multiple passes from words already in the list, and words containing
-    // a given kana. Only those words are kept that are found in both. On each pass the words of
-    // the next kana are added to the list. If we put the wordpool words as the initial contents of
-    // the list, we can limit the result even more.
-    if (wordpool != nullptr)
-        list = *wordpool;
+    // Only words containing every kana of the search string can match. The word lists of the
+    // 3 kana with the least words are intersected, together with the wordpool if it's
+    // specified. The words found in all of them are checked for the original search string.
 
-    // Create a string that only contains unique hiragana of the search word. The hiragana in front
-    // of the string are in less words than the latter ones.
+    // Create a string that only contains unique hiragana of the search word.
     QString hiragana = hiraganize(search);
+    std::sort(hiragana.begin(), hiragana.end(), [](const QChar &a, const QChar &b) { return a.unicode() < b.unicode(); });
+    hiragana.resize(std::unique(hiragana.begin(), hiragana.end()) - hiragana.begin());
 
-    // Holds the number of characters that are used in the search. At most 3 characters are used.
-    int hlen = hiragana.size();
-
-    std::sort(hiragana.begin(), hiragana.end(), [](const QChar &a, const QChar &b) { return a.unicode() < b.unicode();  });
-    auto it = std::unique(hiragana.begin(), hiragana.end());
-    if (it != hiragana.end())
-        hlen = it - hiragana.begin();
-
-    std::sort(hiragana.begin(), it, [this](const QChar &a, const QChar &b) { 
-        return kanadata.at(a.unicode()).size() < kanadata.at(b.unicode()).size();
-    });
-    hlen = std::min(hlen, 3);
-    
-    for (int ix = 0; ix != hlen; ++ix)
+    std::vector<const PostingList*> lists;
+    for (int ix = 0, siz = hiragana.size(); ix != siz; ++ix)
     {
-        if (!kanadata.count(hiragana.at(ix).unicode()))
-            continue;
-
-        if (list.empty())
-            list = kanadata.at(hiragana.at(ix).unicode());
-        else
-        {
-            std::vector<int> llist; // Llist receives the sorted items of both klist and list.
-            std::vector<int> klist = kanadata.at(hiragana.at(ix).unicode());
-            llist.reserve(list.size() + klist.size());
-
-            int lpos = 0;
-            int kpos = 0;
-
-            int lsiz = tosigned(list.size());
-            int ksiz = tosigned(klist.size());
-            while (lpos != lsiz && kpos != ksiz)
-            {
-                int lval = list[lpos];
-                int kval = klist[kpos];
-                if (lval == kval)
-                {
-                    llist.push_back(lval);
-                    llist.push_back(kval);
-                    ++lpos;
-                    ++kpos;
-                }
-                else if (lval < kval)
-                {
-                    llist.push_back(lval);
-                    ++lpos;
-                }
-                else
-                {
-                    llist.push_back(kval);
-                    ++kpos;
-                }
-            }
-
-
-            while (lpos != lsiz)
-                llist.push_back(list[lpos++]);
-            while (kpos != ksiz)
-                llist.push_back(klist[kpos++]);
-
-            list.swap(llist);
-        }
-
-        if (list.size() > 250000)
-            hlen = ix + 1;
+        auto it = kanadata.find(hiragana.at(ix).unicode());
+        if (it != kanadata.end())
+            lists.push_back(&it->second);
     }
+    std::sort(lists.begin(), lists.end(), [](const PostingList *a, const PostingList *b) { return a->size() < b->size(); });
+    if (lists.size() > 3)
+        lists.resize(3);
 
-    // Let's pretend there's another hiragana in the search string, to match the number of times
-    // the words must be in list.
+    std::vector<PostingCursor> cursors;
+    for (const PostingList *list : lists)
+        cursors.emplace_back(*list);
     if (wordpool != nullptr)
-        ++hlen;
+        cursors.emplace_back(*wordpool);
 
-    // Remove duplicates and find real matches that also fit the conditions.
+    // Find real matches that also fit the conditions.
 
     QString romaji;
     if (!sameform)
         romaji = romanize(search);
 
-    int found = 1;
-
-    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
-    {
-        if (ix == 0 || list[ix - 1] != list[ix])
-            found = 1;
-        else
-            ++found;
+    // Number of words checked, to only look at the cancel flag once in a while.
+    int checked = 0;
+    bool canceled = false;
+    intersectPostings(cursors, [this, &result, &romaji, &search, sameform, conditions, cancel, &checked, &canceled](int windex) {
+        if (canceled || (cancel != nullptr && (++checked % 1024) == 0 && cancel->load(std::memory_order_relaxed)))
+        {
+            canceled = true;
+            return;
+        }
 
-        if (found == hlen &&
-            (conditions == nullptr || ZKanji::wordfilters().match(words[list[ix]], conditions)) &&
-            ((!sameform && words[list[ix]]->romaji.find(romaji.constData()) != -1) ||
-            (sameform && words[list[ix]]->kana.find(search.constData()) != -1)))
-            result.push_back(list[ix]);
-    }
+        if ((conditions == nullptr || ZKanji::wordfilters().match(words[windex], conditions)) &&
+            ((!sameform && words[windex]->romaji.find(romaji.constData()) != -1) ||
+            (sameform && words[windex]->kana.find(search.constData()) != -1)))
+            result.push_back(windex);
+    });
 
     //return WordResultList(this, result);
 }
@@ -5709,36 +6640,17 @@ bool Dictionary::wordMatchesKanaSearch(int windex, QString search, SearchWildcar
     return false;
 }
 
-int Dictionary::findKanjiKanaWord(const QChar *kanji, const QChar *kana, const QChar *romaji, int kanjilen, int kanalen, int romajilen)
+int Dictionary::findKanjiKanaWord(const QChar *kanji, const QChar *kana, int kanjilen, int kanalen)
 {
-    QCharString tmp;
-    if (romaji == nullptr)
-    {
-        tmp.copy(romanize(kana, kanalen).constData());
-        romaji = tmp.data();
-        romajilen = tmp.size();
-    }
-
     if (kanjilen == -1)
         kanjilen = tosigned(qcharlen(kanji));
     if (kanalen == -1)
         kanalen = tosigned(qcharlen(kana));
-    if (romajilen == -1)
-        romajilen = tosigned(qcharlen(romaji));
 
-    // l will contain words that have a romanized kana starting with romaji.
-    std::vector<int> l;
-    ktree.getSiblings(l, romaji, romajilen);
+    if (wordindex.size() != tosigned(words.size()))
+        wordindex.rebuild();
 
-    // The kana can still be different and the kanji must be checked as well.
-    for (int ix = 0, siz = tosigned(l.size()); ix != siz; ++ix)
-    {
-        WordEntry *e = words[l[ix]];
-        if (tosigned(e->kanji.size()) != kanjilen || tosigned(e->kana.size()) != kanalen || qcharncmp(e->kanji.data(), kanji, kanjilen) || qcharncmp(e->kana.data(), kana, kanalen))
-            continue;
-        return l[ix];
-    }
-    return -1;
+    return wordindex.find(kanji, kanjilen, kana, kanalen);
 }
 
 int Dictionary::findKanjiKanaWord(const QCharString &kanji, const QCharString &kana)
@@ -5753,7 +6665,7 @@ int Dictionary::findKanjiKanaWord(const QString &kanji, const QString &kana)
 
 int Dictionary::findKanjiKanaWord(WordEntry *e)
 {
-    return findKanjiKanaWord(e->kanji.data(), e->kana.data(), e->romaji.data());
+    return findKanjiKanaWord(e->kanji.data(), e->kana.data(), tosigned(e->kanji.size()), tosigned(e->kana.size()));
 }
 
 std::function<bool(int, const QChar*)> Dictionary::browseOrderCompareFunc(BrowseOrder order) const
@@ -6157,24 +7069,37 @@ void Dictionary::listUsedWords(std::vector<int> &result)
     result.resize(std::unique(result.begin(), result.end()) - result.begin());
 }
 
-std::map<int, int> Dictionary::mapWords(Dictionary *src, const std::vector<int> &wlist)
+std::vector<int> Dictionary::mapWords(Dictionary *src, const std::vector<int> &wlist)
 {
-    std::map<int, int> tmp;
-    //tmp.reserve(wlist.size());
+    std::vector<int> result(src->words.size(), -1);
 
-    for (int ix = 0, siz = tosigned(wlist.size()); ix != siz; ++ix)
-    {
-        WordEntry *e = src->wordEntry(wlist[ix]);
-        tmp.insert(std::make_pair(wlist[ix], findKanjiKanaWord(e)));
-    }
+    // The index is only read after this point, which is safe from multiple threads.
+    if (wordindex.size() != tosigned(words.size()))
+        wordindex.rebuild();
+
+    const int shardsize = 4096;
+    int cnt = tosigned(wlist.size());
+
+    ZKanji::parallelFor((cnt + shardsize - 1) / shardsize, [this, src, &wlist, cnt, &result](int shard) {
+        for (int ix = shard * shardsize, last = std::min(cnt, ix + shardsize); ix != last; ++ix)
+        {
+            int windex = wlist[ix];
+            const WordEntry *e = src->words[windex];
+            result[windex] = wordindex.find(e->kanji.data(), tosigned(e->kanji.size()), e->kana.data(), tosigned(e->kana.size()));
+        }
+    });
 
-    return tmp;
+    return result;
 }
 
 void Dictionary::diff(Dictionary *other, std::vector<std::pair<int, int>> &result)
 {
     result.clear();
 
+    // The result pairs word indexes of both dictionaries without the removed words.
+    compactEntries();
+    other->compactEntries();
+
     //std::vector<std::pair<int, int>> tmp;
     if (words.empty() || other->words.empty())
     {
@@ -6266,6 +7191,8 @@ void Dictionary::diff(Dictionary *other, std::vector<std::pair<int, int>> &resul
 
 int Dictionary::addWordCopy(WordEntry *src, bool originals)
 {
+    ZKanji::stopBackgroundSearches();
+
     if (originals && this == ZKanji::dictionary(0))
     {
         ZKanji::originals.createAdded(tounsigned(words.size()), src->kanji.data(), src->kana.data());
@@ -6281,6 +7208,7 @@ int Dictionary::addWordCopy(WordEntry *src, bool originals)
     addWordData();
 
     int windex = tounsigned(words.size()) - 1;
+    wordindex.add(windex);
     emit entryAdded(windex);
 
     if (this != ZKanji::dictionary(0))
@@ -6291,6 +7219,8 @@ int Dictionary::addWordCopy(WordEntry *src, bool originals)
 
 void Dictionary::cloneWordData(int windex, WordEntry *src, bool originals, bool checkoriginals)
 {
+    ZKanji::stopBackgroundSearches();
+
     WordEntry *w = words[windex];
 
     bool orichanged = false;
@@ -6308,6 +7238,7 @@ void Dictionary::cloneWordData(int windex, WordEntry *src, bool originals, bool
 
     dtree.removeLine(windex, false);
     dtree.expandWith(windex, false);
+    freezeLater();
 
     emit entryChanged(windex, false);
 
@@ -6317,6 +7248,8 @@ void Dictionary::cloneWordData(int windex, WordEntry *src, bool originals, bool
 
 void Dictionary::revertEntry(int windex)
 {
+    ZKanji::stopBackgroundSearches();
+
     if (this != ZKanji::dictionary(0))
         return;
 
@@ -6327,76 +7260,74 @@ void Dictionary::revertEntry(int windex)
 
     dtree.removeLine(windex, false);
     dtree.expandWith(windex, false);
+    freezeLater();
 
     emit entryChanged(windex, false);
 
     setToUserModified();
 }
 
-void Dictionary::addWordData()
+void Dictionary::freezeLater()
 {
-    WordEntry *w = words.back();
-
-    int windex = tounsigned(words.size()) - 1;
+    if (freezequeued)
+        return;
 
-    std::map<QCharString, QString> hira;
-    auto it = std::upper_bound(abcde.begin(), abcde.end(), -1, [this, w, &hira](int a, int b) {
-        WordEntry *wa = a == -1 ? w : words[a];
-        WordEntry *wb = b == -1 ? w : words[b];
+    freezequeued = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        freezequeued = false;
+        freezeTrees();
+    }, Qt::QueuedConnection);
+}
 
-        int val = qcharcmp(wa->romaji.data(), wb->romaji.data());
+// Returns whether the word a comes before the word b in the abcde or aiueo ordering of a
+// dictionary. The hiragana forms of the words' kana are saved in hira to be reused.
+static bool wordOrderLess(BrowseOrder order, const WordEntry *a, const WordEntry *b, std::map<QCharString, QString> &hira)
+{
+    int val;
+    if (order == BrowseOrder::ABCDE)
+    {
+        val = qcharcmp(a->romaji.data(), b->romaji.data());
         if (val != 0)
             return val < 0;
+    }
 
-        QString ah;
-        QString bh;
-        auto it = hira.find(wa->kana);
-        if (it != hira.end())
-            ah = it->second;
-        else
-            hira[wa->kana] = ah = hiraganize(wa->kana);
-        it = hira.find(wb->kana);
-        if (it != hira.end())
-            bh = it->second;
-        else
-            hira[wb->kana] = bh = hiraganize(wb->kana);
-        val = qcharcmp(ah.constData(), bh.constData());
-        if (val != 0)
-            return val < 0;
+    QString ah;
+    QString bh;
+    auto it = hira.find(a->kana);
+    if (it != hira.end())
+        ah = it->second;
+    else
+        hira[a->kana] = ah = hiraganize(a->kana);
+    it = hira.find(b->kana);
+    if (it != hira.end())
+        bh = it->second;
+    else
+        hira[b->kana] = bh = hiraganize(b->kana);
+    val = qcharcmp(ah.constData(), bh.constData());
+    if (val != 0)
+        return val < 0;
 
-        val = qcharcmp(wa->kana.data(), wb->kana.data());
-        if (val != 0)
-            return val < 0;
+    val = qcharcmp(a->kana.data(), b->kana.data());
+    if (val != 0)
+        return val < 0;
+
+    return qcharcmp(a->kanji.data(), b->kanji.data()) < 0;
+}
+
+void Dictionary::addWordData()
+{
+    WordEntry *w = words.back();
+
+    int windex = tounsigned(words.size()) - 1;
 
-        return qcharcmp(wa->kanji.data(), wb->kanji.data()) < 0;
+    std::map<QCharString, QString> hira;
+    auto it = std::upper_bound(abcde.begin(), abcde.end(), -1, [this, w, &hira](int a, int b) {
+        return wordOrderLess(BrowseOrder::ABCDE, a == -1 ? w : words[a], b == -1 ? w : words[b], hira);
     });
     abcde.insert(it, windex);
 
     it = std::upper_bound(aiueo.begin(), aiueo.end(), -1, [this, w, &hira](int a, int b) {
-        WordEntry *wa = a == -1 ? w : words[a];
-        WordEntry *wb = b == -1 ? w : words[b];
-
-        QString ah;
-        QString bh;
-        auto it = hira.find(wa->kana);
-        if (it != hira.end())
-            ah = it->second;
-        else
-            hira[wa->kana] = ah = hiraganize(wa->kana);
-        it = hira.find(wb->kana);
-        if (it != hira.end())
-            bh = it->second;
-        else
-            hira[wb->kana] = bh = hiraganize(wb->kana);
-        int val = qcharcmp(ah.constData(), bh.constData());
-        if (val != 0)
-            return val < 0;
-
-        val = qcharcmp(wa->kana.data(), wb->kana.data());
-        if (val != 0)
-            return val < 0;
-
-        return qcharcmp(wa->kanji.data(), wb->kanji.data()) < 0;
+        return wordOrderLess(BrowseOrder::AIUEO, a == -1 ? w : words[a], b == -1 ? w : words[b], hira);
     });
     aiueo.insert(it, windex);
 
@@ -6408,7 +7339,7 @@ void Dictionary::addWordData()
         {
             int kix = ZKanji::kanjiIndex(ch);
 
-            std::vector<int> &wvec = kanjidata[kix]->words;
+            PostingList &wvec = kanjidata[kix]->words;
             if (!wvec.empty() && wvec.back() == windex)
                 continue;
             wvec.push_back(windex);
@@ -6417,7 +7348,7 @@ void Dictionary::addWordData()
         }
         else if (!KANA(ch) && UNICODE_J(ch))
         {
-            std::vector<int> &svec = symdata[ch];
+            PostingList &svec = symdata[ch];
             if (!svec.empty() && svec.back() == windex)
                 continue;
             svec.push_back(windex);
@@ -6436,7 +7367,7 @@ void Dictionary::addWordData()
         if (!kanavowelize(ch, dummy, romaji + ix, wlen - ix))
             continue;
 
-        std::vector<int> &kvec = kanadata[ch];
+        PostingList &kvec = kanadata[ch];
         if (!kvec.empty() && kvec.back() == windex)
             continue;
         kvec.push_back(windex);
@@ -6453,7 +7384,7 @@ void Dictionary::addWordData()
         if (KATAKANA(ch) && ch <= 0x30F4)
             ch -= 0x60;
 
-        std::vector<int> &kvec = kanadata[ch];
+        PostingList &kvec = kanadata[ch];
         if (!kvec.empty() && kvec.back() == windex)
             continue;
         kvec.push_back(windex);
@@ -6464,76 +7395,97 @@ void Dictionary::addWordData()
         dtree.expandWith(tounsigned(words.size()) - 1, false);
     ktree.expandWith(tounsigned(words.size()) - 1, false);
     btree.expandWith(tounsigned(words.size()) - 1, false);
+    freezeLater();
 }
 
 void Dictionary::removeWordData(int index, int &abcdeindex, int &aiueoindex)
 {
-    // Remove word from alphabetic ordering.
+    WordEntry *w = words[index];
 
-    int *abcdat = abcde.data();
-    for (int ix = 0, pos = 0, siz = tosigned(abcde.size()); ix != siz; ++ix, ++pos)
-    {
-        if (abcdat[ix] < index)
-            abcdat[pos] = abcdat[ix];
-        else if (abcdat[ix] > index)
-            abcdat[pos] = abcdat[ix] - 1;
-        else
-        {
-            abcdeindex = ix;
-            --pos;
-        }
-    }
-    abcde.resize(abcde.size() - 1);
+    // Remove word from the alphabetic orderings. The word is looked up among the words that
+    // compare equal to it.
 
-    abcdat = aiueo.data();
-    for (int ix = 0, pos = 0, siz = tosigned(aiueo.size()); ix != siz; ++ix, ++pos)
+    std::map<QCharString, QString> hira;
+    for (BrowseOrder order : { BrowseOrder::ABCDE, BrowseOrder::AIUEO })
     {
-        if (abcdat[ix] < index)
-            abcdat[pos] = abcdat[ix];
-        else if (abcdat[ix] > index)
-            abcdat[pos] = abcdat[ix] - 1;
-        else
-        {
-            aiueoindex = ix;
-            --pos;
-        }
-    }
-    aiueo.resize(aiueo.size() - 1);
+        std::vector<int> &list = order == BrowseOrder::ABCDE ? abcde : aiueo;
+        auto it = std::lower_bound(list.begin(), list.end(), -1, [this, w, order, &hira](int a, int b) {
+            return wordOrderLess(order, a == -1 ? w : words[a], b == -1 ? w : words[b], hira);
+        });
+        while (it != list.end() && *it != index && !wordOrderLess(order, w, words[*it], hira))
+            ++it;
+        if (it == list.end() || *it != index)
+            it = std::find(list.begin(), list.end(), index);
 
-    // Remove word from kanjidata, symdata and kanadata, and its frequency from kanjis' freq value.
+        (order == BrowseOrder::ABCDE ? abcdeindex : aiueoindex) = tosigned(it - list.begin());
+        list.erase(it);
+    }
 
-    WordEntry *w = words[index];
+    // Remove word from the lists of its kanji, symbols and kana, and its frequency from the
+    // kanjis' freq value. The lists are the same as in addWordData().
 
     std::set<ushort> found;
     for (int ix = w->kanji.size() - 1; ix != -1; --ix)
     {
         ushort ch = w->kanji[ix].unicode();
+        if (found.count(ch) != 0)
+            continue;
+        found.insert(ch);
 
-        if (KANJI(ch) && found.count(ch) == 0)
+        if (KANJI(ch))
         {
-            found.insert(ch);
-
             int kix = ZKanji::kanjiIndex(ch);
             ZKanji::kanjis[kix]->word_freq -= w->freq;
+
+            kanjidata[kix]->words.remove(index);
+            std::vector<int> &ex = kanjidata[kix]->ex;
+            auto exit = std::find(ex.begin(), ex.end(), index);
+            if (exit != ex.end())
+                ex.erase(exit);
+        }
+        else if (!KANA(ch) && UNICODE_J(ch))
+        {
+            auto it = symdata.find(ch);
+            if (it != symdata.end())
+                it->second.remove(index);
         }
     }
 
-    for (int ix = 0, siz = tosigned(kanjidata.size()); ix != siz; ++ix)
+    found.clear();
+    QChar *romaji = w->romaji.data();
+    int wlen = w->romaji.size();
+    for (int ix = 0; ix != wlen; ++ix)
+    {
+        ushort ch;
+
+        int dummy;
+        if (!kanavowelize(ch, dummy, romaji + ix, wlen - ix))
+            continue;
+        found.insert(ch);
+    }
+
+    QChar *kana = w->kana.data();
+    wlen = w->kana.size();
+    for (int ix = 0; ix != wlen; ++ix)
     {
-        removeIndexFromList(index, kanjidata[ix]->ex);
-        removeIndexFromList(index, kanjidata[ix]->words);
+        ushort ch = kana[ix].unicode();
+        if (!KANA(ch))
+            continue;
+        if (KATAKANA(ch) && ch <= 0x30F4)
+            ch -= 0x60;
+        found.insert(ch);
     }
 
-    for (auto &keyvalue : symdata)
-        removeIndexFromList(index, keyvalue.second);
-    for (auto &keyvalue : kanadata)
-        removeIndexFromList(index, keyvalue.second);
+    for (ushort ch : found)
+    {
+        auto it = kanadata.find(ch);
+        if (it != kanadata.end())
+            it->second.remove(index);
+    }
 
-    // Remove word from the search trees.
+    wordindex.remove(index);
 
-    dtree.removeLine(index, true);
-    ktree.removeLine(index, true);
-    btree.removeLine(index, true);
+    // The word is left in the search trees until compactEntries(), and searches skip it.
 }
 
 //bool Dictionary::importedWordStrings(const QString &line, int pos, int len, QString &kanji, QString &kana)
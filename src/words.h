@@ -15,10 +15,14 @@
 
 #include <memory>
 #include <map>
+#include <atomic>
+#include <functional>
 
 #include "zkanjimain.h"
 #include "fastarray.h"
 #include "searchtree.h"
+#include "postinglist.h"
+#include "wordkeyindex.h"
 
 // Parts of a word entry used as flags. Default is only used for main hints.
 enum class WordPartBits : uchar { Kanji = 0x01, Kana = 0x02, Definition = 0x04, Default = 0x08, AllParts = Kanji | Kana | Definition };
@@ -62,9 +66,12 @@ bool operator==(const WordDefinition &a, const WordDefinition &b);
 
 // General use word flags not stored on disk.
 // InGroup: the word is placed in at least one word group.
+// Removed: the word was removed from the dictionary, but its index is kept until the
+// dictionary's entries are compacted.
 enum class WordRuntimeData
 {
-    InGroup
+    InGroup,
+    Removed
 };
 
 // Data of a single word entry in dictionaries.
@@ -169,6 +176,10 @@ public:
     // Returns whether the passed word matches the filters inclusion list. Calls the other
     // match function with every filter not ignored and evaluates the result.
     bool match(const WordEntry *w, const WordFilterConditions *conditions) const;
+    // Returns whether match() can be called with conditions from multiple threads at the same
+    // time. Checking conditions that need the words' commons data is not safe, because that
+    // data is looked up in a tree that's not thread safe.
+    bool threadSafe(const WordFilterConditions *conditions) const;
 signals:
     // Signaled when a new filter has been added.
     void filterCreated();
@@ -271,9 +282,12 @@ public:
     // this list, but it is not checked.
     bool revertModified(int windex, WordEntry *w);
 
-    // Decrements every stored word's index if they have a value above windex. Removes the
-    // originals data of the word with windex if found. Returns whether changes were made.
+    // Removes the originals data of the word with windex if found. The index of other words
+    // is not changed. Returns whether changes were made.
     bool processRemovedWord(int windex);
+    // Updates the stored word indexes after the dictionary was compacted. The new index of a
+    // word is at its original index in changes. Removed words are not in the list.
+    void processCompactedWords(const std::vector<int> &changes);
 private:
     smartvector<OriginalWord> list;
 };
@@ -299,6 +313,7 @@ public:
     WordResultList(Dictionary *dict);
     WordResultList(WordResultList &&src);
     WordResultList& operator=(WordResultList &&src);
+    ~WordResultList();
 
     WordResultList(const WordResultList&) = delete;
     WordResultList& operator=(const WordResultList&) = delete;
@@ -361,6 +376,26 @@ public:
     // computed with windex removed from the list.
     int defInsertPos(QString searchstr, int windex, int *oldpos);
 
+    // Minimum number of items sorted by a lazy sort at a time.
+    enum { LazySortSize = 256 };
+
+    // Sorts the list in the same order as jpSort(), but only the first count items are moved
+    // to their sorted position. The rest of the list is sorted as it's accessed with
+    // sortTo(). Inserting or adding items sorts the whole list first.
+    void jpSortLazy(int count = LazySortSize);
+    // Sorts the list in the same order as defSort(), but only the first count items are moved
+    // to their sorted position. The rest of the list is sorted as it's accessed with
+    // sortTo(). Inserting or adding items sorts the whole list first.
+    void defSortLazy(QString searchstr, int count = LazySortSize);
+    // Makes sure the first count items are in their sorted position after a lazy sort. To
+    // avoid sorting the unsorted part of the list again for every few items, at least as
+    // many items are sorted as there are already in position.
+    void sortTo(int count);
+    // Number of items at the front of the list in their sorted position after a lazy sort.
+    // The items in getIndexes() after this position are not in order yet. Equals size() if
+    // the list is not being sorted.
+    int sortedSize() const;
+
     void removeAt(int ix);
 
     void insert(int pos, int wordindex);
@@ -372,10 +407,18 @@ public:
     // Expands the list with a new word and its inflections.
     void add(int wordindex, const std::vector<InfTypes> &inf);
 private:
+    // Reorders the items from position first to the end of the list to match the order of
+    // list. The list holds positions relative to first.
+    void sortRange(int first, const std::vector<int> &list);
+
     std::vector<int> indexes;
     smartvector<std::vector<InfTypes>> infs;
 
     Dictionary *dict;
+
+    // Sort data of the items not yet sorted by a lazy sort.
+    struct PendingSort;
+    std::unique_ptr<PendingSort> pending;
 };
 
 
@@ -401,6 +444,8 @@ public:
     using TextSearchTreeBase::loadLegacy;
     using TextSearchTreeBase::load;
     using TextSearchTreeBase::save;
+    using TextSearchTreeBase::loadFlat;
+    using TextSearchTreeBase::saveFlat;
 
     // Returns a list of words starting with the search string. If exact is true, the word
     // can't be longer than the romanized search. If sameform is true, the kana/kanji or
@@ -409,7 +454,9 @@ public:
     // The search string should be in Japanese form for kana trees, and not reversed. Pass a
     // list for the results in result. Pass a list of word indexes in wordpool to limit the
     // possible results to the words in that list. This list must be sorted.
-    void findWords(std::vector<int> &result, QString search, bool exact, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize = 0);
+    // When the value of cancel is set from another thread, the search stops early and result
+    // only holds part of the found words.
+    void findWords(std::vector<int> &result, QString search, bool exact, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize = 0, const std::atomic<bool> *cancel = nullptr);
     // Returns whether the result of findWords() would hold windex with the passed arguments.
     // Filter conditions and word filtering list are not supported. This function can be fast
     // for a single value, but it's slow to use in place of findWords(). Pass a boolean
@@ -480,10 +527,14 @@ public:
     // Updates the definition list's word indexes by the changes mapping and rebuilds the
     // tree. If multiple definitions are changed to the same new word index, the first one is
     // kept and the rest will be lost. Definitions with a new index of -1 are removed.
-    void applyChanges(std::map<int, int> &changes);
+    void applyChanges(const std::vector<int> &changes);
 
-    // Called when a word was removed from the dictionary.
+    // Called when a word was removed from the dictionary. The index of other words is not
+    // changed.
     void processRemovedWord(int windex);
+    // Updates the definition list's word indexes after the dictionary was compacted. The
+    // removed words are not in the list.
+    void processCompactedWords(const std::vector<int> &changes);
 
     // Number of definitions stored.
     virtual size_type size() const override;
@@ -674,7 +725,7 @@ private:
 struct KanjiDictData
 {
     // Index of words containing the kanji.
-    std::vector<int> words;
+    PostingList words;
     // Meanings assigned to the kanji by users of a given dictionary.
     QCharStringList meanings;
     // Words that contain the kanji and were selected by the user as examples.
@@ -707,8 +758,13 @@ signals:
 
     // Emited before removing an entry.
     //void entryAboutToBeRemoved(int windex);
-    // Emited after an entry was removed.
+    // Emited after an entry was removed. The indexes of other entries don't change until
+    // entriesCompacted() is emited.
     void entryRemoved(int windex, int abcdeindex, int aiueoindex);
+    // Emited after the removed entries were erased from the dictionary. Every word index
+    // stored outside the dictionary must be changed to its value in changes. Removed words
+    // are mapped to -1.
+    void entriesCompacted(const std::vector<int> &changes);
 
     // Emited after a word entry's frequency or word attributes (inf) changed.
     //void entryAttribChanged(int windex);
@@ -737,6 +793,13 @@ signals:
     void kanjiMeaningChanged(int kindex);
 public:
 
+    // Parts of the user data, which are saved separately in the user data journal. The values
+    // can be combined as flags.
+    enum class UserData : uchar { Words = 0x01, Groups = 0x02, Study = 0x04, Definitions = 0x08, Kanji = 0x10, All = 0x1f };
+    // Single edits of the user data, which are written to the journal instead of the whole
+    // part they changed. They are applied again in order after the user data is loaded.
+    enum class UserDataOp : uchar { DeckStartTest = 1, DeckNewItems, DeckAnswer, DeckReadingAnswered, GroupInsert, GroupRemove, GroupMove, StudyDefinition };
+
     Dictionary(const Dictionary&) = delete;
     Dictionary& operator=(const Dictionary&) = delete;
 
@@ -744,7 +807,7 @@ public:
     ~Dictionary();
     // Constructs a dictionary from imported data.
     Dictionary(smartvector<WordEntry> &&words, TextSearchTree &&dtree, TextSearchTree &&ktree, TextSearchTree &&btree,
-        smartvector<KanjiDictData> &&kanjidata, std::map<ushort, std::vector<int>> &&symdata, std::map<ushort, std::vector<int>> &&kanadata,
+        smartvector<KanjiDictData> &&kanjidata, std::map<ushort, PostingList> &&symdata, std::map<ushort, PostingList> &&kanadata,
         std::vector<int> &&abcde, std::vector<int> &&aiueo);
 
     // Loads the base dictionary data which mainly consists of data for kanji.
@@ -754,6 +817,8 @@ public:
     // Set skiporiginals to true for user dictionaries.
     // Both basedict and skiporiginals are only used for the old data formats.
     void loadFile(const QString &filename, bool maindict, bool skiporiginals);
+    // Loads the user data from filename. The changes saved to the journal of the file with
+    // saveUserDataJournal() are applied as well.
     void loadUserDataFile(const QString &filename, bool emitreset);
 
     void loadBaseLegacy(QDataStream &stream, int version);
@@ -763,7 +828,9 @@ public:
     void load(QDataStream &stream);
 
     void loadUserDataLegacy(QDataStream &stream, int version);
-    void loadUserData(QDataStream &stream, int version);
+    // Loads the user data after the file header. From version 4, the parts saved in the
+    // journal file journalname replace those in the stream.
+    void loadUserData(QDataStream &stream, int version, const QString &journalname = QString());
 
     void clearUserData();
 
@@ -781,6 +848,7 @@ public:
     //void fixStudyData();
 
     // Saves the base file with the given name and returns false if there was an error.
+    // The base file is written with QDataStream. Only dictionary files use the flat format.
     Error saveBase(const QString &filename);
 
     // Saves the dictionary with the given name and returns false if there was an error.
@@ -788,8 +856,15 @@ public:
     Error save(const QString &filename);
 
     // Saves the user data, including changed dictionary words for the main dictionary.
-    // Updates user data modified status to false.
+    // Updates user data modified status to false. The journal of the file is deleted.
     Error saveUserData(const QString &filename);
+    // Appends the modified parts of the user data to the journal of filename, which must
+    // have been written by saveUserData(). The journal is applied when the file is loaded.
+    // The whole file is saved instead when it's in an older format or the journal grew too
+    // large. Updates user data modified status to false.
+    Error saveUserDataJournal(const QString &filename);
+    // Name of the journal file belonging to the user data file filename.
+    static QString userDataJournalName(const QString &filename);
 
     // Writes an export file of user data that can be imported later.  Pass the kanji groups
     // to write in kgroups and the words groups to write in wgroups. Set kexamples to true to
@@ -831,10 +906,11 @@ public:
     void setInfoText(QString text);
 
     // Swaps the dictionary data of src with this dictionary, keeping old groups and study
-    // data. The word indexes in the user data is then updated with the changes mapping.
+    // data. The word indexes in the user data is then updated with the changes mapping,
+    // which holds the new word index at every old word index, or -1 for removed words.
     // After the swap, src will hold a copy of the original dictionary data, and user data.
     // This data can be restored by calling restoreChanges() with the same dictionary.
-    void swapDictionaries(Dictionary *src, std::map<int, int> &changes);
+    void swapDictionaries(Dictionary *src, const std::vector<int> &changes);
     // Restores the dictionary after an update made with applyChanges(). Passing any other
     // source dictionary than that in applyChanges() will result in undefined behavior.
     void restoreChanges(Dictionary *src);
@@ -845,8 +921,13 @@ public:
     void setToModified();
     // Whether the user data has been modified since the last load or save.
     bool isUserModified() const;
-    // Changes the user data modified flag to true.
-    void setToUserModified();
+    // Changes the user data modified flag to true. Pass the parts of the user data that were
+    // changed, which will be written to the journal on the next save.
+    void setToUserModified(UserData parts = UserData::All);
+    // Changes the user data modified flag to true, but only a single edit of part will be
+    // written to the journal, with the data written by func. Call after the edit was made.
+    // Nothing is recorded if the whole part will be saved anyway.
+    void addUserDataOp(UserData part, UserDataOp op, const std::function<void(QDataStream&)> &func);
 
     WordGroups& wordGroups();
     KanjiGroups& kanjiGroups();
@@ -854,6 +935,8 @@ public:
     const KanjiGroups& kanjiGroups() const;
 
     // Number of entries found in the dictionary. Each entry can hold multiple translations.
+    // Removed entries are counted until the next compactEntries(), so the result is the
+    // upper bound of word indexes and not the number of valid words.
     int entryCount() const;
     WordEntry* wordEntry(int ix);
     const WordEntry* wordEntry(int ix) const;
@@ -863,8 +946,17 @@ public:
     // The kanji and kana must only contain valid characters.
     //int createEntry(const QString &kanji, const QString &kana, ushort freq, uint inf/*, QString defstr, const WordDefAttrib &attrib*/);
 
-    // Removes a word entry from the dictionary, removing it from every index.
+    // Removes a word entry from the dictionary, removing it from every index. The entry is
+    // only marked as removed, and the indexes of other words stay the same until the next
+    // call to compactEntries().
     void removeEntry(int windex);
+    // Returns whether the entry at windex was removed with removeEntry() and is waiting to
+    // be erased by compactEntries().
+    bool isEntryRemoved(int windex) const;
+    // Erases the removed entries from the dictionary and updates the word indexes in every
+    // list referencing them. Emits entriesCompacted() if there were removed entries. Called
+    // before the dictionary or its user data is saved.
+    void compactEntries();
 
     // Returns whether the entry at windex is found in the originals list and was created by
     // the user. Only valid for the base dictionary().
@@ -922,7 +1014,8 @@ public:
     void getKanjiWords(const std::vector<ushort> &kanji, std::vector<int> &dest) const;
     // Returns the number of words that contain a given kanji.
     int kanjiWordCount(short kindex) const;
-    // Returns the index of the word in the list of words which contain the passed kanji.
+    // Returns the index of the word in the list of words which contain the passed kanji. The
+    // lists are compressed, so use getKanjiWords() when every word is needed.
     int kanjiWordAt(short kindex, int ix) const;
 
     // Lists a word as an example for kanji at kindex. Checks whether the same word has been
@@ -970,7 +1063,9 @@ public:
     // dictionary version is not checked.
     // WARNING: Passing a search string made with QString::fromRawData() might not be null
     // terminated, or the null might come too late. In that case this function can fail.
-    void findWords(WordResultList &result, SearchMode searchmode, QString search, SearchWildcards wildcards, bool sameform, bool inflections, bool studydefs, const std::vector<int> *wordpool, const WordFilterConditions *conditions);
+    // When the value of cancel is set from another thread, the search stops early and the
+    // result is incomplete.
+    void findWords(WordResultList &result, SearchMode searchmode, QString search, SearchWildcards wildcards, bool sameform, bool inflections, bool studydefs, const std::vector<int> *wordpool, const WordFilterConditions *conditions, const std::atomic<bool> *cancel = nullptr);
 
     // Determines whether the passed word index would be listed in the result of findWords(),
     // if searching with the same parameters. Fills inftypes with the inflections affecting
@@ -986,7 +1081,8 @@ public:
     // possible results to the words in that list. This list must be sorted.
     // WARNING: Passing a search string made with QString::fromRawData() might not be null terminated,
     // or the null might come too late. In that case this function can fail.
-    void findKanjiWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize = 0) const;
+    // The search stops early when the value of cancel is set from another thread.
+    void findKanjiWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize = 0, const std::atomic<bool> *cancel = nullptr) const;
     // Returns whether the result of findKanjiWords() would contain windex. This check is fast
     // for a single value, but much slower than findKanjiWords() when filling a results list.
     bool wordMatchesKanjiSearch(int windex, QString search, SearchWildcards wildcards, bool sameform, int infsize = 0) const;
@@ -1000,16 +1096,28 @@ public:
     // possible results to the words in that list. This list must be sorted.
     // WARNING: Passing a search string made with QString::fromRawData() might not be null terminated,
     // or the null might come too late. In that case this function can fail.
-    void findKanaWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize = 0);
+    // The search stops early when the value of cancel is set from another thread.
+    void findKanaWords(std::vector<int> &result, QString search, SearchWildcards wildcards, bool sameform, const std::vector<int> *wordpool, const WordFilterConditions *conditions, int infsize = 0, const std::atomic<bool> *cancel = nullptr);
+
+    // Returns whether findKanjiWords() and findKanaWords() can be called from multiple
+    // threads at the same time. This is true while the search trees are frozen. Editing the
+    // dictionary converts them back to the mutable form until freezeTrees() is called. Set
+    // studydefs to true to check whether definition searches that include the user defined
+    // study definitions are safe too.
+    bool threadSafeSearch(bool studydefs = false) const;
+    // Converts the search trees to their read-only form, which is faster to search and can
+    // be searched from multiple threads. Called after loading the dictionary or the user
+    // data, and after the dictionary was edited.
+    void freezeTrees();
     // Returns whether the result of findKanaWords() would contain windex. This check is fast
     // for a single value, but much slower than findKanaWords() when filling a results list.
     bool wordMatchesKanaSearch(int windex, QString search, SearchWildcards wildcards, bool sameform, const int infsize = 0);
 
 
-    // Returns the index of the word with the exact kanji, kana and romaji. Romaji must
-    // correspond to the kana, but it's not required when not available. If the word is not
-    // found, -1 is returned.
-    int findKanjiKanaWord(const QChar *kanji, const QChar *kana, const QChar *romaji = nullptr, int kanjilen = -1, int kanalen = -1, int romajilen = -1);
+    // Returns the index of the word with the exact kanji and kana. If the word is not found,
+    // -1 is returned. The words are looked up in a hash table, which is built on the first
+    // call, and updated when words are added or removed.
+    int findKanjiKanaWord(const QChar *kanji, const QChar *kana, int kanjilen = -1, int kanalen = -1);
 
     // Returns the index of the word with the exact kanji and kana. If the word is not found,
     // -1 is returned.
@@ -1105,9 +1213,11 @@ public:
     // imports. The returned list is sorted by index and every index is unique.
     void listUsedWords(std::vector<int> &result);
 
-    // Returns a mapping of word indexes from src to this dictionary, for the
-    // word indexes passed in wlist.
-    std::map<int, int> mapWords(Dictionary *src, const std::vector<int> &wlist);
+    // Returns a mapping of word indexes from src to this dictionary, for the word indexes
+    // passed in wlist. The returned list holds the index in this dictionary at the index of
+    // every word in src. It's -1 for words not found and for words not in wlist. The words
+    // are looked up in parallel.
+    std::vector<int> mapWords(Dictionary *src, const std::vector<int> &wlist);
 
     // Returns a mapping of word indexes from the main dictionary to this dictionary for
     // originalwords.
@@ -1133,15 +1243,52 @@ public:
     // dictionary, if it was modified by the user. User created words are not modified.
     void revertEntry(int windex);
 private:
+    // Loads the dictionary data after the file header from a file written in the flat
+    // format. The file of the stream's device is mapped in memory while loading, and its
+    // strings, trees and word lists are copied from there in bulk.
+    // Version 2 files hold the search trees in pre-order, version 3 files in their frozen
+    // form, and version 4 files hold the word lists of kanji, symbols and kana compressed.
+    void loadFlat(QDataStream &stream, int version);
+
+    // Loads a single part of the user data from stream.
+    void loadUserDataPart(QDataStream &stream, UserData part, int version);
+    // Writes a single part of the user data to stream.
+    void saveUserDataPart(QDataStream &stream, UserData part) const;
+    // A single edit of the user data recorded with addUserDataOp().
+    struct UserDataEdit
+    {
+        UserData part;
+        UserDataOp op;
+        QByteArray data;
+    };
+
+    // Reads the journal file of a user data file, which was saved with stamp. The latest data
+    // of each part in the journal is placed in parts, and the edits recorded after them in
+    // ops, if parts is not null. The journal's format version is placed in version. Returns
+    // the size of the journal up to the first record that was not fully written, or 0 if the
+    // journal doesn't exist or belongs to a different save.
+    static qint64 readUserDataJournal(const QString &journalname, qint64 stamp, int &version, std::map<UserData, QByteArray> *parts, std::vector<UserDataEdit> *ops);
+    // Applies an edit recorded with addUserDataOp() to the loaded user data.
+    void applyUserDataOp(UserDataOp op, const QByteArray &data);
+
+    // Adds a cursor to cursors for the word list of every kanji and symbol in search. Symbols
+    // not used in any word are skipped.
+    void kanjiSearchCursors(const QString &search, std::vector<PostingCursor> &cursors) const;
+
     // Adds a word to necessary lists and maps. The abcde and aiueo lists, kanji, kana and
     // symbol data lists/maps, and the kana and definition trees. The word must be the latest
     // added word to the dictionary with an index of words.size() - 1.
     // If the added word lacks any definitions, the definition tree will be unchanged. Any
     // definitions created later must be added to the definition tree separately.
     void addWordData();
-    // Erases every trace of a word with the given index from lists and maps. Sets abcde and
-    // aiueo indexes to the word's index in these lists.
+    // Erases the word with the given index from lists and maps, without changing the indexes
+    // of other words. Only the lists the word can be found in are updated. The word is left
+    // in the search trees until compactEntries(). Sets abcde and aiueo indexes to the word's
+    // index in these lists.
     void removeWordData(int index, int &abcdeindex, int &aiueoindex);
+    // Calls freezeTrees() once control returns to the event loop. Edits made in the same
+    // batch only cause a single freeze.
+    void freezeLater();
 
     //// Sets the kanji and kana strings to those found in line starting at pos up to len
     //// characters. The format of the line's substring should be kanji(kana). Returns whether
@@ -1168,11 +1315,27 @@ private:
     // Dictionary was modified since last save.
     bool mod;
 
-    // User data was modified since last save.
-    bool usermod;
+    // Number of words marked as removed and not yet erased by compactEntries().
+    int removedcnt;
+
+    // Parts of the user data modified since last save, as UserData flags.
+    uchar usermod;
+
+    // Edits of user data parts not in usermod, since last save.
+    std::vector<UserDataEdit> userops;
+
+    // Set while a call to freezeTrees() is queued by freezeLater().
+    bool freezequeued;
+
+    // Character data of the words and definitions loaded from the dictionary file. Must be
+    // declared before words, to be destroyed after them.
+    QCharStringArena strings;
 
 	smartvector<WordEntry> words;
 
+    // Words by their kanji and kana for findKanjiKanaWord().
+    WordKeyIndex wordindex;
+
     // Definitions tree.
     TextSearchTree dtree;
 
@@ -1187,16 +1350,16 @@ private:
     smartvector<KanjiDictData> kanjidata;
 
     // List of words containing the unicode symbols in their written form, kana excluded. The
-    // key is the unicode value for the symbols. The lists must be sorted by word index and
-    // every item must be unique. The symbols are those in the ZKanji::validcode array.
-    std::map<ushort, std::vector<int>> symdata;
+    // key is the unicode value for the symbols. The lists are sorted by word index and every
+    // item is unique. The symbols are those in the ZKanji::validcode array.
+    std::map<ushort, PostingList> symdata;
 
     // List of words containing each hiragana (or small ka/ke or vu not in hiragana). The
     // hiragana characters are taken both from the romanized form of the word's kana, using
     // kanavowelize(), and its kana string. In the latter case katakana is converted to
     // hiragana unless it's larger than 0x30F4 (small ka ke etc.) Look into importJMdict() for
-    // details. The lists must be sorted by word index and every item must be unique.
-    std::map<ushort, std::vector<int>> kanadata;
+    // details. The lists are sorted by word index and every item is unique.
+    std::map<ushort, PostingList> kanadata;
 
     // Alphabetic ordering of words.
     std::vector<int> abcde;
@@ -1250,6 +1413,30 @@ namespace ZKanji
     // normal means.
     void findEntriesByKana(std::vector<WordEntriesResult> &result, const QString &kana);
 
+    // Set whether searches with multiple independent parts, like the deinflected forms of a
+    // word or the same search in every dictionary, can run on multiple threads. The results
+    // are the same either way. Parallel search is enabled by default.
+    void setParallelSearch(bool enable);
+    bool parallelSearch();
+
+    // Searches running on other threads than the main thread register their cancel flag by
+    // calling beginBackgroundSearch() on the main thread before they start, and call
+    // endBackgroundSearch() from their own thread when they finished. Code that changes the
+    // dictionaries, the word filters or the settings used in searches must first call
+    // stopBackgroundSearches(), which sets every registered cancel flag and waits for the
+    // searches to end.
+    void beginBackgroundSearch(std::atomic<bool> *cancel);
+    void endBackgroundSearch(std::atomic<bool> *cancel);
+    void stopBackgroundSearches();
+    // Sets the value of cancel and waits for the search registered with it to end.
+    void stopBackgroundSearch(std::atomic<bool> *cancel);
+
+    // Measures the time taken by Japanese searches with inflections in the main dictionary,
+    // both with and without parallel search. Each query in queries is searched repeat times.
+    // When queries is empty, a built in list of inflected words is used. Returns a report
+    // with the average search time of every query.
+    QString benchmarkFindWords(const QStringList &queries = QStringList(), int repeat = 20);
+
     WordAttributeFilterList& wordfilters();
 
     // Adds dictionary to the dictionaries list. If a dictionary is already present, an
@@ -1307,8 +1494,9 @@ namespace ZKanji
     void changeDictionaryOrder(const std::list<quint8> &order);
 
     // Saves every modified dictionary and group to the user data folder. Set forced to true
-    // to save unmodified data too.
-    void saveUserData(bool forced = false);
+    // to save unmodified data too. Set journal to only append the modified parts of the user
+    // data to the journal files, unless the whole files must be saved.
+    void saveUserData(bool forced = false, bool journal = false);
 
     // Checks whether the user data files should be backed up according to the user settings,
     // and creates a backup of the current files in so. Removes any extra backup files first,
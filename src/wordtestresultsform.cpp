@@ -109,6 +109,13 @@ void WordStudyItemModel::entryRemoved(int /*windex*/, int /*abcdeindex*/, int /*
     ;
 }
 
+void WordStudyItemModel::entriesCompacted(const std::vector<int> &/*changes*/)
+{
+    // The model is not used in windows that are shown while the dictionary can be
+    // manipulated.
+    ;
+}
+
 void WordStudyItemModel::entryChanged(int /*windex*/, bool /*studydef*/)
 {
     // The model is not used in windows that are shown while the dictionary can be
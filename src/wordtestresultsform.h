@@ -42,6 +42,7 @@ public:
 protected slots:
     //virtual void entryAboutToBeRemoved(int windex) override;
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 private:
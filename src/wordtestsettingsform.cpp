@@ -556,6 +556,11 @@ void TestWordsItemModel::entryRemoved(int /*windex*/, int /*abcdeindex*/, int /*
     ;
 }
 
+void TestWordsItemModel::entriesCompacted(const std::vector<int> &/*changes*/)
+{
+    ;
+}
+
 //void TestWordsItemModel::entryChanged(int windex, bool studydef)
 //{
 //    ;
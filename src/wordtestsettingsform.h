@@ -83,6 +83,7 @@ public:
     bool sortOrder(int c, int a, int b) const;
 protected slots:
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 private:
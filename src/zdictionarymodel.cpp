@@ -9,6 +9,8 @@
 #include <QColor>
 #include <QSet>
 #include <QStringBuilder>
+#include <QThreadPool>
+#include <algorithm>
 //#include "zkanjimain.h"
 #include "zdictionarymodel.h"
 #include "words.h"
@@ -454,6 +456,7 @@ void DictionaryItemModel::connect()
     connect(dictionary(), &Dictionary::entryChanged, this, &DictionaryItemModel::entryChanged);
     //connect(dictionary(), &Dictionary::entryAboutToBeRemoved, this, &DictionaryItemModel::entryAboutToBeRemoved);
     connect(dictionary(), &Dictionary::entryRemoved, this, &DictionaryItemModel::entryRemoved);
+    connect(dictionary(), &Dictionary::entriesCompacted, this, &DictionaryItemModel::entriesCompacted);
     connect(dictionary(), &Dictionary::entryAdded, this, &DictionaryItemModel::entryAdded);
 
     connected = true;
@@ -709,22 +712,22 @@ void DictionaryWordListItemModel::settingsChanged()
 
 void DictionaryWordListItemModel::entryRemoved(int windex, int /*abcdeindex*/, int /*aiueoindex*/)
 {
-    int wpos = -1;
-    for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
-    {
-        if (list[ix] == windex)
-            wpos = ix;
-        else if (list[ix] > windex)
-            --list[ix];
-    }
-
-    if (wpos == -1)
+    auto it = std::find(list.begin(), list.end(), windex);
+    if (it == list.end())
         return;
 
-    list.erase(list.begin() + wpos);
+    int wpos = tosigned(it - list.begin());
+    list.erase(it);
     signalRowsRemoved({ { wpos, wpos } }); //endRemoveRows();
 }
 
+void DictionaryWordListItemModel::entriesCompacted(const std::vector<int> &changes)
+{
+    // Removed entries were taken out of the list in entryRemoved().
+    for (int &windex : list)
+        windex = changes[windex];
+}
+
 void DictionaryWordListItemModel::entryChanged(int windex, bool /*studydef*/)
 {
     int pos = -1;
@@ -910,6 +913,12 @@ void DictionaryDefinitionListItemModel::entryRemoved(int windex, int /*abcdeinde
     endResetModel();
 }
 
+void DictionaryDefinitionListItemModel::entriesCompacted(const std::vector<int> &changes)
+{
+    if (index != -1)
+        index = changes[index];
+}
+
 void DictionaryDefinitionListItemModel::entryChanged(int windex, bool studydef)
 {
     if (windex != index || studydef)
@@ -927,7 +936,7 @@ void DictionaryDefinitionListItemModel::entryAdded(int /*windex*/)
 //-------------------------------------------------------------
 
 
-DictionarySearchResultItemModel::DictionarySearchResultItemModel(QObject *parent) : base(parent), sdict(nullptr)
+DictionarySearchResultItemModel::DictionarySearchResultItemModel(QObject *parent) : base(parent), searchid(0), sdict(nullptr)
 {
     connect(&ZKanji::wordfilters(), &WordAttributeFilterList::filterMoved, this, &DictionarySearchResultItemModel::filterMoved);
     connect(gUI, &GlobalUI::settingsChanged, this, &DictionarySearchResultItemModel::settingsChanged);
@@ -935,7 +944,10 @@ DictionarySearchResultItemModel::DictionarySearchResultItemModel(QObject *parent
 
 DictionarySearchResultItemModel::~DictionarySearchResultItemModel()
 {
-
+    // The searches must end before the model is gone, as they report back to the model.
+    // Searches that already ended return immediately.
+    for (auto &cancel : searches)
+        ZKanji::stopBackgroundSearch(cancel.get());
 }
 
 void DictionarySearchResultItemModel::search(SearchMode mode, Dictionary *dict, QString searchstr, SearchWildcards wildcards, bool strict, bool inflections, bool studydefs, WordFilterConditions *cond)
@@ -953,6 +965,11 @@ void DictionarySearchResultItemModel::search(SearchMode mode, Dictionary *dict,
         sdict = dict;
         if (sdict != nullptr)
             connect();
+
+        // Results from another dictionary can't be shown while the new search runs.
+        beginResetModel();
+        list.reset(new WordResultList(sdict));
+        endResetModel();
     }
 
     swildcards = wildcards;
@@ -972,16 +989,102 @@ void DictionarySearchResultItemModel::search(SearchMode mode, Dictionary *dict,
 
     resultorder = Settings::dictionary.resultorder;
 
-    list.reset(new WordResultList(dict));
+    startSearch();
+}
+
+void DictionarySearchResultItemModel::startSearch()
+{
+    ++searchid;
+    if (searchcancel)
+    {
+        // The results of the previous search won't be used.
+        searchcancel->store(true);
+        searchcancel.reset();
+    }
+
+    if (!sdict->threadSafeSearch(sstudydefs && smode == SearchMode::Definition) || !ZKanji::wordfilters().threadSafe(scond.get()))
+    {
+        std::unique_ptr<WordResultList> found(new WordResultList(sdict));
+        sdict->findWords(*found, smode, ssearchstr, swildcards, sstrict, sinflections, sstudydefs, nullptr, scond.get());
+        sortResults(*found, smode, ssearchstr);
+
+        beginResetModel();
+        list = std::move(found);
+        endResetModel();
+        return;
+    }
+
+    std::shared_ptr<std::atomic<bool>> cancel = std::make_shared<std::atomic<bool>>(false);
+    searchcancel = cancel;
+    searches.push_back(cancel);
+    ZKanji::beginBackgroundSearch(cancel.get());
+
+    // The search parameters can change while the search runs, so it gets its own copy.
+    std::shared_ptr<WordFilterConditions> cond;
+    if (scond)
+        cond = std::make_shared<WordFilterConditions>(*scond);
+    int id = searchid;
+    Dictionary *dict = sdict;
+    SearchMode mode = smode;
+    QString searchstr = ssearchstr;
+    SearchWildcards wildcards = swildcards;
+    bool strict = sstrict;
+    bool inflections = sinflections;
+    bool studydefs = sstudydefs;
+
+    // Sorting by JLPT level looks up the words in the commons tree, which is not thread safe.
+    // In that case the results are sorted on the main thread.
+    bool sort = resultorder != ResultOrder::JLPTfrom1 && resultorder != ResultOrder::JLPTfrom5;
+
+    QThreadPool::globalInstance()->start([this, id, cancel, cond, dict, mode, searchstr, wildcards, strict, inflections, studydefs, sort]() {
+        std::shared_ptr<WordResultList> found = std::make_shared<WordResultList>(dict);
+        dict->findWords(*found, mode, searchstr, wildcards, strict, inflections, studydefs, nullptr, cond.get(), cancel.get());
+        if (sort && !cancel->load())
+            sortResults(*found, mode, searchstr);
+
+        // The model waits for every search in its searches list to end before it's
+        // destroyed, so it's valid here. The queued call is dropped if the model is destroyed
+        // before it arrives.
+        QMetaObject::invokeMethod(this, [this, id, cancel, found, sort]() { searchFinished(id, cancel, found, sort); }, Qt::QueuedConnection);
+
+        ZKanji::endBackgroundSearch(cancel.get());
+    });
+}
+
+void DictionarySearchResultItemModel::searchFinished(int id, std::shared_ptr<std::atomic<bool>> cancel, std::shared_ptr<WordResultList> found, bool sorted)
+{
+    searches.erase(std::find(searches.begin(), searches.end(), cancel));
+
+    if (id != searchid || cancel != searchcancel)
+        return;
+
+    // The flag is checked here and not in the search's thread, because it can be set after
+    // the search finished but before its results arrived.
+    bool canceled = searchcancel->load();
+    searchcancel.reset();
+
+    if (canceled)
+    {
+        startSearch();
+        return;
+    }
+
+    if (!sorted)
+        sortResults(*found, smode, ssearchstr);
 
     beginResetModel();
-    sdict->findWords(*list, mode, searchstr, wildcards, strict, inflections, studydefs, nullptr, cond);
-    if (smode == SearchMode::Japanese)
-        list->jpSort();
-    else if (smode == SearchMode::Definition)
-        list->defSort(ssearchstr);
+    list.reset(new WordResultList(std::move(*found)));
     endResetModel();
+}
 
+void DictionarySearchResultItemModel::sortResults(WordResultList &found, SearchMode mode, const QString &searchstr)
+{
+    // Only the first rows are sorted here. The rest are sorted when the view scrolls to them
+    // and asks for their data.
+    if (mode == SearchMode::Japanese)
+        found.jpSortLazy();
+    else if (mode == SearchMode::Definition)
+        found.defSortLazy(searchstr);
 }
 
 void DictionarySearchResultItemModel::resetFilterConditions()
@@ -996,6 +1099,7 @@ Dictionary* DictionarySearchResultItemModel::dictionary() const
 
 int DictionarySearchResultItemModel::indexes(int pos) const
 {
+    list->sortTo(pos + 1);
     return list->getIndexes()[pos];
 }
 
@@ -1010,6 +1114,7 @@ QVariant DictionarySearchResultItemModel::data(const QModelIndex &index, int rol
 {
     if (role == (int)DictRowRoles::Inflection)
     {
+        list->sortTo(index.row() + 1);
         auto &inflist = list->getInflections();
         if (tosigned(inflist.size()) <= index.row())
             return 0;
@@ -1077,19 +1182,20 @@ void DictionarySearchResultItemModel::settingsChanged()
 void DictionarySearchResultItemModel::entryRemoved(int windex, int /*abcdeindex*/, int /*aiueoindex*/)
 {
     auto &ind = list->getIndexes();
-    int wpos = -1;
-    for (int ix = 0, siz = tosigned(list->size()); ix != siz; ++ix)
-        if (ind[ix] == windex)
-            wpos = ix;
-        else if (ind[ix] > windex)
-            --ind[ix];
+    auto it = std::find(ind.begin(), ind.end(), windex);
+    if (it == ind.end())
+        return;
 
-    if (wpos != -1)
-    {
-        list->removeAt(wpos);
-        //endRemoveRows();
-        signalRowsRemoved({ { wpos, wpos } });
-    }
+    int wpos = tosigned(it - ind.begin());
+    list->removeAt(wpos);
+    //endRemoveRows();
+    signalRowsRemoved({ { wpos, wpos } });
+}
+
+void DictionarySearchResultItemModel::entriesCompacted(const std::vector<int> &changes)
+{
+    for (int &windex : list->getIndexes())
+        windex = changes[windex];
 }
 
 void DictionarySearchResultItemModel::entryChanged(int windex, bool studydef)
@@ -1417,7 +1523,7 @@ int DictionaryBrowseItemModel::indexes(int pos) const
 int DictionaryBrowseItemModel::rowCount(const QModelIndex &/*parent*/) const
 {
     if (!cond)
-        return dict->entryCount();
+        return tosigned(dict->wordOrdering(order).size());
 
     return tosigned(list.size());
 }
@@ -1464,14 +1570,12 @@ void DictionaryBrowseItemModel::entryRemoved(int windex, int abcdeindex, int aiu
     int wpos = -1;
     if (cond)
     {
-        for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
-            if (list[ix] > windex)
-                --list[ix];
-            else if (list[ix] == windex)
-                wpos = ix;
-
-        if (wpos != -1)
-            list.erase(list.begin() + wpos);
+        auto it = std::find(list.begin(), list.end(), windex);
+        if (it != list.end())
+        {
+            wpos = tosigned(it - list.begin());
+            list.erase(it);
+        }
     }
     else
     {
@@ -1485,6 +1589,16 @@ void DictionaryBrowseItemModel::entryRemoved(int windex, int abcdeindex, int aiu
         signalRowsRemoved({ { wpos, wpos } });
 }
 
+void DictionaryBrowseItemModel::entriesCompacted(const std::vector<int> &changes)
+{
+    // Without cond the rows come from the dictionary's ordering, which is already updated.
+    if (!cond)
+        return;
+
+    for (int &windex : list)
+        windex = changes[windex];
+}
+
 void DictionaryBrowseItemModel::entryChanged(int windex, bool studydef)
 {
     if (studydef)
@@ -1950,6 +2064,12 @@ void DictionaryGroupItemModel::entryRemoved(int /*windex*/, int /*abcdeindex*/,
     ;
 }
 
+void DictionaryGroupItemModel::entriesCompacted(const std::vector<int> &/*changes*/)
+{
+    // The rows are read from the group, which is updated by the dictionary.
+    ;
+}
+
 void DictionaryGroupItemModel::entryChanged(int windex, bool /*studydef*/)
 {
     // A word in the group's dictionary has changed, but the word might not be part of the
@@ -2690,10 +2810,11 @@ void KanjiWordsItemModel::fillList()
     else
     {
         KanjiEntry *k = ZKanji::kanjis[kix];
-        int siz = dict->kanjiWordCount(kix);
-        for (int ix = 0; ix != siz /-*dat->words.size()*-/; ++ix)
+        std::vector<int> kwords;
+        dict->getKanjiWords(kix, kwords);
+        for (int ix = 0, siz = tosigned(kwords.size()); ix != siz; ++ix)
         {
-            int wix = dict->kanjiWordAt(kix, ix); //dat->words[ix];
+            int wix = kwords[ix];
             WordEntry *e = dict->wordEntry(wix);
             if ((rix == -1 || matchKanjiReading(e->kanji, e->kana, k, rix)) && (!onlyex || dict->isKanjiExample(kix, wix) /-*std::find(dat->ex.begin(), dat->ex.end(), wix) != dat->ex.end()*-/ ))
                 list.push_back(wix);
@@ -2832,10 +2953,11 @@ void KanjiWordsItemModel::fillList(Dictionary *d)
     else
     {
         KanjiEntry *k = ZKanji::kanjis[kix];
-        int siz = d->kanjiWordCount(kix);
-        for (int ix = 0; ix != siz; ++ix)
+        std::vector<int> kwords;
+        d->getKanjiWords(kix, kwords);
+        for (int ix = 0, siz = tosigned(kwords.size()); ix != siz; ++ix)
         {
-            int wix = d->kanjiWordAt(kix, ix);
+            int wix = kwords[ix];
             WordEntry *e = d->wordEntry(wix);
             if ((rix == -1 || matchKanjiReading(e->kanji, e->kana, k, rix)) && (!onlyex || d->isKanjiExample(kix, wix)))
                 result.push_back(wix);
@@ -9,6 +9,8 @@
 
 #include <memory>
 #include <functional>
+#include <atomic>
+#include <vector>
 #include "fastarray.h"
 #include "zabstracttablemodel.h"
 #include "smartvector.h"
@@ -156,7 +158,12 @@ protected:
     void disconnect();
 protected slots:
     //virtual void entryAboutToBeRemoved(int windex) = 0;
+    // Called when an entry was removed from the dictionary. The indexes of other entries
+    // don't change until entriesCompacted() is called.
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) = 0;
+    // Called when the removed entries were erased from the dictionary. The new index of an
+    // entry is at its original index in changes, which is -1 for removed entries.
+    virtual void entriesCompacted(const std::vector<int> &changes) = 0;
     virtual void entryChanged(int windex, bool studydef) = 0;
     virtual void entryAdded(int windex) = 0;
     virtual void dictionaryToBeRemoved(int ind, int oldind, Dictionary *dict);
@@ -231,6 +238,7 @@ protected:
 protected slots:
     void settingsChanged();
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 private:
@@ -265,6 +273,7 @@ public:
 protected slots:
     //virtual void entryAboutToBeRemoved(int windex) override;
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 private:
@@ -290,7 +299,9 @@ public:
 
     // Populates the model by searching the dictionary according to the given conditions. Only
     // does a new search if the passed parameters are different from a previous call to this
-    // function.
+    // function. When possible, the search runs on another thread and the model is reset once
+    // its results arrive. Until then the model keeps showing the results of the previous
+    // search. Results of searches that were outdated by a newer call are dropped.
     void search(SearchMode mode, Dictionary *dict, QString searchstr, SearchWildcards wildcards, bool strict, bool inflections, bool studydefs, WordFilterConditions *cond);
 
     // Prepares the model for a new search in case the filter conditions changed, but does not
@@ -314,13 +325,36 @@ protected slots:
     void settingsChanged();
     //virtual void entryAboutToBeRemoved(int windex) override;
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 
     virtual void filterMoved(int index, int to);
 private:
+    // Searches with the saved search parameters. The search runs in the background if the
+    // dictionary and the filter conditions allow it, otherwise the model is updated
+    // immediately.
+    void startSearch();
+    // Called on the main thread when a background search finished. The results are dropped
+    // if the search is not the latest one. If the latest search was canceled, because the
+    // dictionary or the settings changed, it's started again. Set sorted to false if the
+    // found words must be sorted first.
+    void searchFinished(int id, std::shared_ptr<std::atomic<bool>> cancel, std::shared_ptr<WordResultList> found, bool sorted);
+    // Sorts the first rows of the found words of a search in mode for searchstr. The rest of
+    // the list is sorted as the rows are accessed.
+    static void sortResults(WordResultList &found, SearchMode mode, const QString &searchstr);
+
     std::unique_ptr<WordResultList> list;
 
+    // Incremented when a new search starts, to recognize the results of the latest search.
+    int searchid;
+    // Cancel flag of the latest search running in the background, or null.
+    std::shared_ptr<std::atomic<bool>> searchcancel;
+    // Cancel flags of every background search whose results haven't arrived yet, including
+    // the ones replaced by a newer search. The model must wait for all of them before it's
+    // destroyed, as they report back to the model.
+    std::vector<std::shared_ptr<std::atomic<bool>>> searches;
+
     // Saved search parameters. When calling search, if these match, the list is not updated.
 
     std::unique_ptr<WordFilterConditions> scond;
@@ -376,6 +410,7 @@ public:
 protected slots:
     //virtual void entryAboutToBeRemoved(int windex) override;
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 private:
@@ -438,6 +473,7 @@ public:
 protected slots:
     //virtual void entryAboutToBeRemoved(int windex) override {};
 virtual void entryRemoved(int /*windex*/, int /*abcdeindex*/, int /*aiueoindex*/) override {};
+virtual void entriesCompacted(const std::vector<int> &/*changes*/) override {};
 virtual void entryChanged(int /*windex*/, bool /*studydef*/) override {};
 virtual void entryAdded(int /*windex*/) override {};
 private:
@@ -481,6 +517,7 @@ public:
 protected slots:
     //virtual void entryAboutToBeRemoved(int windex) override;
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
     void dictionaryReset();
@@ -381,9 +381,9 @@ void ZExampleStrip::setItem(Dictionary *d, int windex, int wpos, int wordform)
     if (d == nullptr)
         windex = -1;
 
-    if (d != nullptr && windex != -1 && wpos != -1 && wordform != -1 && wordindex != -1 && sentence.words.size() > wpos && sentence.words[wpos].forms.size() > wordform)
+    if (d != nullptr && windex != -1 && wpos != -1 && wordform != -1 && wordindex != -1 && sentence->words.size() > wpos && sentence->words[wpos].forms.size() > wordform)
     {
-        const ExampleWordsData::Form &form = sentence.words[wpos].forms[wordform];
+        const ExampleWordsData::Form &form = sentence->words[wpos].forms[wordform];
         if (w->kanji == form.kanji && w->kana == form.kana)
             keepsentence = true;
     }
@@ -414,6 +414,7 @@ void ZExampleStrip::setItem(Dictionary *d, int windex, int wpos, int wordform)
     {
         connect(dict, &Dictionary::entryAdded, this, &ZExampleStrip::dictionaryChanged);
         connect(dict, &Dictionary::entryRemoved, this, &ZExampleStrip::dictionaryChanged);
+        connect(dict, &Dictionary::entriesCompacted, this, &ZExampleStrip::dictionaryChanged);
         connect(dict, &Dictionary::dictionaryReset, this, &ZExampleStrip::dictionaryChanged);
     }
 
@@ -664,19 +665,19 @@ void ZExampleStrip::paintEvent(QPaintEvent *e)
         int ttop = jtop + jh + gap / 2;
 
         painter.setFont(jf);
-        //painter.drawText(QRect(x, jtop, 1, 1), flags, sentence.japanese.toQStringRaw());
+        //painter.drawText(QRect(x, jtop, 1, 1), flags, sentence->japanese.toQStringRaw());
         paintJapanese(&painter, jfm, jtop);
 
         painter.setPen(Settings::textColor(this, ColorSettings::Text));
         painter.setFont(tf);
-        painter.drawText(QRect(x, ttop, 1, 1), flags, sentence.translated.toQStringRaw());
+        painter.drawText(QRect(x, ttop, 1, 1), flags, sentence->translated.toQStringRaw());
     }
     else if (display == ExampleDisplay::Japanese)
     {
         int jtop = r.top() + (r.height() - jh) / 2;
         painter.setPen(Settings::textColor(this, ColorSettings::Text));
         painter.setFont(jf);
-        //painter.drawText(QRect(x, jtop, 1, 1), flags, sentence.japanese.toQStringRaw());
+        //painter.drawText(QRect(x, jtop, 1, 1), flags, sentence->japanese.toQStringRaw());
         paintJapanese(&painter, jfm, jtop);
     }
     else
@@ -684,7 +685,7 @@ void ZExampleStrip::paintEvent(QPaintEvent *e)
         int ttop = r.top() + (r.height() - th) / 2;
         painter.setPen(Settings::textColor(this, ColorSettings::Text));
         painter.setFont(tf);
-        painter.drawText(QRect(x, ttop, 1, 1), flags, sentence.translated.toQStringRaw());
+        painter.drawText(QRect(x, ttop, 1, 1), flags, sentence->translated.toQStringRaw());
     }
 }
 
@@ -767,11 +768,11 @@ void ZExampleStrip::mouseMoveEvent(QMouseEvent *e)
             hovered = hpos;
             updateWordRect(hovered);
 
-            const ExampleWordsData &worddata = sentence.words[hovered];
+            const ExampleWordsData &worddata = sentence->words[hovered];
             if (worddata.forms.size() == 1)
             {
                 const ExampleWordsData::Form &wordform = worddata.forms[0];
-                if (wordform.kanji == wordform.kana && wordform.kanji.size() == worddata.len && qcharncmp(sentence.japanese.data() + worddata.pos, wordform.kana.data(), worddata.len) == 0)
+                if (wordform.kanji == wordform.kana && wordform.kanji.size() == worddata.len && qcharncmp(sentence->japanese.data() + worddata.pos, wordform.kana.data(), worddata.len) == 0)
                 {
                     popup.reset();
                     return;
@@ -850,9 +851,9 @@ int ZExampleStrip::scrollMax() const
         //int jh = jfm.height();
         //int th = tfm.height();
         if (display == ExampleDisplay::Both || display == ExampleDisplay::Japanese)
-            jpwidth = jfm.boundingRect(sentence.japanese.toQStringRaw()).width();
+            jpwidth = jfm.boundingRect(sentence->japanese.toQStringRaw()).width();
         if (display == ExampleDisplay::Both || display == ExampleDisplay::Translated)
-            trwidth = tfm.boundingRect(sentence.translated.toQStringRaw()).width();
+            trwidth = tfm.boundingRect(sentence->translated.toQStringRaw()).width();
     }
 
     if (display == ExampleDisplay::Both)
@@ -922,9 +923,7 @@ void ZExampleStrip::updateSentence()
     jpwidth = -1;
     trwidth = -1;
 
-    sentence.japanese.clear();
-    sentence.translated.clear();
-    sentence.words.clear();
+    sentence = ExampleSentence();
 
     if (wordindex != -1)
     {
@@ -1000,32 +999,32 @@ void ZExampleStrip::fillWordRects()
     // Currently word.
     int pos = 0;
 
-    while (pos != sentence.words.size())
+    while (pos != sentence->words.size())
     {
         int gappos = 0;
-        int gaplen = sentence.words[pos].pos;
+        int gaplen = sentence->words[pos].pos;
 
         if (pos != 0)
         {
-            gappos = sentence.words[pos - 1].pos + sentence.words[pos - 1].len;
-            gaplen = sentence.words[pos].pos - gappos;
+            gappos = sentence->words[pos - 1].pos + sentence->words[pos - 1].len;
+            gaplen = sentence->words[pos].pos - gappos;
         }
 
         // Non-word part of sentence between two words.
         if (gaplen != 0)
         {
-            QString str = sentence.japanese.toQString(gappos, gaplen);
+            QString str = sentence->japanese.toQString(gappos, gaplen);
             x += fm.horizontalAdvance(str);
         }
 
-        QString str = sentence.japanese.toQString(sentence.words[pos].pos, sentence.words[pos].len);
+        QString str = sentence->japanese.toQString(sentence->words[pos].pos, sentence->words[pos].len);
 
         int w = fm.horizontalAdvance(str);
 
         bool found = false;
-        for (int ix = 0; ix != sentence.words[pos].forms.size() && !found; ++ix)
+        for (int ix = 0; ix != sentence->words[pos].forms.size() && !found; ++ix)
         {
-            const ExampleWordsData::Form &f = sentence.words[pos].forms[ix];
+            const ExampleWordsData::Form &f = sentence->words[pos].forms[ix];
             found = dict->findKanjiKanaWord(f.kanji, f.kana) != -1;
         }
 
@@ -1063,30 +1062,30 @@ void ZExampleStrip::paintJapanese(QPainter *p, QFontMetrics &fm, int y)
 
     QPalette pal;
 
-    while (pos != sentence.words.size())
+    while (pos != sentence->words.size())
     {
         // Drawing two sentence parts. One before the current word but after the previous, and
         // the word at position.
 
         int gappos = 0;
-        int gaplen = sentence.words[pos].pos;
+        int gaplen = sentence->words[pos].pos;
 
         if (pos != 0)
         {
-            gappos = sentence.words[pos - 1].pos + sentence.words[pos - 1].len;
-            gaplen = sentence.words[pos].pos - gappos;
+            gappos = sentence->words[pos - 1].pos + sentence->words[pos - 1].len;
+            gaplen = sentence->words[pos].pos - gappos;
         }
 
         // Non-word part of sentence between two words.
         if (gaplen != 0)
         {
-            QString str = sentence.japanese.toQString(gappos, gaplen);
+            QString str = sentence->japanese.toQString(gappos, gaplen);
             p->setPen(Settings::textColor(this, ColorSettings::Text));
             p->drawText(x, y, 1, 1, flags, str);
             x += fm.horizontalAdvance(str);
         }
 
-        QString str = sentence.japanese.toQString(sentence.words[pos].pos, sentence.words[pos].len);
+        QString str = sentence->japanese.toQString(sentence->words[pos].pos, sentence->words[pos].len);
         // Skip the hovered word because it will be drawn separately below, so the drawn
         // bounding rectangle can cover neighbouring words.
         if (hovered != pos)
@@ -1101,9 +1100,9 @@ void ZExampleStrip::paintJapanese(QPainter *p, QFontMetrics &fm, int y)
             // Only add rectangle to words and word forms present in the current dictionary.
 
             bool found = false;
-            for (int ix = 0; ix != sentence.words[pos].forms.size() && !found; ++ix)
+            for (int ix = 0; ix != sentence->words[pos].forms.size() && !found; ++ix)
             {
-                const ExampleWordsData::Form &f = sentence.words[pos].forms[ix];
+                const ExampleWordsData::Form &f = sentence->words[pos].forms[ix];
                 found = dict->findKanjiKanaWord(f.kanji, f.kana) != -1;
             }
 
@@ -1120,11 +1119,11 @@ void ZExampleStrip::paintJapanese(QPainter *p, QFontMetrics &fm, int y)
     p->setPen(Settings::textColor(this, ColorSettings::Text));
 
     // Last part of the sentence without a word rectangle.
-    int gappos = sentence.words[pos - 1].pos + sentence.words[pos - 1].len;
-    if (gappos < tosigned(sentence.japanese.size()))
+    int gappos = sentence->words[pos - 1].pos + sentence->words[pos - 1].len;
+    if (gappos < tosigned(sentence->japanese.size()))
     {
-        int gaplen = sentence.japanese.size() - gappos;
-        QString str = sentence.japanese.toQString(gappos, gaplen);
+        int gaplen = sentence->japanese.size() - gappos;
+        QString str = sentence->japanese.toQString(gappos, gaplen);
         p->drawText(x, y, 1, 1, flags, str);
     }
 
@@ -1138,7 +1137,7 @@ void ZExampleStrip::paintJapanese(QPainter *p, QFontMetrics &fm, int y)
         r.adjust(0, 0, -1, -1);
         p->fillRect(r, Settings::textColor(this, ColorSettings::Bg));
 
-        QString str = sentence.japanese.toQString(sentence.words[hovered].pos, sentence.words[hovered].len);
+        QString str = sentence->japanese.toQString(sentence->words[hovered].pos, sentence->words[hovered].len);
 
         p->setPen(wordpos == hovered ? Settings::uiColor(ColorSettings::SentenceWord) : Settings::textColor(this, ColorSettings::Text));
         p->drawText(wordrect[hovered].left(), y, 1, 1, flags, str);
@@ -1188,7 +1187,7 @@ void ZExampleStrip::selectForm(int form, int wpos)
 {
     if (wordpos == hovered && wpos == -1)
     {
-        ExampleWordsData::Form &dat = sentence.words[wordpos].forms[form];
+        const ExampleWordsData::Form &dat = sentence->words[wordpos].forms[form];
         int windex = dict->findKanjiKanaWord(dat.kanji, dat.kana);
         if (windex == wordindex)
             return;
@@ -1198,7 +1197,7 @@ void ZExampleStrip::selectForm(int form, int wpos)
     if (popup && popup->underMouse())
         popup->deleteLater();
 
-    if (form < 0 || form >= sentence.words.size())
+    if (form < 0 || form >= sentence->words.size())
         form = 0;
 
     if (wpos == -1)
@@ -197,7 +197,7 @@ private:
     int current;
 
     // Data of the sentence being displayed.
-    ExampleSentenceData sentence;
+    ExampleSentence sentence;
 
     // A list of rectangle positions for every word in the current Japanese sentence. The list
     // is populated when the strip is first drawn with a new sentence or different display
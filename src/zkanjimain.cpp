@@ -7,6 +7,12 @@
 #include <QPoint>
 #include <QDir>
 #include <QStringBuilder>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+#include <exception>
 #include "zkanjimain.h"
 #include "kanji.h"
 #include "studydecks.h"
@@ -904,6 +910,7 @@ namespace ZKanji
         validkanji.clear();
         radlist.clear();
         kanjis.clear();
+        kanjistrings.clear();
         radkmap.clear();
         radklist.clear();
         radkcnt.clear();
@@ -926,6 +933,90 @@ namespace ZKanji
         return t.addDays((qint64)d).addMSecs((d - (qint64)d) * (24 * 60 * 60 * 1000)).toUTC();
     }
 
+    // Shared between the threads running the calls of a single parallelFor. It's kept alive
+    // by any thread pool task that started too late to get any work, after parallelFor
+    // already returned.
+    struct ParallelForData
+    {
+        std::function<void(int)> func;
+        int count;
+        std::atomic_int next;
+        std::atomic_int done;
+
+        // Set when a call of func threw. The remaining indexes are counted as done without
+        // calling func, and the first exception is rethrown by parallelFor.
+        std::atomic<bool> failed;
+        std::exception_ptr error;
+
+        QMutex mutex;
+        QWaitCondition finished;
+    };
+
+    static void parallelForWork(ParallelForData &data)
+    {
+        int ix;
+        while ((ix = data.next++) < data.count)
+        {
+            if (!data.failed)
+            {
+                try
+                {
+                    data.func(ix);
+                }
+                catch (...)
+                {
+                    QMutexLocker locker(&data.mutex);
+                    if (!data.failed.exchange(true))
+                        data.error = std::current_exception();
+                }
+            }
+
+            if (++data.done == data.count)
+            {
+                QMutexLocker locker(&data.mutex);
+                data.finished.wakeAll();
+            }
+        }
+    }
+
+    void parallelFor(int count, const std::function<void(int)> &func)
+    {
+        QThreadPool *pool = QThreadPool::globalInstance();
+        int helpers = std::min(count - 1, pool->maxThreadCount());
+
+        if (helpers <= 0)
+        {
+            for (int ix = 0; ix < count; ++ix)
+                func(ix);
+            return;
+        }
+
+        std::shared_ptr<ParallelForData> data = std::make_shared<ParallelForData>();
+        data->func = func;
+        data->count = count;
+        data->next = 0;
+        data->done = 0;
+        data->failed = false;
+
+        for (int ix = 0; ix != helpers; ++ix)
+            pool->start([data]() { parallelForWork(*data); });
+
+        // The calling thread takes part in the work too, so nothing is left waiting if the
+        // thread pool is busy.
+        parallelForWork(*data);
+
+        QMutexLocker locker(&data->mutex);
+        while (data->done != count)
+            data->finished.wait(&data->mutex);
+
+        if (data->error)
+        {
+            std::exception_ptr error = data->error;
+            locker.unlock();
+            std::rethrow_exception(error);
+        }
+    }
+
     static bool nobasedatafound = false;
     bool noData()
     {
@@ -772,6 +772,15 @@ namespace ZKanji
 
     QDateTime QDateTimeUTCFromTDateTime(double d);
 
+    // Calls func with every index from 0 to count - 1, distributing the calls between the
+    // calling thread and the threads of the global thread pool. Returns once every call has
+    // finished. The order of the calls is undefined, and func must be safe to call from
+    // multiple threads. Can be called from a thread of the global thread pool as well, as
+    // the calling thread works through the indexes itself when no other thread is free.
+    // If func throws, the indexes not yet started are skipped, and the first exception is
+    // rethrown once every started call has finished.
+    void parallelFor(int count, const std::function<void(int)> &func);
+
     // Shows the kanji information window with a kanji by the passed index.
     void showKanjiInfo(/*QWidget *owner,*/ Dictionary *d, int index);
 
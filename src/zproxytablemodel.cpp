@@ -12,15 +12,19 @@
 #include "zdictionarymodel.h"
 #include "words.h"
 #include "ranges.h"
+#include "romajizer.h"
 
 #include "checked_cast.h"
 
 //-------------------------------------------------------------
 
 
-DictionarySearchFilterProxyModel::DictionarySearchFilterProxyModel(QObject *parent) : base(parent), sortcolumn(-1), sortorder(Qt::AscendingOrder)/*, sdict(nullptr)*/
+DictionarySearchFilterProxyModel::DictionarySearchFilterProxyModel(QObject *parent) : base(parent), smode(SearchMode::Browse), swildcards(SearchWildcard::NoWildcard), sstrict(false),
+        sinflections(false), sstudydefs(false), sortcolumn(-1), sortorder(Qt::AscendingOrder)/*, sdict(nullptr)*/
 {
     connect(&ZKanji::wordfilters(), &WordAttributeFilterList::filterMoved, this, &DictionarySearchFilterProxyModel::filterMoved);
+    connect(&ZKanji::wordfilters(), &WordAttributeFilterList::filterChanged, this, [this]() { clearCache(); });
+    connect(&ZKanji::wordfilters(), &WordAttributeFilterList::filterErased, this, [this]() { clearCache(); });
 }
 
 DictionarySearchFilterProxyModel::~DictionarySearchFilterProxyModel()
@@ -89,6 +93,17 @@ void DictionarySearchFilterProxyModel::filter(SearchMode mode, QString searchstr
     if (sourceModel() == nullptr || sourceModel()->dictionary() == nullptr || (/*sdict == sourceModel()->dictionary() &&*/ smode == mode && swildcards == wildcards && sstrict == strict && sinflections == inflections && sstudydefs == studydefs && ((!scond && !cond) || (!scond == !cond && *scond == *cond)) && ssearchstr == searchstr))
         return;
 
+    // Source model rows matching the previous search, when only those must be checked.
+    std::vector<int> rows;
+    bool narrowed = narrowsSearch(mode, searchstr, wildcards, strict, inflections, studydefs, cond);
+    if (narrowed)
+    {
+        rows.reserve(list.size());
+        for (const auto &p : list)
+            rows.push_back(p.first);
+        std::sort(rows.begin(), rows.end());
+    }
+
     smode = mode;
     //sdict = sourceModel()->dictionary();
     swildcards = wildcards;
@@ -106,7 +121,13 @@ void DictionarySearchFilterProxyModel::filter(SearchMode mode, QString searchstr
 
     ssearchstr = searchstr;
 
-    fillLists(sourceModel());
+    beginResetModel();
+    if (!restoreLists())
+    {
+        fillLists(sourceModel(), narrowed ? &rows : nullptr);
+        cacheLists();
+    }
+    endResetModel();
 }
 
 void DictionarySearchFilterProxyModel::sortBy(int column, Qt::SortOrder order, ProxySortFunction func)
@@ -192,6 +213,8 @@ void DictionarySearchFilterProxyModel::setSourceModel(DictionaryItemModel *newmo
     if (smodel == newmodel)
         return;
 
+    clearCache();
+
     if (smodel != nullptr)
     {
         disconnect(smodel, nullptr, this, nullptr);
@@ -325,6 +348,8 @@ void DictionarySearchFilterProxyModel::sourceDataChanged(const QModelIndex &sour
         throw "Invalid range.";
 #endif
 
+    clearCache();
+
     if (sourceModel() == nullptr || !source_top_left.isValid() || !source_bottom_right.isValid())
         return;
 
@@ -640,6 +665,7 @@ void DictionarySearchFilterProxyModel::sourceAboutToBeReset()
 
 void DictionarySearchFilterProxyModel::sourceReset()
 {
+    clearCache();
     fillLists(sourceModel());
     endResetModel();
 }
@@ -658,6 +684,8 @@ void DictionarySearchFilterProxyModel::sourceRowsInserted(const smartvector<Inte
     if (sourceModel() == nullptr || intervals.empty())
         return;
 
+    clearCache();
+
     int insertcnt = _intervalSize(intervals);
 
     bool filtering = !ssearchstr.isEmpty() || !condEmpty();
@@ -1133,6 +1161,8 @@ void DictionarySearchFilterProxyModel::sourceRowsRemoved(const smartvector<Range
     if (sourceModel() == nullptr || ranges.empty())
         return;
 
+    clearCache();
+
     //int removed = end - start + 1;
     int removedcnt = _rangeSize(ranges);
 
@@ -1360,6 +1390,8 @@ void DictionarySearchFilterProxyModel::sourceRowsMoved(const smartvector<Range>
     if (sourceModel() == nullptr || ranges.empty())
         return;
 
+    clearCache();
+
     bool filtering = !ssearchstr.isEmpty() || !condEmpty();
     if (!filtering && !sortfunc)
     {
@@ -1613,6 +1645,7 @@ void DictionarySearchFilterProxyModel::sourceLayoutAboutToBeChanged(const QList<
 
 void DictionarySearchFilterProxyModel::sourceLayoutChanged(const QList<QPersistentModelIndex> &/*parents*/, QAbstractItemModel::LayoutChangeHint hint)
 {
+    clearCache();
     fillLists(sourceModel());
 
     QModelIndexList destindexes;
@@ -1633,6 +1666,8 @@ void DictionarySearchFilterProxyModel::sourceStatusChanged()
 
 void DictionarySearchFilterProxyModel::filterMoved(int index, int to)
 {
+    clearCache();
+
     if (!scond)
         return;
 
@@ -1669,7 +1704,172 @@ bool DictionarySearchFilterProxyModel::condEmpty() const
     return !scond || !*scond;
 }
 
-void DictionarySearchFilterProxyModel::fillLists(DictionaryItemModel *source)
+namespace
+{
+    // Returns whether every string matched by search with the wildcards is also matched by
+    // prev.
+    bool searchContained(const QString &prev, const QString &search, SearchWildcards wildcards)
+    {
+        if (prev == search)
+            return true;
+
+        bool before = wildcards.testFlag(SearchWildcard::AnyBefore);
+        bool after = wildcards.testFlag(SearchWildcard::AnyAfter);
+        if (before && after)
+            return search.contains(prev);
+        if (after)
+            return search.startsWith(prev);
+        if (before)
+            return search.endsWith(prev);
+        return false;
+    }
+
+    // Returns whether the Japanese search string contains characters that make
+    // Dictionary::findWords() search in the written form of words.
+    bool kanjiSearch(const QString &str)
+    {
+        for (int ix = 0, siz = str.size(); ix != siz; ++ix)
+        {
+            ushort ch = str.at(ix).unicode();
+            if (VALIDCODE(ch) || KANJI(ch))
+                return true;
+        }
+        return false;
+    }
+}
+
+bool DictionarySearchFilterProxyModel::cacheable() const
+{
+    return condEmpty() || (scond->groups == Inclusion::Ignore && scond->examples == Inclusion::Ignore);
+}
+
+bool DictionarySearchFilterProxyModel::narrowsSearch(SearchMode mode, const QString &searchstr, SearchWildcards wildcards, bool strict, bool inflections, bool studydefs, WordFilterConditions *cond) const
+{
+    if (sourceModel() == nullptr || !cacheable() || smode != mode || swildcards != wildcards || sstrict != strict || sinflections != inflections || sstudydefs != studydefs)
+        return false;
+
+    // Every condition of the previous search must be kept.
+    if (!condEmpty())
+    {
+        if (cond == nullptr)
+            return false;
+        for (int ix = 0, siz = tosigned(scond->inclusions.size()); ix != siz; ++ix)
+            if (scond->inclusions[ix] != Inclusion::Ignore && (ix >= tosigned(cond->inclusions.size()) || cond->inclusions[ix] != scond->inclusions[ix]))
+                return false;
+    }
+
+    if (ssearchstr.isEmpty())
+        return true;
+    if (searchstr.isEmpty())
+        return false;
+
+    QString prev = ssearchstr;
+    QString search = searchstr;
+
+    if (mode == SearchMode::Japanese)
+    {
+        // Deinflected forms of the longer string are not related to the previous ones.
+        if (inflections)
+            return false;
+
+        // Same as in Dictionary::findWords(), characters that are not Japanese are ignored.
+        for (int ix = prev.size() - 1; ix != -1; --ix)
+            if (!JAPAN(prev.at(ix).unicode()))
+                prev.remove(ix, 1);
+        for (int ix = search.size() - 1; ix != -1; --ix)
+            if (!JAPAN(search.at(ix).unicode()))
+                search.remove(ix, 1);
+
+        // Nothing was found with an empty search string.
+        if (prev.isEmpty())
+            return search.isEmpty();
+        if (search.isEmpty() || prev == search)
+            return true;
+
+        if (kanjiSearch(prev) != kanjiSearch(search) || !searchContained(prev, search, wildcards))
+            return false;
+
+        // Kana is matched in its romanized form as well.
+        return searchContained(romanize(prev), romanize(search), wildcards);
+    }
+
+    if (mode == SearchMode::Definition)
+    {
+        if (!strict)
+        {
+            prev = prev.toLower();
+            search = search.toLower();
+        }
+        // Only words at the start of a definition word are matched without exact matching.
+        return searchContained(prev, search, wildcards & SearchWildcard::AnyAfter);
+    }
+
+    return false;
+}
+
+void DictionarySearchFilterProxyModel::cacheLists()
+{
+    // Results of no filtering are quick to get again.
+    if ((ssearchstr.isEmpty() && condEmpty()) || !cacheable())
+        return;
+
+    // Number of results kept.
+    const int cachesize = 8;
+
+    CachedFilter c;
+    if (scond)
+        c.cond.reset(new WordFilterConditions(*scond));
+    c.mode = smode;
+    c.searchstr = ssearchstr;
+    c.wildcards = swildcards;
+    c.strict = sstrict;
+    c.inflections = sinflections;
+    c.studydefs = sstudydefs;
+
+    c.list.reserve(list.size());
+    for (const auto &p : list)
+        c.list.emplace_back(p.first, p.second != nullptr ? *p.second : InfVector());
+    std::sort(c.list.begin(), c.list.end(), [](const std::pair<int, InfVector> &a, const std::pair<int, InfVector> &b) { return a.first < b.first; });
+
+    cache.push_front(std::move(c));
+    if (tosigned(cache.size()) > cachesize)
+        cache.pop_back();
+}
+
+bool DictionarySearchFilterProxyModel::restoreLists()
+{
+    if (!cacheable())
+        return false;
+
+    auto it = std::find_if(cache.begin(), cache.end(), [this](const CachedFilter &c) {
+        return c.mode == smode && c.wildcards == swildcards && c.strict == sstrict && c.inflections == sinflections && c.studydefs == sstudydefs &&
+            ((!c.cond && !scond) || (!c.cond == !scond && *c.cond == *scond)) && c.searchstr == ssearchstr;
+    });
+    if (it == cache.end())
+        return false;
+
+    // Keep the most recently used results first.
+    cache.splice(cache.begin(), cache, it);
+
+    for (auto p : list)
+        delete p.second;
+
+    sortfunc = preparedsortfunc;
+    std::vector<std::pair<int, InfVector*>>().swap(list);
+    list.reserve(it->list.size());
+    for (const auto &p : it->list)
+        list.emplace_back(p.first, p.second.empty() ? nullptr : new InfVector(p.second));
+
+    sortLists(sourceModel());
+    return true;
+}
+
+void DictionarySearchFilterProxyModel::clearCache()
+{
+    cache.clear();
+}
+
+void DictionarySearchFilterProxyModel::fillLists(DictionaryItemModel *source, const std::vector<int> *rows)
 {
     for (auto p : list)
         delete p.second;
@@ -1694,11 +1894,12 @@ void DictionarySearchFilterProxyModel::fillLists(DictionaryItemModel *source)
         wfilter.reserve(cnt);
         // [word index, source model index]
         std::vector<std::pair<int, int>> worder;
-        for (int ix = 0; ix != cnt; ++ix)
+        for (int ix = 0, siz = rows != nullptr ? tosigned(rows->size()) : cnt; ix != siz; ++ix)
         {
-            int windex = source->indexes(ix);
+            int row = rows != nullptr ? (*rows)[ix] : ix;
+            int windex = source->indexes(row);
             wfilter.push_back(windex);
-            worder.emplace_back(windex, ix);
+            worder.emplace_back(windex, row);
         }
         std::sort(worder.begin(), worder.end(), [](const std::pair<int, int> &a, const std::pair<int, int> &b) { 
             if (a.first != b.first)
@@ -1777,6 +1978,11 @@ void DictionarySearchFilterProxyModel::fillLists(DictionaryItemModel *source)
             std::sort(list.begin(), list.end(), [](const std::pair<int, InfVector*> &a, const std::pair<int, InfVector*> &b) { return a.first < b.first; });
     }
 
+    sortLists(source);
+}
+
+void DictionarySearchFilterProxyModel::sortLists(DictionaryItemModel *source)
+{
     // Rebuilding srclist.
     srclist.resize(list.size());
     for (int ix = 0, siz = tosigned(list.size()); ix != siz; ++ix)
@@ -9,6 +9,7 @@
 
 #include <functional>
 #include <memory>
+#include <list>
 #include "zabstracttablemodel.h"
 #include "smartvector.h"
 
@@ -45,6 +46,9 @@ public:
     //void setFilterList(WordResultList &&filter);
 
     // Filters the source model according to the given dictionary search filter conditions.
+    // When the new search can only match a subset of the words matched by the previous one,
+    // for example when the search string was extended, only the previous results are checked.
+    // The results of the last few searches are kept until the source model changes.
     void filter(SearchMode mode, QString searchstr, SearchWildcards wildcards, bool strict, bool inflections, bool studydefs, WordFilterConditions *cond);
 
     // Sorts the source model by the given parameters using the passed function. Changing the
@@ -107,8 +111,27 @@ private:
 
     bool condEmpty() const;
     // Rebuilds list and infs from the passed model. Model should match the current
-    // sourceModel() or the model which is about to be set as sourceModel().
-    void fillLists(DictionaryItemModel *model);
+    // sourceModel() or the model which is about to be set as sourceModel(). If rows is not
+    // null, only the source model rows listed in it are checked for a match.
+    void fillLists(DictionaryItemModel *model, const std::vector<int> *rows = nullptr);
+    // Sorts list with the current sort function and rebuilds srclist.
+    void sortLists(DictionaryItemModel *model);
+
+    // Returns whether the results of the saved search parameters can be cached or narrowed
+    // down. Words in groups and words with examples change without a signal from the source
+    // model, so results filtered by them are always looked up again.
+    bool cacheable() const;
+    // Returns whether searching with the passed parameters can only find words that are
+    // found by the saved search parameters.
+    bool narrowsSearch(SearchMode mode, const QString &searchstr, SearchWildcards wildcards, bool strict, bool inflections, bool studydefs, WordFilterConditions *cond) const;
+
+    // Adds the current list to the cached results with the saved search parameters.
+    void cacheLists();
+    // Fills list from the cached results of the saved search parameters. Returns false if
+    // they are not cached.
+    bool restoreLists();
+    // Removes every cached result when the source model changed.
+    void clearCache();
 
     // [Source model index, Inflection types] Mapping from this model to the source model. The list
     // may be sorted by a sorting function.
@@ -130,6 +153,24 @@ private:
     bool sinflections;
     bool sstudydefs;
 
+    // Results of a previous filtering with the search parameters.
+    struct CachedFilter
+    {
+        std::unique_ptr<WordFilterConditions> cond;
+        SearchMode mode;
+        QString searchstr;
+        SearchWildcards wildcards;
+        bool strict;
+        bool inflections;
+        bool studydefs;
+
+        // [Source model index, Inflection types] The inflection types are empty for items
+        // without inflections.
+        std::vector<std::pair<int, InfVector>> list;
+    };
+    // Results of the most recent searches, the last one first.
+    std::list<CachedFilter> cache;
+
     int sortcolumn;
     Qt::SortOrder sortorder;
     ProxySortFunction sortfunc;
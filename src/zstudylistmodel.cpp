@@ -956,6 +956,12 @@ void StudyListModel::entryRemoved(int /*windex*/, int /*abcdeindex*/, int /*aiue
     //emit dataChanged(base::index(0, 0), base::index(list.size(), 0), { Qt::DisplayRole });
 }
 
+void StudyListModel::entriesCompacted(const std::vector<int> &/*changes*/)
+{
+    // The list holds positions in the deck, which are not changed.
+    ;
+}
+
 void StudyListModel::entryChanged(int windex, bool /*studydef*/)
 {
     // There can be multiple versions of the same item in the queue. The whole lists must be
@@ -113,6 +113,7 @@ protected:
     virtual void setColumnTexts() override;
 protected slots:;
     virtual void entryRemoved(int windex, int abcdeindex, int aiueoindex) override;
+    virtual void entriesCompacted(const std::vector<int> &changes) override;
     virtual void entryChanged(int windex, bool studydef) override;
     virtual void entryAdded(int windex) override;
 private slots:
@@ -756,6 +756,11 @@ QDate ltDay(const QDateTime &d)
     return DateTimeFunctions::getLTDay(d);
 }
 
+qint64 ltDayStart(QDate day)
+{
+    return day.startOfDay().toMSecsSinceEpoch() + 1000 * 60 * 60 * Settings::study.starthour;
+}
+
 
 //QImage* makeImageFromSvg(QImage* &img, QString svgpath, int width, int height)
 //{
@@ -210,6 +210,10 @@ QString fixFormatNextDate(const QDateTime &d);
 // subtracting hours from it. Beware that the time part is not cleared, though its value
 // becomes unusable.
 QDate ltDay(const QDateTime &d);
+// Returns the first moment of a day of the long-term study list in milliseconds since the
+// epoch. The result of ltDay() is day for every date time from this moment until the start
+// of the next day.
+qint64 ltDayStart(QDate day);
 
 
 // Pass an image pointer and a path to an SVG file (usually resource.) If the